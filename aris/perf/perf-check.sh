@@ -0,0 +1,121 @@
+#!/bin/sh
+# Compares the evaluation of a corpus of proofs with a baseline.
+
+#  Copyright (C) 2012 Ian Dunn.
+
+#  This program is free software: you can redistribute it and/or modify
+#  it under the terms of the GNU General Public License as published by
+#  the Free Software Foundation, either version 3 of the License, or
+#  (at your option) any later version.
+
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+
+#  You should have received a copy of the GNU General Public License
+#  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# Usage: perf-check.sh ARIS BASELINE RUNS THRESHOLD FILE...
+#    or: perf-check.sh --update ARIS BASELINE RUNS FILE...
+#
+# Each FILE is evaluated RUNS times by ARIS.  The median time and the
+# most bytes allocated at once by the evaluation of each are compared
+# with those of BASELINE, and the check fails if either grew by more
+# than THRESHOLD percent.  The files of the corpus each take about a
+# tenth of a second, so that the noise of a run is well within
+# THRESHOLD.  The largest resident size of each process is printed as
+# well, but isn't checked, since most of it is the program and its
+# libraries.  With --update, BASELINE is written instead.
+
+update=no
+if test "x$1" = "x--update"; then
+  update=yes
+  shift
+fi
+
+aris=$1
+baseline=$2
+runs=$3
+shift 3
+
+if test $update = no; then
+  threshold=$1
+  shift
+  if test ! -f "$baseline"; then
+    echo "perf-check: no baseline $baseline; run 'make perf-baseline'" >&2
+    exit 1
+  fi
+fi
+
+# Gets a number from a line of JSON.
+#  $1 - the line.
+#  $2 - the name of the number.
+get_num ()
+{
+  echo "$1" | sed -n "s/.*\"$2\":\([0-9.]*\).*/\1/p"
+}
+
+status=0
+results=
+
+for file in "$@"; do
+  name=`basename "$file"`
+
+  out=`"$aris" -e --bench="$runs" -f "$file"` || {
+    echo "perf-check: $name: evaluation failed" >&2
+    exit 1
+  }
+
+  time=`get_num "$out" time`
+  peak=`get_num "$out" peak`
+  rss=`get_num "$out" max_rss`
+  line="{\"file\":\"$name\",\"runs\":$runs,\"time\":$time,\"peak\":$peak,\"max_rss\":$rss}"
+
+  if test $update = yes; then
+    results="$results$line
+"
+    echo "$name: $time s, $peak bytes, $rss KB max RSS"
+    continue
+  fi
+
+  base=`grep "\"file\":\"$name\"" "$baseline"`
+  if test -z "$base"; then
+    echo "$name: $time s, $peak bytes, $rss KB max RSS (not in the baseline)"
+    continue
+  fi
+
+  base_time=`get_num "$base" time`
+  base_peak=`get_num "$base" peak`
+
+  verdict=`awk -v t="$time" -v bt="$base_time" -v p="$peak" \
+	       -v bp="$base_peak" -v th="$threshold" '
+    BEGIN {
+      v = "ok";
+      if (t > bt * (1 + th / 100))
+	v = "SLOWER";
+      if (bp > 0 && p > bp * (1 + th / 100))
+	v = (v == "ok") ? "LARGER" : v " LARGER";
+      print v;
+    }'`
+
+  echo "$name: $time s (baseline $base_time s), $peak bytes (baseline $base_peak bytes), $rss KB max RSS: $verdict"
+  if test "$verdict" != ok; then
+    status=1
+  fi
+done
+
+if test $update = yes; then
+  {
+    echo "["
+    printf "%s" "$results" | sed '$!s/$/,/'
+    echo "]"
+  } > "$baseline"
+  exit 0
+fi
+
+if test $status != 0; then
+  echo "perf-check: the evaluation regressed by more than $threshold%" >&2
+fi
+
+exit $status
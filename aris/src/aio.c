@@ -33,6 +33,9 @@
 #include "rules.h"
 #include "process.h"
 
+#define MEM_SUBSYSTEM MEM_IO
+#include "mem.h"
+
 #define XML_ERR(r) {fprintf (stderr, "XML Error\n"); return r;}
 #define PRINT_LINE() {printf ("%i\n", __LINE__);}
 
@@ -669,6 +672,7 @@ aio_open (const char * file_name)
 	      rule = -1;
 	      sen_depth = 0;
 	      file = text = NULL;
+	      refs = NULL;
 
 	      attrs = xmlTextReaderAttributeCount (xml);
 	      if (attrs < 0)
@@ -740,7 +744,7 @@ aio_open (const char * file_name)
 			  num_refs ++;
 
 		      num_refs++;
-		      refs = (int *) calloc (num_refs, sizeof (int));
+		      refs = (int *) calloc (num_refs + 1, sizeof (int));
 		      CHECK_ALLOC (refs, NULL);
 
 		      int old_i = -1, k = 0;
@@ -763,12 +767,10 @@ aio_open (const char * file_name)
 
 		      ret = sscanf ((const char *) buffer + old_i + 1,
 				    "%i", &(refs[k]));
-		      if (ret < 0 && ret != EOF)
-			{
-			  XML_ERR (NULL);
-			}
+		      if (ret == 1)
+			k++;
 
-		      refs[k+1] = -1;
+		      refs[k] = -1;
 
 		      got_refs = 1;
 		      continue;
@@ -816,6 +818,13 @@ aio_open (const char * file_name)
 	      if (name)  free (name);
 	      name = NULL;
 
+	      if (!refs)
+		{
+		  refs = (int *) calloc (1, sizeof (int));
+		  CHECK_ALLOC (refs, NULL);
+		  refs[0] = -1;
+		}
+
 	      int sub = 0, old_depth;
 	      old_depth = ((sen_data *) proof->everything->tail->value)->depth;
 	      if (sen_depth > old_depth)
@@ -26,6 +26,9 @@
 #include "goal.h"
 #include "sen-parent.h"
 
+#define MEM_SUBSYSTEM MEM_GUI
+#include "mem.h"
+
 /* Initializes an app structure.
  *  input:
  *    boolean - the boolean flag from the cmd line args.
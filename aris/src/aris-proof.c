@@ -33,11 +33,23 @@
 #include "goal.h"
 #include "callbacks.h"
 #include "list.h"
+#include "hash.h"
+#include "eval-job.h"
+#include "subproof.h"
 #include "process.h"
 #include "sexpr-process.h"
+#include "history.h"
+#include "vec.h"
+
+#define MEM_SUBSYSTEM MEM_GUI
+#include "mem.h"
 
 #define SUBPROOFS_DISABLED 0
 
+static int aris_proof_history_init (aris_proof * ap);
+static int aris_proof_history_insert (aris_proof * ap, sentence * sen);
+static int aris_proof_history_remove (aris_proof * ap, sentence * sen);
+
 /* Menu Data Arrays */
 
 enum MENU_ORDER {
@@ -52,8 +64,8 @@ enum MENU_ORDER {
 
 enum MENU_SIZE {
   FILE_MENU_SIZE = 8,
-  EDIT_MENU_SIZE = 8,
-  PROOF_MENU_SIZE = 5,
+  EDIT_MENU_SIZE = 11,
+  PROOF_MENU_SIZE = 6,
   RULES_MENU_SIZE = 2,
   FONT_MENU_SIZE = 4,
   HELP_MENU_SIZE = 2
@@ -101,7 +113,10 @@ static mid_t edit_text[EDIT_MENU_SIZE] =
     {NULL, NULL, NULL, -1, -1, SEPARATOR, -1},
     {N_("Copy Line"), N_("Copy the current line in the current proof."), GTK_STOCK_COPY, GDK_KEY_g, GDK_CONTROL_MASK, STANDARD, MENU_COPY},
     {N_("Kill Line"), N_("Kill (Cut) the current line in the current proof."), GTK_STOCK_CUT, GDK_KEY_k, GDK_CONTROL_MASK, STANDARD, MENU_KILL},
-    {N_("Insert Line"), N_("Insert a copied/killed line after the current line in the current proof."), GTK_STOCK_PASTE, GDK_KEY_i, GDK_CONTROL_MASK, STANDARD, MENU_INSERT}
+    {N_("Insert Line"), N_("Insert a copied/killed line after the current line in the current proof."), GTK_STOCK_PASTE, GDK_KEY_i, GDK_CONTROL_MASK, STANDARD, MENU_INSERT},
+    {NULL, NULL, NULL, -1, -1, SEPARATOR, -1},
+    {N_("Undo"), N_("Undo the last edit of the current proof."), GTK_STOCK_UNDO, GDK_KEY_z, GDK_CONTROL_MASK, STANDARD, MENU_UNDO},
+    {N_("Redo"), N_("Redo the last undone edit of the current proof."), GTK_STOCK_REDO, GDK_KEY_y, GDK_CONTROL_MASK, STANDARD, MENU_REDO}
   };
 
 // The proof menu array.
@@ -110,6 +125,7 @@ static mid_t proof_text[PROOF_MENU_SIZE] =
   {
     {N_("Evaluate Line"), N_("Evaluate the current line in the current proof."), GTK_STOCK_EXECUTE, GDK_KEY_e, GDK_CONTROL_MASK, STANDARD, MENU_EVAL_LINE},
     {N_("Evaluate Proof"), N_("Evaluate the current proof."), GTK_STOCK_SELECT_ALL, GDK_KEY_f, GDK_CONTROL_MASK, STANDARD, MENU_EVAL_PROOF},
+    {N_("Infer Rules"), N_("Find the rules that accept the current line."), GTK_STOCK_FIND, GDK_KEY_e, GDK_CONTROL_MASK | GDK_SHIFT_MASK, STANDARD, MENU_INFER_RULES},
     {NULL, NULL, NULL, -1, -1, SEPARATOR, -1},
     {N_("Goal..."), N_("Check/Modify the current goal(s) for the current proof."), GTK_STOCK_INDEX, GDK_KEY_l, GDK_CONTROL_MASK,  STANDARD, MENU_GOAL},
     {N_("Toggle Boolean Mode"), N_("Toggle Boolean mode for the current proof."), GTK_STOCK_CONVERT, GDK_KEY_m, GDK_CONTROL_MASK, STANDARD, MENU_BOOLEAN}
@@ -158,10 +174,6 @@ aris_proof_init ()
   ap = (aris_proof *) calloc (1, sizeof (aris_proof));
   CHECK_ALLOC (ap, NULL);
 
-  ap->vars = init_list ();
-  if (!ap->vars)
-    return NULL;
-
   sen_parent_init (SEN_PARENT (ap), _("GNU Aris - Untitled"),
 		   640, 320, aris_proof_create_menu, SEN_PARENT_TYPE_PROOF);
 
@@ -195,6 +207,22 @@ aris_proof_init ()
   if (!ap->selected)
     return NULL;
 
+  ap->index = init_hash (0);
+  if (!ap->index)
+    return NULL;
+
+  ap->index_dirty = init_list ();
+  if (!ap->index_dirty)
+    return NULL;
+
+  ap->subproofs = subproof_tree_init ();
+  if (!ap->subproofs)
+    return NULL;
+
+  ap->hist_dirty = init_list ();
+  if (!ap->hist_dirty)
+    return NULL;
+
   aris_proof_set_sb (ap, _("Ready"));
 
   int ret;
@@ -207,6 +235,10 @@ aris_proof_init ()
   if (!ap->goal)
     return NULL;
 
+  ret = aris_proof_history_init (ap);
+  if (ret < 0)
+    return NULL;
+
   aris_proof_set_font (ap, FONT_TYPE_SMALL);
 
   g_signal_connect (G_OBJECT (SEN_PARENT (ap)->window), "delete-event",
@@ -228,7 +260,6 @@ int
 aris_proof_post_init (aris_proof * ap)
 {
   sen_data * sd;
-  sentence * sen;
 
   // Initialize the separator
   SEN_PARENT (ap)->separator = gtk_hseparator_new ();
@@ -237,22 +268,14 @@ aris_proof_post_init (aris_proof * ap)
   if (!sd)
     return -1;
 
-  sen = sentence_init (sd, (sen_parent *) ap, NULL);
-  if (!sen)
-    return -1;
-
   gtk_box_pack_start (GTK_BOX (SEN_PARENT (ap)->container),
-		      sen->panel, FALSE, FALSE, 0);
+		      SEN_PARENT (ap)->separator, FALSE, FALSE, 0);
 
-  item_t * itm = ls_ins_obj (SEN_PARENT (ap)->everything, sen,
-			     SEN_PARENT (ap)->everything->head);
+  item_t * itm = sen_parent_ins_sentence (SEN_PARENT (ap), sd, NULL);
   if (!itm)
     return -1;
 
-  ap->fin_prem = SEN_PARENT (ap)->focused = SEN_PARENT (ap)->everything->head;
-
-  gtk_box_pack_start (GTK_BOX (SEN_PARENT (ap)->container),
-		      SEN_PARENT (ap)->separator, FALSE, FALSE, 0);
+  ap->fin_prem = itm;
 
   return 0;
 }
@@ -270,10 +293,6 @@ aris_proof_init_from_proof (proof_t * proof)
   ap = (aris_proof *) calloc (1, sizeof (aris_proof));
   CHECK_ALLOC (ap, NULL);
 
-  ap->vars = init_list ();
-  if (!ap->vars)
-    return NULL;
-
   sen_parent_init (SEN_PARENT (ap), _("GNU Aris - "),
 		   640, 320, aris_proof_create_menu, SEN_PARENT_TYPE_PROOF);
 
@@ -284,6 +303,22 @@ aris_proof_init_from_proof (proof_t * proof)
   if (!ap->selected)
     return NULL;
 
+  ap->index = init_hash (proof->everything->num_stuff);
+  if (!ap->index)
+    return NULL;
+
+  ap->index_dirty = init_list ();
+  if (!ap->index_dirty)
+    return NULL;
+
+  ap->subproofs = subproof_tree_init ();
+  if (!ap->subproofs)
+    return NULL;
+
+  ap->hist_dirty = init_list ();
+  if (!ap->hist_dirty)
+    return NULL;
+
   if (ap->boolean || SUBPROOFS_DISABLED)
     {
       GList * gl;
@@ -327,14 +362,16 @@ aris_proof_init_from_proof (proof_t * proof)
       if (first == 1)
 	{
 	  SEN_PARENT (ap)->separator = gtk_hseparator_new ();
-	  item_t * itm;
+	  gtk_box_pack_start (GTK_BOX (SEN_PARENT (ap)->container),
+			      SEN_PARENT (ap)->separator, FALSE, FALSE, 0);
 
-	  itm = sen_parent_ins_sentence ((sen_parent *) ap, sd, NULL, 0);
+	  item_t * itm;
 
-	  ap->fin_prem = SEN_PARENT (ap)->focused = SEN_PARENT (ap)->everything->head;
+	  itm = sen_parent_ins_sentence ((sen_parent *) ap, sd, NULL);
+	  if (!itm)
+	    return NULL;
 
-	  gtk_box_pack_start (GTK_BOX (SEN_PARENT (ap)->container),
-			      SEN_PARENT (ap)->separator, FALSE, FALSE, 0);
+	  ap->fin_prem = itm;
 	  first = 0;
 	}
       else
@@ -351,8 +388,11 @@ aris_proof_init_from_proof (proof_t * proof)
   if (!ap->goal)
     return NULL;
 
+  if (aris_proof_history_init (ap) < 0)
+    return NULL;
+
   gtk_widget_show_all (SEN_PARENT (ap)->window);
-  gtk_widget_grab_focus (((sentence *) SEN_PARENT (ap)->everything->head->value)->entry);
+  sen_parent_set_focus (SEN_PARENT (ap), SEN_PARENT (ap)->everything->head);
 
   return ap;
 }
@@ -366,6 +406,8 @@ aris_proof_init_from_proof (proof_t * proof)
 void
 aris_proof_destroy (aris_proof * ap)
 {
+  eval_job_cancel (ap);
+
   if (ap->yanked)
     {
       item_t * yank_itr;
@@ -383,23 +425,6 @@ aris_proof_destroy (aris_proof * ap)
   ap->fin_prem = NULL;
   ap->sb_text = NULL;
 
-  item_t * var_itr, * n_var_itr;
-  var_itr = ap->vars->head;
-
-  for (var_itr = ap->vars->head; var_itr != NULL; var_itr = n_var_itr)
-    {
-      n_var_itr = var_itr->next;
-      if (((variable *) var_itr->value)->text)
-	free (((variable *) var_itr->value)->text);
-
-      free (var_itr->value);
-      var_itr->value = var_itr->next = var_itr->prev = NULL;
-      free (var_itr);
-    }
-
-  free (ap->vars);
-  ap->vars = NULL;
-
   goal_destroy (ap->goal);
   if (ap->selected)
     {
@@ -408,6 +433,25 @@ aris_proof_destroy (aris_proof * ap)
     }
 
   sen_parent_destroy ((sen_parent *) SEN_PARENT (ap));
+
+  destroy_hash (ap->index);
+  ap->index = NULL;
+
+  destroy_list (ap->index_dirty);
+  ap->index_dirty = NULL;
+
+  subproof_tree_destroy (ap->subproofs);
+  ap->subproofs = NULL;
+
+  if (ap->history)
+    history_destroy (ap->history);
+  ap->history = NULL;
+
+  history_seq_release (ap->hist_seq);
+  ap->hist_seq = NULL;
+
+  destroy_list (ap->hist_dirty);
+  ap->hist_dirty = NULL;
 }
 
 /* Creates the menu of an aris proof - used in sen_parent_init.
@@ -454,6 +498,10 @@ aris_proof_set_changed (aris_proof * ap, int changed)
   const char * title = gtk_window_get_title (GTK_WINDOW (SEN_PARENT (ap)->window));
   int pos = 0;
 
+  // Any evaluation in progress is now out of date.
+  if (changed)
+    eval_job_cancel (ap);
+
   new_title = (char *) calloc (strlen (title) + 4, sizeof (char));
   CHECK_ALLOC (new_title, -1);
   pos = sprintf (new_title, "%s", title);
@@ -473,42 +521,48 @@ aris_proof_set_changed (aris_proof * ap, int changed)
   return 0;
 }
 
-/* Adjusts the line number of each sentence in an aris proof.
+/* Adjusts the line numbers of an aris proof after a line is inserted or
+ *  removed.  Lines are numbered by their positions, so only the labels of
+ *  the shown lines change, once the proof is laid out again.
  *  input:
  *    ap - the aris proof to adjust the line numbers of.
- *    itm - the iterator in ap->everything to begin at.
- *    mod - modifier for each sentence, either 1 or -1.
  *  output:
  *    0 on success, -1 on error.
  */
 int
-aris_proof_adjust_lines (aris_proof * ap, item_t * itm, int mod)
+aris_proof_adjust_lines (aris_proof * ap)
 {
-  int line_mod = 1;
-  line_mod *= mod;
+  // The lines of any evaluation in progress no longer match.
+  eval_job_cancel (ap);
+
+  sen_parent_queue_layout (SEN_PARENT (ap));
 
-  int cur_line = ((sentence *) itm->value)->line_num;
+  return 0;
+}
+
+/* Builds the subproof tree of an aris proof from its sentences.
+ *  input:
+ *    ap - the aris proof.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+static int
+aris_proof_build_subproofs (aris_proof * ap)
+{
   item_t * ev_itr;
+  int ret, line_num = 1;
+
+  subproof_tree_clear (ap->subproofs);
 
-  for (ev_itr = itm->next; ev_itr; ev_itr = ev_itr->next)
+  for (ev_itr = SEN_PARENT (ap)->everything->head; ev_itr;
+       ev_itr = ev_itr->next, line_num++)
     {
-      int new_line_no, ret;
-      sentence * ev_sen;
+      sentence * sen = ev_itr->value;
 
-      ev_sen = ev_itr->value;
-      new_line_no = ev_sen->line_num + line_mod;
-      ret = sentence_set_line_no (ev_sen, new_line_no);
-      if (ret == -1)
+      ret = subproof_tree_insert (ap->subproofs, line_num, sen->depth,
+				  sen->subproof);
+      if (ret < 0)
 	return -1;
-
-      int i;
-      for (i = 0; i < ev_sen->depth; i++)
-	{
-	  // Check if any index is greater than or equal to
-	  // the new item's line number.
-	  if (ev_sen->indices[i] >= cur_line)
-	    ev_sen->indices[i] = ev_sen->indices[i] + line_mod;
-	}
     }
 
   return 0;
@@ -535,7 +589,12 @@ aris_proof_to_proof (aris_proof * ap)
   for (g_itr = ap->goal->goals->head; g_itr; g_itr = g_itr->next)
     {
       sen = g_itr->value;
-      unsigned char * entry_text = sen->text;
+      unsigned char * entry_text;
+
+      entry_text = (unsigned char *) calloc (strlen (sen->text) + 1,
+					     sizeof (char));
+      CHECK_ALLOC (entry_text, NULL);
+      strcpy (entry_text, sen->text);
 
       itm = ls_ins_obj (proof->goals, entry_text, proof->goals->tail);
       if (!itm)
@@ -572,7 +631,6 @@ aris_proof_create_sentence (aris_proof * ap, sen_data * sd)
   sentence * sen;
   item_t * itm, * fcs;
   item_t * foc_1, * foc_2;
-  int new_order;
 
   // Is the new sentence a premise?
 
@@ -589,9 +647,6 @@ aris_proof_create_sentence (aris_proof * ap, sen_data * sd)
 
   fcs = (SENTENCE (SEN_PARENT (ap)->focused->value)->premise) ? foc_1 : foc_2;
 
-  new_order = SENTENCE (fcs->value)->line_num;
-  if (!sd->premise)  new_order++;
-
   if (sd->depth == -1)
     {
       sd->depth = ((sentence *) fcs->value)->depth - 1;
@@ -603,7 +658,7 @@ aris_proof_create_sentence (aris_proof * ap, sen_data * sd)
 	sd->depth++;
     }
 
-  itm = sen_parent_ins_sentence ((sen_parent *) ap, sd, fcs, new_order);
+  itm = sen_parent_ins_sentence ((sen_parent *) ap, sd, fcs);
   if (!itm)
     return NULL;
 
@@ -611,7 +666,21 @@ aris_proof_create_sentence (aris_proof * ap, sen_data * sd)
     ap->fin_prem = itm;
 
   int ret;
-  ret = aris_proof_adjust_lines (ap, itm, 1);
+  ret = aris_proof_adjust_lines (ap);
+  if (ret < 0)
+    return NULL;
+
+  sen = itm->value;
+
+  ret = subproof_tree_insert (ap->subproofs, sentence_get_line_no (sen),
+			      sen->depth,
+			      sen->subproof);
+  if (ret == 1)
+    ret = aris_proof_build_subproofs (ap);
+  if (ret < 0)
+    return NULL;
+
+  ret = aris_proof_history_insert (ap, sen);
   if (ret < 0)
     return NULL;
 
@@ -619,8 +688,6 @@ aris_proof_create_sentence (aris_proof * ap, sen_data * sd)
   if (ret < 0)
     return NULL;
 
-  sen = itm->value;
-  
   return sen;
 }
 
@@ -737,6 +804,11 @@ aris_proof_end_sub (aris_proof * ap)
 int
 aris_proof_remove_sentence (aris_proof * ap, sentence * sen)
 {
+  int line_num = sentence_get_line_no (sen);
+
+  if (aris_proof_history_remove (ap, sen) < 0)
+    return -1;
+
   item_t * target = sen_parent_rem_sentence ((sen_parent *) ap, sen);
   if (!target)
     return -1;
@@ -744,7 +816,13 @@ aris_proof_remove_sentence (aris_proof * ap, sentence * sen)
   if (ap->fin_prem == target)
     ap->fin_prem = SEN_PARENT (ap)->focused;
 
-  int ret = aris_proof_adjust_lines (ap, target, -1);
+  int ret = aris_proof_adjust_lines (ap);
+  if (ret < 0)
+    return -1;
+
+  ret = subproof_tree_remove (ap->subproofs, line_num);
+  if (ret == 1)
+    ret = aris_proof_build_subproofs (ap);
   if (ret < 0)
     return -1;
 
@@ -924,7 +1002,7 @@ aris_proof_kill (aris_proof * ap)
       sentence * sen;
       sen = start_itr->value;
 
-      if (sen->line_num == 1)
+      if (sentence_get_line_no (sen) == 1)
 	return 1;
     }
 
@@ -1040,3 +1118,639 @@ aris_proof_toggle_boolean_mode (aris_proof * ap)
 
   return 0;
 }
+
+/* Marks a sentence as changed, removing it from the index of an aris proof.
+ * It is indexed again the next time the index is searched.
+ *  input:
+ *    ap - the aris proof that contains the sentence.
+ *    sen - the sentence to mark.  Its sexpr must not have been changed yet.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+int
+aris_proof_index_mark (aris_proof * ap, sentence * sen)
+{
+  if (sen->indexed)
+    {
+      hash_rem_obj (ap->index, sen->sexpr, sen);
+      sen->indexed = 0;
+    }
+
+  if (!sen->index_dirty)
+    {
+      item_t * itm;
+      itm = ls_push_obj (ap->index_dirty, sen);
+      if (!itm)
+	return -1;
+
+      sen->index_dirty = 1;
+    }
+
+  return 0;
+}
+
+/* Removes a sentence from the index of an aris proof altogether.
+ *  input:
+ *    ap - the aris proof that contains the sentence.
+ *    sen - the sentence being removed.
+ *  output:
+ *    none.
+ */
+void
+aris_proof_index_remove (aris_proof * ap, sentence * sen)
+{
+  if (sen->indexed)
+    {
+      hash_rem_obj (ap->index, sen->sexpr, sen);
+      sen->indexed = 0;
+    }
+
+  if (sen->index_dirty)
+    {
+      ls_rem_obj_value (ap->index_dirty, sen);
+      sen->index_dirty = 0;
+    }
+}
+
+/* Indexes the sentences of an aris proof that have changed.
+ *  input:
+ *    ap - the aris proof to update the index of.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+static int
+aris_proof_index_flush (aris_proof * ap)
+{
+  while (ap->index_dirty->head)
+    {
+      sentence * sen;
+      int ret;
+
+      sen = ap->index_dirty->head->value;
+      ls_rem_obj (ap->index_dirty, ap->index_dirty->head);
+      sen->index_dirty = 0;
+
+      if (!sen->sexpr)
+	{
+	  if (sen->text[0] == '\0')
+	    continue;
+
+	  ret = text_to_sexpr (sen->text, &sen->sexpr);
+	  if (ret == -1)
+	    return -1;
+
+	  // Sentences with text errors can't match anything.
+	  if (ret != 0)
+	    continue;
+	}
+
+      if (!hash_add_obj (ap->index, sen->sexpr, sen))
+	return -1;
+
+      sen->indexed = 1;
+    }
+
+  return 0;
+}
+
+/* Finds the first sentence of an aris proof with a given sexpr.
+ *  input:
+ *    ap - the aris proof to search.
+ *    sexpr - the sexpr to search for.
+ *    sen - receives the sentence, or NULL if none was found.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+int
+aris_proof_find_sexpr (aris_proof * ap, unsigned char * sexpr,
+		       sentence ** sen)
+{
+  hash_entry_t * ent;
+  int ret;
+
+  *sen = NULL;
+
+  ret = aris_proof_index_flush (ap);
+  if (ret < 0)
+    return -1;
+
+  for (ent = hash_find (ap->index, sexpr); ent; ent = hash_find_next (ent))
+    {
+      sentence * ent_sen = ent->value;
+
+      if (!*sen
+	  || sentence_get_line_no (ent_sen) < sentence_get_line_no (*sen))
+	*sen = ent_sen;
+    }
+
+  return 0;
+}
+
+/* Makes a record of a sentence of an aris proof.
+ *  input:
+ *    sen - the sentence to make a record of.
+ *  output:
+ *    the record, with one reference, or NULL on memory error.
+ */
+static history_line_t *
+aris_proof_history_line (sentence * sen)
+{
+  item_t * ref_itr;
+  int * refs, i = 0;
+
+  refs = (int *) calloc (sen->refs->num_stuff + 1, sizeof (int));
+  CHECK_ALLOC (refs, NULL);
+
+  for (ref_itr = sen->refs->head; ref_itr; ref_itr = ref_itr->next)
+    refs[i++] = SENTENCE (ref_itr->value)->id;
+  refs[i] = -1;
+
+  return history_line_init (sen->id, sen->text, sen->sexpr, sen->file, refs,
+			    sen->rule, sen->premise ? 1 : 0,
+			    sen->subproof ? 1 : 0, sen->depth,
+			    sen->value_type);
+}
+
+/* Starts the history of an aris proof with a snapshot of its lines.
+ *  input:
+ *    ap - the aris proof.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+static int
+aris_proof_history_init (aris_proof * ap)
+{
+  item_t * ev_itr;
+  int ret;
+
+  ap->history = history_init (HISTORY_DEPTH);
+  if (!ap->history)
+    return -1;
+
+  ap->hist_seq = NULL;
+
+  for (ev_itr = SEN_PARENT (ap)->everything->head; ev_itr;
+       ev_itr = ev_itr->next)
+    {
+      sentence * sen = ev_itr->value;
+      history_line_t * line;
+
+      line = aris_proof_history_line (sen);
+      if (!line)
+	return -1;
+
+      ret = history_seq_insert (&ap->hist_seq,
+				sentence_get_line_no (sen) - 1, line);
+      history_line_release (line);
+      if (ret < 0)
+	return -1;
+
+      sen->hist = line;
+    }
+
+  return history_push (ap->history, ap->hist_seq);
+}
+
+/* Adds a new sentence of an aris proof to its current lines.
+ *  input:
+ *    ap - the aris proof.
+ *    sen - the sentence, with its line number already set.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+static int
+aris_proof_history_insert (aris_proof * ap, sentence * sen)
+{
+  history_line_t * line;
+  int ret;
+
+  // A snapshot being restored sets the lines once it is done.
+  if (!ap->history || ap->hist_restoring)
+    return 0;
+
+  line = aris_proof_history_line (sen);
+  if (!line)
+    return -1;
+
+  ret = history_seq_insert (&ap->hist_seq, sentence_get_line_no (sen) - 1,
+			    line);
+  history_line_release (line);
+  if (ret < 0)
+    return -1;
+
+  sen->hist = line;
+  ap->hist_edited = 1;
+
+  return 0;
+}
+
+/* Removes a sentence of an aris proof from its current lines.
+ *  input:
+ *    ap - the aris proof.
+ *    sen - the sentence, which is still in the proof.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+static int
+aris_proof_history_remove (aris_proof * ap, sentence * sen)
+{
+  item_t * ev_itr;
+  int ret;
+
+  if (sen->hist_dirty)
+    {
+      ls_rem_obj_value (ap->hist_dirty, sen);
+      sen->hist_dirty = 0;
+    }
+
+  if (!ap->history || ap->hist_restoring)
+    return 0;
+
+  // The sentences that refer to this one are about to lose a reference.
+  ev_itr = sen_parent_find (SEN_PARENT (ap), sen);
+  for (ev_itr = ev_itr->next; ev_itr; ev_itr = ev_itr->next)
+    {
+      sentence * ev_sen = ev_itr->value;
+
+      if (ls_find (ev_sen->refs, sen))
+	{
+	  ret = aris_proof_history_mark (ap, ev_sen, 1);
+	  if (ret < 0)
+	    return -1;
+	}
+    }
+
+  ret = history_seq_remove (&ap->hist_seq, sentence_get_line_no (sen) - 1);
+  if (ret < 0)
+    return -1;
+
+  ap->hist_edited = 1;
+
+  return 0;
+}
+
+/* Marks a sentence of an aris proof as changed since the last snapshot.
+ * It is recorded again when the next snapshot is taken, so an edit must
+ * be marked before it is made.
+ *  input:
+ *    ap - the aris proof that contains the sentence.
+ *    sen - the sentence that changed.
+ *    edit - 1 if the sentence was edited, 0 if only its value changed.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+int
+aris_proof_history_mark (aris_proof * ap, sentence * sen, int edit)
+{
+  if (!ap->history || ap->hist_restoring)
+    return 0;
+
+  // New values before an edit belong to the snapshot before it.
+  if (edit && !ap->hist_edited && ap->hist_dirty->head)
+    {
+      if (aris_proof_history_commit (ap) < 0)
+	return -1;
+    }
+
+  if (!sen->hist_dirty)
+    {
+      item_t * itm;
+      itm = ls_push_obj (ap->hist_dirty, sen);
+      if (!itm)
+	return -1;
+
+      sen->hist_dirty = 1;
+    }
+
+  if (edit)
+    ap->hist_edited = 1;
+
+  return 0;
+}
+
+/* Takes a snapshot of an aris proof, if it changed since the last one.
+ * If only the values of its lines changed, the last snapshot is replaced
+ * instead, so that an evaluation isn't a step of its own.
+ *  input:
+ *    ap - the aris proof.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+int
+aris_proof_history_commit (aris_proof * ap)
+{
+  int ret, edited;
+
+  if (!ap->history || ap->hist_restoring)
+    return 0;
+
+  while (ap->hist_dirty->head)
+    {
+      history_line_t * line;
+      sentence * sen;
+
+      sen = ap->hist_dirty->head->value;
+      ls_rem_obj (ap->hist_dirty, ap->hist_dirty->head);
+      sen->hist_dirty = 0;
+
+      line = aris_proof_history_line (sen);
+      if (!line)
+	return -1;
+
+      ret = history_seq_set (&ap->hist_seq, sentence_get_line_no (sen) - 1,
+			     line);
+      history_line_release (line);
+      if (ret < 0)
+	return -1;
+
+      sen->hist = line;
+    }
+
+  edited = ap->hist_edited;
+  ap->hist_edited = 0;
+
+  if (ap->hist_seq == ap->history->steps[ap->history->cur])
+    return 0;
+
+  if (!edited)
+    {
+      history_amend (ap->history, ap->hist_seq);
+      return 0;
+    }
+
+  return history_push (ap->history, ap->hist_seq);
+}
+
+/* Restores the lines of an aris proof from a snapshot.  Only the lines
+ * whose records differ from the snapshot are changed, and they get back
+ * their sexprs and values along with their text, so that nothing needs
+ * to be evaluated again.
+ *  input:
+ *    ap - the aris proof, whose changes have all been recorded.
+ *    seq - the snapshot to restore.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+static int
+aris_proof_history_restore (aris_proof * ap, history_seq_t * seq)
+{
+  vec_t * lines, * sens;
+  hash_t * ids;
+  item_t * ev_itr, * prev;
+  history_line_t * line;
+  sentence * sen;
+  char key[16];
+  int i, ret, first = -1;
+
+  lines = init_vec (sizeof (history_line_t *));
+  if (!lines)
+    return -1;
+
+  ret = history_seq_lines (seq, lines);
+  if (ret < 0)
+    return -1;
+
+  ids = init_hash (lines->num_stuff);
+  if (!ids)
+    return -1;
+
+  for (i = 0; i < lines->num_stuff; i++)
+    {
+      line = *((history_line_t **) vec_nth (lines, i));
+      sprintf (key, "%i", line->id);
+      if (!hash_add_obj (ids, (unsigned char *) key, vec_nth (lines, i)))
+	return -1;
+    }
+
+  ap->hist_restoring = 1;
+
+  while (ap->selected->head)
+    {
+      sentence_set_selected (ap->selected->head->value, 0);
+      ls_rem_obj (ap->selected, ap->selected->head);
+    }
+
+  sentence_out (SEN_PARENT (ap)->focused->value);
+
+  // Remove the sentences that the snapshot doesn't have, and add the
+  // ones that only it has.  Lines are only ever added and removed, so
+  // the sentences that both have are in the same order.  The first line
+  // can't be removed, so every new line comes after another.
+
+  ev_itr = SEN_PARENT (ap)->everything->head;
+  prev = NULL;
+  i = 0;
+
+  while (ev_itr || i < lines->num_stuff)
+    {
+      sen_data * sd;
+
+      line = (i < lines->num_stuff)
+	? *((history_line_t **) vec_nth (lines, i)) : NULL;
+
+      if (ev_itr)
+	{
+	  sen = ev_itr->value;
+	  if (line && sen->id == line->id)
+	    {
+	      prev = ev_itr;
+	      ev_itr = ev_itr->next;
+	      i++;
+	      continue;
+	    }
+
+	  sprintf (key, "%i", sen->id);
+	  if (!hash_find (ids, (unsigned char *) key))
+	    {
+	      int line_num = sentence_get_line_no (sen);
+
+	      if (first == -1 || line_num - 2 < first)
+		first = line_num - 2;
+
+	      ev_itr = ev_itr->next;
+	      ret = aris_proof_remove_sentence (ap, sen);
+	      if (ret < 0)
+		return -1;
+	      continue;
+	    }
+	}
+
+      if (!line || !prev)
+	break;
+
+      sd = sen_data_init (-1, line->rule, line->text, NULL, line->premise,
+			  line->file, line->subproof, line->depth, NULL);
+      if (!sd)
+	return -1;
+
+      SEN_PARENT (ap)->focused = prev;
+      sen = aris_proof_create_sentence (ap, sd);
+      sen_data_destroy (sd);
+      if (!sen)
+	return -1;
+
+      sen->id = line->id;
+      sen->hist = NULL;
+      prev = SEN_PARENT (ap)->focused;
+      i++;
+    }
+
+  // Bring the rest of each changed sentence back.
+
+  sens = init_vec (sizeof (sentence *));
+  if (!sens)
+    return -1;
+
+  ap->fin_prem = NULL;
+
+  ev_itr = SEN_PARENT (ap)->everything->head;
+  for (i = 0; ev_itr && i < lines->num_stuff; ev_itr = ev_itr->next, i++)
+    {
+      sen = ev_itr->value;
+      line = *((history_line_t **) vec_nth (lines, i));
+
+      ret = vec_add_obj (sens, &sen);
+      if (ret < 0)
+	return -1;
+
+      if (sen->premise)
+	ap->fin_prem = ev_itr;
+
+      if (sen->hist != line)
+	{
+	  int r;
+
+	  if (strcmp ((const char *) sen->text, (const char *) line->text))
+	    {
+	      ret = sentence_set_text (sen, line->text);
+	      if (ret < 0)
+		return -1;
+	    }
+
+	  if (line->sexpr && !sen->sexpr)
+	    {
+	      ret = aris_proof_index_mark (ap, sen);
+	      if (ret < 0)
+		return -1;
+
+	      sen->sexpr = (unsigned char *) strdup ((const char *) line->sexpr);
+	      CHECK_ALLOC (sen->sexpr, -1);
+	    }
+
+	  while (sen->refs->head)
+	    ls_rem_obj (sen->refs, sen->refs->head);
+
+	  for (r = 0; line->refs[r] != -1; r++)
+	    {
+	      hash_entry_t * ent;
+	      int pos;
+
+	      sprintf (key, "%i", line->refs[r]);
+	      ent = hash_find (ids, (unsigned char *) key);
+	      if (!ent)
+		continue;
+
+	      pos = (history_line_t **) ent->value
+		- (history_line_t **) lines->stuff;
+	      if (pos >= i)
+		continue;
+
+	      if (!ls_push_obj (sen->refs, *((sentence **) vec_nth (sens, pos))))
+		return -1;
+	    }
+
+	  if ((!sen->file != !line->file)
+	      || (sen->file && strcmp ((const char *) sen->file,
+				       (const char *) line->file)))
+	    {
+	      if (sen->proof)
+		proof_destroy (sen->proof);
+	      sen->proof = NULL;
+
+	      if (sen->file)
+		free (sen->file);
+	      sen->file = NULL;
+
+	      if (line->file)
+		{
+		  sen->file = (unsigned char *) strdup ((const char *) line->file);
+		  CHECK_ALLOC (sen->file, -1);
+		}
+	    }
+
+	  sen->rule = line->rule;
+	  sen->hist = line;
+
+	  if (first == -1 || i < first)
+	    first = i;
+	}
+
+      // Changing the text of a line clears the values of its dependents.
+      if (sen->value_type != line->value_type)
+	sentence_set_value (sen, line->value_type);
+    }
+
+  destroy_vec (sens);
+  destroy_vec (lines);
+  destroy_hash (ids);
+
+  history_seq_retain (seq);
+  history_seq_release (ap->hist_seq);
+  ap->hist_seq = seq;
+  ap->hist_edited = 0;
+  ap->hist_restoring = 0;
+
+  ret = aris_proof_set_changed (ap, 1);
+  if (ret < 0)
+    return -1;
+
+  ev_itr = sen_parent_nth (SEN_PARENT (ap), (first < 0) ? 0 : first);
+  sen_parent_set_focus (SEN_PARENT (ap), ev_itr);
+  sentence_in (ev_itr->value);
+
+  return 0;
+}
+
+/* Undoes the last edit of an aris proof.
+ *  input:
+ *    ap - the aris proof.
+ *  output:
+ *    0 on success, -1 on memory error, 1 if there is nothing to undo.
+ */
+int
+aris_proof_undo (aris_proof * ap)
+{
+  history_seq_t * seq;
+  int ret;
+
+  ret = aris_proof_history_commit (ap);
+  if (ret < 0)
+    return -1;
+
+  if (history_undo (ap->history, &seq) == 1)
+    return 1;
+
+  return aris_proof_history_restore (ap, seq);
+}
+
+/* Redoes the last edit of an aris proof that was undone.
+ *  input:
+ *    ap - the aris proof.
+ *  output:
+ *    0 on success, -1 on memory error, 1 if there is nothing to redo.
+ */
+int
+aris_proof_redo (aris_proof * ap)
+{
+  history_seq_t * seq;
+  int ret;
+
+  ret = aris_proof_history_commit (ap);
+  if (ret < 0)
+    return -1;
+
+  if (history_redo (ap->history, &seq) == 1)
+    return 1;
+
+  return aris_proof_history_restore (ap, seq);
+}
@@ -32,6 +32,11 @@ typedef struct list list_t;
 typedef struct vector vec_t;
 typedef struct item item_t;
 typedef struct goal goal_t;
+typedef struct hash_table hash_t;
+typedef struct eval_job eval_job;
+typedef struct subproof_tree subproof_tree_t;
+typedef struct history history_t;
+typedef struct history_seq history_seq_t;
 typedef struct aris_proof aris_proof;
 
 // The main proof/gui structure.
@@ -56,7 +61,6 @@ struct aris_proof {
   int type;                  // The type of sentence parent.
   // sen_parent ends here.
 
-  list_t * vars;  // The list of variables for this proof.
   goal_t * goal;  // The goal structure for this proof.
 
   int edited : 1;   // Whether or not this proof has been edited.
@@ -68,6 +72,19 @@ struct aris_proof {
 
   char * sb_text;  // The statusbar text - may not be needed.
   int boolean : 1;
+
+  hash_t * index;         // Index of the sentences by their sexprs.
+  list_t * index_dirty;   // Sentences that have changed since being indexed.
+
+  subproof_tree_t * subproofs;  // The subproofs, kept up to date with the lines.
+
+  eval_job * job;  // The evaluation running in the background, if any.
+
+  history_t * history;      // The snapshots that edits can be undone to.
+  history_seq_t * hist_seq; // The lines as they are now, shared with the history.
+  list_t * hist_dirty;      // Sentences that have changed since the last snapshot.
+  int hist_edited : 1;      // Whether or not an edit was made since the last snapshot.
+  int hist_restoring : 1;   // Whether or not a snapshot is being restored.
 };
 
 aris_proof * aris_proof_init ();
@@ -78,7 +95,7 @@ void aris_proof_destroy ();
 void aris_proof_create_menu (sen_parent * ap);
 
 int aris_proof_set_changed (aris_proof * ap, int changed);
-int aris_proof_adjust_lines (aris_proof * ap, item_t * itm, int mod);
+int aris_proof_adjust_lines (aris_proof * ap);
 
 proof_t * aris_proof_to_proof (aris_proof * ap);
 
@@ -100,4 +117,14 @@ int aris_proof_copy (aris_proof * ap);
 
 int aris_proof_toggle_boolean_mode (aris_proof * ap);
 
+int aris_proof_index_mark (aris_proof * ap, sentence * sen);
+void aris_proof_index_remove (aris_proof * ap, sentence * sen);
+int aris_proof_find_sexpr (aris_proof * ap, unsigned char * sexpr,
+			   sentence ** sen);
+
+int aris_proof_history_mark (aris_proof * ap, sentence * sen, int edit);
+int aris_proof_history_commit (aris_proof * ap);
+int aris_proof_undo (aris_proof * ap);
+int aris_proof_redo (aris_proof * ap);
+
 #endif /*  ARIS_PROOF_H  */
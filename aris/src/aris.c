@@ -19,6 +19,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include <getopt.h>
 
 #include "process.h"
@@ -31,6 +32,12 @@
 #include "rules.h"
 #include "config.h"
 #include "interop-isar.h"
+#include "trace.h"
+#include "grade.h"
+#include "rule-search.h"
+#include "process-cache.h"
+#include "latex.h"
+#include "bench.h"
 
 #ifdef ARIS_GUI
 #include <gtk/gtk.h>
@@ -39,6 +46,21 @@
 #include "rules-table.h"
 #endif
 
+#define MEM_SUBSYSTEM MEM_IO
+#include "mem.h"
+
+// The options that only have a long form.
+
+enum {
+  TRACE_OPTION = CHAR_MAX + 1,
+  FORMAT_OPTION,
+  INFER_OPTION,
+  CACHE_OPTION,
+  ISAR_PATH_OPTION,
+  BENCH_OPTION,
+  MEM_STATS_OPTION
+};
+
 // The options array for getopt_long.
 
 static struct option const long_opts[] =
@@ -59,6 +81,14 @@ static struct option const long_opts[] =
     {"latex", required_argument, NULL, 'x'},
     {"version", no_argument, NULL, 0},
     {"help", no_argument, NULL, 'h'},
+    {"trace", required_argument, NULL, TRACE_OPTION},
+    {"jobs", required_argument, NULL, 'j'},
+    {"format", required_argument, NULL, FORMAT_OPTION},
+    {"infer", no_argument, NULL, INFER_OPTION},
+    {"cache", required_argument, NULL, CACHE_OPTION},
+    {"isar-path", required_argument, NULL, ISAR_PATH_OPTION},
+    {"bench", required_argument, NULL, BENCH_OPTION},
+    {"mem-stats", no_argument, NULL, MEM_STATS_OPTION},
     {NULL, 0, NULL, 0}
   };
 
@@ -68,14 +98,21 @@ struct arg_items {
   int verbose : 1;
   int evaluate : 1;
   int boolean : 1;
-  char * file_name[256];
-  char * grade_name[256];
+  int infer : 1;
+  vec_t * files;
+  char * grade_name;
+  int jobs;
+  int grade_format;
   char * latex_name[256];
   char * conclusion;
   vec_t * prems;
   char rule[3];
   char * rule_file;
-  vec_t * vars;
+  var_set_t * vars;
+  char * trace_name;
+  char * cache_name;
+  char * isar_name;
+  int bench_runs;
 };
 
 struct arg_flags {
@@ -171,22 +208,38 @@ version ()
 void
 usage (int status)
 {
-  printf ("Usage: aris [OPTIONS]... [-f FILE] [-g FILE]\n");
+  printf ("Usage: aris [OPTIONS]... [-f FILE]...\n");
   printf ("   or: aris [OPTIONS]... [-p PREMISE]... -r RULE -c CONCLUSION\n");
+  printf ("   or: aris -e -g KEY [OPTIONS]... FILE...\n");
   printf ("\n");
   printf ("Options:\n");
   printf ("  -a, --variable=VARIABLE        Use VARIABLE as a variable.\n");
   printf ("                                  Place an '*' next to the variable to designate it as arbitrary.\n");
   printf ("  -b, --boolean                  Run Aris in boolean mode.\n");
+  printf ("      --bench=N                  Evaluate each FILE N times, and print the median time,\n");
+  printf ("                                  the most bytes it allocated at once, and the largest\n");
+  printf ("                                  resident size of Aris as JSON.\n");
+  printf ("      --cache=FILE               Keep the results of the rules in FILE between runs.\n");
   printf ("  -c, --conclusion=CONCLUSION    Set CONCLUSION as the conclusion.\n");
   printf ("  -e, --evaluate                 Run Aris in evaluation mode.\n");
   printf ("  -f, --file=FILE                Evaluate FILE.\n");
-  //printf ("  -g, --grade=FILE               Grade file flag FILE against grade flag FILE.\n");
+  printf ("      --format=FORMAT            Print grades as FORMAT, either 'csv' (the default) or 'json'.\n");
+  printf ("  -g, --grade=KEY                Grade each FILE against the answer key KEY.\n");
+  printf ("      --infer                    Print every rule that accepts the conclusion,\n");
+  printf ("                                  or each line of each FILE, instead of checking RULE.\n");
+  printf ("  -i, --isar=FILE                Print the premises and goals of FILE, an Isabelle theory.\n");
+  printf ("      --isar-path=DIRS           Look for the theories that a theory imports in DIRS,\n");
+  printf ("                                  separated by ':', after the theory's own directory.\n");
+  printf ("  -j, --jobs=N                   Grade or convert N files, or check N rules, at once,\n");
+  printf ("                                  defaulting to one per processor.\n");
   printf ("  -l, --list                     List the available rules.\n");
+  printf ("      --mem-stats                Count the allocations of each part of Aris, print them\n");
+  printf ("                                  at exit, and report what outlives each graded FILE.\n");
   printf ("  -p, --premise PREMISE          Use PREMISE as a premise.\n");
   printf ("  -r, --rule RULE                Set RULE as the rule.\n");
   printf ("                                  Use 'lm:/path/to/file' to designate a file.\n");
   printf ("  -t, --text TEXT                Simply check the correctness of TEXT.\n");
+  printf ("      --trace=FILE               Write a trace of the evaluation of each line to FILE.\n");
   printf ("  -v, --verbose                  Print status and error messages.\n");
   printf ("  -x, --latex=FILE               Convert FILE to a LaTeX proof file.\n");
   printf ("  -h, --help                     Print this help and exit.\n");
@@ -200,6 +253,32 @@ usage (int status)
   exit (status);
 }
 
+/* Prints the premises and goals of an Isabelle theory.
+ *  input:
+ *    proof - the proof that the theory was read into.
+ *  output:
+ *    none.
+ */
+void
+print_thy (proof_t * proof)
+{
+  item_t * itm;
+  int line = 1;
+
+  for (itm = proof->everything->head; itm; itm = itm->next)
+    {
+      sen_data * sd = itm->value;
+      if (!sd->premise)
+	break;
+      printf (" %3i | %s\n", line++, sd->text);
+    }
+
+  printf ("----------------\n");
+
+  for (itm = proof->goals->head; itm; itm = itm->next)
+    printf (" %3i | %s\n", line++, (char *) itm->value);
+}
+
 /* Checks argument text.
  *  input:
  *   arg_text - the text to check.
@@ -236,295 +315,50 @@ check_arg_text (unsigned char * arg_text)
   return 1;
 }
 
-/* Converts sentence data to a LaTeX line.
- *  input:
- *   sd - the sentence data to convert.
- *  output:
- *   The converted text, or NULL on error.
- */
-char *
-convert_sd_latex (sen_data * sd)
-{
-  char * out_str, * text;
-  int out_pos, i;
-
-  text = die_spaces_die (sd->text);
-  if (!text)
-    return NULL;
-
-  main_conns = gui_conns;
-
-  out_str = (char *) calloc (sd->depth * 6 + 1, sizeof (char));
-  CHECK_ALLOC (out_str, NULL);
-
-  out_pos = 0;
-
-  for (i = 0; i < sd->depth; i++)
-    out_pos += sprintf (out_str + out_pos, "\\quad ");
-
-  for (i = 0; text[i]; i++)
-    {
-      if (i > 0 && i % 80 == 0)
-	{
-	  out_str = (char *) realloc (out_str, out_pos + 5);
-	  CHECK_ALLOC (out_str, NULL);
-	  out_pos += sprintf (out_str + out_pos, "\\\\\n&");
-	}
-
-      if (!strncmp (text + i, AND, CL))
-	{
-	  out_str = (char *) realloc (out_str, out_pos + 8);
-	  CHECK_ALLOC (out_str, NULL);
-	  out_pos += sprintf (out_str + out_pos, "\\land ");
-	  i += CL - 1;
-	  continue;
-	}
-
-      if (!strncmp (text + i, OR, CL))
-	{
-	  out_str = (char *) realloc (out_str, out_pos + 8);
-	  CHECK_ALLOC (out_str, NULL);
-	  out_pos += sprintf (out_str + out_pos, "\\lor ");
-	  i += CL - 1;
-	  continue;
-	}
-
-      if (!strncmp (text + i, NOT, NL))
-	{
-	  out_str = (char *) realloc (out_str, out_pos + 8);
-	  CHECK_ALLOC (out_str, NULL);
-	  out_pos += sprintf (out_str + out_pos, "\\neg ");
-	  i += NL - 1;
-	  continue;
-	}
-
-      if (!strncmp (text + i, CON, CL))
-	{
-	  out_str = (char *) realloc (out_str, out_pos + 16);
-	  CHECK_ALLOC (out_str, NULL);
-	  out_pos += sprintf (out_str + out_pos, "\\rightarrow ");
-	  i += CL - 1;
-	  continue;
-	}
-
-      if (!strncmp (text + i, BIC, CL))
-	{
-	  out_str = (char *) realloc (out_str, out_pos + 18);
-	  CHECK_ALLOC (out_str, NULL);
-	  out_pos += sprintf (out_str + out_pos, "\\leftrightarrow ");
-	  i += CL - 1;
-	  continue;
-	}
-
-      if (!strncmp (text + i, UNV, CL))
-	{
-	  out_str = (char *) realloc (out_str, out_pos + 16);
-	  CHECK_ALLOC (out_str, NULL);
-	  out_pos += sprintf (out_str + out_pos, "\\forall ");
-	  i += CL - 1;
-	  continue;
-	}
-
-      if (!strncmp (text + i, EXL, CL))
-	{
-	  out_str = (char *) realloc (out_str, out_pos + 16);
-	  CHECK_ALLOC (out_str, NULL);
-	  out_pos += sprintf (out_str + out_pos, "\\exists ");
-	  i += CL - 1;
-	  continue;
-	}
-
-      if (!strncmp (text + i, TAU, CL))
-	{
-	  out_str = (char *) realloc (out_str, out_pos + 8);
-	  CHECK_ALLOC (out_str, NULL);
-	  out_pos += sprintf (out_str + out_pos, "\\top ");
-	  i += CL - 1;
-	  continue;
-	}
-
-      if (!strncmp (text + i, CTR, CL))
-	{
-	  out_str = (char *) realloc (out_str, out_pos + 8);
-	  CHECK_ALLOC (out_str, NULL);
-	  out_pos += sprintf (out_str + out_pos, "\\bot ");
-	  i += CL - 1;
-	  continue;
-	}
-
-      if (!strncmp (text + i, ELM, CL))
-	{
-	  out_str = (char *) realloc (out_str, out_pos + 8);
-	  CHECK_ALLOC (out_str, NULL);
-	  out_pos += sprintf (out_str + out_pos, "\\in ");
-	  i += CL - 1;
-	  continue;
-	}
-
-      if (!strncmp (text + i, NIL, CL))
-	{
-	  out_str = (char *) realloc (out_str, out_pos + 8);
-	  CHECK_ALLOC (out_str, NULL);
-	  out_pos += sprintf (out_str + out_pos, " nil ");
-	  i += CL - 1;
-	  continue;
-	}
-
-      out_str = (char *) realloc (out_str, out_pos + 2);
-      CHECK_ALLOC (out_str, NULL);
-      out_str[out_pos++] = text[i];
-
-    }
-
-  out_str = (char *) realloc (out_str, out_pos + 1);
-  CHECK_ALLOC (out_str, NULL);
-  out_str[out_pos] = '\0';
-
-  main_conns = cli_conns;
-  
-  return out_str;
-}
-
-/* Converts a proof into a LaTeX file.
+/* Prints the rules that accept each line of a proof.
  *  input:
- *   proof - the proof to convert.
- *   file - the file to write to.
+ *   proof - the proof to search the rules of.
+ *   jobs - the amount of rules to check at once, or 0 for one per processor.
  *  output:
  *   0 on success, -1 on error.
  */
 int
-convert_proof_latex (proof_t * proof, FILE * file)
+infer_proof_rules (proof_t * proof, int jobs)
 {
-  fprintf (file, "\\documentclass{article}\n");
-  fprintf (file, "\\usepackage{amsmath}\n");
-  fprintf (file, "\\usepackage{amsfonts}\n");
-  fprintf (file, "\\begin{document}\n");
-  fprintf (file, "\\newcommand{\\eline}{--------}\n");
-  fprintf (file, "\\newcommand{\\prmline}[2]{\\text{#1.}&\\quad #2 &}\n");
-  fprintf (file, "\\newcommand{\\stdline}[3]{\\text{#1.}&\\quad #2 & \\texttt{#3 }}\n");
-  fprintf (file, "\n");
-
-  fprintf (file, "{\\allowdisplaybreaks\n");
-  fprintf (file, "  \\begin{align*}\n");
-
-  item_t * ev_itr;
-  char * text;
-  int i;
-
-  for (ev_itr = proof->everything->head; ev_itr; ev_itr = ev_itr->next)
-    {
-      sen_data * sd;
-      sd = ev_itr->value;
+  vec_t * found;
+  rule_search_line * line;
+  char * names;
+  int i, ret;
 
-      if (!sd->premise)
-	break;
-
-      text = convert_sd_latex (sd);
-      if (!text)
-	return -1;
-
-      fprintf (file, "    \\prmline{%i}{%s}\\\\\n", sd->line_num, text);
-      free (text);
-    }
+  found = init_vec (sizeof (rule_search_line));
+  if (!found)
+    return -1;
 
-  fprintf (file, "    &\\eline\\\\\n");
+  ret = proof_infer (proof, 0, jobs, found);
+  if (ret == -1)
+    return -1;
 
-  for (; ev_itr; ev_itr = ev_itr->next)
+  for (i = 0; i < found->num_stuff; i++)
     {
-      sen_data * sd;
-      sd = ev_itr->value;
+      line = vec_nth (found, i);
 
-      text = convert_sd_latex (sd);
-      if (!text)
+      names = rule_search_names (line->rules);
+      if (!names)
 	return -1;
 
-      const char * rule = sd->subproof ? "assume" : rules_list[sd->rule];
-
-      fprintf (file, "    \\stdline{%i}{%s}{%s} ", sd->line_num,
-	       text, rule);
-
-      if (!(sd->rule == RULE_EX || sd->rule == RULE_II
-	    || sd->rule == RULE_SQ || sd->subproof))
-	{
-	  for (i = 0; sd->refs[i] != -1; i++)
-	    {
-	      fprintf (file, "(%i)", sd->refs[i]);
-	      if (sd->refs[i + 1] != -1)
-		fprintf (file, ",");
-	    }
-	}
+      if (names[0] == '\0')
+	printf ("%i: No rule accepts the line.\n", line->line_num);
+      else
+	printf ("%i: %s\n", line->line_num, names);
+      free (names);
 
-      fprintf (file, "\\\\\n");
-      free (text);
+      rule_search_line_clear (line);
     }
 
-  fprintf (file, "  \\end{align*}\n");
-  fprintf (file, "}\n");
-
-  fprintf (file, "\\end{document}\n");
+  destroy_vec (found);
   return 0;
 }
 
-/* Grades a single proof against a file.
- */
-int
-grade_file (FILE * g_file, proof_t * c_file)
-{
-  int ret_chk, grade;
-  vec_t * rets;
-
-  rets = init_vec (sizeof (int));
-  if (!rets)
-    return -1;
-
-  ret_chk = proof_eval (c_file, rets, 0);
-  if (ret_chk == -1)
-    return -1;
-
-  // Grades them out of five points:
-  // 2 - Effort (evaluates properly)
-  // 2 - Is similar to the correct file
-  // 1 - Obtains the goal(s).
-
-  if (rets->num_stuff >= (c_file->everything->num_stuff / 2))
-    {
-      grade = 1;
-      if (rets->num_stuff == c_file->everything->num_stuff)
-	grade = 2;
-    }
-
-  // Read through the grade file, and get the goal(s).
-  unsigned char * goal;
-  fscanf (g_file, "%s", &goal);
-
-  if (c_file->goals)
-    {
-      item_t * g_itr, * ev_itr;
-      for (g_itr = c_file->goals->head; g_itr; g_itr = g_itr->next)
-	{
-	  sen_data * g_sd;
-	  g_sd = g_itr->value;
-	  for (ev_itr = c_file->everything->head; ev_itr; ev_itr = ev_itr->next)
-	    {
-	      sen_data * e_sd;
-	      e_sd = ev_itr->value;
-	      if (!strcmp (e_sd->text, g_sd->text))
-		break;
-	    }
-	  if (!ev_itr)
-	    break;
-	}
-      if (!g_itr)
-	grade++;
-    }
-
-  // Check the sequence of rules, making sure that they are met
-  // in the file being graded.
-
-
-  return grade;
-}
-
 /* Parses the supplied arguments.
  *  input:
  *   argc, argv - should be self-explanatory.
@@ -537,22 +371,29 @@ parse_args (int argc, char * argv[], struct arg_items * ai)
 {
   int c;
 
-  int cur_file, cur_grade, cur_latex;
+  int cur_latex;
   int opt_len;
   int c_ret;
 
-  cur_file = cur_grade = cur_latex = 0;
-  ai->verbose = ai->boolean = ai->evaluate = 0;
+  cur_latex = 0;
+  ai->verbose = ai->boolean = ai->evaluate = ai->infer = 0;
   ai->rule_file = NULL;
+  ai->trace_name = NULL;
+  ai->cache_name = NULL;
+  ai->isar_name = NULL;
+  ai->bench_runs = 0;
+  ai->grade_name = NULL;
+  ai->jobs = 0;
+  ai->grade_format = GRADE_FORMAT_CSV;
   for (c = 0; c < 256; c++)
-    {
-      ai->file_name[c] = NULL;
-      ai->grade_name[c] = NULL;
-      ai->latex_name[c] = NULL;
-    }
+    ai->latex_name[c] = NULL;
+
+  ai->files = init_vec (sizeof (char *));
+  if (!ai->files)
+    exit (EXIT_FAILURE);
 
   ai->prems = init_vec (sizeof (char*));
-  ai->vars = init_vec (sizeof (variable));
+  ai->vars = NULL;
   memset ((char *) ai->rule, 0, sizeof (char) * 3);
 
   //Only one conclusion and one rule can exist.
@@ -565,7 +406,7 @@ parse_args (int argc, char * argv[], struct arg_items * ai)
     {
       int opt_idx = 0;
 
-      c = getopt_long (argc, argv, "ep:c:r:t:a:f:g:i:s:x:lbvh", long_opts, &opt_idx);
+      c = getopt_long (argc, argv, "ep:c:r:t:a:f:g:j:i:s:x:lbvh", long_opts, &opt_idx);
 
       if (c == -1)
 	break;
@@ -702,23 +543,23 @@ parse_args (int argc, char * argv[], struct arg_items * ai)
 		  break;
 		}
 
-	      variable v;
-	      opt_len = strlen (optarg);
+	      unsigned char * var_text;
+	      int arbitrary;
 
-	      v.text = (unsigned char *) calloc (opt_len, sizeof (char));
-	      strcpy (v.text, optarg);
+	      opt_len = strlen (optarg);
+	      var_text = (unsigned char *) calloc (opt_len + 1, sizeof (char));
+	      if (!var_text)
+		exit (EXIT_FAILURE);
+	      strcpy (var_text, optarg);
 
-	      if (v.text[opt_len - 1] == '*')
-		{
-		  v.arbitrary = 1;
-		  v.text[opt_len - 1] = '\0';
-		}
-	      else
-		{
-		  v.arbitrary = 0;
-		}
+	      arbitrary = (var_text[opt_len - 1] == '*');
+	      if (arbitrary)
+		var_text[opt_len - 1] = '\0';
 
-	      vec_add_obj (ai->vars, &v);
+	      c_ret = var_set_add (&ai->vars, var_text, arbitrary);
+	      free (var_text);
+	      if (c_ret == -1)
+		exit (EXIT_FAILURE);
 	    }
 	  else
 	    {
@@ -731,24 +572,9 @@ parse_args (int argc, char * argv[], struct arg_items * ai)
 
 	  if (optarg)
 	    {
-	      if (ai->file_name[255])
-		{
-		  fprintf (stderr, "Argument Warning - a maximum of 256 filenames can be specified, ignoring file \"%s\".\n", optarg);
-		  break;
-		}
-
-	      int arg_len = strlen (optarg);
-
-	      ai->file_name[cur_file] = (char *) calloc (arg_len + 1,
-							 sizeof (char));
-	      if (!ai->file_name[cur_file])
-		{
-		  perror (NULL);
-		  exit (EXIT_FAILURE);
-		}
-
-	      strcpy (ai->file_name[cur_file], optarg);
-	      cur_file++;
+	      c_ret = vec_str_add_obj (ai->files, optarg);
+	      if (c_ret == -1)
+		exit (EXIT_FAILURE);
 	    }
 	  else
 	    {
@@ -757,49 +583,40 @@ parse_args (int argc, char * argv[], struct arg_items * ai)
 	    }
 	  break;
 
-	  /*
 	case 'g':
 	  if (optarg)
 	    {
-	      if (ai->grade_name[255])
+	      if (ai->grade_name)
 		{
-		  fprintf (stderr, "Argument Warning - a maximum of 256 filenames can be specified, ignoring file \"%s\".\n", optarg);
+		  fprintf (stderr, "Argument Warning - only one (1) answer key must be specified, ignoring file \"%s\".\n", optarg);
 		  break;
 		}
 
-	      int arg_len = strlen (optarg);
-
-	      ai->grade_name[cur_grade] = (char *) calloc (arg_len + 1,
-							   sizeof (char));
-	      if (!ai->grade_name[cur_grade])
-		{
-		  perror (NULL);
-		  exit (EXIT_FAILURE);
-		}
-
-	      strcpy (ai->grade_name[cur_grade], optarg);
-	      cur_grade++;
+	      ai->grade_name = optarg;
 	    }
 	  else
 	    {
 	      fprintf (stderr, "Argument Warning - grade flag requires a filename, ignoring flag.\n");
 	    }
 	  break;
-	  */
 
-	case 'i':
+	case 'j':
 	  if (optarg)
 	    {
-	      proof_t * proof;
-
-	      proof = proof_init ();
-	      if (!proof)
-		exit (EXIT_FAILURE);
-
-	      main_conns = cli_conns;
-	      parse_thy (optarg, proof);
-	      exit (EXIT_SUCCESS);
+	      ai->jobs = atoi (optarg);
+	      if (ai->jobs < 1)
+		{
+		  fprintf (stderr, "Argument Warning - the amount of jobs must be positive, ignoring \"%s\".\n", optarg);
+		  ai->jobs = 0;
+		}
 	    }
+	  break;
+
+	case 'i':
+	  // The theory is read once every option is known, so that the
+	  // isar-path flag may come after it.
+	  ai->isar_name = optarg;
+	  break;
 
 	case 's':
 	  if (optarg)
@@ -853,6 +670,45 @@ parse_args (int argc, char * argv[], struct arg_items * ai)
 	    }
 	  break;
 
+	case TRACE_OPTION:
+	  ai->trace_name = optarg;
+	  break;
+
+	case INFER_OPTION:
+	  ai->infer = 1;
+	  break;
+
+	case CACHE_OPTION:
+	  ai->cache_name = optarg;
+	  break;
+
+	case BENCH_OPTION:
+	  ai->bench_runs = atoi (optarg);
+	  if (ai->bench_runs < 1)
+	    {
+	      fprintf (stderr, "Argument Warning - the amount of runs must be positive, running once.\n");
+	      ai->bench_runs = 1;
+	    }
+	  break;
+
+	case MEM_STATS_OPTION:
+	  mem_stats_enable ();
+	  break;
+
+	case ISAR_PATH_OPTION:
+	  if (isar_set_path (optarg) == -1)
+	    exit (EXIT_FAILURE);
+	  break;
+
+	case FORMAT_OPTION:
+	  if (!strcmp (optarg, "csv"))
+	    ai->grade_format = GRADE_FORMAT_CSV;
+	  else if (!strcmp (optarg, "json"))
+	    ai->grade_format = GRADE_FORMAT_JSON;
+	  else
+	    fprintf (stderr, "Argument Warning - unknown format \"%s\", ignoring flag.\n", optarg);
+	  break;
+
 	case 0:
 	  if (opt_idx == 14)
 	    version ();
@@ -868,6 +724,15 @@ parse_args (int argc, char * argv[], struct arg_items * ai)
 	}
     }
 
+  // The remaining arguments are files.
+
+  for (; optind < argc; optind++)
+    {
+      c_ret = vec_str_add_obj (ai->files, argv[optind]);
+      if (c_ret == -1)
+	exit (EXIT_FAILURE);
+    }
+
   return 0;
 }
 
@@ -880,10 +745,11 @@ main (int argc, char *argv[])
   vec_t * prems;
   unsigned char * conc = NULL;
   char * rule;
-  vec_t * vars;
-  char ** file_name, ** grade_name, ** latex_name;
-  proof_t ** proof, ** grade;
-  int cur_file, cur_grade, cur_latex;
+  var_set_t * vars;
+  vec_t * files;
+  char ** latex_name;
+  proof_t ** proof;
+  int cur_file, cur_latex;
   char * rule_file = NULL;
   int opt_len, verbose, boolean, evaluate_mode;
   int c_ret;
@@ -897,31 +763,43 @@ main (int argc, char *argv[])
   verbose = args.verbose;
   evaluate_mode = args.evaluate;
   boolean = args.boolean;
-  file_name = args.file_name;
-  grade_name = args.grade_name;
+  files = args.files;
   latex_name = args.latex_name;
   rule = args.rule;
   rule_file = args.rule_file;
 
-  cur_file = cur_grade = cur_latex = -1;
+  cur_file = files->num_stuff;
+  cur_latex = -1;
 
-  cur_grade = 0;
-  for (c = 0; c < 256; c++)
+  if (args.isar_name)
     {
-      if (cur_file != -1 && cur_grade != -1 && cur_latex != -1)
-	break;
+      proof_t * thy;
+
+      thy = proof_init ();
+      if (!thy)
+	exit (EXIT_FAILURE);
+
+      main_conns = cli_conns;
+      if (parse_thy (args.isar_name, thy) == -1)
+	exit (EXIT_FAILURE);
 
-      if (cur_file == -1 && !file_name[c])
-	cur_file = c;
+      print_thy (thy);
+      exit (EXIT_SUCCESS);
+    }
 
-      if (cur_grade == -1 && !grade_name[c])
-	cur_grade = c;
+  if (args.cache_name && process_cache_open (args.cache_name) == -1)
+    exit (EXIT_FAILURE);
 
-      if (cur_latex == -1 && !latex_name[c])
-	cur_latex = c;
+  for (c = 0; c < 256; c++)
+    {
+      if (!latex_name[c])
+	{
+	  cur_latex = c;
+	  break;
+	}
     }
 
-  if (conc == NULL && evaluate_mode && !file_name[0] && !latex_name[0])
+  if (conc == NULL && evaluate_mode && cur_file == 0 && !latex_name[0])
     {
       fprintf (stderr, "Argument Error - a conclusion must be specified in evaluation mode.\n");
       exit (EXIT_FAILURE);
@@ -929,78 +807,73 @@ main (int argc, char *argv[])
 
   if (cur_latex > 0)
     {
-      proof = (proof_t **) calloc (cur_latex, sizeof (proof_t *));
-      CHECK_ALLOC (proof, EXIT_FAILURE);
+      if (latex_export_files (latex_name, cur_latex, args.jobs) == -1)
+	exit (EXIT_FAILURE);
 
-      for (c = 0; c < cur_latex; c++)
-	{
-	  proof[c] = aio_open (latex_name[c]);
-	  if (!proof[c])
-	    exit (EXIT_FAILURE);
+      exit (EXIT_SUCCESS);
+    }
 
-	  FILE * file;
-	  char * fname;
-	  int n_len;
+  if (args.grade_name)
+    {
+      grade_key * key;
 
-	  n_len = strlen (latex_name[c]);
-	  fname = (char *) calloc (n_len + 1, sizeof (char));
-	  CHECK_ALLOC (fname, EXIT_FAILURE);
+      if (!evaluate_mode || cur_file == 0)
+	{
+	  fprintf (stderr, "Argument Error - the grade flag requires evaluation mode and at least one file.\n");
+	  exit (EXIT_FAILURE);
+	}
 
-	  strncpy (fname, latex_name[c], n_len - 3);
-	  sprintf (fname + n_len - 3, "tex");
+      main_conns = gui_conns;
 
-	  file = fopen (fname, "w+");
-	  if (!file)
-	    {
-	      perror (NULL);
-	      exit (EXIT_FAILURE);
-	    }
+      key = grade_key_init (args.grade_name);
+      if (!key)
+	exit (EXIT_FAILURE);
 
-	  c_ret = convert_proof_latex (proof[c], file);
-	  if (c_ret == -1)
-	    exit (EXIT_FAILURE);
+      c_ret = grade_files (key, files, args.jobs, args.grade_format, stdout);
+      if (c_ret == -1)
+	exit (EXIT_FAILURE);
 
-	  proof_destroy (proof[c]);
-	  free (proof[c]);
-	}
+      grade_key_destroy (key);
 
+      if (process_cache_close () == -1)
+	exit (EXIT_FAILURE);
       exit (EXIT_SUCCESS);
     }
 
-  if (cur_file > 0)
+  if (args.bench_runs > 0)
     {
-      proof = (proof_t **) calloc (cur_file, sizeof (proof_t *));
-      if (!proof)
+      if (!evaluate_mode || cur_file == 0)
 	{
-	  perror (NULL);
+	  fprintf (stderr, "Argument Error - the bench flag requires evaluation mode and at least one file.\n");
 	  exit (EXIT_FAILURE);
 	}
 
-      for (c = 0; c < cur_file; c++)
-	{
-	  proof[c] = aio_open (file_name[c]);
-	  if (!proof[c])
-	    exit (EXIT_FAILURE);
-	}
+      main_conns = gui_conns;
+
+      c_ret = bench_files (files, args.bench_runs, stdout);
+      if (c_ret == -1)
+	exit (EXIT_FAILURE);
+
+      if (process_cache_close () == -1)
+	exit (EXIT_FAILURE);
+      exit (EXIT_SUCCESS);
     }
 
-  if (/*cur_grade > 0*/0)
+  if (cur_file > 0)
     {
-      grade = (proof_t **) calloc (cur_grade, sizeof (proof_t *));
-      if (!grade)
+      proof = (proof_t **) calloc (cur_file, sizeof (proof_t *));
+      if (!proof)
 	{
 	  perror (NULL);
 	  exit (EXIT_FAILURE);
 	}
 
-      /*
-      for (c = 0; c < cur_grade; c++)
+      for (c = 0; c < cur_file; c++)
 	{
-	  grade[c] = aio_open (grade_name[c]);
-	  if (!grade[c])
+	  proof[c] = aio_open (vec_str_nth (files, c));
+	  if (!proof[c])
 	    exit (EXIT_FAILURE);
 	}
-      */
     }
 
   if (evaluate_mode)
@@ -1011,40 +884,33 @@ main (int argc, char *argv[])
 	{
 	  main_conns = gui_conns;
 
-	  /*TODO: Figure out how we are going to handle the grade flag. */
-	  if (/*cur_grade > 0*/0)
-	    {
-	      // Maybe only allow one file per set of grade flags.
-	      if (cur_file < 1)
-		{
-		  fprintf (stderr, "Argument Error - a file flag must be used with the grade flag.\n");
-		  exit (EXIT_FAILURE);
-		}
-
-	      int g;
-	      FILE * g_file;
-	      g_file = fopen (grade_name[0], "r+");
-	      if (!g_file)
-		{
-		  exit (EXIT_FAILURE);
-		}
+	  trace_t * trace = NULL;
 
-	      for (c = 0; c < cur_file; c++)
-		{
-		  g = grade_file (g_file, proof[c]);
-		  if (g == -1)
-		    exit (EXIT_FAILURE);
-		  printf ("Graded File %i. %s => Grade = %i\n", c, grade_name[c], g);
-		}
+	  if (args.trace_name)
+	    {
+	      trace = trace_init (args.trace_name);
+	      if (!trace)
+		exit (EXIT_FAILURE);
 	    }
 
 	  for (c = 0; c < cur_file; c++)
 	    {
 	      int ret_chk;
-	      ret_chk = proof_eval (proof[c], NULL, verbose);
+
+	      ret_chk = trace_set_proof (trace, c + 1, vec_str_nth (files, c));
+	      if (ret_chk == -1)
+		exit (EXIT_FAILURE);
+
+	      if (args.infer)
+		ret_chk = infer_proof_rules (proof[c], args.jobs);
+	      else
+		ret_chk = proof_eval (proof[c], NULL, verbose, trace);
 	      if (ret_chk == -1)
 		exit (EXIT_FAILURE);
 	    }
+
+	  if (trace && trace_destroy (trace) == -1)
+	    exit (EXIT_FAILURE);
 	}
       else
 	{
@@ -1077,13 +943,43 @@ main (int argc, char *argv[])
 		}
 	    }
 
-	  p_ret = process (conc, prems, rule, vars, proof);
-	  if (!p_ret)
-	    exit (EXIT_FAILURE);
+	  if (args.infer)
+	    {
+	      rule_search_line line;
+	      char * names;
+
+	      line.line_num = 0;
+	      line.conc = conc;
+	      line.prems = prems;
+	      line.vars = vars;
+	      line.lemma = proof;
+
+	      c_ret = rule_search (&line, 1, args.jobs);
+	      if (c_ret == -1)
+		exit (EXIT_FAILURE);
+
+	      names = rule_search_names (line.rules);
+	      if (!names)
+		exit (EXIT_FAILURE);
+
+	      if (names[0] == '\0')
+		printf ("No rule accepts the conclusion.\n");
+	      else
+		printf ("%s\n", names);
+	      free (names);
+	    }
+	  else
+	    {
+	      p_ret = process (conc, prems, rule, vars, proof);
+	      if (!p_ret)
+		exit (EXIT_FAILURE);
 
-	  printf ("%s\n", p_ret);
+	      printf ("%s\n", p_ret);
+	    }
 	}
 
+      if (process_cache_close () == -1)
+	exit (EXIT_FAILURE);
       return 0;
     }
   else
@@ -1122,7 +1018,7 @@ main (int argc, char *argv[])
 	      if (!new_gui)
 		return -1;
 
-	      aris_proof_set_filename (new_gui, file_name[c]);
+	      aris_proof_set_filename (new_gui, vec_str_nth (files, c));
 	      new_gui->edited = 0;
 
 	      ret = the_app_add_gui (new_gui);
@@ -0,0 +1,218 @@
+/* Functions for measuring the evaluation of proofs.
+
+   Copyright (C) 2012 Ian Dunn.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <sys/time.h>
+
+#ifndef WIN32
+#include <sys/resource.h>
+#endif
+
+#include "bench.h"
+#include "vec.h"
+#include "proof.h"
+#include "aio.h"
+#include "process.h"
+#include "process-cache.h"
+#include "trace.h"
+
+#define MEM_SUBSYSTEM MEM_IO
+#include "mem.h"
+
+/* Main Idea:
+ *  To notice when a change makes evaluation slower, each file is opened
+ *  and evaluated several times, and the median time of the evaluations
+ *  is reported.  The most bytes allocated at once while evaluating a file
+ *  are counted in a run of their own, through mem.c, and reported along
+ *  with the largest resident size of the process.  The results of the
+ *  rules are forgotten before each evaluation, so that every run
+ *  checks each line again.  The results are printed as JSON, one file
+ *  per line, so that perf/perf-check.sh can compare them with a
+ *  baseline.
+ */
+
+/* Gets the current time in seconds.
+ *  input:
+ *    none.
+ *  output:
+ *    the current time.
+ */
+static double
+bench_clock ()
+{
+  struct timeval tv;
+
+  gettimeofday (&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/* Gets the largest resident size of the process.
+ *  input:
+ *    none.
+ *  output:
+ *    the largest resident size in kilobytes, or 0 if it isn't known.
+ */
+static long
+bench_max_rss ()
+{
+#ifndef WIN32
+  struct rusage usage;
+
+  if (getrusage (RUSAGE_SELF, &usage) == 0)
+    return usage.ru_maxrss;
+#endif
+
+  return 0;
+}
+
+/* Compares two times, for qsort.
+ *  input:
+ *    a, b - the times.
+ *  output:
+ *    less than, equal to, or greater than 0 as a is less than, equal to,
+ *    or greater than b.
+ */
+static int
+bench_cmp_time (const void * a, const void * b)
+{
+  double ta = *(const double *) a, tb = *(const double *) b;
+
+  return (ta > tb) - (ta < tb);
+}
+
+/* Opens and evaluates a file once.
+ *  input:
+ *    file_name - the name of the file.
+ *    time - receives the time taken by the evaluation, or NULL.
+ *    peak - receives the most bytes allocated at once by the evaluation,
+ *      or NULL.  The allocations are only counted if this is given.
+ *  output:
+ *    0 on success, -1 on error.
+ */
+static int
+bench_eval (const char * file_name, double * time, size_t * peak)
+{
+  proof_t * proof;
+  unsigned long mark;
+  double start;
+  int ret;
+
+  mark = mem_mark ();
+  proof = aio_open (file_name);
+  if (!proof)
+    return -1;
+
+  process_cache_clear ();
+
+  if (peak)
+    mem_peak_begin ();
+
+  start = bench_clock ();
+  ret = proof_eval (proof, NULL, 0, NULL);
+  if (time)
+    *time = bench_clock () - start;
+
+  if (peak)
+    *peak = mem_peak_end ();
+
+  proof_destroy (proof);
+  if (ret < 0)
+    return -1;
+
+  mem_check_live (file_name, mark);
+  return 0;
+}
+
+/* Evaluates a file several times.  The allocations are counted in a
+ * run of their own first, since counting them slows the evaluation.
+ *  input:
+ *    file_name - the name of the file.
+ *    runs - the amount of times to evaluate the file.
+ *    times - receives the time taken by each evaluation.
+ *    peak - receives the most bytes allocated at once by an evaluation.
+ *  output:
+ *    0 on success, -1 on error.
+ */
+static int
+bench_file (const char * file_name, int runs, double * times, size_t * peak)
+{
+  int i, ret;
+
+  ret = bench_eval (file_name, NULL, peak);
+  if (ret < 0)
+    return -1;
+
+  for (i = 0; i < runs; i++)
+    {
+      ret = bench_eval (file_name, times + i, NULL);
+      if (ret < 0)
+	return -1;
+    }
+
+  return 0;
+}
+
+/* Measures the evaluation of files, and prints the results.
+ *  input:
+ *    files - the names of the files.
+ *    runs - the amount of times to evaluate each file.
+ *    out - the file to print to.
+ *  output:
+ *    0 on success, -1 on error.
+ */
+int
+bench_files (vec_t * files, int runs, FILE * out)
+{
+  double * times;
+  size_t peak;
+  int i, ret;
+
+  times = (double *) calloc (runs, sizeof (double));
+  CHECK_ALLOC (times, -1);
+
+  for (i = 0; i < files->num_stuff; i++)
+    {
+      const char * file_name = (const char *) vec_str_nth (files, i);
+
+      ret = bench_file (file_name, runs, times, &peak);
+      if (ret < 0)
+	{
+	  free (times);
+	  return -1;
+	}
+
+      qsort (times, runs, sizeof (double), bench_cmp_time);
+
+      fprintf (out, "{\"file\":");
+      trace_write_str (out, file_name);
+      fprintf (out, ",\"runs\":%i,\"time\":%.6f,\"peak\":%lu,\"max_rss\":%li}\n",
+	       runs, times[runs / 2], (unsigned long) peak, bench_max_rss ());
+    }
+
+  free (times);
+
+  fflush (out);
+  if (ferror (out))
+    {
+      perror (NULL);
+      return -1;
+    }
+
+  return 0;
+}
@@ -39,6 +39,10 @@
 #include "var.h"
 #include "interop-isar.h"
 #include "proof.h"
+#include "eval-job.h"
+
+#define MEM_SUBSYSTEM MEM_GUI
+#include "mem.h"
 
 // Menu order from aris proof.
 
@@ -252,6 +256,17 @@ sentence_mapped (GtkWidget * widget, GdkRectangle * rect, gpointer data)
   g_signal_handler_disconnect (sen->entry, sen->sig_id);
 }
 
+/* Calls sen_parent_queue_layout (sen-parent.h) when a sentence parent
+ *  is scrolled or resized.
+ *  input:
+ *    data - the sentence parent whose view changed.
+ */
+G_MODULE_EXPORT void
+sen_parent_scrolled (GtkAdjustment * adj, gpointer data)
+{
+  sen_parent_queue_layout ((sen_parent *) data);
+}
+
 /* Processes the goal's menu being activated; uses the goal of the focused gui.
  *  input:
  *    data - the menu id of the menu item being activated.
@@ -660,6 +675,8 @@ gui_save (aris_proof * ap, int save_as)
       if (ret < 0)
 	return -1;
 
+      proof_destroy (proof);
+
       ret = aris_proof_set_changed (ap, 0);
       if (ret < 0)
 	return -1;
@@ -672,109 +689,20 @@ gui_save (aris_proof * ap, int save_as)
   return 0;
 }
 
-/* Evaluates a sentence.
+/* Evaluates a sentence in the background.
  *  input:
  *    ap - the aris proof containing the sentence being evaluated.
  *    sen - the sentence being evaluated.
  *  output:
- *    0 on success, -1 on memory error, non-zero on generic error.
+ *    0 on success, -1 on memory error.
  */
 int
 evaluate_line (aris_proof * ap, sentence * sen)
 {
-  item_t * ev_itr, * ret_chk;
-  int ret;
-  list_t * lines;
-  sen_data * tmp_sd;
-
-  lines = init_list ();
-  if (!lines)
-    return -1;
-
-  for (ev_itr = SEN_PARENT (ap)->everything->head;
-       ev_itr != SEN_PARENT (ap)->focused; ev_itr = ev_itr->next)
-    {
-      sentence * ev_sen = ev_itr->value;
-      if (ev_sen->text[0] == '\0')
-	continue;
-
-      if (!ev_sen->sexpr)
-	{
-	  ret = check_text (ev_sen->text);
-	  if (ret == -1)
-	    return -1;
-
-	  if (ret != 0)
-	    continue;
-
-	  unsigned char * tmp_str, * sexpr_sen;
-	  tmp_str = die_spaces_die (ev_sen->text);
-	  if (!tmp_str)
-	    return -1;
-
-	  sexpr_sen = convert_sexpr (tmp_str);
-	  if (!sexpr_sen)
-	    return -1;
-	  free (tmp_str);
-	  ev_sen->sexpr = sexpr_sen;
-	}
-
-      ret = sentence_can_select_as_ref (sen, ev_sen);
-
-      if (ret == ev_sen->line_num)
-	{
-	  int arb = (ev_sen->premise || ev_sen->rule == RULE_EI || ev_sen->subproof) ?
-	    0 : 1;
-	  ret = sexpr_collect_vars_to_proof (ap->vars, ev_sen->sexpr, arb);
-	  if (ret == -1)
-	    return -1;
-	}
-    }
-
-  // Construct lines.
-
-  for (ev_itr = SEN_PARENT (ap)->everything->head;
-       ev_itr; ev_itr = ev_itr->next)
-    {
-      sentence * ev_sen;
-      ev_sen = ev_itr->value;
-
-      tmp_sd = sentence_copy_to_data (ev_sen);
-      if (!tmp_sd)
-	return -1;
-
-      ret_chk = ls_push_obj (lines, tmp_sd);
-      if (!ret_chk)
-	return -1;
-    }
-
-  // Get the sentence data.
-  sen_data * sd;
-  sd = sentence_copy_to_data (sen);
-  if (!sd)
-    return -1;
-
-  char * ret_str;
-  ret_str = sen_data_evaluate (sd, &ret, ap->vars, lines);
-  if (!ret_str)
-    return -1;
-
-  sentence_set_value (sen, ret);
-  aris_proof_set_sb (ap, ret_str);
-
-  for (ev_itr = lines->head; ev_itr; ev_itr = ev_itr->next)
-    {
-      sen_data * sd;
-      sd = ev_itr->value;
-      sen_data_destroy (sd);
-    }
-
-  destroy_list (lines);
-
-  return ret;
+  return eval_job_start (ap, sentence_get_line_no (sen));
 }
 
-/* Evaluates an aris proof.
+/* Evaluates an aris proof in the background.
  *  input:
  *    ap - the aris proof to evaluate.
  *  output:
@@ -783,50 +711,20 @@ evaluate_line (aris_proof * ap, sentence * sen)
 int
 evaluate_proof (aris_proof * ap)
 {
-  item_t * ev_itr;
-  sentence * sen;
-  int ret;
-
-  for (ev_itr = SEN_PARENT (ap)->everything->head; ev_itr; ev_itr = ev_itr->next)
-    {
-      sentence * ev_sen = ev_itr->value;
-
-      if (!ev_sen->sexpr)
-	{
-	  if (ev_sen->text[0] == '\0')
-	    continue;
-
-	  ret = check_text (ev_sen->text);
-	  if (ret == -1)
-	    return -1;
-
-	  if (ret != 0)
-	    continue;
-
-	  unsigned char * tmp_str, * sexpr;
-	  tmp_str = die_spaces_die (ev_sen->text);
-	  if (!tmp_str)
-	    return -1;
-
-	  sexpr = convert_sexpr (tmp_str);
-	  if (!sexpr)
-	    return -1;
-	  free (tmp_str);
-	  ev_sen->sexpr = sexpr;
-	}
-    }
-
-  for (ev_itr = SEN_PARENT (ap)->everything->head; ev_itr; ev_itr = ev_itr->next)
-    {
-      sen = ev_itr->value;
-      ret = evaluate_line (ap, sen);
-      if (ret == -1)
-	return -1;
-
-      ls_clear (ap->vars);
-    }
+  return eval_job_start (ap, 0);
+}
 
-  return 0;
+/* Finds the rules that accept a sentence in the background.
+ *  input:
+ *    ap - the aris proof that contains the sentence.
+ *    sen - the sentence whose rules to find.
+ *  output:
+ *    0 on success, -1 on error.
+ */
+int
+infer_rules (aris_proof * ap, sentence * sen)
+{
+  return eval_job_infer (ap, sentence_get_line_no (sen));
 }
 
 /* Toggles the goal window.
@@ -1029,6 +927,15 @@ menu_activated (aris_proof * ap, int menu_id)
       font_large = (GtkWidget *) g_list_first(gl)->next->next->data;
     }
 
+  // Each change to the lines is a step of its own, apart from the
+  // typing that came before it.
+  if (menu_id >= MENU_ADD_PREM && menu_id <= MENU_INSERT)
+    {
+      ret = aris_proof_history_commit (ap);
+      if (ret < 0)
+	return -1;
+    }
+
   switch (menu_id)
     {
     case MENU_NEW:
@@ -1106,13 +1013,35 @@ menu_activated (aris_proof * ap, int menu_id)
       ret = aris_proof_yank (ap);
       aris_proof_set_sb (ap, _("Sentence Inserted."));
       break;
+    case MENU_UNDO:
+      ret = aris_proof_undo (ap);
+      if (ret < 0)
+	return -1;
+
+      if (ret == 1)
+	aris_proof_set_sb (ap, _("There is nothing to undo."));
+      else
+	aris_proof_set_sb (ap, _("Edit Undone."));
+      break;
+    case MENU_REDO:
+      ret = aris_proof_redo (ap);
+      if (ret < 0)
+	return -1;
+
+      if (ret == 1)
+	aris_proof_set_sb (ap, _("There is nothing to redo."));
+      else
+	aris_proof_set_sb (ap, _("Edit Redone."));
+      break;
     case MENU_EVAL_LINE:
-      ls_clear (ap->vars);
       evaluate_line (ap, SENTENCE (SEN_PARENT (ap)->focused->value));
       break;
     case MENU_EVAL_PROOF:
       ret = evaluate_proof (ap);
       break;
+    case MENU_INFER_RULES:
+      ret = infer_rules (ap, SENTENCE (SEN_PARENT (ap)->focused->value));
+      break;
     case MENU_GOAL:
       gui_goal_check (ap);
       break;
@@ -1182,5 +1111,13 @@ menu_activated (aris_proof * ap, int menu_id)
       break;
     }
 
+  // Then the change is recorded by itself.
+  if (menu_id >= MENU_ADD_PREM && menu_id <= MENU_INSERT)
+    {
+      ret = aris_proof_history_commit (ap);
+      if (ret < 0)
+	return -1;
+    }
+
   return 0;
 }
@@ -68,6 +68,7 @@ G_MODULE_EXPORT void sentence_changed (GtkTextView * edit, gpointer data);
 G_MODULE_EXPORT void sentence_mapped (GtkWidget * widget,
 				      GdkRectangle * rect,
 				      gpointer data);
+G_MODULE_EXPORT void sen_parent_scrolled (GtkAdjustment * adj, gpointer data);
 					  
 
 G_MODULE_EXPORT void goal_menu_activate (GtkMenuItem * item, gpointer data);
@@ -93,6 +94,7 @@ int gui_open (GtkWidget * window);
 
 int evaluate_line (aris_proof * ap, sentence * sen);
 int evaluate_proof (aris_proof * ap);
+int infer_rules (aris_proof * ap, sentence * sen);
 
 int gui_keydown (aris_proof * ap, unsigned int mask, unsigned int val);
 int gui_goal_check (aris_proof * ap);
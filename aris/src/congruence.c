@@ -0,0 +1,546 @@
+/* Congruence closure over formula trees.
+
+   Copyright (C) 2012 Ian Dunn.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "congruence.h"
+#include "formula.h"
+#include "sexpr-process.h"
+
+#define MEM_SUBSYSTEM MEM_RULES
+#include "mem.h"
+
+/* Main Idea:
+ *  Every distinct subterm of the formulas that are added becomes a node
+ *  of a graph, whose edges go from a list or quantifier to its children.
+ *  The nodes are kept in classes by a union-find, and each class keeps
+ *  the nodes that use one of its members as a child.  When two classes
+ *  are merged, the users of the smaller one are looked up again in a
+ *  table of signatures, the label of a node and the classes of its
+ *  children, so that nodes whose children became equal are merged as
+ *  well.  Merging n nodes takes O(n log n) time.
+ */
+
+#define CONGRUENCE_HASH(h,c) (((h) ^ (c)) * 16777619u)
+
+// A node of the term graph.
+
+struct congruence_node {
+  formula_t * fm;       // The subterm of the node.
+  int * args;           // The nodes of the children, or NULL for leaves.
+  int parent;           // The parent in the union-find.
+  int size;             // For the root of a class, the amount of users.
+  int uses;             // For the root of a class, the first user, or -1.
+  int last_use;         // For the root of a class, the last user, or -1.
+};
+
+// An entry of a list of users, or of a chain of the signature table.
+
+struct congruence_link {
+  int node;             // The node.
+  int next;             // The next entry, or -1.
+};
+
+// The term graph, its classes and its signature table.
+
+struct congruence {
+  struct congruence_node * nodes;  // The nodes.
+  int num_nodes;                   // The amount of nodes.
+  int size_nodes;                  // The space allocated for the nodes.
+  struct congruence_link * links;  // The entries of user lists and chains.
+  int num_links;                   // The amount of entries.
+  int size_links;                  // The space allocated for the entries.
+  int * buckets;                   // The chains of the signature table.
+  int num_buckets;                 // The amount of chains, a power of two.
+  int num_sigs;                    // The amount of entries in the chains.
+  int * pending;                   // The pairs of nodes waiting to be merged.
+  int num_pending;                 // The amount of nodes in pending.
+  int size_pending;                // The space allocated for pending.
+};
+
+/* Initializes an empty congruence.
+ *  input:
+ *    none.
+ *  output:
+ *    the congruence, or NULL on memory error.
+ */
+congruence_t *
+congruence_init ()
+{
+  congruence_t * cc;
+  int i;
+
+  cc = (congruence_t *) calloc (1, sizeof (congruence_t));
+  CHECK_ALLOC (cc, NULL);
+
+  cc->num_buckets = 64;
+  cc->buckets = (int *) calloc (cc->num_buckets, sizeof (int));
+  CHECK_ALLOC (cc->buckets, NULL);
+
+  for (i = 0; i < cc->num_buckets; i++)
+    cc->buckets[i] = -1;
+
+  return cc;
+}
+
+/* Destroys a congruence.  The formulas that were added aren't freed.
+ *  input:
+ *    cc - the congruence to destroy.
+ *  output:
+ *    none.
+ */
+void
+congruence_destroy (congruence_t * cc)
+{
+  int i;
+
+  for (i = 0; i < cc->num_nodes; i++)
+    free (cc->nodes[i].args);
+
+  free (cc->nodes);
+  free (cc->links);
+  free (cc->buckets);
+  free (cc->pending);
+  free (cc);
+}
+
+/* Finds the root of a node's class, shortening the path to it.
+ *  input:
+ *    cc - the congruence.
+ *    node - the node.
+ *  output:
+ *    the root of the class.
+ */
+static int
+congruence_find (congruence_t * cc, int node)
+{
+  struct congruence_node * nodes = cc->nodes;
+
+  while (nodes[node].parent != node)
+    {
+      nodes[node].parent = nodes[nodes[node].parent].parent;
+      node = nodes[node].parent;
+    }
+
+  return node;
+}
+
+/* Gets the hash of a node's signature, from the classes of its children.
+ *  input:
+ *    cc - the congruence.
+ *    node - the node.
+ *  output:
+ *    the hash.
+ */
+static unsigned int
+congruence_sig_hash (congruence_t * cc, int node)
+{
+  struct congruence_node * nd = cc->nodes + node;
+  unsigned int hash = 2166136261u;
+  int i;
+
+  // Leaves are their own signature.
+
+  if (!nd->args)
+    return nd->fm->hash;
+
+  hash = CONGRUENCE_HASH (hash, nd->fm->type);
+  hash = CONGRUENCE_HASH (hash, nd->fm->quant);
+
+  for (i = 0; i < nd->fm->num_args; i++)
+    hash = CONGRUENCE_HASH (hash, congruence_find (cc, nd->args[i]));
+
+  return hash;
+}
+
+/* Determines whether two nodes have the same signature.
+ *  input:
+ *    cc - the congruence.
+ *    a, b - the nodes.
+ *  output:
+ *    1 if they do, 0 otherwise.
+ */
+static int
+congruence_sig_equal (congruence_t * cc, int a, int b)
+{
+  struct congruence_node * na = cc->nodes + a, * nb = cc->nodes + b;
+  int i;
+
+  if (!na->args || !nb->args)
+    return (!na->args && !nb->args && formula_equal (na->fm, nb->fm));
+
+  if (na->fm->type != nb->fm->type || na->fm->quant != nb->fm->quant
+      || na->fm->num_args != nb->fm->num_args)
+    return 0;
+
+  for (i = 0; i < na->fm->num_args; i++)
+    if (congruence_find (cc, na->args[i]) != congruence_find (cc, nb->args[i]))
+      return 0;
+
+  return 1;
+}
+
+/* Adds an entry to the list of entries.
+ *  input:
+ *    cc - the congruence.
+ *    node - the node of the entry.
+ *    next - the next entry, or -1.
+ *  output:
+ *    the index of the entry, or -1 on memory error.
+ */
+static int
+congruence_link (congruence_t * cc, int node, int next)
+{
+  struct congruence_link * links;
+  int size;
+
+  if (cc->num_links == cc->size_links)
+    {
+      size = cc->size_links ? cc->size_links * 2 : 64;
+      links = (struct congruence_link *)
+	realloc (cc->links, size * sizeof (struct congruence_link));
+      CHECK_ALLOC (links, -1);
+
+      cc->links = links;
+      cc->size_links = size;
+    }
+
+  cc->links[cc->num_links].node = node;
+  cc->links[cc->num_links].next = next;
+
+  return cc->num_links++;
+}
+
+/* Looks for a node with the same signature as another.
+ *  input:
+ *    cc - the congruence.
+ *    node - the node to look for.
+ *    hash - the hash of its signature.
+ *  output:
+ *    a different node with the same signature, or -1 if there is none.
+ */
+static int
+congruence_sig_find (congruence_t * cc, int node, unsigned int hash)
+{
+  int link, other;
+
+  // The table may still hold nodes under their old signatures.  Those
+  // are only returned when their current signature matches as well.
+
+  for (link = cc->buckets[hash & (cc->num_buckets - 1)]; link != -1;
+       link = cc->links[link].next)
+    {
+      other = cc->links[link].node;
+      if (other != node && congruence_sig_equal (cc, node, other))
+	return other;
+    }
+
+  return -1;
+}
+
+/* Adds a node to the signature table.
+ *  input:
+ *    cc - the congruence.
+ *    node - the node to add.
+ *    hash - the hash of its signature.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+static int
+congruence_sig_add (congruence_t * cc, int node, unsigned int hash)
+{
+  int * buckets, num_buckets, i, link, next;
+
+  // Grow the table once it has twice as many entries as chains.
+
+  if (cc->num_sigs >= cc->num_buckets * 2)
+    {
+      num_buckets = cc->num_buckets * 2;
+      buckets = (int *) calloc (num_buckets, sizeof (int));
+      CHECK_ALLOC (buckets, -1);
+
+      for (i = 0; i < num_buckets; i++)
+	buckets[i] = -1;
+
+      for (i = 0; i < cc->num_buckets; i++)
+	{
+	  for (link = cc->buckets[i]; link != -1; link = next)
+	    {
+	      unsigned int h;
+
+	      next = cc->links[link].next;
+	      h = congruence_sig_hash (cc, cc->links[link].node);
+	      cc->links[link].next = buckets[h & (num_buckets - 1)];
+	      buckets[h & (num_buckets - 1)] = link;
+	    }
+	}
+
+      free (cc->buckets);
+      cc->buckets = buckets;
+      cc->num_buckets = num_buckets;
+      hash = congruence_sig_hash (cc, node);
+    }
+
+  link = congruence_link (cc, node,
+			  cc->buckets[hash & (cc->num_buckets - 1)]);
+  if (link == -1)
+    return -1;
+
+  cc->buckets[hash & (cc->num_buckets - 1)] = link;
+  cc->num_sigs++;
+
+  return 0;
+}
+
+/* Adds a pair of nodes to be merged.
+ *  input:
+ *    cc - the congruence.
+ *    a, b - the nodes.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+static int
+congruence_push (congruence_t * cc, int a, int b)
+{
+  int * pending, size;
+
+  if (cc->num_pending + 2 > cc->size_pending)
+    {
+      size = cc->size_pending ? cc->size_pending * 2 : 32;
+      pending = (int *) realloc (cc->pending, size * sizeof (int));
+      CHECK_ALLOC (pending, -1);
+
+      cc->pending = pending;
+      cc->size_pending = size;
+    }
+
+  cc->pending[cc->num_pending++] = a;
+  cc->pending[cc->num_pending++] = b;
+
+  return 0;
+}
+
+/* Adds a formula and its subterms to the term graph.  A formula that
+ * is already in the graph, or is congruent to one that is, gives the
+ * node of that one.
+ *  input:
+ *    cc - the congruence.
+ *    fm - the formula to add, which must outlive the congruence.
+ *  output:
+ *    the node of the formula, or -1 on memory error.
+ */
+int
+congruence_add (congruence_t * cc, formula_t * fm)
+{
+  struct congruence_node * nodes, * nd;
+  unsigned int hash;
+  int * args = NULL;
+  int i, node, root, size;
+
+  if (fm->num_args > 0)
+    {
+      args = (int *) calloc (fm->num_args, sizeof (int));
+      CHECK_ALLOC (args, -1);
+
+      for (i = 0; i < fm->num_args; i++)
+	{
+	  args[i] = congruence_add (cc, fm->args[i]);
+	  if (args[i] == -1)
+	    {
+	      free (args);
+	      return -1;
+	    }
+	}
+    }
+
+  if (cc->num_nodes == cc->size_nodes)
+    {
+      size = cc->size_nodes ? cc->size_nodes * 2 : 64;
+      nodes = (struct congruence_node *)
+	realloc (cc->nodes, size * sizeof (struct congruence_node));
+      CHECK_ALLOC (nodes, -1);
+
+      cc->nodes = nodes;
+      cc->size_nodes = size;
+    }
+
+  // The node is only kept if no node has its signature yet.
+
+  node = cc->num_nodes;
+  nd = cc->nodes + node;
+  nd->fm = fm;
+  nd->args = args;
+  nd->parent = node;
+  nd->size = 0;
+  nd->uses = nd->last_use = -1;
+
+  hash = congruence_sig_hash (cc, node);
+  i = congruence_sig_find (cc, node, hash);
+  if (i != -1)
+    {
+      free (args);
+      return i;
+    }
+
+  cc->num_nodes++;
+  if (congruence_sig_add (cc, node, hash) == -1)
+    return -1;
+
+  for (i = 0; i < fm->num_args; i++)
+    {
+      root = congruence_find (cc, args[i]);
+      nd = cc->nodes + root;
+
+      nd->uses = congruence_link (cc, node, nd->uses);
+      if (nd->uses == -1)
+	return -1;
+
+      if (nd->last_use == -1)
+	nd->last_use = nd->uses;
+      nd->size++;
+    }
+
+  return node;
+}
+
+/* Merges the classes of two nodes, and every class that becomes equal
+ * by congruence as a result.
+ *  input:
+ *    cc - the congruence.
+ *    a, b - the nodes to merge.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+int
+congruence_merge (congruence_t * cc, int a, int b)
+{
+  struct congruence_node * ra, * rb;
+  unsigned int hash;
+  int root_a, root_b, link, user, other;
+
+  if (congruence_push (cc, a, b) == -1)
+    return -1;
+
+  while (cc->num_pending > 0)
+    {
+      cc->num_pending -= 2;
+      root_a = congruence_find (cc, cc->pending[cc->num_pending]);
+      root_b = congruence_find (cc, cc->pending[cc->num_pending + 1]);
+
+      if (root_a == root_b)
+	continue;
+
+      // The class with fewer users is merged into the other.
+
+      if (cc->nodes[root_a].size < cc->nodes[root_b].size)
+	{
+	  other = root_a;
+	  root_a = root_b;
+	  root_b = other;
+	}
+
+      ra = cc->nodes + root_a;
+      rb = cc->nodes + root_b;
+      rb->parent = root_a;
+
+      for (link = rb->uses; link != -1; link = cc->links[link].next)
+	{
+	  user = cc->links[link].node;
+	  hash = congruence_sig_hash (cc, user);
+
+	  other = congruence_sig_find (cc, user, hash);
+	  if (other != -1)
+	    {
+	      if (congruence_push (cc, user, other) == -1)
+		return -1;
+	    }
+	  else if (congruence_sig_add (cc, user, hash) == -1)
+	    return -1;
+	}
+
+      if (rb->uses != -1)
+	{
+	  if (ra->uses == -1)
+	    ra->uses = rb->uses;
+	  else
+	    cc->links[ra->last_use].next = rb->uses;
+
+	  ra->last_use = rb->last_use;
+	  ra->size += rb->size;
+	}
+
+      rb->uses = rb->last_use = -1;
+      rb->size = 0;
+    }
+
+  return 0;
+}
+
+/* Determines whether two nodes are in the same class.
+ *  input:
+ *    cc - the congruence.
+ *    a, b - the nodes.
+ *  output:
+ *    1 if they are, 0 otherwise.
+ */
+int
+congruence_equal (congruence_t * cc, int a, int b)
+{
+  return (congruence_find (cc, a) == congruence_find (cc, b));
+}
+
+/* Determines whether two formulas are equal by the given identities,
+ * with any amount of their occurrences substituted.
+ *  input:
+ *    a, b - the formulas to compare.
+ *    eqs - the identities, each of the form (= x y).
+ *    num_eqs - the amount of identities.
+ *  output:
+ *    1 if the formulas are congruent, 0 if they aren't, -1 on memory error.
+ */
+int
+congruence_check (formula_t * a, formula_t * b, formula_t ** eqs,
+		  int num_eqs)
+{
+  congruence_t * cc;
+  int node_a, node_b, lhs, rhs, i, ret;
+
+  cc = congruence_init ();
+  if (!cc)
+    return -1;
+
+  node_a = congruence_add (cc, a);
+  node_b = (node_a == -1) ? -1 : congruence_add (cc, b);
+
+  ret = (node_b == -1) ? -1 : 0;
+  for (i = 0; ret == 0 && i < num_eqs; i++)
+    {
+      lhs = congruence_add (cc, eqs[i]->args[1]);
+      rhs = (lhs == -1) ? -1 : congruence_add (cc, eqs[i]->args[2]);
+
+      if (rhs == -1 || congruence_merge (cc, lhs, rhs) == -1)
+	ret = -1;
+    }
+
+  if (ret == 0)
+    ret = congruence_equal (cc, node_a, node_b);
+
+  congruence_destroy (cc);
+  return ret;
+}
@@ -0,0 +1,33 @@
+/* Congruence closure over formula trees.
+
+   Copyright (C) 2012 Ian Dunn.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ARIS_CONGRUENCE_H
+#define ARIS_CONGRUENCE_H
+
+typedef struct congruence congruence_t;
+typedef struct formula formula_t;
+
+congruence_t * congruence_init ();
+void congruence_destroy (congruence_t * cc);
+int congruence_add (congruence_t * cc, formula_t * fm);
+int congruence_merge (congruence_t * cc, int a, int b);
+int congruence_equal (congruence_t * cc, int a, int b);
+int congruence_check (formula_t * a, formula_t * b, formula_t ** eqs,
+		      int num_eqs);
+
+#endif /* ARIS_CONGRUENCE_H */
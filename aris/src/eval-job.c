@@ -0,0 +1,395 @@
+/* Functions for evaluating proofs in the background.
+
+   Copyright (C) 2012 Ian Dunn.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <gtk/gtk.h>
+#include <libxml/parser.h>
+
+#include "eval-job.h"
+#include "aris-proof.h"
+#include "sen-parent.h"
+#include "sentence.h"
+#include "sen-data.h"
+#include "proof.h"
+#include "list.h"
+#include "vec.h"
+#include "process.h"
+#include "rule-search.h"
+
+#define MEM_SUBSYSTEM MEM_RULES
+#include "mem.h"
+
+// The interval, in milliseconds, at which results are posted.
+
+#define EVAL_JOB_POLL 50
+
+// The result of a single line.
+
+struct eval_result {
+  int line_num;    // The line that was evaluated.
+  int value_type;  // The value type of the line.
+  char * text;     // The result of the evaluation, owned by the job
+                   // when its rules are being found.
+};
+
+/* Releases a reference to a job, destroying it with the last one.
+ *  input:
+ *    job - the job to release.
+ *  output:
+ *    none.
+ */
+static void
+eval_job_unref (eval_job * job)
+{
+  int ref_count, i;
+
+  pthread_mutex_lock (&job->lock);
+  ref_count = --job->ref_count;
+  pthread_mutex_unlock (&job->lock);
+
+  if (ref_count > 0)
+    return;
+
+  if (job->infer)
+    {
+      for (i = 0; i < job->results->num_stuff; i++)
+	free (((struct eval_result *) vec_nth (job->results, i))->text);
+    }
+
+  proof_destroy (job->proof);
+  destroy_vec (job->results);
+  destroy_vec (job->posting);
+  pthread_mutex_destroy (&job->lock);
+  free (job);
+}
+
+/* Queues the result of a line to be posted.  Called from the worker.
+ *  input:
+ *    job - the job that evaluated the line.
+ *    line_num - the line number of the line.
+ *    value_type - the value type of the line.
+ *    text - the result of the evaluation.
+ *  output:
+ *    0 on success, 1 if the job was cancelled, -1 on memory error.
+ */
+static int
+eval_job_post (eval_job * job, int line_num, int value_type, char * text)
+{
+  struct eval_result res;
+  int ret = 0;
+
+  res.line_num = line_num;
+  res.value_type = value_type;
+  res.text = text;
+
+  pthread_mutex_lock (&job->lock);
+  if (job->cancelled)
+    ret = 1;
+  else if (vec_add_obj (job->results, &res) < 0)
+    ret = -1;
+  pthread_mutex_unlock (&job->lock);
+
+  return ret;
+}
+
+/* Queues the result of a line from proof_eval_each.
+ *  input:
+ *    sd - the line that was evaluated.
+ *    ret_val - the value type of the line.
+ *    ret_chk - the result of the evaluation.
+ *    data - the job.
+ *  output:
+ *    0 on success, 1 if the job was cancelled, -1 on memory error.
+ */
+static int
+eval_job_report (sen_data * sd, int ret_val, char * ret_chk, void * data)
+{
+  return eval_job_post ((eval_job *) data, sd->line_num, ret_val, ret_chk);
+}
+
+/* Finds the rules that accept the line of a job.
+ *  input:
+ *    job - the job.
+ *  output:
+ *    the message listing the rules, or NULL on memory error.
+ */
+static char *
+eval_job_infer_rules (eval_job * job)
+{
+  vec_t * found;
+  rule_search_line * line;
+  char * names, * text;
+  const char * fmt;
+  int ret;
+
+  found = init_vec (sizeof (rule_search_line));
+  if (!found)
+    return NULL;
+
+  ret = proof_infer (job->proof, job->line_num, 0, found);
+  if (ret == -1)
+    return NULL;
+
+  line = vec_nth (found, 0);
+  if (!line)
+    {
+      destroy_vec (found);
+      return strdup (_("Rules can only be found for conclusions."));
+    }
+
+  names = rule_search_names (line->rules);
+  rule_search_line_clear (line);
+  destroy_vec (found);
+
+  if (!names)
+    return NULL;
+
+  if (names[0] == '\0')
+    fmt = _("No rule accepts this line.");
+  else
+    fmt = _("Rules that accept this line: %s");
+
+  text = (char *) calloc (strlen (fmt) + strlen (names) + 1, sizeof (char));
+  CHECK_ALLOC (text, NULL);
+
+  sprintf (text, fmt, names);
+  free (names);
+
+  return text;
+}
+
+/* Evaluates the snapshot of a job.  This is the worker thread.
+ *  input:
+ *    arg - the job.
+ *  output:
+ *    NULL.
+ */
+static void *
+eval_job_run (void * arg)
+{
+  eval_job * job = arg;
+
+  if (job->infer)
+    {
+      char * text;
+
+      text = eval_job_infer_rules (job);
+      if (text && eval_job_post (job, job->line_num, -1, text) != 0)
+	free (text);
+    }
+  else if (job->line_num > 0)
+    {
+      char * ret_chk;
+      int ret_val;
+
+      ret_chk = proof_eval_line (job->proof, job->line_num, &ret_val);
+      if (ret_chk)
+	eval_job_post (job, job->line_num, ret_val, ret_chk);
+    }
+  else
+    {
+      proof_eval_each (job->proof, eval_job_report, job, NULL);
+    }
+
+  pthread_mutex_lock (&job->lock);
+  job->done = 1;
+  pthread_mutex_unlock (&job->lock);
+
+  eval_job_unref (job);
+  return NULL;
+}
+
+/* Posts the results of a job to its proof.  Runs in the main loop.
+ *  input:
+ *    data - the job.
+ *  output:
+ *    TRUE while the job is still running, FALSE once it is finished.
+ */
+static gboolean
+eval_job_poll (gpointer data)
+{
+  eval_job * job = data;
+  vec_t * tmp;
+  int done, i;
+
+  pthread_mutex_lock (&job->lock);
+  tmp = job->posting;
+  job->posting = job->results;
+  job->results = tmp;
+  done = job->done;
+  pthread_mutex_unlock (&job->lock);
+
+  // The job is only cancelled from the main thread.
+  if (!job->cancelled)
+    {
+      aris_proof * ap = job->ap;
+      struct eval_result * res = NULL;
+      item_t * itm;
+
+      // The proof can't have changed, so the sentences are found by
+      // their line numbers.
+
+      for (i = 0; i < job->posting->num_stuff; i++)
+	{
+	  res = vec_nth (job->posting, i);
+
+	  // Finding the rules of a line leaves its value as it is.
+	  if (job->infer)
+	    continue;
+
+	  itm = sen_parent_nth (SEN_PARENT (ap), res->line_num - 1);
+	  if (itm)
+	    sentence_set_value (SENTENCE (itm->value), res->value_type);
+	}
+
+      if (res)
+	aris_proof_set_sb (ap, res->text);
+
+      if (job->infer)
+	{
+	  for (i = 0; i < job->posting->num_stuff; i++)
+	    free (((struct eval_result *) vec_nth (job->posting, i))->text);
+	}
+
+      if (done)
+	{
+	  ap->job = NULL;
+	  eval_job_unref (job);
+	}
+    }
+
+  job->posting->num_stuff = 0;
+
+  if (done || job->cancelled)
+    {
+      eval_job_unref (job);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+/* Starts a job on an aris proof, cancelling any job that is already running.
+ *  input:
+ *    ap - the aris proof.
+ *    line_num - the line of the job, or 0 for every line.
+ *    infer - whether to find the rules of the line, or to evaluate it.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+static int
+eval_job_begin (aris_proof * ap, int line_num, int infer)
+{
+  eval_job * job;
+  pthread_t thread;
+
+  eval_job_cancel (ap);
+
+  job = (eval_job *) calloc (1, sizeof (eval_job));
+  CHECK_ALLOC (job, -1);
+
+  job->proof = aris_proof_to_proof (ap);
+  if (!job->proof)
+    return -1;
+
+  job->results = init_vec (sizeof (struct eval_result));
+  if (!job->results)
+    return -1;
+
+  job->posting = init_vec (sizeof (struct eval_result));
+  if (!job->posting)
+    return -1;
+
+  job->ap = ap;
+  job->line_num = line_num;
+  job->infer = infer;
+  job->cancelled = job->done = 0;
+
+  // One reference each for the proof, the worker, and the poll.
+  job->ref_count = 3;
+  pthread_mutex_init (&job->lock, NULL);
+
+  ap->job = job;
+
+  // libxml2 must be initialized before lemmas are loaded from the worker.
+  xmlInitParser ();
+
+  aris_proof_set_sb (ap, infer ? _("Finding rules...") : _("Evaluating..."));
+  g_timeout_add (EVAL_JOB_POLL, eval_job_poll, job);
+
+  // Without another thread, evaluate the proof right away.
+  if (pthread_create (&thread, NULL, eval_job_run, job))
+    eval_job_run (job);
+  else
+    pthread_detach (thread);
+
+  return 0;
+}
+
+/* Starts evaluating an aris proof in the background, cancelling any
+ * evaluation that is already running.
+ *  input:
+ *    ap - the aris proof to evaluate.
+ *    line_num - the line to evaluate, or 0 to evaluate every line.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+int
+eval_job_start (aris_proof * ap, int line_num)
+{
+  return eval_job_begin (ap, line_num, 0);
+}
+
+/* Starts finding the rules that accept a line of an aris proof in the
+ * background, cancelling any evaluation that is already running.
+ *  input:
+ *    ap - the aris proof.
+ *    line_num - the line whose rules to find.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+int
+eval_job_infer (aris_proof * ap, int line_num)
+{
+  return eval_job_begin (ap, line_num, 1);
+}
+
+/* Cancels the evaluation of an aris proof, if one is running.
+ *  input:
+ *    ap - the aris proof.
+ *  output:
+ *    none.
+ */
+void
+eval_job_cancel (aris_proof * ap)
+{
+  eval_job * job = ap->job;
+
+  if (!job)
+    return;
+
+  pthread_mutex_lock (&job->lock);
+  job->cancelled = 1;
+  pthread_mutex_unlock (&job->lock);
+
+  job->ap = NULL;
+  ap->job = NULL;
+  eval_job_unref (job);
+}
@@ -0,0 +1,56 @@
+/* Background evaluation job data type.
+
+   Copyright (C) 2012 Ian Dunn.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ARIS_EVAL_JOB_H
+#define ARIS_EVAL_JOB_H
+
+#include <pthread.h>
+
+typedef struct eval_job eval_job;
+typedef struct aris_proof aris_proof;
+typedef struct proof proof_t;
+typedef struct vector vec_t;
+typedef struct item item_t;
+
+// An evaluation running on a worker thread.  The worker evaluates a
+// snapshot of the proof, and the main thread polls for its results,
+// so that only the main thread touches the widgets.  The job is shared
+// by the proof, the worker and the poll, and is destroyed with the last
+// of them.
+
+struct eval_job {
+  aris_proof * ap;   // The proof being evaluated, or NULL once cancelled.
+  proof_t * proof;   // The snapshot of the proof.
+  int line_num;      // The line being evaluated, or 0 for all of them.
+  int infer;         // Whether the rules of the line are found instead.
+
+  int ref_count;     // The amount of references to this job.
+  int cancelled;     // Whether or not the proof has changed since.
+  int done;          // Whether or not the worker has finished.
+
+  vec_t * results;   // The results that have yet to be posted.
+  vec_t * posting;   // The results being posted by the main thread.
+
+  pthread_mutex_t lock;
+};
+
+int eval_job_start (aris_proof * ap, int line_num);
+int eval_job_infer (aris_proof * ap, int line_num);
+void eval_job_cancel (aris_proof * ap);
+
+#endif /* ARIS_EVAL_JOB_H */
@@ -0,0 +1,502 @@
+/* Functions for handling formula trees.
+
+   Copyright (C) 2012 Ian Dunn.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "formula.h"
+#include "symbol.h"
+#include "vec.h"
+#include "sexpr-process.h"
+
+#define MEM_SUBSYSTEM MEM_PARSER
+#include "mem.h"
+
+#define FORMULA_HASH(h,c) (((h) ^ (c)) * 16777619u)
+
+// A quantifier that is being parsed, and the quantifiers around it.
+
+struct formula_scope {
+  const unsigned char * var;    // The variable of the quantifier.
+  int var_len;                  // The length of the variable.
+  struct formula_scope * next;  // The quantifier around this one.
+};
+
+/* Allocates a formula node.
+ *  input:
+ *    type - the type of the node.
+ *    text - the text of the node, or NULL.
+ *    len - the length of text.
+ *  output:
+ *    the new node, or NULL on memory error.
+ */
+static formula_t *
+formula_node (int type, const unsigned char * text, int len)
+{
+  formula_t * fm;
+
+  fm = (formula_t *) calloc (1, sizeof (formula_t));
+  CHECK_ALLOC (fm, NULL);
+
+  fm->type = type;
+  fm->sym = -1;
+
+  if (text)
+    {
+      fm->sym = symbol_intern (text, len);
+      if (fm->sym == -1)
+	{
+	  free (fm);
+	  return NULL;
+	}
+
+      fm->text = symbol_text (fm->sym);
+    }
+
+  return fm;
+}
+
+/* Adds a child to a formula node.
+ *  input:
+ *    fm - the node.
+ *    arg - the child to add.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+static int
+formula_add_arg (formula_t * fm, formula_t * arg)
+{
+  // Grow whenever the amount of children reaches a power of two.
+  if ((fm->num_args & (fm->num_args - 1)) == 0)
+    {
+      formula_t ** args;
+      int alloc = fm->num_args ? fm->num_args * 2 : 1;
+
+      args = (formula_t **) realloc (fm->args, alloc * sizeof (formula_t *));
+      CHECK_ALLOC (args, -1);
+      fm->args = args;
+    }
+
+  fm->args[fm->num_args++] = arg;
+  return 0;
+}
+
+/* Determines the loose set and the hash of a formula node from its children.
+ *  input:
+ *    fm - the node.
+ *  output:
+ *    none.
+ */
+static void
+formula_summarize (formula_t * fm)
+{
+  unsigned int hash = 2166136261u;
+  int i;
+
+  hash = FORMULA_HASH (hash, fm->type);
+
+  switch (fm->type)
+    {
+    case FORMULA_SYMBOL:
+      fm->loose = 0;
+      hash = FORMULA_HASH (hash, fm->sym);
+      break;
+
+    case FORMULA_BOUND:
+      fm->loose = (fm->index < FORMULA_LOOSE_MAX)
+	? (1u << fm->index) : FORMULA_LOOSE_DEEP;
+      hash = FORMULA_HASH (hash, fm->index);
+      break;
+
+    case FORMULA_QUANT:
+      // The quantifier's own variable is no longer free.
+      fm->loose = ((fm->args[0]->loose & ~1u) >> 1)
+	| (fm->args[0]->loose & FORMULA_LOOSE_DEEP);
+      hash = FORMULA_HASH (hash, fm->quant);
+      hash = FORMULA_HASH (hash, fm->args[0]->hash);
+      break;
+
+    case FORMULA_LIST:
+      fm->loose = 0;
+      for (i = 0; i < fm->num_args; i++)
+	{
+	  fm->loose |= fm->args[i]->loose;
+	  hash = FORMULA_HASH (hash, fm->args[i]->hash);
+	}
+      break;
+    }
+
+  fm->hash = hash;
+}
+
+/* Parses a single element of a sexpr string.
+ *  input:
+ *    str - the sexpr string.
+ *    pos - the position of the element, which receives the position
+ *      after it.
+ *    scope - the quantifiers around the element.
+ *    head - whether or not the element begins a list.
+ *  output:
+ *    the node of the element, or NULL on memory error.
+ */
+static formula_t *
+formula_parse (const unsigned char * str, int * pos,
+	       struct formula_scope * scope, int head)
+{
+  const unsigned char * c = str + *pos;
+  formula_t * fm, * arg;
+  int len, ret;
+
+  if (c[0] == '(' && c[1] == '('
+      && (!strncmp (c + 2, S_UNV, S_CL) || !strncmp (c + 2, S_EXL, S_CL))
+      && c[2 + S_CL] == ' ')
+    {
+      // A quantifier, ((<quant> var) scope).
+      struct formula_scope inner;
+
+      inner.var = c + 3 + S_CL;
+      for (len = 0; inner.var[len] != ')' && inner.var[len] != '\0'; len++)
+	;
+      inner.var_len = len;
+      inner.next = scope;
+
+      fm = formula_node (FORMULA_QUANT, inner.var, len);
+      if (!fm)
+	return NULL;
+
+      fm->quant = strncmp (c + 2, S_UNV, S_CL) ? FORMULA_EXL : FORMULA_UNV;
+
+      *pos += 3 + S_CL + len;
+      if (str[*pos] == ')')
+	(*pos)++;
+      if (str[*pos] == ' ')
+	(*pos)++;
+
+      arg = formula_parse (str, pos, &inner, 0);
+      if (!arg)
+	return NULL;
+
+      ret = formula_add_arg (fm, arg);
+      if (ret < 0)
+	return NULL;
+
+      if (str[*pos] == ')')
+	(*pos)++;
+    }
+  else if (c[0] == '(')
+    {
+      fm = formula_node (FORMULA_LIST, NULL, 0);
+      if (!fm)
+	return NULL;
+
+      (*pos)++;
+      while (str[*pos] != ')' && str[*pos] != '\0')
+	{
+	  arg = formula_parse (str, pos, scope, fm->num_args == 0);
+	  if (!arg)
+	    return NULL;
+
+	  ret = formula_add_arg (fm, arg);
+	  if (ret < 0)
+	    return NULL;
+
+	  if (str[*pos] == ' ')
+	    (*pos)++;
+	}
+
+      if (str[*pos] == ')')
+	(*pos)++;
+    }
+  else
+    {
+      struct formula_scope * sc;
+      int index = 0;
+
+      for (len = 0; c[len] != ' ' && c[len] != '(' && c[len] != ')'
+	     && c[len] != '\0'; len++)
+	;
+
+      // A variable is bound by the closest quantifier of the same name.
+      sc = NULL;
+      if (!head)
+	for (sc = scope; sc; sc = sc->next, index++)
+	  if (sc->var_len == len && !strncmp (sc->var, c, len))
+	    break;
+
+      fm = formula_node (sc ? FORMULA_BOUND : FORMULA_SYMBOL, c, len);
+      if (!fm)
+	return NULL;
+
+      fm->index = index;
+      *pos += len;
+    }
+
+  formula_summarize (fm);
+  return fm;
+}
+
+/* Builds the tree of a sexpr string.
+ *  input:
+ *    sexpr - the sexpr string.
+ *  output:
+ *    the tree of the string, or NULL on memory error.
+ */
+formula_t *
+formula_init (const unsigned char * sexpr)
+{
+  int pos = 0;
+
+  return formula_parse (sexpr, &pos, NULL, 0);
+}
+
+/* Destroys a formula tree.
+ *  input:
+ *    fm - the tree to destroy.
+ *  output:
+ *    none.
+ */
+void
+formula_destroy (formula_t * fm)
+{
+  int i;
+
+  for (i = 0; i < fm->num_args; i++)
+    formula_destroy (fm->args[i]);
+
+  if (fm->args)
+    free (fm->args);
+  free (fm);
+}
+
+/* Determines whether or not two formulas are the same, up to the names
+ * of their bound variables.
+ *  input:
+ *    a, b - the formulas to compare.
+ *  output:
+ *    1 if they are the same, 0 otherwise.
+ */
+int
+formula_equal (formula_t * a, formula_t * b)
+{
+  int i;
+
+  if (a == b)
+    return 1;
+
+  if (a->hash != b->hash || a->type != b->type || a->num_args != b->num_args)
+    return 0;
+
+  switch (a->type)
+    {
+    case FORMULA_SYMBOL:
+      return (a->sym == b->sym);
+
+    case FORMULA_BOUND:
+      return (a->index == b->index);
+
+    case FORMULA_QUANT:
+      if (a->quant != b->quant)
+	return 0;
+      break;
+    }
+
+  for (i = 0; i < a->num_args; i++)
+    if (!formula_equal (a->args[i], b->args[i]))
+      return 0;
+
+  return 1;
+}
+
+/* Matches a pattern against a formula.
+ *  input:
+ *    pat - the pattern.
+ *    fm - the formula.
+ *    depth - the amount of quantifiers passed within pat.
+ *    num_vars - the amount of pattern variables.
+ *    terms - the terms matched by each pattern variable so far.
+ *  output:
+ *    1 if the pattern matches, 0 otherwise.
+ */
+static int
+formula_match (formula_t * pat, formula_t * fm, int depth, int num_vars,
+	       formula_t ** terms)
+{
+  int i, var;
+
+  // Without pattern variables, the two must be the same.
+  if (depth < FORMULA_LOOSE_MAX && (pat->loose >> depth) == 0)
+    return formula_equal (pat, fm);
+
+  switch (pat->type)
+    {
+    case FORMULA_BOUND:
+      if (pat->index < depth)
+	return (fm->type == FORMULA_BOUND && fm->index == pat->index);
+
+      var = pat->index - depth;
+      if (var >= num_vars)
+	return 0;
+
+      // A term can't refer to a quantifier that it is moved out of.
+      if (fm->loose)
+	return 0;
+
+      if (!terms[var])
+	{
+	  terms[var] = fm;
+	  return 1;
+	}
+
+      return formula_equal (terms[var], fm);
+
+    case FORMULA_QUANT:
+      if (fm->type != FORMULA_QUANT || fm->quant != pat->quant)
+	return 0;
+
+      return formula_match (pat->args[0], fm->args[0], depth + 1,
+			    num_vars, terms);
+
+    case FORMULA_LIST:
+      if (fm->type != FORMULA_LIST || fm->num_args != pat->num_args)
+	return 0;
+
+      for (i = 0; i < pat->num_args; i++)
+	if (!formula_match (pat->args[i], fm->args[i], depth, num_vars, terms))
+	  return 0;
+
+      return 1;
+    }
+
+  return formula_equal (pat, fm);
+}
+
+/* Matches the scope of a series of quantifiers against a formula, finding
+ * the terms with which the quantifiers' variables are instantiated.
+ *  input:
+ *    pat - the scope of the quantifiers.
+ *    fm - the formula.
+ *    num_vars - the amount of quantifiers.
+ *    terms - receives the terms, innermost quantifier first.  A variable
+ *      that doesn't occur in pat receives NULL.
+ *  output:
+ *    1 if the scope matches, 0 otherwise.
+ */
+int
+formula_quant_match (formula_t * pat, formula_t * fm, int num_vars,
+		     formula_t ** terms)
+{
+  int i;
+
+  for (i = 0; i < num_vars; i++)
+    terms[i] = NULL;
+
+  return formula_match (pat, fm, 0, num_vars, terms);
+}
+
+/* Determines whether or not a formula is a list headed by a connective.
+ *  input:
+ *    fm - the formula.
+ *    conn - the sexpr connective, such as S_AND or S_NOT.
+ *  output:
+ *    1 if it is, 0 otherwise.
+ */
+int
+formula_is_conn (formula_t * fm, const unsigned char * conn)
+{
+  return (fm->type == FORMULA_LIST && fm->num_args > 1
+	  && fm->args[0]->type == FORMULA_SYMBOL
+	  && !strcmp (fm->args[0]->text, conn));
+}
+
+/* Determines whether or not two formulas differ only in their children,
+ * so that their children can be compared in place.
+ *  input:
+ *    a, b - the formulas.
+ *  output:
+ *    1 if they have the same shape, 0 otherwise.
+ */
+int
+formula_same_shape (formula_t * a, formula_t * b)
+{
+  if (a->type != b->type || a->num_args != b->num_args)
+    return 0;
+
+  switch (a->type)
+    {
+    case FORMULA_QUANT:
+      return (a->quant == b->quant);
+
+    case FORMULA_LIST:
+      return formula_equal (a->args[0], b->args[0]);
+    }
+
+  return 0;
+}
+
+/* Finds the smallest pair of subformulas that holds every difference
+ * between two formulas, in a single walk down both of them.
+ *  input:
+ *    a, b - the formulas to compare.
+ *    da, db - receive the differing subformulas of a and b.
+ *    path - an integer vector that receives the indices of the children
+ *      taken to reach the difference, or NULL.
+ *  output:
+ *    1 if the formulas differ, 0 if they don't, -1 on memory error.
+ */
+int
+formula_diff (formula_t * a, formula_t * b, formula_t ** da,
+	      formula_t ** db, vec_t * path)
+{
+  int i, diff, ret;
+
+  if (formula_equal (a, b))
+    return 0;
+
+  while (formula_same_shape (a, b))
+    {
+      // Descend only while a single child differs.
+      diff = -1;
+      for (i = 0; i < a->num_args; i++)
+	{
+	  if (formula_equal (a->args[i], b->args[i]))
+	    continue;
+
+	  if (diff != -1)
+	    break;
+	  diff = i;
+	}
+
+      if (i < a->num_args || diff == -1)
+	break;
+
+      if (path)
+	{
+	  ret = vec_add_obj (path, &diff);
+	  if (ret < 0)
+	    return -1;
+	}
+
+      a = a->args[diff];
+      b = b->args[diff];
+    }
+
+  *da = a;
+  *db = b;
+
+  return 1;
+}
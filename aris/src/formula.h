@@ -0,0 +1,79 @@
+/* The formula tree data type.
+
+   Copyright (C) 2012 Ian Dunn.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ARIS_FORMULA_H
+#define ARIS_FORMULA_H
+
+typedef struct formula formula_t;
+typedef struct vector vec_t;
+
+// The types of formula nodes.
+
+enum FORMULA_TYPES {
+  FORMULA_SYMBOL = 0,  // A predicate, function, connective or free variable.
+  FORMULA_BOUND,       // A variable bound by a quantifier.
+  FORMULA_QUANT,       // A quantifier and its scope.
+  FORMULA_LIST         // A parenthesized list, such as (P x y).
+};
+
+// The quantifiers of quantifier nodes.
+
+enum FORMULA_QUANTS {
+  FORMULA_UNV = 0,
+  FORMULA_EXL
+};
+
+// Bound variables at least this many quantifiers out share the last bit
+// of a loose set.
+
+#define FORMULA_LOOSE_MAX 31
+#define FORMULA_LOOSE_DEEP (1u << FORMULA_LOOSE_MAX)
+
+// A node of a sentence's tree.  A bound variable is kept as a de Bruijn
+// index, the amount of quantifiers between it and its own, so that the
+// name given to a bound variable is only kept for display.  Two formulas
+// that differ only in the names of their bound variables have the same
+// tree.  Each node caches the bound variables that occur free in it,
+// as a bit set of their indices, and a hash of its structure.  Names are
+// kept in the table of symbols, so two names are the same exactly when
+// their symbols are.
+
+struct formula {
+  int type;               // The type of this node.
+  int sym;                // The symbol of text, or -1 for lists.
+  unsigned char * text;   // The symbol, or the name of the bound variable,
+                          // which is shared and must not be changed.
+  int index;              // For bound variables, the de Bruijn index.
+  int quant;              // For quantifiers, the quantifier.
+  int num_args;           // The amount of children.
+  formula_t ** args;      // The elements of a list, or a quantifier's scope.
+  unsigned int loose;     // The indices of the bound variables free in this.
+  unsigned int hash;      // The hash of this node's structure.
+};
+
+formula_t * formula_init (const unsigned char * sexpr);
+void formula_destroy (formula_t * fm);
+int formula_equal (formula_t * a, formula_t * b);
+int formula_quant_match (formula_t * pat, formula_t * fm, int num_vars,
+			 formula_t ** terms);
+int formula_is_conn (formula_t * fm, const unsigned char * conn);
+int formula_same_shape (formula_t * a, formula_t * b);
+int formula_diff (formula_t * a, formula_t * b, formula_t ** da,
+		  formula_t ** db, vec_t * path);
+
+#endif /* ARIS_FORMULA_H */
@@ -30,6 +30,9 @@
 #include "callbacks.h"
 #include "process.h"
 
+#define MEM_SUBSYSTEM MEM_GUI
+#include "mem.h"
+
 // The goal menu data.
 
 static mid_t goal_data[7] =
@@ -167,86 +170,77 @@ goal_check_line (goal_t * goal, sentence * sen)
 {
   // First, check for text errors.
 
-  int ret_check = check_text (sen->text);
+  unsigned char * sexpr;
+  int ret_check;
+
+  ret_check = text_to_sexpr (sen->text, &sexpr);
   if (ret_check < 0)
     return -1;
 
-  unsigned char * cmp_text;
-  cmp_text = die_spaces_die (sen->text);
-  if (!cmp_text)
+  // Look the goal up in the proof's index.
+
+  sentence * ev_sen;
+
+  ret_check = aris_proof_find_sexpr (goal->parent, sexpr, &ev_sen);
+  free (sexpr);
+  if (ret_check < 0)
     return -1;
 
+  if (!ev_sen)
+    {
+      sentence_set_value (sen, VALUE_TYPE_FALSE);
+      sen_parent_set_sb ((sen_parent *) goal, "This goal has not been met.");
+      return 0;
+    }
+
+  // Only the lines up to the one that met the goal can invalidate it.
+
   item_t * ev_itr;
   int is_valid = 1;
 
   for (ev_itr = SEN_PARENT (goal->parent)->everything->head; ev_itr != NULL;
        ev_itr = ev_itr->next)
     {
-      sentence * ev_sen = ev_itr->value;
-      unsigned char * ev_cmp_text = die_spaces_die (ev_sen->text);
-      if (!ev_cmp_text)
-	return -1;
+      sentence * itr_sen = ev_itr->value;
 
-      if (!strcmp (ev_cmp_text, cmp_text))
+      if (itr_sen->premise || itr_sen->subproof)
 	{
-	  if (ev_sen->premise || ev_sen->subproof)
-	    {
-	      if (ev_sen->value_type == VALUE_TYPE_ERROR)
-		is_valid = 0;
-	    }
-	  else if (ev_sen->value_type != VALUE_TYPE_TRUE)
+	  if (itr_sen->value_type == VALUE_TYPE_ERROR)
 	    is_valid = 0;
-
-	  sentence_set_line_no (sen, ev_sen->line_num);
-
-	  if (is_valid)
-	    {
-	      gtk_widget_modify_bg (ev_sen->eventbox, GTK_STATE_NORMAL,
-				    the_app->bg_colors[BG_COLOR_EMERALD]);
-	      sentence_set_value (sen, VALUE_TYPE_TRUE);
-	    }
-	  else
-	    {
-	      gtk_widget_modify_bg (ev_sen->eventbox, GTK_STATE_NORMAL,
-				    the_app->bg_colors[BG_COLOR_CRIMSON]);
-	      sentence_set_value (sen, VALUE_TYPE_REF);
-	    }
-
-	  char * sb_text = (char *) calloc (30, sizeof (char *));
-	  CHECK_ALLOC (sb_text, -1);
-	  int offset = 0;
-	  offset += sprintf (sb_text, "The goal was met at line %i",
-			     ev_sen->line_num);
-	  if (!is_valid)
-	    {
-	      offset += sprintf (sb_text + offset,
-				 ", however there are errors leading up to it.");
-	    }
-	  sen_parent_set_sb ((sen_parent *) goal, sb_text);
-	  free (ev_cmp_text);
-	  free (cmp_text);
-	  return 0;
 	}
-      else
+      else if (itr_sen->value_type != VALUE_TYPE_TRUE)
 	{
-	  if (ev_sen->premise || ev_sen->subproof)
-	    {
-	      if (ev_sen->value_type == VALUE_TYPE_ERROR)
-		is_valid = 0;
-	    }
-	  else if (ev_sen->value_type != VALUE_TYPE_TRUE)
-	    {
-	      is_valid = 0;
-	    }
+	  is_valid = 0;
 	}
 
-      free (ev_cmp_text);
+      if (itr_sen == ev_sen)
+	break;
     }
 
-  free (cmp_text);
+  sentence_set_line_no (sen, sentence_get_line_no (ev_sen));
 
-  sentence_set_value (sen, VALUE_TYPE_FALSE);
-  sen_parent_set_sb ((sen_parent *) goal, "This goal has not been met.");
+  if (is_valid)
+    {
+      sentence_set_line_bg (ev_sen, BG_COLOR_EMERALD);
+      sentence_set_value (sen, VALUE_TYPE_TRUE);
+    }
+  else
+    {
+      sentence_set_line_bg (ev_sen, BG_COLOR_CRIMSON);
+      sentence_set_value (sen, VALUE_TYPE_REF);
+    }
+
+  char * sb_text = (char *) calloc (30, sizeof (char *));
+  CHECK_ALLOC (sb_text, -1);
+  int offset = 0;
+  offset += sprintf (sb_text, "The goal was met at line %i",
+		     sentence_get_line_no (ev_sen));
+  if (!is_valid)
+    {
+      offset += sprintf (sb_text + offset,
+			 ", however there are errors leading up to it.");
+    }
+  sen_parent_set_sb ((sen_parent *) goal, sb_text);
   return 0;
 }
 
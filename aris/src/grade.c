@@ -0,0 +1,580 @@
+/* Functions for grading proofs against an answer key.
+
+   Copyright (C) 2012 Ian Dunn.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <libxml/parser.h>
+
+#include "grade.h"
+#include "proof.h"
+#include "sen-data.h"
+#include "list.h"
+#include "vec.h"
+#include "hash.h"
+#include "aio.h"
+#include "process.h"
+#include "trace.h"
+
+#define MEM_SUBSYSTEM MEM_IO
+#include "mem.h"
+
+// The state shared by the grading threads.
+
+struct grade_queue {
+  grade_key * key;          // The answer key.
+  vec_t * files;            // The names of the files to grade.
+  grade_result * results;   // The results, one for each file.
+  int * done;               // Whether or not each result is ready.
+  int next;                 // The index of the next file to grade.
+  int failed;               // Set on memory error.
+  pthread_mutex_t lock;
+  pthread_cond_t ready;
+};
+
+/* Collects the sequence of rules used by a proof.
+ *  input:
+ *    proof - the proof to collect the rules from.
+ *  output:
+ *    a vector of the rule indices, or NULL on error.
+ */
+static vec_t *
+grade_collect_rules (proof_t * proof)
+{
+  vec_t * rules;
+  item_t * itr;
+  int ret;
+
+  rules = init_vec (sizeof (int));
+  if (!rules)
+    return NULL;
+
+  for (itr = proof->everything->head; itr; itr = itr->next)
+    {
+      sen_data * sd = itr->value;
+
+      if (sd->premise || sd->subproof)
+	continue;
+
+      ret = vec_add_obj (rules, &sd->rule);
+      if (ret < 0)
+	return NULL;
+    }
+
+  return rules;
+}
+
+/* Determines the length of the longest common subsequence of two rule
+ * sequences.
+ *  input:
+ *    r_0, r_1 - the rule sequences to compare.
+ *  output:
+ *    the length of the longest common subsequence, or -1 on error.
+ */
+static int
+grade_rules_lcs (vec_t * r_0, vec_t * r_1)
+{
+  int * prev, * cur, * tmp;
+  int i, j, len;
+
+  prev = (int *) calloc (r_1->num_stuff + 1, sizeof (int));
+  CHECK_ALLOC (prev, -1);
+
+  cur = (int *) calloc (r_1->num_stuff + 1, sizeof (int));
+  CHECK_ALLOC (cur, -1);
+
+  for (i = 0; i < r_0->num_stuff; i++)
+    {
+      int rule = *((int *) vec_nth (r_0, i));
+
+      for (j = 0; j < r_1->num_stuff; j++)
+	{
+	  if (rule == *((int *) vec_nth (r_1, j)))
+	    cur[j + 1] = prev[j] + 1;
+	  else
+	    cur[j + 1] = (cur[j] > prev[j + 1]) ? cur[j] : prev[j + 1];
+	}
+
+      tmp = prev;
+      prev = cur;
+      cur = tmp;
+    }
+
+  len = prev[r_1->num_stuff];
+  free (prev);
+  free (cur);
+
+  return len;
+}
+
+/* Initializes an answer key from a proof file.
+ *  input:
+ *    file_name - the name of the answer key's file.
+ *  output:
+ *    the newly initialized answer key, or NULL on error.
+ */
+grade_key *
+grade_key_init (const char * file_name)
+{
+  grade_key * key;
+  item_t * itr;
+  int ret;
+
+  key = (grade_key *) calloc (1, sizeof (grade_key));
+  CHECK_ALLOC (key, NULL);
+
+  key->proof = aio_open (file_name);
+  if (!key->proof)
+    return NULL;
+
+  ret = proof_eval (key->proof, NULL, 0, NULL);
+  if (ret < 0)
+    return NULL;
+
+  key->goals = init_vec (sizeof (char *));
+  if (!key->goals)
+    return NULL;
+
+  for (itr = key->proof->goals->head; itr; itr = itr->next)
+    {
+      unsigned char * sexpr;
+
+      ret = text_to_sexpr (itr->value, &sexpr);
+      if (ret == -1)
+	return NULL;
+
+      if (ret < 0)
+	{
+	  fprintf (stderr, "Grade Warning - goal \"%s\" of the answer key has a text error, ignoring goal.\n",
+		   (char *) itr->value);
+	  continue;
+	}
+
+      ret = vec_str_add_obj (key->goals, sexpr);
+      if (ret < 0)
+	return NULL;
+      free (sexpr);
+    }
+
+  // Without any goals, the answer key's last top level line is the goal.
+
+  if (key->goals->num_stuff == 0)
+    {
+      for (itr = key->proof->everything->tail; itr; itr = itr->prev)
+	{
+	  sen_data * sd = itr->value;
+
+	  if (sd->depth == 0 && sd->sexpr)
+	    {
+	      ret = vec_str_add_obj (key->goals, sd->sexpr);
+	      if (ret < 0)
+		return NULL;
+	      break;
+	    }
+	}
+    }
+
+  key->rules = grade_collect_rules (key->proof);
+  if (!key->rules)
+    return NULL;
+
+  return key;
+}
+
+/* Destroys an answer key.
+ *  input:
+ *    key - the answer key to destroy.
+ *  output:
+ *    none.
+ */
+void
+grade_key_destroy (grade_key * key)
+{
+  proof_destroy (key->proof);
+  destroy_str_vec (key->goals);
+  destroy_vec (key->rules);
+  free (key);
+}
+
+/* Grades a single proof against an answer key.
+ * Proofs are graded out of five points:
+ *   2 - Effort (evaluates properly).
+ *   2 - Is similar to the answer key (uses its sequence of rules).
+ *   1 - Obtains the goal(s) of the answer key.
+ *  input:
+ *    key - the answer key.
+ *    proof - the proof to grade.
+ *    result - receives the grade.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+int
+grade_proof (grade_key * key, proof_t * proof, grade_result * result)
+{
+  vec_t * rets, * rules;
+  unsigned char * correct;
+  int i, ret;
+
+  result->error = NULL;
+  result->num_lines = proof->everything->num_stuff;
+  result->num_goals = key->goals->num_stuff;
+  result->num_correct = result->goals_met = 0;
+  result->effort = result->similarity = result->goal = result->grade = 0;
+
+  rets = init_vec (sizeof (int));
+  if (!rets)
+    return -1;
+
+  ret = proof_eval (proof, rets, 0, NULL);
+  if (ret < 0)
+    {
+      destroy_vec (rets);
+      result->error = "the proof could not be evaluated";
+      return 0;
+    }
+
+  // Effort.
+
+  result->num_correct = rets->num_stuff;
+
+  if (result->num_correct == result->num_lines)
+    result->effort = GRADE_EFFORT_POINTS;
+  else if (result->num_correct * 2 >= result->num_lines)
+    result->effort = GRADE_EFFORT_POINTS / 2;
+
+  // Similarity, from how much of the answer key's sequence of rules
+  // appears, in order, in the proof's.
+
+  rules = grade_collect_rules (proof);
+  if (!rules)
+    return -1;
+
+  ret = grade_rules_lcs (key->rules, rules);
+  if (ret < 0)
+    return -1;
+  destroy_vec (rules);
+
+  if (ret == key->rules->num_stuff)
+    result->similarity = GRADE_SIMILARITY_POINTS;
+  else if (ret * 2 >= key->rules->num_stuff)
+    result->similarity = GRADE_SIMILARITY_POINTS / 2;
+
+  // Goals, looked up in the proof's index of sexprs.
+
+  correct = (unsigned char *) calloc (result->num_lines + 1, sizeof (char));
+  CHECK_ALLOC (correct, -1);
+
+  for (i = 0; i < rets->num_stuff; i++)
+    correct[*((int *) vec_nth (rets, i))] = 1;
+  destroy_vec (rets);
+
+  for (i = 0; i < key->goals->num_stuff; i++)
+    {
+      hash_entry_t * ent;
+
+      ent = proof_find_sexpr (proof, vec_str_nth (key->goals, i));
+      for (; ent; ent = hash_find_next (ent))
+	{
+	  sen_data * sd = ent->value;
+
+	  if (sd->depth == 0 && sd->line_num > 0
+	      && sd->line_num <= result->num_lines && correct[sd->line_num])
+	    {
+	      result->goals_met++;
+	      break;
+	    }
+	}
+    }
+
+  if (result->num_goals > 0 && result->goals_met == result->num_goals)
+    result->goal = GRADE_GOAL_POINTS;
+
+  free (correct);
+
+  result->grade = result->effort + result->similarity + result->goal;
+
+  return 0;
+}
+
+/* Opens and grades a single file.
+ *  input:
+ *    key - the answer key.
+ *    file_name - the name of the file to grade.
+ *    result - receives the grade.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+static int
+grade_one_file (grade_key * key, const char * file_name,
+		grade_result * result)
+{
+  proof_t * proof;
+  unsigned long mark;
+  int ret;
+
+  memset (result, 0, sizeof (grade_result));
+  result->file_name = file_name;
+
+  mark = mem_mark ();
+  proof = aio_open (file_name);
+  if (!proof)
+    {
+      result->error = "the file could not be opened";
+      return 0;
+    }
+
+  ret = grade_proof (key, proof, result);
+  proof_destroy (proof);
+
+  mem_check_live (file_name, mark);
+
+  return ret;
+}
+
+/* Writes a string to a file, quoted for the given format.
+ *  input:
+ *    out - the file to write to.
+ *    str - the string to write.
+ *    format - the output format.
+ *  output:
+ *    none.
+ */
+static void
+grade_print_str (FILE * out, const char * str, int format)
+{
+  const char * c;
+
+  if (format != GRADE_FORMAT_CSV)
+    {
+      trace_write_str (out, str);
+      return;
+    }
+
+  fputc ('"', out);
+  for (c = str; *c; c++)
+    {
+      if (*c == '"')
+	fputc ('"', out);
+      fputc (*c, out);
+    }
+  fputc ('"', out);
+}
+
+/* Prints a grade.
+ *  input:
+ *    out - the file to print to.
+ *    result - the grade to print.
+ *    format - the output format.
+ *  output:
+ *    0 on success, -1 on error.
+ */
+static int
+grade_print_result (FILE * out, grade_result * result, int format)
+{
+  if (format == GRADE_FORMAT_CSV)
+    {
+      grade_print_str (out, result->file_name, format);
+      fprintf (out, ",%i,%i,%i,%i,%i,%i,%i,%i,",
+	       result->grade, result->effort, result->similarity,
+	       result->goal, result->num_correct, result->num_lines,
+	       result->goals_met, result->num_goals);
+      if (result->error)
+	grade_print_str (out, result->error, format);
+      fprintf (out, "\n");
+    }
+  else
+    {
+      fprintf (out, "{\"file\":");
+      grade_print_str (out, result->file_name, format);
+      fprintf (out, ",\"grade\":%i,\"effort\":%i,\"similarity\":%i,\"goal\":%i,\"correct\":%i,\"lines\":%i,\"goals_met\":%i,\"goals\":%i",
+	       result->grade, result->effort, result->similarity,
+	       result->goal, result->num_correct, result->num_lines,
+	       result->goals_met, result->num_goals);
+      if (result->error)
+	{
+	  fprintf (out, ",\"error\":");
+	  grade_print_str (out, result->error, format);
+	}
+      fprintf (out, "}\n");
+    }
+
+  fflush (out);
+  if (ferror (out))
+    {
+      perror (NULL);
+      return -1;
+    }
+
+  return 0;
+}
+
+/* Grades files taken from a grading queue, until it is empty.
+ *  input:
+ *    arg - the grading queue.
+ *  output:
+ *    NULL.
+ */
+static void *
+grade_worker (void * arg)
+{
+  struct grade_queue * queue = arg;
+  int i, ret;
+
+  while (1)
+    {
+      pthread_mutex_lock (&queue->lock);
+      i = queue->next++;
+      pthread_mutex_unlock (&queue->lock);
+
+      if (i >= queue->files->num_stuff)
+	break;
+
+      ret = grade_one_file (queue->key, vec_str_nth (queue->files, i),
+			    &queue->results[i]);
+
+      pthread_mutex_lock (&queue->lock);
+      if (ret < 0)
+	queue->failed = 1;
+      queue->done[i] = 1;
+      pthread_cond_broadcast (&queue->ready);
+      pthread_mutex_unlock (&queue->lock);
+    }
+
+  return NULL;
+}
+
+/* Gets the amount of processors available.
+ *  input:
+ *    none.
+ *  output:
+ *    the amount of processors, at least one.
+ */
+static int
+grade_num_cpus ()
+{
+  long num = 1;
+
+#ifdef _SC_NPROCESSORS_ONLN
+  num = sysconf (_SC_NPROCESSORS_ONLN);
+#endif
+
+  return (num > 0) ? (int) num : 1;
+}
+
+/* Grades files against an answer key, printing each grade as it is
+ * determined, in the order of the files.
+ *  input:
+ *    key - the answer key.
+ *    files - the names of the files to grade.
+ *    jobs - the amount of files to grade at once, or 0 for one per processor.
+ *    format - the output format.
+ *    out - the file to print the grades to.
+ *  output:
+ *    0 on success, -1 on error.
+ */
+int
+grade_files (grade_key * key, vec_t * files, int jobs, int format,
+	     FILE * out)
+{
+  struct grade_queue queue;
+  pthread_t * threads;
+  int i, ret, num_threads;
+
+  if (format == GRADE_FORMAT_CSV)
+    fprintf (out, "file,grade,effort,similarity,goal,correct,lines,goals_met,goals,error\n");
+
+  if (jobs < 1)
+    jobs = grade_num_cpus ();
+
+  if (jobs > files->num_stuff)
+    jobs = files->num_stuff;
+
+  queue.key = key;
+  queue.files = files;
+  queue.next = 0;
+  queue.failed = 0;
+
+  queue.results = (grade_result *) calloc (files->num_stuff + 1,
+					   sizeof (grade_result));
+  CHECK_ALLOC (queue.results, -1);
+
+  queue.done = (int *) calloc (files->num_stuff + 1, sizeof (int));
+  CHECK_ALLOC (queue.done, -1);
+
+  threads = (pthread_t *) calloc (jobs + 1, sizeof (pthread_t));
+  CHECK_ALLOC (threads, -1);
+
+  pthread_mutex_init (&queue.lock, NULL);
+  pthread_cond_init (&queue.ready, NULL);
+
+  // libxml2 must be initialized before it is used from several threads.
+
+  xmlInitParser ();
+
+  // The files are graded in parallel, but the grades are printed in order.
+
+  num_threads = 0;
+  if (jobs > 1)
+    {
+      for (i = 0; i < jobs; i++)
+	{
+	  if (pthread_create (&threads[num_threads], NULL, grade_worker,
+			      &queue))
+	    break;
+	  num_threads++;
+	}
+    }
+
+  ret = 0;
+  for (i = 0; i < files->num_stuff; i++)
+    {
+      if (num_threads == 0)
+	{
+	  if (grade_one_file (key, vec_str_nth (files, i),
+			      &queue.results[i]) < 0)
+	    queue.failed = 1;
+	}
+      else
+	{
+	  pthread_mutex_lock (&queue.lock);
+	  while (!queue.done[i])
+	    pthread_cond_wait (&queue.ready, &queue.lock);
+	  pthread_mutex_unlock (&queue.lock);
+	}
+
+      if (ret == 0 && grade_print_result (out, &queue.results[i], format) < 0)
+	ret = -1;
+    }
+
+  for (i = 0; i < num_threads; i++)
+    pthread_join (threads[i], NULL);
+
+  pthread_mutex_destroy (&queue.lock);
+  pthread_cond_destroy (&queue.ready);
+
+  if (queue.failed)
+    ret = -1;
+
+  free (threads);
+  free (queue.results);
+  free (queue.done);
+
+  return ret;
+}
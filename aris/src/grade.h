@@ -0,0 +1,71 @@
+/* Grading data types.
+
+   Copyright (C) 2012 Ian Dunn.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ARIS_GRADE_H
+#define ARIS_GRADE_H
+
+#include <stdio.h>
+
+typedef struct proof proof_t;
+typedef struct vector vec_t;
+typedef struct grade_key grade_key;
+typedef struct grade_result grade_result;
+
+// The output formats of the grader.
+
+enum GRADE_FORMAT {
+  GRADE_FORMAT_CSV = 0,
+  GRADE_FORMAT_JSON
+};
+
+// The points given for each part of a grade.
+
+#define GRADE_EFFORT_POINTS     2
+#define GRADE_SIMILARITY_POINTS 2
+#define GRADE_GOAL_POINTS       1
+
+// The answer key that proofs are graded against.
+
+struct grade_key {
+  proof_t * proof;  // The answer key itself.
+  vec_t * goals;    // The sexprs of the goals of the answer key.
+  vec_t * rules;    // The sequence of rules used by the answer key.
+};
+
+// The grade of a single proof.
+
+struct grade_result {
+  const char * file_name;  // The name of the graded file.
+  const char * error;      // The error message, or NULL if graded.
+  int num_lines;           // The amount of lines in the proof.
+  int num_correct;         // The amount of correct lines.
+  int num_goals;           // The amount of goals of the answer key.
+  int goals_met;           // The amount of goals that were obtained.
+  int effort;              // The effort points.
+  int similarity;          // The similarity points.
+  int goal;                // The goal points.
+  int grade;               // The total grade.
+};
+
+grade_key * grade_key_init (const char * file_name);
+void grade_key_destroy (grade_key * key);
+int grade_proof (grade_key * key, proof_t * proof, grade_result * result);
+int grade_files (grade_key * key, vec_t * files, int jobs, int format,
+		 FILE * out);
+
+#endif /* ARIS_GRADE_H */
@@ -0,0 +1,289 @@
+/* Functions for handling hash tables.
+
+   Copyright (C) 2012 Ian Dunn.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "hash.h"
+
+#define MEM_SUBSYSTEM MEM_STRUCTS
+#include "mem.h"
+
+/* Hashes a string, using the FNV-1a algorithm.
+ *  input:
+ *    str - the string to hash.
+ *  output:
+ *    the hash of the string.
+ */
+unsigned int
+hash_str (const unsigned char * str)
+{
+  unsigned int hash = 2166136261u;
+
+  for (; *str; str++)
+    {
+      hash ^= *str;
+      hash *= 16777619u;
+    }
+
+  return hash;
+}
+
+/* Initializes a hash table.
+ *  input:
+ *    size - the initial amount of buckets, rounded up to a power of two.
+ *  output:
+ *    the newly initialized hash table, or NULL on error.
+ */
+hash_t *
+init_hash (unsigned int size)
+{
+  hash_t * ht;
+
+  ht = (hash_t *) calloc (1, sizeof (hash_t));
+  if (!ht)
+    {
+      perror (NULL);
+      return NULL;
+    }
+
+  ht->num_stuff = 0;
+  ht->num_buckets = 8;
+  while (ht->num_buckets < size)
+    ht->num_buckets *= 2;
+
+  ht->buckets = (hash_entry_t **) calloc (ht->num_buckets,
+					  sizeof (hash_entry_t *));
+  if (!ht->buckets)
+    {
+      perror (NULL);
+      free (ht);
+      return NULL;
+    }
+
+  return ht;
+}
+
+/* Clears a hash table - DOES NOT FREE MEMORY OF VALUES.
+ *  input:
+ *    ht - the hash table to clear.
+ *  output:
+ *    none.
+ */
+void
+hash_clear (hash_t * ht)
+{
+  unsigned int i;
+
+  for (i = 0; i < ht->num_buckets; i++)
+    {
+      hash_entry_t * ent, * n_ent;
+
+      for (ent = ht->buckets[i]; ent; ent = n_ent)
+	{
+	  n_ent = ent->next;
+	  free (ent->key);
+	  free (ent);
+	}
+
+      ht->buckets[i] = NULL;
+    }
+
+  ht->num_stuff = 0;
+}
+
+/* Destroys a hash table - DOES NOT FREE MEMORY OF VALUES.
+ *  input:
+ *    ht - the hash table to destroy.
+ *  output:
+ *    none.
+ */
+void
+destroy_hash (hash_t * ht)
+{
+  hash_clear (ht);
+  free (ht->buckets);
+  free (ht);
+}
+
+/* Doubles the amount of buckets of a hash table.
+ *  input:
+ *    ht - the hash table to grow.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+static int
+hash_grow (hash_t * ht)
+{
+  hash_entry_t ** buckets;
+  unsigned int i, num_buckets;
+
+  num_buckets = ht->num_buckets * 2;
+  buckets = (hash_entry_t **) calloc (num_buckets, sizeof (hash_entry_t *));
+  if (!buckets)
+    {
+      perror (NULL);
+      return -1;
+    }
+
+  for (i = 0; i < ht->num_buckets; i++)
+    {
+      hash_entry_t * ent, * n_ent;
+
+      for (ent = ht->buckets[i]; ent; ent = n_ent)
+	{
+	  unsigned int b = ent->hash & (num_buckets - 1);
+
+	  n_ent = ent->next;
+	  ent->next = buckets[b];
+	  buckets[b] = ent;
+	}
+    }
+
+  free (ht->buckets);
+  ht->buckets = buckets;
+  ht->num_buckets = num_buckets;
+
+  return 0;
+}
+
+/* Adds an entry to a hash table.
+ *  input:
+ *    ht - the hash table to add to.
+ *    key - the key of the new entry, which is copied.
+ *    value - the value of the new entry.
+ *  output:
+ *    the new entry, or NULL on error.
+ */
+hash_entry_t *
+hash_add_obj (hash_t * ht, const unsigned char * key, void * value)
+{
+  hash_entry_t * ent;
+  unsigned int b;
+
+  if (ht->num_stuff >= ht->num_buckets && hash_grow (ht) < 0)
+    return NULL;
+
+  ent = (hash_entry_t *) calloc (1, sizeof (hash_entry_t));
+  if (!ent)
+    {
+      perror (NULL);
+      return NULL;
+    }
+
+  ent->key = (unsigned char *) calloc (strlen ((const char *) key) + 1,
+				       sizeof (char));
+  if (!ent->key)
+    {
+      perror (NULL);
+      free (ent);
+      return NULL;
+    }
+
+  strcpy ((char *) ent->key, (const char *) key);
+  ent->hash = hash_str (key);
+  ent->value = value;
+
+  b = ent->hash & (ht->num_buckets - 1);
+  ent->next = ht->buckets[b];
+  ht->buckets[b] = ent;
+  ht->num_stuff++;
+
+  return ent;
+}
+
+/* Finds the first entry with a given key.
+ *  input:
+ *    ht - the hash table to search.
+ *    key - the key to search for.
+ *  output:
+ *    the matching entry, or NULL if there is none.
+ */
+hash_entry_t *
+hash_find (hash_t * ht, const unsigned char * key)
+{
+  hash_entry_t * ent;
+  unsigned int hash;
+
+  hash = hash_str (key);
+
+  for (ent = ht->buckets[hash & (ht->num_buckets - 1)]; ent; ent = ent->next)
+    {
+      if (ent->hash == hash
+	  && !strcmp ((const char *) ent->key, (const char *) key))
+	return ent;
+    }
+
+  return NULL;
+}
+
+/* Finds the next entry with the same key as an entry.
+ *  input:
+ *    entry - the entry from hash_find or hash_find_next.
+ *  output:
+ *    the next matching entry, or NULL if there is none.
+ */
+hash_entry_t *
+hash_find_next (hash_entry_t * entry)
+{
+  hash_entry_t * ent;
+
+  for (ent = entry->next; ent; ent = ent->next)
+    {
+      if (ent->hash == entry->hash
+	  && !strcmp ((const char *) ent->key, (const char *) entry->key))
+	return ent;
+    }
+
+  return NULL;
+}
+
+/* Removes an entry from a hash table.
+ *  input:
+ *    ht - the hash table to remove from.
+ *    key - the key of the entry.
+ *    value - the value of the entry.
+ *  output:
+ *    0 if the entry was removed, 1 if it wasn't found.
+ */
+int
+hash_rem_obj (hash_t * ht, const unsigned char * key, void * value)
+{
+  hash_entry_t ** ent_ptr, * ent;
+  unsigned int hash;
+
+  hash = hash_str (key);
+
+  for (ent_ptr = &ht->buckets[hash & (ht->num_buckets - 1)]; *ent_ptr;
+       ent_ptr = &(*ent_ptr)->next)
+    {
+      ent = *ent_ptr;
+      if (ent->value == value && ent->hash == hash
+	  && !strcmp ((const char *) ent->key, (const char *) key))
+	{
+	  *ent_ptr = ent->next;
+	  free (ent->key);
+	  free (ent);
+	  ht->num_stuff--;
+	  return 0;
+	}
+    }
+
+  return 1;
+}
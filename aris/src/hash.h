@@ -0,0 +1,56 @@
+/* Hash table data type.
+
+   Copyright (C) 2012 Ian Dunn.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ARIS_HASH_H
+#define ARIS_HASH_H
+
+typedef struct hash_entry hash_entry_t;
+typedef struct hash_table hash_t;
+
+// An entry of the hash table.  Several entries may share a key.
+
+struct hash_entry
+{
+  struct hash_entry * next;
+
+  unsigned int hash;     // The full hash of the key.
+  unsigned char * key;   // The key, owned by the table.
+  void * value;
+};
+
+// The hash table structure itself.
+
+struct hash_table
+{
+  unsigned int num_stuff;    // The amount of entries.
+  unsigned int num_buckets;  // The amount of buckets.
+
+  hash_entry_t ** buckets;
+};
+
+unsigned int hash_str (const unsigned char * str);
+hash_t * init_hash (unsigned int size);
+void destroy_hash (hash_t * ht);
+hash_entry_t * hash_add_obj (hash_t * ht, const unsigned char * key,
+			     void * value);
+hash_entry_t * hash_find (hash_t * ht, const unsigned char * key);
+hash_entry_t * hash_find_next (hash_entry_t * entry);
+int hash_rem_obj (hash_t * ht, const unsigned char * key, void * value);
+void hash_clear (hash_t * ht);
+
+#endif /* ARIS_HASH_H */
@@ -0,0 +1,617 @@
+/* The undo history of a proof.
+
+   Copyright (C) 2012 Ian Dunn.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "history.h"
+#include "vec.h"
+#include "process.h"
+
+#define MEM_SUBSYSTEM MEM_GUI
+#include "mem.h"
+
+/* Main Idea:
+ *  A snapshot of a proof is a treap of the records of its lines, ordered
+ *  by their positions.  Changing a snapshot copies only the nodes on the
+ *  path to the line that changed, and shares the rest of the tree with
+ *  the snapshot it came from, so that taking a snapshot after an edit
+ *  costs O(log n) for each line that changed, and every snapshot keeps
+ *  the records of its lines, sexprs and values included.  A node that
+ *  only one tree uses is changed in place instead of being copied.
+ */
+
+#define HISTORY_SIZE(s) ((s) ? (s)->size : 0)
+
+/* Initializes the record of a line.
+ *  input:
+ *    id - the id of the sentence.
+ *    text - the text of the line.
+ *    sexpr - the sexpr of the line, or NULL.
+ *    file - the file of the lemma of the line, or NULL.
+ *    refs - the ids of the references, ending with -1.  The record
+ *           takes ownership of them.
+ *    rule - the rule of the line.
+ *    premise - whether or not the line is a premise.
+ *    subproof - whether or not the line starts a subproof.
+ *    depth - the depth of the line.
+ *    value_type - the value type of the line.
+ *  output:
+ *    the new record, with one reference, or NULL on error.
+ */
+history_line_t *
+history_line_init (int id, unsigned char * text, unsigned char * sexpr,
+		   unsigned char * file, int * refs, int rule, int premise,
+		   int subproof, int depth, int value_type)
+{
+  history_line_t * line;
+
+  line = (history_line_t *) calloc (1, sizeof (history_line_t));
+  CHECK_ALLOC (line, NULL);
+
+  line->text = (unsigned char *) strdup ((const char *) text);
+  CHECK_ALLOC (line->text, NULL);
+
+  if (sexpr)
+    {
+      line->sexpr = (unsigned char *) strdup ((const char *) sexpr);
+      CHECK_ALLOC (line->sexpr, NULL);
+    }
+
+  if (file)
+    {
+      line->file = (unsigned char *) strdup ((const char *) file);
+      CHECK_ALLOC (line->file, NULL);
+    }
+
+  line->ref_count = 1;
+  line->id = id;
+  line->refs = refs;
+  line->rule = rule;
+  line->premise = premise;
+  line->subproof = subproof;
+  line->depth = depth;
+  line->value_type = value_type;
+
+  return line;
+}
+
+/* Releases a reference to the record of a line.
+ *  input:
+ *    line - the record to release.
+ *  output:
+ *    none.
+ */
+void
+history_line_release (history_line_t * line)
+{
+  if (--line->ref_count > 0)
+    return;
+
+  free (line->text);
+  if (line->sexpr)
+    free (line->sexpr);
+  if (line->file)
+    free (line->file);
+  free (line->refs);
+  free (line);
+}
+
+/* Gets the priority of a new node from the id of its line, so that
+ * the treap stays balanced without keeping any state.
+ *  input:
+ *    id - the id of the line.
+ *  output:
+ *    the priority.
+ */
+static unsigned int
+history_priority (int id)
+{
+  unsigned int h = (unsigned int) id;
+
+  h ^= h >> 16;
+  h *= 0x7feb352du;
+  h ^= h >> 15;
+  h *= 0x846ca68bu;
+  h ^= h >> 16;
+
+  return h;
+}
+
+/* Updates the size of a node from its children.
+ *  input:
+ *    seq - the node.
+ *  output:
+ *    none.
+ */
+static void
+history_seq_update (history_seq_t * seq)
+{
+  seq->size = HISTORY_SIZE (seq->left) + HISTORY_SIZE (seq->right) + 1;
+}
+
+/* Gets a node that may be changed in place, copying it if another
+ * tree shares it.
+ *  input:
+ *    seq - the node, whose reference is given up.
+ *  output:
+ *    a node that only the caller uses, or NULL on memory error.
+ */
+static history_seq_t *
+history_seq_own (history_seq_t * seq)
+{
+  history_seq_t * copy;
+
+  if (seq->ref_count == 1)
+    return seq;
+
+  copy = (history_seq_t *) calloc (1, sizeof (history_seq_t));
+  CHECK_ALLOC (copy, NULL);
+
+  *copy = *seq;
+  copy->ref_count = 1;
+
+  copy->line->ref_count++;
+  if (copy->left)
+    copy->left->ref_count++;
+  if (copy->right)
+    copy->right->ref_count++;
+
+  // The other users keep the original.
+  seq->ref_count--;
+
+  return copy;
+}
+
+/* Splits a tree in two.
+ *  input:
+ *    seq - the tree, whose reference is given up.
+ *    pos - the amount of lines to put in the first tree.
+ *    left - receives the first pos lines.
+ *    right - receives the rest of the lines.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+static int
+history_seq_split (history_seq_t * seq, int pos, history_seq_t ** left,
+		   history_seq_t ** right)
+{
+  int ret;
+
+  if (!seq)
+    {
+      *left = *right = NULL;
+      return 0;
+    }
+
+  seq = history_seq_own (seq);
+  if (!seq)
+    return -1;
+
+  if (HISTORY_SIZE (seq->left) >= pos)
+    {
+      ret = history_seq_split (seq->left, pos, left, &seq->left);
+      *right = seq;
+    }
+  else
+    {
+      ret = history_seq_split (seq->right, pos - HISTORY_SIZE (seq->left) - 1,
+			       &seq->right, right);
+      *left = seq;
+    }
+
+  history_seq_update (seq);
+  return ret;
+}
+
+/* Joins two trees, the lines of one coming before those of the other.
+ *  input:
+ *    left - the first tree, whose reference is given up.
+ *    right - the second tree, whose reference is given up.
+ *    seq - receives the joined tree.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+static int
+history_seq_merge (history_seq_t * left, history_seq_t * right,
+		   history_seq_t ** seq)
+{
+  int ret;
+
+  if (!left || !right)
+    {
+      *seq = left ? left : right;
+      return 0;
+    }
+
+  if (left->priority > right->priority)
+    {
+      left = history_seq_own (left);
+      if (!left)
+	return -1;
+
+      ret = history_seq_merge (left->right, right, &left->right);
+      history_seq_update (left);
+      *seq = left;
+    }
+  else
+    {
+      right = history_seq_own (right);
+      if (!right)
+	return -1;
+
+      ret = history_seq_merge (left, right->left, &right->left);
+      history_seq_update (right);
+      *seq = right;
+    }
+
+  return ret;
+}
+
+/* Gets the amount of lines in a snapshot.
+ *  input:
+ *    seq - the snapshot.
+ *  output:
+ *    the amount of lines.
+ */
+int
+history_seq_size (history_seq_t * seq)
+{
+  return HISTORY_SIZE (seq);
+}
+
+/* Gets the record of a line of a snapshot.
+ *  input:
+ *    seq - the snapshot.
+ *    pos - the position of the line, starting at 0.
+ *  output:
+ *    the record, or NULL if there is no such line.
+ */
+history_line_t *
+history_seq_nth (history_seq_t * seq, int pos)
+{
+  while (seq)
+    {
+      int left_size = HISTORY_SIZE (seq->left);
+
+      if (pos < left_size)
+	{
+	  seq = seq->left;
+	}
+      else if (pos == left_size)
+	{
+	  return seq->line;
+	}
+      else
+	{
+	  pos -= left_size + 1;
+	  seq = seq->right;
+	}
+    }
+
+  return NULL;
+}
+
+/* Inserts a line into a snapshot.  The snapshots that share it keep
+ * their lines.
+ *  input:
+ *    seq - the snapshot, which is replaced by the new one.
+ *    pos - the position of the new line.
+ *    line - the record of the new line, which is retained.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+int
+history_seq_insert (history_seq_t ** seq, int pos, history_line_t * line)
+{
+  history_seq_t * node, * left, * right;
+  int ret;
+
+  node = (history_seq_t *) calloc (1, sizeof (history_seq_t));
+  CHECK_ALLOC (node, -1);
+
+  node->ref_count = 1;
+  node->size = 1;
+  node->priority = history_priority (line->id);
+  node->line = line;
+  line->ref_count++;
+
+  ret = history_seq_split (*seq, pos, &left, &right);
+  if (ret < 0)
+    return -1;
+
+  ret = history_seq_merge (left, node, &left);
+  if (ret < 0)
+    return -1;
+
+  return history_seq_merge (left, right, seq);
+}
+
+/* Removes a line from a snapshot.  The snapshots that share it keep
+ * their lines.
+ *  input:
+ *    seq - the snapshot, which is replaced by the new one.
+ *    pos - the position of the line to remove.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+int
+history_seq_remove (history_seq_t ** seq, int pos)
+{
+  history_seq_t * left, * mid, * right;
+  int ret;
+
+  ret = history_seq_split (*seq, pos, &left, &right);
+  if (ret < 0)
+    return -1;
+
+  ret = history_seq_split (right, 1, &mid, &right);
+  if (ret < 0)
+    return -1;
+
+  history_seq_release (mid);
+
+  return history_seq_merge (left, right, seq);
+}
+
+/* Replaces the record of a line of a snapshot.  The snapshots that
+ * share it keep their lines.
+ *  input:
+ *    seq - the snapshot, which is replaced by the new one.
+ *    pos - the position of the line.
+ *    line - the new record of the line, which is retained.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+int
+history_seq_set (history_seq_t ** seq, int pos, history_line_t * line)
+{
+  history_seq_t ** slot = seq;
+
+  while (*slot)
+    {
+      history_seq_t * cur;
+      int left_size;
+
+      cur = history_seq_own (*slot);
+      if (!cur)
+	return -1;
+      *slot = cur;
+
+      left_size = HISTORY_SIZE (cur->left);
+      if (pos < left_size)
+	{
+	  slot = &cur->left;
+	}
+      else if (pos == left_size)
+	{
+	  line->ref_count++;
+	  history_line_release (cur->line);
+	  cur->line = line;
+	  return 0;
+	}
+      else
+	{
+	  pos -= left_size + 1;
+	  slot = &cur->right;
+	}
+    }
+
+  return 0;
+}
+
+/* Lists the records of the lines of a snapshot, in order.
+ *  input:
+ *    seq - the snapshot.
+ *    lines - the vector of history_line_t pointers to add the records to.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+int
+history_seq_lines (history_seq_t * seq, vec_t * lines)
+{
+  int ret;
+
+  while (seq)
+    {
+      ret = history_seq_lines (seq->left, lines);
+      if (ret < 0)
+	return -1;
+
+      ret = vec_add_obj (lines, &seq->line);
+      if (ret < 0)
+	return -1;
+
+      seq = seq->right;
+    }
+
+  return 0;
+}
+
+/* Retains a snapshot.
+ *  input:
+ *    seq - the snapshot.
+ *  output:
+ *    the snapshot.
+ */
+history_seq_t *
+history_seq_retain (history_seq_t * seq)
+{
+  if (seq)
+    seq->ref_count++;
+
+  return seq;
+}
+
+/* Releases a reference to a snapshot, destroying the nodes that no
+ * other snapshot shares.
+ *  input:
+ *    seq - the snapshot to release.
+ *  output:
+ *    none.
+ */
+void
+history_seq_release (history_seq_t * seq)
+{
+  while (seq && --seq->ref_count == 0)
+    {
+      history_seq_t * right = seq->right;
+
+      history_line_release (seq->line);
+      history_seq_release (seq->left);
+      free (seq);
+
+      seq = right;
+    }
+}
+
+/* Initializes an empty history.
+ *  input:
+ *    max_steps - the most snapshots to keep.
+ *  output:
+ *    the new history, or NULL on error.
+ */
+history_t *
+history_init (int max_steps)
+{
+  history_t * hist;
+
+  hist = (history_t *) calloc (1, sizeof (history_t));
+  CHECK_ALLOC (hist, NULL);
+
+  hist->alloc_steps = 16;
+  hist->steps = (history_seq_t **) calloc (hist->alloc_steps,
+					   sizeof (history_seq_t *));
+  CHECK_ALLOC (hist->steps, NULL);
+
+  hist->num_steps = 0;
+  hist->cur = -1;
+  hist->max_steps = max_steps;
+
+  return hist;
+}
+
+/* Destroys a history, and releases its snapshots.
+ *  input:
+ *    hist - the history to destroy.
+ *  output:
+ *    none.
+ */
+void
+history_destroy (history_t * hist)
+{
+  int i;
+
+  for (i = 0; i < hist->num_steps; i++)
+    history_seq_release (hist->steps[i]);
+
+  free (hist->steps);
+  free (hist);
+}
+
+/* Adds a snapshot after the current one, dropping any that were undone,
+ * and the oldest one if there are too many.
+ *  input:
+ *    hist - the history.
+ *    seq - the snapshot, which is retained.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+int
+history_push (history_t * hist, history_seq_t * seq)
+{
+  while (hist->num_steps > hist->cur + 1)
+    history_seq_release (hist->steps[--hist->num_steps]);
+
+  if (hist->num_steps == hist->max_steps)
+    {
+      history_seq_release (hist->steps[0]);
+      memmove (hist->steps, hist->steps + 1,
+	       (hist->num_steps - 1) * sizeof (history_seq_t *));
+      hist->num_steps--;
+    }
+
+  if (hist->num_steps == hist->alloc_steps)
+    {
+      history_seq_t ** steps;
+
+      steps = (history_seq_t **) realloc (hist->steps,
+					  2 * hist->alloc_steps
+					  * sizeof (history_seq_t *));
+      CHECK_ALLOC (steps, -1);
+
+      hist->steps = steps;
+      hist->alloc_steps *= 2;
+    }
+
+  hist->steps[hist->num_steps++] = history_seq_retain (seq);
+  hist->cur = hist->num_steps - 1;
+
+  return 0;
+}
+
+/* Replaces the current snapshot, such as when only the values of its
+ * lines have changed.
+ *  input:
+ *    hist - the history.
+ *    seq - the snapshot, which is retained.
+ *  output:
+ *    none.
+ */
+void
+history_amend (history_t * hist, history_seq_t * seq)
+{
+  history_seq_retain (seq);
+  history_seq_release (hist->steps[hist->cur]);
+  hist->steps[hist->cur] = seq;
+}
+
+/* Moves back to the previous snapshot.
+ *  input:
+ *    hist - the history.
+ *    seq - receives the previous snapshot, which is not retained.
+ *  output:
+ *    0 on success, 1 if there is nothing to undo.
+ */
+int
+history_undo (history_t * hist, history_seq_t ** seq)
+{
+  if (hist->cur <= 0)
+    return 1;
+
+  *seq = hist->steps[--hist->cur];
+  return 0;
+}
+
+/* Moves forward to the snapshot that was last undone.
+ *  input:
+ *    hist - the history.
+ *    seq - receives the next snapshot, which is not retained.
+ *  output:
+ *    0 on success, 1 if there is nothing to redo.
+ */
+int
+history_redo (history_t * hist, history_seq_t ** seq)
+{
+  if (hist->cur + 1 >= hist->num_steps)
+    return 1;
+
+  *seq = hist->steps[++hist->cur];
+  return 0;
+}
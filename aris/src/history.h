@@ -0,0 +1,94 @@
+/* The undo history of a proof.
+
+   Copyright (C) 2012 Ian Dunn.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ARIS_HISTORY_H
+#define ARIS_HISTORY_H
+
+typedef struct history_line history_line_t;
+typedef struct history_seq history_seq_t;
+typedef struct history history_t;
+typedef struct vector vec_t;
+
+// The most steps kept by a history.
+
+#define HISTORY_DEPTH 1000
+
+// The record of a line, as it was when a snapshot was taken.  Records
+// never change once they are made, so snapshots share them.
+
+struct history_line {
+  int ref_count;          // The amount of snapshots that use this record.
+  int id;                 // The id of the sentence this is a record of.
+  unsigned char * text;   // The text of the line.
+  unsigned char * sexpr;  // The sexpr of the line, or NULL if not known.
+  unsigned char * file;   // The file of the lemma, or NULL.
+  int * refs;             // The ids of the references, ending with -1.
+  int rule;               // The rule of the line.
+  int premise;            // Whether or not the line is a premise.
+  int subproof;           // Whether or not the line starts a subproof.
+  int depth;              // The depth of the line.
+  int value_type;         // The value type of the line.
+};
+
+// A node of a snapshot.  A snapshot is a tree of the records of its
+// lines, kept in order, and is never changed once another one shares it.
+
+struct history_seq {
+  int ref_count;           // The amount of trees that use this subtree.
+  int size;                // The amount of lines in this subtree.
+  unsigned int priority;   // The priority of the node in the treap.
+  history_line_t * line;   // The record of the line.
+  history_seq_t * left;    // The lines before this one.
+  history_seq_t * right;   // The lines after this one.
+};
+
+// The snapshots that can be undone or redone to.
+
+struct history {
+  history_seq_t ** steps;  // The snapshots, oldest first.
+  int num_steps;           // The amount of snapshots.
+  int alloc_steps;         // The allocated amount of snapshots.
+  int cur;                 // The index of the current snapshot.
+  int max_steps;           // The most snapshots that are kept.
+};
+
+history_line_t * history_line_init (int id, unsigned char * text,
+				    unsigned char * sexpr,
+				    unsigned char * file, int * refs,
+				    int rule, int premise, int subproof,
+				    int depth, int value_type);
+void history_line_release (history_line_t * line);
+
+int history_seq_size (history_seq_t * seq);
+history_line_t * history_seq_nth (history_seq_t * seq, int pos);
+int history_seq_insert (history_seq_t ** seq, int pos,
+			history_line_t * line);
+int history_seq_remove (history_seq_t ** seq, int pos);
+int history_seq_set (history_seq_t ** seq, int pos, history_line_t * line);
+int history_seq_lines (history_seq_t * seq, vec_t * lines);
+history_seq_t * history_seq_retain (history_seq_t * seq);
+void history_seq_release (history_seq_t * seq);
+
+history_t * history_init (int max_steps);
+void history_destroy (history_t * hist);
+int history_push (history_t * hist, history_seq_t * seq);
+void history_amend (history_t * hist, history_seq_t * seq);
+int history_undo (history_t * hist, history_seq_t ** seq);
+int history_redo (history_t * hist, history_seq_t ** seq);
+
+#endif /* ARIS_HISTORY_H */
@@ -1,1668 +1,2432 @@
+/* Functions for importing Isabelle theories.
+
+   Copyright (C) 2012 Ian Dunn.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
-#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <pthread.h>
+
+#ifndef WIN32
+#include <sys/mman.h>
+#endif
 
-#include "vec.h"
 #include "process.h"
 #include "interop-isar.h"
+#include "vec.h"
 #include "list.h"
+#include "hash.h"
 #include "proof.h"
 #include "sen-data.h"
 
-// Defined sequences.
-vec_t * seqs;
-
-// List of null keys.
-static const char * null_keys[] = {
-  "text",
-  "text_raw",
-  "subsection",
-  "subsubsection",
-  NULL
-};
-
-static char * conn_prec[4] = {
-  "%",
-  "$",
-  "|",
-  "&"
-};
+#define MEM_SUBSYSTEM MEM_IO
+#include "mem.h"
 
 /* Main Idea:
- *  Parse the definitions from the .thy file,
- *  then parse the lemmas and theorems.
- *  Create a vector of references from the definitions,
- *  then, create a proof_t with the definitions and such as premises,
- *  and the lemmas as goals.
- *  Use (R0 & R1 & R2 & ... & RN) $ Conc for each lemma.
+ *  The theory is read in one pass by a lexer over the mapped file.
+ *  The definitions, axioms and function equations of the theory become
+ *  the premises of a proof_t, and its lemmas and theorems become the
+ *  goals, so that the theory can be used as a lemma.
+ *  Each term is parsed by a recursive descent parser into a tree, which
+ *  is then written out with Aris' connectives.
+ *  The theories that a theory imports are found next to it or in the
+ *  search path, and are read first, each once, so that their definitions
+ *  are premises as well.  What was read from each file is kept until the
+ *  file changes, and theories that need reading are read in parallel.
  */
 
-// Might help to keep track of annotations, such as infixl, etc.
-// Keep track of function name, annotation string, association, and priority.
-
-/*TODO:
- *  Most of these functions don't do anything yet, but stand as place holders.
- *  Still need to parse notation, such as 'infix'.
- *  Still need:
- *    class
- *    instance
- *    instantiation
- *    abbreviation
- */
+// The tokens of a theory.
 
-int
-get_std_seqs ()
-{
-  int chk;
-  in_type seq_n, seq_s;
+enum ISAR_TOKENS {
+  ISAR_TOK_END = 0,     // The end of the file.
+  ISAR_TOK_NAME,        // A name or keyword, such as lemma or P.
+  ISAR_TOK_STRING,      // A quoted string, holding a term or a type.
+  ISAR_TOK_CARTOUCHE,   // A cartouche, holding a term or text.
+  ISAR_TOK_VERBATIM,    // Verbatim text, between {* and *}.
+  ISAR_TOK_SYMBOL,      // Any other symbol, such as : or [.
+  ISAR_TOK_ERROR        // An unterminated string, comment or cartouche.
+};
 
-  seqs = init_vec (sizeof (in_type));
-  if (!seqs)
-    return -1;
+// The tokens of a term.
+
+enum ISAR_TERM_TOKENS {
+  ISAR_TT_END = 0,      // The end of the term.
+  ISAR_TT_NAME,         // A name, such as P or x.
+  ISAR_TT_OPEN,         // An opening parenthesis.
+  ISAR_TT_CLOSE,        // A closing parenthesis.
+  ISAR_TT_COMMA,        // A comma.
+  ISAR_TT_DOT,          // The dot after the variables of a quantifier.
+  ISAR_TT_TYPE,         // The :: before a type.
+  ISAR_TT_ARROW,        // The arrow of a function type.
+  ISAR_TT_NOT,          // A negation.
+  ISAR_TT_ALL,          // A universal quantifier.
+  ISAR_TT_EX,           // An existential quantifier.
+  ISAR_TT_BINARY,       // A binary operator, from isar_ops.
+  ISAR_TT_ERROR         // Anything that isn't understood.
+};
 
-  seq_n.type = "nat";
-  seq_n.seq = "n";
-  chk = vec_add_obj (seqs, &seq_n);
-  if (chk < 0)
-    return -1;
+// The types of the nodes of a term's tree.
 
-  seq_s.type = "set";
-  seq_n.seq = "s";
-  chk = vec_add_obj (seqs, &seq_s);
-  if (chk < 0)
-    return -1;
+enum ISAR_TERMS {
+  ISAR_TERM_NAME = 0,   // A name, such as a variable.
+  ISAR_TERM_APP,        // A function or predicate applied to arguments.
+  ISAR_TERM_NOT,        // A negation.
+  ISAR_TERM_QUANT,      // A quantifier and its scope.
+  ISAR_TERM_BINARY      // A binary operator and its operands.
+};
 
-  return 0;
-}
+// The kinds of binary operators.
+
+enum ISAR_OP_KINDS {
+  ISAR_OP_AND = 0,      // Conjunction.
+  ISAR_OP_OR,           // Disjunction.
+  ISAR_OP_CON,          // Implication, including meta implication.
+  ISAR_OP_BIC,          // Biconditional.
+  ISAR_OP_EQ,           // Equality, which is biconditional between formulas.
+  ISAR_OP_NEQ,          // Inequality.
+  ISAR_OP_ELM,          // Membership.
+  ISAR_OP_TERM          // Any other operator, written as it is.
+};
 
-char *
-get_new_seq ()
-{
-  // Change this to a global variable.
-  int cur_seq = 0;
+typedef struct isar_op isar_op;
+typedef struct isar_term isar_term;
+typedef struct isar_lexer isar_lexer;
+typedef struct isar_term_lexer isar_term_lexer;
+typedef struct isar_buf isar_buf;
+typedef struct isar_theory isar_theory;
+
+// A binary operator of a term.
+
+struct isar_op {
+  const char * text;    // The operator, as it is written in Isabelle.
+  int kind;             // The kind of operator.
+  int prec;             // The precedence of the operator.
+  int right;            // Whether the operator associates to the right.
+  const char * out;     // For other operators, how it is written in Aris.
+};
 
-  int alloc_size;
-  char * ret;
+// The binary operators, longest first where one begins another.
+
+static isar_op isar_ops[] = {
+  { "\\<Longrightarrow>", ISAR_OP_CON, 1, 1, NULL },
+  { "==>", ISAR_OP_CON, 1, 1, NULL },
+  { "\\<equiv>", ISAR_OP_EQ, 2, 0, NULL },
+  { "==", ISAR_OP_EQ, 2, 0, NULL },
+  { "\\<longleftrightarrow>", ISAR_OP_BIC, 25, 1, NULL },
+  { "<->", ISAR_OP_BIC, 25, 1, NULL },
+  { "\\<longrightarrow>", ISAR_OP_CON, 25, 1, NULL },
+  { "-->", ISAR_OP_CON, 25, 1, NULL },
+  { "\\<or>", ISAR_OP_OR, 30, 1, NULL },
+  { "|", ISAR_OP_OR, 30, 1, NULL },
+  { "\\<and>", ISAR_OP_AND, 35, 1, NULL },
+  { "&", ISAR_OP_AND, 35, 1, NULL },
+  { "\\<noteq>", ISAR_OP_NEQ, 50, 0, NULL },
+  { "~=", ISAR_OP_NEQ, 50, 0, NULL },
+  { "\\<in>", ISAR_OP_ELM, 50, 0, NULL },
+  { "\\<le>", ISAR_OP_TERM, 50, 0, "<=" },
+  { "<=", ISAR_OP_TERM, 50, 0, "<=" },
+  { "<", ISAR_OP_TERM, 50, 0, "<" },
+  { "=", ISAR_OP_EQ, 50, 0, NULL },
+  { ":", ISAR_OP_ELM, 50, 0, NULL },
+  { "+", ISAR_OP_TERM, 65, 0, "+" },
+  { "*", ISAR_OP_TERM, 70, 0, "*" },
+  { NULL, 0, 0, 0, NULL }
+};
 
-  alloc_size = (int) log ((double) cur_seq) + 1;
-  alloc_size += 2;
-  ret = (char *) calloc (alloc_size + 1, sizeof (char));
-  CHECK_ALLOC (ret, NULL);
-  sprintf (ret, "ts%i", ++cur_seq);
+// The error given for a token that isn't closed.
 
-  return ret;
-}
+#define ISAR_UNTERMINATED "unterminated string, comment or cartouche."
 
-int
-parse_quant (char * in_str, int sym_size, unsigned char * quant, char ** out_str)
-{
-  int alloc_size, pos, init_pos, ret_chk;
-  char * chk_str;
-  vec_t * vars;
+// The precedence of negation.
 
-  alloc_size = 0;
-  pos = sym_size;
+#define ISAR_PREC_NOT 40
 
-  vars = init_vec (sizeof (char *));
-  if (!vars)
-    return -1;
+// A node of a term's tree.
 
-  while (in_str[pos] != '.')
-    {
-      while (isspace (in_str[pos]))
-	pos++;
+struct isar_term {
+  int type;             // The type of this node.
+  const char * text;    // The name, or the variable of a quantifier.
+  int len;              // The length of the name.
+  int quant;            // For quantifiers, ISAR_TT_ALL or ISAR_TT_EX.
+  isar_op * op;         // For binary operators, the operator.
+  isar_term * left;     // The left operand, or the function's first argument.
+  isar_term * right;    // The right operand, or the scope of a quantifier.
+  isar_term * next;     // The next argument of a function.
+};
 
-      init_pos = pos;
+// A token of a theory.
 
-      while (isalpha (in_str[pos]))
-	pos++;
+struct isar_token {
+  int type;             // The type of the token.
+  const char * text;    // The text of the token, or the inside of a string.
+  int len;              // The length of the text.
+  int line;             // The line that the token starts on.
+};
 
-      char * tmp_str;
-      tmp_str = (char *) calloc (pos - init_pos + 1, sizeof (char));
-      CHECK_ALLOC (tmp_str, -1);
-      strncpy (tmp_str, in_str + init_pos, pos - init_pos);
-      tmp_str[pos - init_pos] = '\0';
-      alloc_size += pos - init_pos + CL;
+// The lexer of a theory.
 
-      ret_chk = vec_str_add_obj (vars, tmp_str);
-      if (ret_chk < 0)
-	return -1;
+struct isar_lexer {
+  const char * file;    // The name of the file, for errors.
+  const char * buf;     // The contents of the file.
+  size_t len;           // The length of the contents.
+  size_t pos;           // The position of the next token.
+  int line;             // The line of the next token.
+  struct isar_token tok;    // The current token.
+  struct isar_token ahead;  // The token after the current one.
+};
 
-      free (tmp_str);
-    }
+// The lexer of a term.
 
-  *out_str = (char *) calloc (alloc_size + 2, sizeof (char));
-  CHECK_ALLOC (*out_str, -1);
+struct isar_term_lexer {
+  const char * buf;     // The term.
+  int len;              // The length of the term.
+  int pos;              // The position of the next token.
+  int type;             // The type of the current token.
+  const char * text;    // The text of the current token.
+  int tok_len;          // The length of the current token.
+  isar_op * op;         // For binary operators, the operator.
+};
 
-  int i, out_pos = 0;
-  for (i = 0; i < vars->num_stuff; i++)
-    {
-      out_pos += sprintf (*out_str + out_pos, "%s%s",
-			  quant, vec_str_nth (vars, i));
-    }
-  destroy_str_vec (vars);
+// A growing string.
 
-  out_pos += sprintf (*out_str + out_pos, "(");
+struct isar_buf {
+  char * str;           // The string.
+  int len;              // The length of the string.
+  int size;             // The space allocated for the string.
+};
 
-  return pos;
-}
+// The states of a theory while its imports are visited.
 
-// Functions associate to the left.
-// For example
-// f a b c = ((f a) b) c
+enum ISAR_STATE {
+  ISAR_VISITING,
+  ISAR_DONE
+};
 
-int
-parse_pred_func (char * in_str, char ** out_str)
-{
-  int pos, init_pos, ret_chk;
-  char * pred;
+// A theory that has been read, kept until its file changes.
+
+struct isar_theory {
+  char * path;          // The canonical path of the file.
+  time_t mtime;         // The modification time of the file when read.
+  off_t size;           // The size of the file when read.
+  vec_t * imports;      // The theories that this one imports.
+  vec_t * prems;        // The premises read from the theory.
+  vec_t * goals;        // The goals read from the theory.
+  int visit;            // The load that last visited the theory.
+  int state;            // The state of the theory in that load.
+  char * buf;           // While being read, the contents of the file.
+  size_t len;           // The length of the contents.
+  int mapped;           // Whether the contents were mapped.
+  isar_lexer lex;       // While being read, the lexer after the header.
+};
 
-  init_pos = pos = 0;
+// The theories that are waiting to be read.
 
-  while (isalnum (in_str[pos]))
-    pos++;
+struct isar_queue {
+  vec_t * todo;         // The theories to read.
+  int next;             // The next theory to read.
+  int failed;           // Whether a theory couldn't be read.
+  pthread_mutex_t lock; // Guards the above.
+};
 
-  pred = (char *) calloc (pos + 1, sizeof (char));
-  CHECK_ALLOC (pred, -1);
-  strncpy (pred, in_str, pos);
-  pred[pos] = '\0';
+// The symbols of a term other than binary operators, longest first where
+// one begins another.
+
+static struct {
+  const char * text;    // The symbol.
+  int type;             // The token of the symbol.
+} isar_words[] = {
+  { "\\<forall>", ISAR_TT_ALL },
+  { "\\<And>", ISAR_TT_ALL },
+  { "!!", ISAR_TT_ALL },
+  { "\\<exists>", ISAR_TT_EX },
+  { "\\<not>", ISAR_TT_NOT },
+  { "::", ISAR_TT_TYPE },
+  { "\\<Rightarrow>", ISAR_TT_ARROW },
+  { "=>", ISAR_TT_ARROW },
+  { NULL, 0 }
+};
 
-  int tmp_pos;
-  tmp_pos = pos;
+// The commands that begin a new part of a theory.  Anything from the
+// start of a proof to the next of these is skipped.
+
+static const char * isar_commands[] = {
+  "lemma", "theorem", "corollary", "proposition", "schematic_goal",
+  "definition", "abbreviation", "fun", "function", "primrec",
+  "axiomatization", "datatype", "codatatype", "type_synonym", "typedecl",
+  "consts", "text", "text_raw", "chapter", "section", "subsection",
+  "subsubsection", "paragraph", "declare", "notation", "no_notation",
+  "locale", "context", "class", "instantiation", "instance",
+  "interpretation", "record", "inductive", "inductive_set", "termination",
+  "lemmas", "named_theorems", "value", "term", "thm", "ML", "setup",
+  "begin", "end",
+  NULL
+};
 
-  while (isspace (in_str[tmp_pos]))
-    tmp_pos++;
+// The separator of the directories in the search path.
 
-  //TODO: Check for a connective or closing parenthesis.
-  if (in_str[tmp_pos] == '|' || in_str[tmp_pos] == '&'
-      || !strncmp (in_str + tmp_pos, "-->", 3)
-      || !strncmp (in_str + tmp_pos, "==>", 3)
-      || in_str[tmp_pos] == ':'
-      || in_str[tmp_pos] == ')' || in_str[tmp_pos] == '\0')
-    {
-      *out_str = (char *) calloc (pos + 1, sizeof (char));
-      CHECK_ALLOC (*out_str, -1);
-      strcpy (*out_str, pred);
-      free (pred);
-      return pos;
-    }
+#ifndef WIN32
+#define ISAR_PATH_SEP ':'
+#else
+#define ISAR_PATH_SEP ';'
+#endif
 
-  vec_t * args;
-  int alloc_size = 0;
+// The theories that have been read, by canonical path.  Entries are
+// never removed, so that theories can point to those they import.
 
-  args = init_vec (sizeof (char *));
-  if (!args)
-    return -1;
+static hash_t * isar_theories = NULL;
 
-  while (in_str[pos] != ')' && in_str[pos] != '\0'
-	 && in_str[pos] != '>' && in_str[pos] != '*'
-	 && in_str[pos] != '<' && in_str[pos] != '+'
-	 && strncmp (in_str + pos, "-->", 3)
-	 && strncmp (in_str + pos, "==>", 3))
-    {
-      while (isspace (in_str[pos]))
-	pos++;
+// The directories that imported theories are looked for in.
 
-      if (in_str[pos] == ')' || in_str[pos] == '\0'
-	  || in_str[pos] == '>' || in_str[pos] == '*'
-	  || in_str[pos] == '<' || in_str[pos] == '+'
-	  || !strncmp (in_str + pos, "-->", 3)
-	  || !strncmp (in_str + pos, "==>", 3))
-	{
-	  break;
-	}
+static vec_t * isar_path = NULL;
 
-      init_pos = pos;
+// The number of the current load, to mark the theories it visits.
 
-      if (in_str[pos] == '(')
-	{
-	  tmp_pos = parse_parens (in_str, pos, NULL);
-	  pos = tmp_pos + 1;
-	}
-      else
-	{
-	  while (isalnum (in_str[pos]) || in_str[pos] == ':')
-	    pos++;
-	}
+static int isar_visits = 0;
 
-      char * cur_arg;
+// Guards the above, for the whole of a load.
 
-      cur_arg = (char *) calloc (pos - init_pos + 1, sizeof (char));
-      CHECK_ALLOC (cur_arg, -1);
-      strncpy (cur_arg, in_str + init_pos, pos - init_pos);
-      cur_arg[pos - init_pos] = '\0';
-      alloc_size += 2 + pos - init_pos;
+static pthread_mutex_t isar_lock = PTHREAD_MUTEX_INITIALIZER;
 
-      ret_chk = vec_str_add_obj (args, cur_arg);
-      if (ret_chk == -1)
-	return -1;
-      free (cur_arg);
+/* Maps a file into memory, or reads it in where it can't be mapped.
+ *  input:
+ *    filename - the name of the file.
+ *    len - receives the length of the file.
+ *    mapped - receives whether the file was mapped.
+ *  output:
+ *    the contents of the file, or NULL on error.
+ */
+static char *
+isar_map (const char * filename, size_t * len, int * mapped)
+{
+  struct stat st;
+  char * buf;
+  size_t pos;
+  ssize_t got;
+  int fd;
+
+  fd = open (filename, O_RDONLY);
+  if (fd == -1 || fstat (fd, &st) == -1)
+    {
+      perror (filename);
+      if (fd != -1)
+	close (fd);
+      return NULL;
     }
 
-  int i, out_pos = 0;
+  *len = st.st_size;
+  *mapped = 0;
 
-  *out_str = (char *) calloc (strlen (pred) + 2, sizeof (char));
-  CHECK_ALLOC (*out_str, -1);
-  out_pos += sprintf (*out_str + out_pos, "%s(", pred);
-  free (pred);
-
-  for (i = 0; i < args->num_stuff; i++)
+#ifndef WIN32
+  if (*len > 0)
     {
-      char * elm_str, * cur_arg;
-      cur_arg = vec_str_nth (args, i);
-      printf ("arg[%i] = '%s'\n", i, cur_arg);
-      if (cur_arg[0] == '(')
-	{
-	  elm_str = elim_par (cur_arg);
-	  if (!elm_str)
-	    return -1;
-	}
-      else
+      buf = mmap (NULL, *len, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (buf != MAP_FAILED)
 	{
-	  elm_str = (char *) calloc (strlen (cur_arg) + 1, sizeof (char));
-	  CHECK_ALLOC (elm_str, -1);
-	  strcpy (elm_str, cur_arg);
+	  close (fd);
+	  *mapped = 1;
+	  return buf;
 	}
+    }
+#endif
 
-      char * mod_arg;
-      ret_chk = parse_pred_func (elm_str, &mod_arg);
-      if (ret_chk == -1)
-	return -1;
-      free (elm_str);
-
-      *out_str = (char *) realloc (*out_str,
-				   (out_pos + strlen (mod_arg) + 2) * sizeof (char));
-      CHECK_ALLOC (*out_str, -1);
-      out_pos += sprintf (*out_str + out_pos, "%s", mod_arg);
-      free (mod_arg);
-
-      if (i < args->num_stuff - 1)
-	out_pos += sprintf (*out_str + out_pos, ",");
+  buf = (char *) calloc (*len + 1, sizeof (char));
+  if (!buf)
+    {
+      perror (NULL);
+      close (fd);
+      return NULL;
     }
 
-  *out_str = (char *) realloc (*out_str, (out_pos + 2) * sizeof (char));
-  CHECK_ALLOC (*out_str, -1);
-  out_pos += sprintf (*out_str + out_pos, ")");
+  for (pos = 0; pos < *len; pos += got)
+    {
+      got = read (fd, buf + pos, *len - pos);
+      if (got <= 0)
+	{
+	  perror (filename);
+	  free (buf);
+	  close (fd);
+	  return NULL;
+	}
+    }
 
-  return pos;
+  close (fd);
+  return buf;
 }
 
-// Check the connectives, and group them as necessary.
-// The priority in Isar is as follows:
-// ~, &, |, $, %
-// This should be reversed, so that they group properly.
-// These all associate to the right (except, of course, ~).
-// parses a specific connective, and ignore the others.
-// Runs for each connective in order.
-//IDEA: Run this for ALL KNOWN SYMBOLS.
-// When each is defined, a priority and association is defined with it.
-//ALSO: Main is not always imported, so it might need to be processed.
-// Might be helpful to have functions for processing standard imports.
-// HOL, Orderings, Lattices, Sets, etc.
-// A complete list is in Isabelle/doc/main.pdf
-
-int
-parse_connectives (char * in_str, int cur_conn, char ** out_str)
+/* Releases a file from isar_map.
+ *  input:
+ *    buf - the contents of the file.
+ *    len - the length of the file.
+ *    mapped - whether the file was mapped.
+ *  output:
+ *    none.
+ */
+static void
+isar_unmap (char * buf, size_t len, int mapped)
 {
-  if (cur_conn > 3)
+#ifndef WIN32
+  if (mapped)
     {
-      *out_str = (char *) calloc (strlen (in_str), sizeof (char));
-      CHECK_ALLOC (*out_str, -1);
-      strcpy (*out_str, in_str);
-      return 0;
+      munmap (buf, len);
+      return;
     }
+#endif
+
+  free (buf);
+}
 
-  vec_t * gens;
-  int gg = 0, ret_chk, gen_pos, in_len;
-  unsigned char * new_gen, * conn, * gen = NULL;
+/* Reports an error in a theory.
+ *  input:
+ *    lex - the lexer of the theory.
+ *    line - the line of the error.
+ *    msg - the error.
+ *  output:
+ *    -1, so that this can be returned.
+ */
+static int
+isar_error (isar_lexer * lex, int line, const char * msg)
+{
+  fprintf (stderr, "Theory Error - %s:%i: %s\n", lex->file, line, msg);
+  return -1;
+}
 
-  //Process negations and quantifiers first.
-  //Similar manner to that of 'convert_sexpr' from process.c.
+/* Checks whether a character can be part of a name.
+ *  input:
+ *    c - the character to check.
+ *  output:
+ *    1 if it can, 0 otherwise.
+ */
+static int
+isar_name_char (char c)
+{
+  return (isalnum ((unsigned char) c) || c == '_' || c == '\'' || c == '.'
+	  || c == '?');
+}
 
-  gens = init_vec (sizeof (char *));
-  if (!gens)
-    return -1;
-  conn = conn_prec[cur_conn];
+/* Checks whether a character is part of a symbolic identifier.
+ *  input:
+ *    c - the character to check.
+ *  output:
+ *    1 if it is, 0 otherwise.
+ */
+static int
+isar_sym_char (char c)
+{
+  return (c != '\0' && strchr ("!#$%&*+-/<=>?@^|~:", c) != NULL);
+}
 
-  // It would be better if spaces were gone when this is processing,
-  // so it would be good if predicates and functions are fixed BEFORE
-  // parse_connectives is called.
+/* Checks whether text begins with a string.
+ *  input:
+ *    buf - the text.
+ *    len - the length of the text.
+ *    str - the string to look for.
+ *  output:
+ *    the length of str if the text begins with it, 0 otherwise.
+ */
+static int
+isar_begins (const char * buf, size_t len, const char * str)
+{
+  size_t str_len = strlen (str);
 
-  vec_t * got_conns;
-  int got_con;
+  if (str_len > len || strncmp (buf, str, str_len))
+    return 0;
 
-  got_conns = init_vec (sizeof (int));
-  if (!got_conns)
-    return -1;
+  return str_len;
+}
 
-  while (in_str[gg] != '\0')
-    {
-      gen_pos = 0;
-      gen = (unsigned char *) calloc (1, sizeof (char));
-      CHECK_ALLOC (gen, -1);
+/* Skips a nested block, such as a comment or a cartouche.
+ *  input:
+ *    lex - the lexer, positioned at the opening of the block.
+ *    open - the opening of the block.
+ *    close - the closing of the block.
+ *  output:
+ *    0 on success, -1 if the block isn't closed.
+ */
+static int
+isar_skip_block (isar_lexer * lex, const char * open, const char * close)
+{
+  int depth = 0, n;
 
-      while (strncmp (in_str + gg, conn, CL))
+  while (lex->pos < lex->len)
+    {
+      if ((n = isar_begins (lex->buf + lex->pos, lex->len - lex->pos, open)))
 	{
-	  gg = get_gen (in_str, gg, &new_gen);
-	  if (gg == -1)
-	    return -1;
+	  depth++;
+	  lex->pos += n;
+	}
+      else if ((n = isar_begins (lex->buf + lex->pos, lex->len - lex->pos,
+				 close)))
+	{
+	  lex->pos += n;
+	  if (--depth == 0)
+	    return 0;
+	}
+      else
+	{
+	  if (lex->buf[lex->pos] == '\n')
+	    lex->line++;
+	  lex->pos++;
+	}
+    }
 
-	  // Need to check for the existence of an actual connective.
-	  // Parent parse_connectives will need to know if parentheses are necessary
+  return -1;
+}
 
-	  int g_len;
+/* Reads the next token of a theory.
+ *  input:
+ *    lex - the lexer.
+ *    tok - receives the token.
+ *  output:
+ *    none.
+ */
+static void
+isar_lex (isar_lexer * lex, struct isar_token * tok)
+{
+  const char * buf = lex->buf;
+  size_t start;
+  int n;
 
-	  g_len = strlen (new_gen);
-	  gen = realloc (gen, (gen_pos + g_len) * sizeof (char));
-	  CHECK_ALLOC (gen, -1);
-	  
-	  gen_pos += sprintf (gen + gen_pos, "%s", new_gen);
-	  free (new_gen);
+  // Skip whitespace and comments.
 
-	  if (in_str[gg] == '\0')
-	    {
-	      got_con = 0;
-	      if (got_conns->num_stuff == gens->num_stuff)
-		{
-		  ret_chk = vec_add_obj (got_conns, &got_con);
-		  if (ret_chk < 0)
-		    return -1;
-		}
-	      break;
-	    }
+  while (lex->pos < lex->len)
+    {
+      if (buf[lex->pos] == '\n')
+	lex->line++;
 
-	  if (strncmp (in_str + gg, conn, CL))
-	    {
-	      strncpy (gen + gen_pos, in_str + gg, CL);
-	      gen_pos += CL;
-	      got_con = 1;
-	      if (got_conns->num_stuff == gens->num_stuff)
-		{
-		  ret_chk = vec_add_obj (got_conns, &got_con);
-		  if (ret_chk < 0)
-		    return -1;
-		}
-	    }
-	  else
+      if (isspace ((unsigned char) buf[lex->pos]))
+	{
+	  lex->pos++;
+	  continue;
+	}
+
+      if (isar_begins (buf + lex->pos, lex->len - lex->pos, "(*"))
+	{
+	  tok->line = lex->line;
+	  if (isar_skip_block (lex, "(*", "*)") == -1)
 	    {
-	      got_con = 0;
-	      if (got_conns->num_stuff == gens->num_stuff)
-		{
-		  ret_chk = vec_add_obj (got_conns, &got_con);
-		  if (ret_chk < 0)
-		    return -1;
-		}
-	      break;
+	      tok->type = ISAR_TOK_ERROR;
+	      return;
 	    }
-
-	  gg += CL;
+	  continue;
 	}
 
-      ret_chk = vec_str_add_obj (gens, gen);
-      if (ret_chk < 0)
-	return -1;
-
-      free (gen);
-      if (in_str[gg] != '\0')
-	gg += CL;
+      break;
     }
 
-  if (gens->num_stuff == 1)
-    {
-      destroy_str_vec (gens);
+  tok->line = lex->line;
+  start = lex->pos;
 
-      char * tmp_str, * mod_in_str;
-      int mod = 0, out_pos, con_mod = 0, * ent, entire;
+  if (lex->pos >= lex->len)
+    {
+      tok->type = ISAR_TOK_END;
+      tok->text = buf + lex->len;
+      tok->len = 0;
+      return;
+    }
 
-      // Confirm that the symbol covers the ENTIRE sentence.
-      ent = vec_nth (got_conns, 0);
-      entire = *ent;
-      destroy_vec (got_conns);
+  if (buf[lex->pos] == '\"')
+    {
+      // Isabelle strings can't hold quotes, except escaped ones.
 
-      if (entire)
+      for (lex->pos++; lex->pos < lex->len && buf[lex->pos] != '\"';
+	   lex->pos++)
 	{
-	  mod_in_str = (char *) calloc (strlen (in_str), sizeof (char));
-	  CHECK_ALLOC (mod_in_str, -1);
-	  strcpy (mod_in_str, in_str);
-	  con_mod = 1;
+	  if (buf[lex->pos] == '\\' && lex->pos + 1 < lex->len
+	      && buf[lex->pos + 1] == '\"')
+	    lex->pos++;
+	  else if (buf[lex->pos] == '\n')
+	    lex->line++;
 	}
-      else
-	{
-	  if (!strncmp (in_str, NOT, NL))
-	    {
-	      mod_in_str = elim_not (in_str);
-	      if (!mod_in_str)
-		return -1;
-
-	      mod = NL;
-	    }
-	  else if (in_str[0] == '(')
-	    {
-	      mod_in_str = elim_par (in_str);
-	      if (!mod_in_str)
-		return -1;
 
-	      mod = 1;
-	    }
-	  else if (!strncmp (in_str, UNV, CL) || !strncmp (in_str, EXL, CL))
-	    {
-	      for (mod = CL; in_str[mod] != '\0'; mod++)
-		{
-		  if (!strncmp (in_str + mod, EXL, CL) || !strncmp (in_str + mod, UNV, CL)
-		      || in_str[mod] == '(' || !strncmp (in_str + mod, NOT, NL))
-		    break;
-		}
-
-	      mod_in_str = (char *) calloc (strlen (in_str) - mod, sizeof (char));
-	      CHECK_ALLOC (mod_in_str, -1);
-	      strcpy (mod_in_str, in_str + mod);
-	    }
-	  else
-	    {
-	      mod_in_str = (char *) calloc (strlen (in_str), sizeof (char));
-	      CHECK_ALLOC (mod_in_str, -1);
-	      strcpy (mod_in_str, in_str);
-	      con_mod = 4;
-	    }
+      if (lex->pos >= lex->len)
+	{
+	  tok->type = ISAR_TOK_ERROR;
+	  return;
 	}
 
-      gg = parse_connectives (mod_in_str, cur_conn + con_mod, &tmp_str);
-      if (gg == -1)
-	return -1;
+      tok->type = ISAR_TOK_STRING;
+      tok->text = buf + start + 1;
+      tok->len = lex->pos - start - 1;
+      lex->pos++;
+      return;
+    }
 
-      free (mod_in_str);
-      out_pos = mod;
+  if (isar_begins (buf + lex->pos, lex->len - lex->pos, "\\<open>"))
+    {
+      if (isar_skip_block (lex, "\\<open>", "\\<close>") == -1)
+	{
+	  tok->type = ISAR_TOK_ERROR;
+	  return;
+	}
 
-      *out_str = (char *) calloc (strlen (tmp_str) + mod + 2, sizeof (char));
-      CHECK_ALLOC (*out_str, -1);
-      strncpy (*out_str, in_str, mod);
-      out_pos += sprintf (*out_str + out_pos, "%s", tmp_str);
-      free (tmp_str);
-      if (in_str[0] == '(' && !entire)
-	(*out_str)[out_pos++] = ')';
+      n = strlen ("\\<open>");
+      tok->type = ISAR_TOK_CARTOUCHE;
+      tok->text = buf + start + n;
+      tok->len = lex->pos - start - n - strlen ("\\<close>");
+      return;
+    }
 
-      (*out_str)[out_pos] = '\0';
+  if (isar_begins (buf + lex->pos, lex->len - lex->pos, "{*"))
+    {
+      n = isar_skip_block (lex, "{*", "*}");
+      tok->type = (n == -1) ? ISAR_TOK_ERROR : ISAR_TOK_VERBATIM;
+      tok->text = buf + start;
+      tok->len = lex->pos - start;
+      return;
+    }
 
-      return 0;
+  if (isar_name_char (buf[lex->pos]))
+    {
+      while (lex->pos < lex->len && isar_name_char (buf[lex->pos]))
+	lex->pos++;
+      tok->type = ISAR_TOK_NAME;
+    }
+  else if (isar_sym_char (buf[lex->pos]))
+    {
+      while (lex->pos < lex->len && isar_sym_char (buf[lex->pos]))
+	lex->pos++;
+      tok->type = ISAR_TOK_SYMBOL;
+    }
+  else if (buf[lex->pos] == '\\' && lex->pos + 1 < lex->len
+	   && buf[lex->pos + 1] == '<')
+    {
+      while (lex->pos < lex->len && buf[lex->pos] != '>'
+	     && buf[lex->pos] != '\n')
+	lex->pos++;
+      if (lex->pos < lex->len && buf[lex->pos] == '>')
+	lex->pos++;
+      tok->type = ISAR_TOK_SYMBOL;
+    }
+  else
+    {
+      lex->pos++;
+      tok->type = ISAR_TOK_SYMBOL;
     }
 
-  vec_t * adjust_gens;
-  adjust_gens = init_vec (sizeof (char *));
-  if (!adjust_gens)
-    return -1;
+  tok->text = buf + start;
+  tok->len = lex->pos - start;
+}
 
-  int i, alloc_size = 0;
-  for (i = 0; i < gens->num_stuff; i++)
-    {
-      char * adj_gen;
-      gg = parse_connectives (vec_str_nth (gens, i), 0, &adj_gen);
-      if (gg == -1)
-	return -1;
+/* Moves a theory's lexer to the next token.
+ *  input:
+ *    lex - the lexer.
+ *  output:
+ *    none.
+ */
+static void
+isar_next (isar_lexer * lex)
+{
+  lex->tok = lex->ahead;
+  if (lex->tok.type != ISAR_TOK_END && lex->tok.type != ISAR_TOK_ERROR)
+    isar_lex (lex, &lex->ahead);
+}
 
-      ret_chk = vec_str_add_obj (adjust_gens, adj_gen);
-      if (ret_chk < 0)
-	return -1;
+/* Checks whether a token is a given name or symbol.
+ *  input:
+ *    tok - the token to check.
+ *    str - the name or symbol.
+ *  output:
+ *    1 if it is, 0 otherwise.
+ */
+static int
+isar_is (struct isar_token * tok, const char * str)
+{
+  if (tok->type != ISAR_TOK_NAME && tok->type != ISAR_TOK_SYMBOL)
+    return 0;
 
-      alloc_size += strlen (adj_gen) + CL;
-      free (adj_gen);
+  return ((size_t) tok->len == strlen (str)
+	  && !strncmp (tok->text, str, tok->len));
+}
 
-      // If parentheses need to be fixed, then increase alloc_size accordingly.
-      int * cur_con;
-      cur_con = vec_nth (got_conns, i);
-      if (*cur_con)
-	alloc_size += 2;
-    }
+/* Checks whether a token begins a new part of a theory.
+ *  input:
+ *    tok - the token to check.
+ *  output:
+ *    1 if it does, 0 otherwise.
+ */
+static int
+isar_is_command (struct isar_token * tok)
+{
+  int i;
 
-  destroy_str_vec (gens);
+  if (tok->type != ISAR_TOK_NAME)
+    return 0;
 
-  int out_pos = 0;
+  for (i = 0; isar_commands[i]; i++)
+    if (isar_is (tok, isar_commands[i]))
+      return 1;
 
-  if (cur_conn == 1 && adjust_gens->num_stuff > 2)
-    alloc_size += 2 * adjust_gens->num_stuff;
+  return 0;
+}
 
-  *out_str = (char *) calloc (alloc_size + 1, sizeof (char));
-  CHECK_ALLOC (*out_str, -1);
-  for (i = 0; i < adjust_gens->num_stuff; i++)
+/* Appends text to a growing string.
+ *  input:
+ *    out - the string to append to.
+ *    text - the text to append.
+ *    len - the length of the text.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+static int
+isar_buf_add (isar_buf * out, const char * text, int len)
+{
+  if (out->len + len + 1 > out->size)
     {
-      if (cur_conn == 1 && i > 0 && adjust_gens->num_stuff > 2 && i < adjust_gens->num_stuff - 1)
-	out_pos += sprintf (*out_str + out_pos, "(");
+      int size = out->size ? out->size : 64;
+      char * str;
 
-      int * cur_con;
-      cur_con = vec_nth (got_conns, i);
-      if (*cur_con)
-	out_pos += sprintf (*out_str + out_pos, "(");
-      out_pos += sprintf (*out_str + out_pos, "%s", vec_str_nth (adjust_gens, i));
-      if (*cur_con)
-	out_pos += sprintf (*out_str + out_pos, ")");
-      if (i < adjust_gens->num_stuff - 1)
-	out_pos += sprintf (*out_str + out_pos, "%s", conn);
-    }
+      while (out->len + len + 1 > size)
+	size *= 2;
 
-  if (cur_conn == 1 && adjust_gens->num_stuff > 2)
-    {
-      for (i = 0; i < adjust_gens->num_stuff - 2; i++)
-	out_pos += sprintf (*out_str + out_pos, ")");
+      str = (char *) realloc (out->str, size);
+      CHECK_ALLOC (str, -1);
+
+      out->str = str;
+      out->size = size;
     }
 
-  destroy_vec (got_conns);
-  destroy_vec (adjust_gens);
+  memcpy (out->str + out->len, text, len);
+  out->len += len;
+  out->str[out->len] = '\0';
 
   return 0;
 }
 
-int
-isar_parse_null (char * in_str)
+/* Appends a string to a growing string.
+ *  input:
+ *    out - the string to append to.
+ *    str - the string to append.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+static int
+isar_buf_str (isar_buf * out, const char * str)
 {
-  // Find '{' character, then find matching '}'.
-  // Return offset.
-  // Should be able to use modified 'parse_parens'.
+  return isar_buf_add (out, str, strlen (str));
+}
 
-  printf ("Got null\n");
+/* Destroys a term's tree.
+ *  input:
+ *    term - the tree to destroy.
+ *  output:
+ *    none.
+ */
+static void
+isar_term_destroy (isar_term * term)
+{
+  isar_term * arg, * next;
 
-  int pos = 0;
+  if (!term)
+    return;
 
-  while (strncmp (in_str + pos, "*}", 2))
-    pos++;
+  if (term->type == ISAR_TERM_APP)
+    {
+      for (arg = term->left; arg; arg = next)
+	{
+	  next = arg->next;
+	  isar_term_destroy (arg);
+	}
+    }
+  else
+    {
+      isar_term_destroy (term->left);
+    }
 
-  return pos;
+  isar_term_destroy (term->right);
+  free (term);
 }
 
-char *
-isar_mod_fun (char * in_str, char * fun_name)
+/* Creates a node of a term's tree.
+ *  input:
+ *    type - the type of the node.
+ *    left - the left operand, or the first argument.
+ *    right - the right operand, or the scope.
+ *  output:
+ *    the new node, or NULL on memory error.  The operands are destroyed
+ *    if the node can't be created.
+ */
+static isar_term *
+isar_term_init (int type, isar_term * left, isar_term * right)
 {
-  // Determine the input from in_str.
-  // If from the nats, use 'v(n,x)'...
-  // If suc (x) => v(n,s(x))
-  // If 1 => v(n,s(z(x)))
-  // Will need to know type sequences.
-  // Change any instance of 'fun_name' to 'v(y,z)', using the appropriate arguments.
+  isar_term * term;
 
-  // Suc 0 => suc (0) / v(n,s(x))
+  term = (isar_term *) calloc (1, sizeof (isar_term));
+  if (!term)
+    {
+      perror (NULL);
+      isar_term_destroy (left);
+      isar_term_destroy (right);
+      return NULL;
+    }
 
-  // Summation starts as (\<Sum>i::nat=0..n. i) (Taken from Summation.thy)
-  // change to sum(n, x);
+  term->type = type;
+  term->left = left;
+  term->right = right;
 
-  return NULL;
+  return term;
 }
 
-//IDEA: Perhaps don't process type_synonyms, but instead store them.
-// When a synonym is come across during processing, expand it.
-
-int
-isar_parse_syn (char * syn, char ** out_str)
+/* Reads the next token of a term.
+ *  input:
+ *    tl - the lexer of the term.
+ *  output:
+ *    none.
+ */
+static void
+isar_term_lex (isar_term_lexer * tl)
 {
-  // type_synonym
+  const char * buf = tl->buf;
+  int i, n, start;
 
-  char * left, * right;
+  while (tl->pos < tl->len && isspace ((unsigned char) buf[tl->pos]))
+    tl->pos++;
 
-  // Determine the sequence both are defined by,
-  // and return (maybe):
-  // @x(v(L,x) = v(R,x))
+  start = tl->pos;
+  tl->text = buf + start;
+  tl->op = NULL;
 
-  printf ("Got synonym\n");
-  // Syntax should be:
-  // 'a seq_0 = 'a set_b
-  // isn't always that way, though.
-  // Looks like right-hand side always surrounded by quotes.
-
-  int pos = 13, rest, start;
+  if (tl->pos >= tl->len)
+    {
+      tl->type = ISAR_TT_END;
+      tl->tok_len = 0;
+      return;
+    }
 
-  while (1)
+  for (i = 0; isar_words[i].text; i++)
     {
-      while (syn[pos] != '=')
-	pos++;
-      if (syn[pos] != '>')
-	break;
+      n = isar_begins (buf + start, tl->len - start, isar_words[i].text);
+      if (n)
+	{
+	  tl->type = isar_words[i].type;
+	  tl->pos += n;
+	  tl->tok_len = n;
+	  return;
+	}
     }
 
-  start = pos;
-  while (syn[start] != '\"')
-    start++;
+  for (i = 0; isar_ops[i].text; i++)
+    {
+      n = isar_begins (buf + start, tl->len - start, isar_ops[i].text);
+      if (n)
+	{
+	  tl->type = ISAR_TT_BINARY;
+	  tl->op = isar_ops + i;
+	  tl->pos += n;
+	  tl->tok_len = n;
+	  return;
+	}
+    }
 
-  rest = ++start;
-  while (syn[rest] != '\"')
-    rest++;
+  if (isalnum ((unsigned char) buf[start]) || buf[start] == '_'
+      || buf[start] == '\'' || buf[start] == '?')
+    {
+      tl->pos++;
+      while (tl->pos < tl->len && (isalnum ((unsigned char) buf[tl->pos])
+				   || buf[tl->pos] == '_'
+				   || buf[tl->pos] == '\''))
+	tl->pos++;
+
+      tl->tok_len = tl->pos - start;
+
+      if ((tl->tok_len == 3 && !strncmp (tl->text, "ALL", 3)))
+	tl->type = ISAR_TT_ALL;
+      else if (tl->tok_len == 2 && !strncmp (tl->text, "EX", 2))
+	tl->type = ISAR_TT_EX;
+      else
+	tl->type = ISAR_TT_NAME;
+      return;
+    }
 
-  // pos points to the '='.
+  tl->pos++;
+  tl->tok_len = 1;
 
-  char * lsen, * rsen;
+  switch (buf[start])
+    {
+    case '(':
+      tl->type = ISAR_TT_OPEN;
+      break;
+    case ')':
+      tl->type = ISAR_TT_CLOSE;
+      break;
+    case ',':
+      tl->type = ISAR_TT_COMMA;
+      break;
+    case '.':
+      tl->type = ISAR_TT_DOT;
+      break;
+    case '~':
+      tl->type = ISAR_TT_NOT;
+      break;
+    default:
+      tl->type = ISAR_TT_ERROR;
+      break;
+    }
+}
 
-  lsen = (char *) calloc (pos - 12, sizeof (char));
-  CHECK_ALLOC (lsen, -1);
-  strncpy (lsen, syn + 13, pos);
-  lsen[pos] = '\0';
+static isar_term * isar_parse_term (isar_term_lexer * tl, int min_prec,
+				    int * err);
 
-  rsen = (char *) calloc (rest - start + 1, sizeof (char));
-  CHECK_ALLOC (rsen, -1);
-  strncpy (rsen, syn + start, rest - start);
-  rsen[rest - start] = '\0';
+/* Skips a type, after the :: of a variable.
+ *  input:
+ *    tl - the lexer of the term, positioned after the ::.
+ *  output:
+ *    none.
+ */
+static void
+isar_skip_type (isar_term_lexer * tl)
+{
+  int depth = 0;
 
-  free (lsen);
-  free (rsen);
+  while (1)
+    {
+      if (tl->type == ISAR_TT_OPEN)
+	depth++;
+      else if (tl->type == ISAR_TT_CLOSE)
+	{
+	  if (depth == 0)
+	    break;
+	  depth--;
+	}
+      else if (tl->type == ISAR_TT_COMMA)
+	{
+	  if (depth == 0)
+	    break;
+	}
+      else if (tl->type != ISAR_TT_NAME && tl->type != ISAR_TT_ARROW)
+	break;
 
-  return rest;
+      isar_term_lex (tl);
+    }
 }
 
-// Remember kids: Logic is FUN!!
-int
-isar_parse_fun (char * fun, char ** out_str)
+/* Parses the atom of a term: a name, or a parenthesized term.
+ *  input:
+ *    tl - the lexer of the term.
+ *    err - receives 1 if the term can't be parsed.
+ *  output:
+ *    the tree of the atom, or NULL on error.
+ */
+static isar_term *
+isar_parse_atom (isar_term_lexer * tl, int * err)
 {
-  printf ("Got fun\n");
+  isar_term * term;
 
-  char * fun_name;
-  int init_pos, pos;
-  int chk;
+  if (tl->type == ISAR_TT_OPEN)
+    {
+      isar_term_lex (tl);
 
-  init_pos = 4;
-  while (isspace(fun[init_pos]))
-    init_pos++;
+      term = isar_parse_term (tl, 0, err);
+      if (!term)
+	return NULL;
 
-  pos = init_pos;
-  while (fun[pos] != ':')
-    pos++;
+      if (tl->type != ISAR_TT_CLOSE)
+	{
+	  isar_term_destroy (term);
+	  *err = 1;
+	  return NULL;
+	}
 
-  pos -= 1;
+      isar_term_lex (tl);
+      return term;
+    }
 
-  fun_name = (char *) calloc (pos - init_pos + 1, sizeof (char));
-  CHECK_ALLOC (fun_name, -1);
-  strncpy (fun_name, fun + init_pos, pos - init_pos);
-  fun_name[pos - init_pos] = '\0';
+  if (tl->type != ISAR_TT_NAME)
+    {
+      *err = 1;
+      return NULL;
+    }
 
-  // Next should come "::"
-  // pos points to two characters before it.
-  // Determine what this function is mapping.
+  term = isar_term_init (ISAR_TERM_NAME, NULL, NULL);
+  if (!term)
+    return NULL;
 
-  char * map_str;
+  term->text = tl->text;
+  term->len = tl->tok_len;
 
-  init_pos = pos + 5;
+  isar_term_lex (tl);
 
-  if (fun[init_pos] == '\"')
-    init_pos++;
+  if (tl->type == ISAR_TT_TYPE)
+    {
+      isar_term_lex (tl);
+      isar_skip_type (tl);
+    }
 
-  pos = init_pos;
+  return term;
+}
 
-  while (fun[pos] != '\"')
-    pos++;
+/* Parses a quantifier and its scope, which extends as far as possible.
+ *  input:
+ *    tl - the lexer of the term, positioned at the quantifier.
+ *    err - receives 1 if the term can't be parsed.
+ *  output:
+ *    the tree of the quantifier, or NULL on error.
+ */
+static isar_term *
+isar_parse_quant (isar_term_lexer * tl, int * err)
+{
+  isar_term * term = NULL, * last = NULL, * var, * scope;
+  int quant, paren;
 
-  map_str = (char *) calloc (pos - init_pos + 1, sizeof (char));
-  CHECK_ALLOC (map_str, -1);
-  strncpy (map_str, fun + init_pos, pos - init_pos);
-  map_str[pos - init_pos] = '\0';
+  quant = tl->type;
+  isar_term_lex (tl);
 
-  //TODO: Use map_str to determine what is being mapped.
+  // Each variable is bound by a quantifier of its own.
 
-  // Next, find the word 'where'
+  while (tl->type == ISAR_TT_NAME || tl->type == ISAR_TT_OPEN)
+    {
+      paren = (tl->type == ISAR_TT_OPEN);
+      if (paren)
+	isar_term_lex (tl);
 
-  init_pos = pos + 1;
-  while (strncmp (fun + init_pos, "where", 5))
-    init_pos++;
+      if (tl->type != ISAR_TT_NAME)
+	break;
 
-  // Now, find the next '"'
+      var = isar_term_init (ISAR_TERM_QUANT, NULL, NULL);
+      if (!var)
+	{
+	  isar_term_destroy (term);
+	  return NULL;
+	}
 
-  while (fun[init_pos] != '\"')
-    init_pos++;
+      var->quant = quant;
+      var->text = tl->text;
+      var->len = tl->tok_len;
 
-  init_pos++;
+      if (last)
+	last->right = var;
+      else
+	term = var;
+      last = var;
 
-  vec_t * base_cases;
-  unsigned char * tmp_str;
+      isar_term_lex (tl);
 
-  base_cases = init_vec (sizeof (char *));
-  if (!base_cases)
-    return -1;
+      if (tl->type == ISAR_TT_TYPE)
+	{
+	  isar_term_lex (tl);
+	  isar_skip_type (tl);
+	}
 
-  pos = init_pos;
+      if (paren)
+	{
+	  if (tl->type != ISAR_TT_CLOSE)
+	    break;
+	  isar_term_lex (tl);
+	}
+    }
 
-  while (fun[pos] != '\"')
-    pos++;
+  if (!term || tl->type != ISAR_TT_DOT)
+    {
+      isar_term_destroy (term);
+      *err = 1;
+      return NULL;
+    }
 
-  tmp_str = (char *) calloc (pos - init_pos + 1, sizeof (char));
-  CHECK_ALLOC (tmp_str, -1);
-  strncpy (tmp_str, fun + init_pos, pos - init_pos);
-  tmp_str[pos - init_pos] = '\0';
+  isar_term_lex (tl);
 
-  while (fun[pos + 2] == '|')
+  scope = isar_parse_term (tl, 0, err);
+  if (!scope)
     {
-      char * mod_str;
-      /*
-      mod_str = isar_mod_fun (tmp_str, fun_name);
-      if (!mod_str)
-	return -1;
-      */
+      isar_term_destroy (term);
+      return NULL;
+    }
 
-      mod_str = tmp_str;
+  last->right = scope;
+  return term;
+}
 
-      chk = vec_str_add_obj (base_cases, mod_str);
-      if (chk < 0)
-	return -1;
-      free (tmp_str);
-      //free (mod_str);
+/* Parses a term whose operators bind at least as tightly as a given
+ * precedence, climbing through the precedences of isar_ops.
+ *  input:
+ *    tl - the lexer of the term.
+ *    min_prec - the least precedence of an operator of the term.
+ *    err - receives 1 if the term can't be parsed.
+ *  output:
+ *    the tree of the term, or NULL on error.
+ */
+static isar_term *
+isar_parse_term (isar_term_lexer * tl, int min_prec, int * err)
+{
+  isar_term * left, * right, * arg, * last;
+  isar_op * op;
 
-      pos += 2;
-      init_pos = pos;
+  if (tl->type == ISAR_TT_NOT)
+    {
+      isar_term_lex (tl);
+      right = isar_parse_term (tl, ISAR_PREC_NOT, err);
+      if (!right)
+	return NULL;
+
+      left = isar_term_init (ISAR_TERM_NOT, NULL, right);
+    }
+  else if (tl->type == ISAR_TT_ALL || tl->type == ISAR_TT_EX)
+    {
+      return isar_parse_quant (tl, err);
+    }
+  else
+    {
+      left = isar_parse_atom (tl, err);
+      if (!left)
+	return NULL;
+
+      // Functions are applied to the atoms after them.
+
+      last = NULL;
+      while (tl->type == ISAR_TT_NAME || tl->type == ISAR_TT_OPEN)
+	{
+	  if (left->type == ISAR_TERM_NAME && !last)
+	    left->type = ISAR_TERM_APP;
+	  else if (left->type != ISAR_TERM_APP)
+	    {
+	      isar_term_destroy (left);
+	      *err = 1;
+	      return NULL;
+	    }
 
-      while (fun[init_pos] != '\"')
-	init_pos++;
+	  arg = isar_parse_atom (tl, err);
+	  if (!arg)
+	    {
+	      isar_term_destroy (left);
+	      return NULL;
+	    }
 
-      init_pos++;
-      pos = init_pos;
+	  if (last)
+	    last->next = arg;
+	  else
+	    left->left = arg;
+	  last = arg;
+	}
+    }
 
-      while (fun[pos] != '\"')
-	pos++;
+  while (left && tl->type == ISAR_TT_BINARY && tl->op->prec >= min_prec)
+    {
+      op = tl->op;
+      isar_term_lex (tl);
 
-      tmp_str = (char *) calloc (pos - init_pos + 1, sizeof (char));
-      CHECK_ALLOC (tmp_str, -1);
-      strncpy (tmp_str, fun + init_pos, pos - init_pos);
-      tmp_str[pos - init_pos] = '\0';
+      right = isar_parse_term (tl, op->right ? op->prec : op->prec + 1, err);
+      if (!right)
+	{
+	  isar_term_destroy (left);
+	  return NULL;
+	}
 
-      init_pos = pos + 2;
+      left = isar_term_init (ISAR_TERM_BINARY, left, right);
+      if (left)
+	left->op = op;
     }
 
-  // Now, base_cases will hold the base cases, and tmp_str will hold the recursive step.
+  return left;
+}
 
-  int fin_pos = pos;
+/* Checks whether a node is a formula, rather than a term.
+ *  input:
+ *    term - the node to check.
+ *  output:
+ *    1 if it is, 0 if it might not be.
+ */
+static int
+isar_is_formula (isar_term * term)
+{
+  if (term->type == ISAR_TERM_NOT || term->type == ISAR_TERM_QUANT)
+    return 1;
 
-  char * mod_tmp_str;
-  /*
-  mod_tmp_str = isar_mod_fun (tmp_str, fun_name);
-  if (!mod_tmp_str)
-    return -1;
-  */
-  mod_tmp_str = tmp_str;
+  if (term->type == ISAR_TERM_BINARY)
+    return (term->op->kind != ISAR_OP_TERM);
 
-  // Use seqlog to construct what is needed.
+  if (term->type == ISAR_TERM_NAME)
+    return ((term->len == 4 && !strncmp (term->text, "True", 4))
+	    || (term->len == 5 && !strncmp (term->text, "False", 5)));
 
+  return 0;
+}
 
-  // Example:
-  // From fibonacci.thy => 'fib' should look like this in the end:
-  //@y(@z(v(y,z) = fib(v(n,z))) $ @z(v(y,z(z)) = 0 & v(y,s(z(z))) = v(n,s(z(z))) & v(y,s(s(z))) = v(y,z) + v(y,s(z))))
+/* Checks whether a binary node is a connective, rather than a relation
+ * or an operator between terms.
+ *  input:
+ *    term - the binary node.
+ *  output:
+ *    1 if it is, 0 otherwise.
+ */
+static int
+isar_is_logical (isar_term * term)
+{
+  switch (term->op->kind)
+    {
+    case ISAR_OP_AND:
+    case ISAR_OP_OR:
+    case ISAR_OP_CON:
+    case ISAR_OP_BIC:
+      return 1;
+    case ISAR_OP_EQ:
+      return (isar_is_formula (term->left) || isar_is_formula (term->right));
+    }
 
-  int num_inputs = 0;
-  char ** inputs;
-  // Parse map_str for '\<Rightarrow>' to determine the amount of inputs.
+  return 0;
+}
 
-  for (pos = 0; map_str[pos] != '\0'; pos++)
+/* Gets the connective of a binary node, as it is written in Aris.
+ *  input:
+ *    term - the binary node.
+ *  output:
+ *    the connective.
+ */
+static const char *
+isar_conn (isar_term * term)
+{
+  switch (term->op->kind)
     {
-      if (!strncmp (map_str + pos, "\\<Rightarrow>", 13))
-	{
-	  num_inputs++;
-	  pos += 12;
-	}
+    case ISAR_OP_AND:
+      return AND;
+    case ISAR_OP_OR:
+      return OR;
+    case ISAR_OP_CON:
+      return CON;
+    case ISAR_OP_BIC:
+      return BIC;
+    case ISAR_OP_EQ:
+      return isar_is_logical (term) ? BIC : "=";
+    case ISAR_OP_ELM:
+      return ELM;
     }
 
-  inputs = (char **) calloc (num_inputs, sizeof (char *));
-  CHECK_ALLOC (inputs, -1);
+  return term->op->out;
+}
 
-  int i,j;
+static int isar_emit (isar_term * term, isar_buf * out);
 
-  i = 0;
-  pos = 0;
-  while (1)
+/* Writes an operand of a binary node, parenthesized where needed.
+ *  input:
+ *    parent - the binary node.
+ *    term - the operand.
+ *    is_right - whether this is the right operand.
+ *    out - the string to write to.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+static int
+isar_emit_operand (isar_term * parent, isar_term * term, int is_right,
+		   isar_buf * out)
+{
+  int paren = 0, logic, parent_logic;
+
+  if (term->type == ISAR_TERM_BINARY)
     {
-      char * type;
-      init_pos = pos;
-      while (strncmp (map_str + pos, "\\<Rightarrow>", 13) && map_str[pos] != '\0')
-	pos++;
+      logic = isar_is_logical (term);
+      parent_logic = isar_is_logical (parent);
 
-      int alloc_size = pos - init_pos - 1;
-      if (map_str[pos] == '\0')
-	alloc_size++;
+      // Conjunctions and disjunctions may be chained, as Aris does.
 
-      type = (char *) calloc (alloc_size + 1, sizeof (char));
-      CHECK_ALLOC (type, -1);
-      strncpy (type, map_str + init_pos, alloc_size);
-      type[alloc_size] = '\0';
+      if (logic && parent_logic)
+	paren = !((parent->op->kind == ISAR_OP_AND
+		   || parent->op->kind == ISAR_OP_OR)
+		  && term->op->kind == parent->op->kind);
+      else if (logic || parent_logic)
+	paren = logic;
+      else
+	paren = (term->op->prec < parent->op->prec
+		 || (term->op->prec == parent->op->prec
+		     && is_right != parent->op->right));
+    }
 
-      for (j = 0; j < seqs->num_stuff; j++)
-	{
-	  in_type * cur;
-	  cur = vec_nth (seqs, j);
-	  if (!strcmp (type, cur->type))
-	    {
-	      inputs[i] = cur->seq;
-	      break;
-	    }
-	}
+  if (paren && isar_buf_str (out, "(") == -1)
+    return -1;
 
-      if (j == seqs->num_stuff)
-	{
-	  // New sequence.
-	  // Not sure how to handle this exactly (yet).
-	  in_type new_seq;
+  if (isar_emit (term, out) == -1)
+    return -1;
 
-	  new_seq.type = type;
-	  new_seq.seq = get_new_seq ();
+  if (paren && isar_buf_str (out, ")") == -1)
+    return -1;
 
-	  chk = vec_add_obj (seqs, &new_seq);
-	  if (chk == -1)
-	    return -1;
+  return 0;
+}
+
+/* Writes a term's tree with Aris' connectives.
+ *  input:
+ *    term - the tree to write.
+ *    out - the string to write to.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+static int
+isar_emit (isar_term * term, isar_buf * out)
+{
+  isar_term * arg;
+  int ret;
 
-	  inputs[i] = new_seq.seq;
+  switch (term->type)
+    {
+    case ISAR_TERM_NAME:
+      if (term->len == 4 && !strncmp (term->text, "True", 4))
+	return isar_buf_str (out, TAU);
+      if (term->len == 5 && !strncmp (term->text, "False", 5))
+	return isar_buf_str (out, CTR);
+      return isar_buf_add (out, term->text, term->len);
+
+    case ISAR_TERM_APP:
+      if (isar_buf_add (out, term->text, term->len) == -1
+	  || isar_buf_str (out, "(") == -1)
+	return -1;
+
+      for (arg = term->left; arg; arg = arg->next)
+	{
+	  if (isar_emit (arg, out) == -1)
+	    return -1;
+	  if (arg->next && isar_buf_str (out, ",") == -1)
+	    return -1;
 	}
 
-      if (map_str[pos] == '\0')
-	break;
-      else
-	pos += 14;
-    }
+      return isar_buf_str (out, ")");
 
-  int fun_pos;
+    case ISAR_TERM_NOT:
+      if (isar_buf_str (out, NOT) == -1)
+	return -1;
 
-  //TODO: Calculate the ACTUAL size this should be.
+      if (term->right->type != ISAR_TERM_BINARY)
+	return isar_emit (term->right, out);
 
-  *out_str = (char *) calloc (1024, sizeof (char));
-  CHECK_ALLOC (*out_str, -1);
+      if (isar_buf_str (out, "(") == -1
+	  || isar_emit (term->right, out) == -1)
+	return -1;
+      return isar_buf_str (out, ")");
+
+    case ISAR_TERM_QUANT:
+      ret = isar_buf_str (out, (term->quant == ISAR_TT_ALL) ? UNV : EXL);
+      if (ret == -1 || isar_buf_add (out, term->text, term->len) == -1)
+	return -1;
 
-  for (i = 0; i < num_inputs - 1; i++)
-    fun_pos += sprintf ((*out_str) + fun_pos, "%sx%i(", UNV, i);
+      // Consecutive quantifiers share the parentheses of the last scope.
 
-  fun_pos += sprintf ((*out_str) + fun_pos, "%sy(%sz(v(y,z) = %s(",
-		      UNV, UNV, fun_name);
+      if (term->right->type == ISAR_TERM_QUANT)
+	return isar_emit (term->right, out);
 
-  // TODO: Determine how the inputs are ordered, maybe.
+      if (isar_buf_str (out, "(") == -1
+	  || isar_emit (term->right, out) == -1)
+	return -1;
+      return isar_buf_str (out, ")");
 
-  for (i = 0; i < num_inputs - 1; i++)
-    fun_pos += sprintf ((*out_str) + fun_pos, "v(%s,x%i),", inputs[i], i);
+    case ISAR_TERM_BINARY:
+      if (term->op->kind == ISAR_OP_NEQ)
+	{
+	  if (isar_buf_str (out, NOT) == -1 || isar_buf_str (out, "(") == -1
+	      || isar_emit (term->left, out) == -1
+	      || isar_buf_str (out, "=") == -1
+	      || isar_emit (term->right, out) == -1)
+	    return -1;
+	  return isar_buf_str (out, ")");
+	}
 
-  fun_pos += sprintf ((*out_str) + fun_pos, "v(%s,z)))", inputs[i]);
-  fun_pos += sprintf ((*out_str) + fun_pos, "%s", CON);
-  fun_pos += sprintf ((*out_str) + fun_pos, "%sz(", UNV);
+      if (isar_emit_operand (term, term->left, 0, out) == -1
+	  || isar_buf_str (out, isar_conn (term)) == -1)
+	return -1;
 
-  for (i = 0; i < base_cases->num_stuff; i++)
-    {
-      fun_pos += sprintf ((*out_str) + fun_pos, "%s%s",
-			  vec_str_nth (base_cases, i), AND);
+      return isar_emit_operand (term, term->right, 1, out);
     }
 
-  fun_pos += sprintf ((*out_str) + fun_pos, "%s))", mod_tmp_str);
+  return 0;
+}
 
-  for (i = 0; i < num_inputs - 1; i++)
-    fun_pos += sprintf ((*out_str) + fun_pos, ")");
+/* Parses a term from its Isabelle text.
+ *  input:
+ *    isar - the text of the term.
+ *    len - the length of the text.
+ *    err - receives 1 if the term can't be parsed.
+ *  output:
+ *    the tree of the term, or NULL on error.
+ */
+static isar_term *
+isar_term_parse (const char * isar, int len, int * err)
+{
+  isar_term_lexer tl;
+  isar_term * term;
 
-  printf ("fun_str = '%s'\n", *out_str);
+  tl.buf = isar;
+  tl.len = len;
+  tl.pos = 0;
+  *err = 0;
 
-  free (tmp_str);
-  //free (mod_tmp_str);
+  isar_term_lex (&tl);
 
-  return fin_pos;
+  term = isar_parse_term (&tl, 0, err);
+  if (term && tl.type != ISAR_TT_END)
+    {
+      isar_term_destroy (term);
+      *err = 1;
+      term = NULL;
+    }
+
+  return term;
 }
 
-int
-isar_parse_lemma (char * lemma, char ** out_str)
+/* Skips the name and attributes of a fact, such as 'foo [simp]:'.
+ *  input:
+ *    lex - the lexer.
+ *  output:
+ *    none.
+ */
+static void
+isar_skip_fact_name (isar_lexer * lex)
 {
-  printf ("Got lemma\n");
-
-  // Find the next instance of proof.
-  //char * proof;
-  //proof = strstr (lemma, "proof");
+  int depth = 0;
 
-  int pos = 5;
-  while (isspace (lemma[pos]))
-    pos++;
+  if (lex->tok.type == ISAR_TOK_NAME
+      && (isar_is (&lex->ahead, ":") || isar_is (&lex->ahead, "[")))
+    isar_next (lex);
 
-  int init_pos;
-  if (lemma[pos] != '\"')
+  if (isar_is (&lex->tok, "["))
     {
-      if (!strncmp (lemma + pos, "proof", 5))
-	{
-	  pos += 5;
-	  while (isspace (lemma[pos]))
-	    pos++;
-	}
-
-      if (!strncmp (lemma + pos, "assume", 6))
+      for (; lex->tok.type != ISAR_TOK_END && lex->tok.type != ISAR_TOK_ERROR;
+	   isar_next (lex))
 	{
-	  pos += 6;
-	  if (lemma[pos] == 's')
+	  if (isar_is (&lex->tok, "["))
+	    depth++;
+	  else if (isar_is (&lex->tok, "]") && --depth == 0)
 	    {
-	      // Move to assumption.
+	      isar_next (lex);
+	      break;
 	    }
+	}
+    }
+
+  if (isar_is (&lex->tok, ":"))
+    isar_next (lex);
+}
+
+/* Parses a list of terms, such as 'foo: "A" "B" and "C"'.
+ *  input:
+ *    lex - the lexer, positioned at the first term.
+ *    sep - a separator of the terms other than 'and', or NULL.
+ *    props - receives the tokens of the terms.
+ *  output:
+ *    0 on success, -1 on error.
+ */
+static int
+isar_parse_props (isar_lexer * lex, const char * sep, vec_t * props)
+{
+  while (1)
+    {
+      isar_skip_fact_name (lex);
+
+      if (lex->tok.type == ISAR_TOK_ERROR)
+	return isar_error (lex, lex->tok.line, ISAR_UNTERMINATED);
+
+      if (lex->tok.type != ISAR_TOK_STRING
+	  && lex->tok.type != ISAR_TOK_CARTOUCHE)
+	return isar_error (lex, lex->tok.line, "expected a term.");
 
-	  // Move to show statement.
-	  // Exit.
+      // Several terms may share one name.
+
+      while (lex->tok.type == ISAR_TOK_STRING
+	     || lex->tok.type == ISAR_TOK_CARTOUCHE)
+	{
+	  if (vec_add_obj (props, &lex->tok) < 0)
+	    return -1;
+	  isar_next (lex);
 	}
 
-      while (!isspace (lemma[pos]))
-	pos++;
+      if (!isar_is (&lex->tok, "and") && !(sep && isar_is (&lex->tok, sep)))
+	break;
 
-      while (isspace (lemma[pos]))
-	pos++;
+      isar_next (lex);
     }
 
-  char * tmp_str;
+  return 0;
+}
 
-  init_pos = pos + 1;
-  pos = init_pos;
+/* Converts a term of a theory to a sentence, made conditional on a list
+ * of assumptions.
+ *  input:
+ *    prop - the token of the term.
+ *    assms - the tokens of the assumptions, or NULL.
+ *    sens - receives the sentence.
+ *  output:
+ *    0 on success, -1 on memory error, -2 if a term can't be read.
+ */
+static int
+isar_add_sentence (struct isar_token * prop, vec_t * assms, vec_t * sens)
+{
+  struct isar_token * tok;
+  isar_term * term, * assm;
+  isar_buf out;
+  int i, err;
 
-  while (lemma[pos] != '\"')
-    pos++;
+  term = isar_term_parse (prop->text, prop->len, &err);
 
-  tmp_str = (char *) calloc (pos - init_pos + 1, sizeof (char));
-  CHECK_ALLOC (tmp_str, -1);
+  // The assumptions are joined as Isabelle's meta implication is.
 
-  strncpy (tmp_str, lemma + init_pos, pos - init_pos);
-  tmp_str[pos - init_pos] = '\0';
+  for (i = assms ? (int) assms->num_stuff - 1 : -1; term && i >= 0; i--)
+    {
+      tok = vec_nth (assms, i);
+      assm = isar_term_parse (tok->text, tok->len, &err);
+      if (!assm)
+	{
+	  isar_term_destroy (term);
+	  term = NULL;
+	  break;
+	}
 
-  *out_str = isar_to_aris (tmp_str);
-  if (!(*out_str))
-    return -1;
-  free (tmp_str);
+      // The first operator is the meta implication.
+
+      term = isar_term_init (ISAR_TERM_BINARY, assm, term);
+      if (term)
+	term->op = isar_ops;
+    }
+
+  if (!term)
+    return err ? -2 : -1;
 
-  // Find any instances of 'assume' and 'show'
-  // May not be necessary.
-  // Most instances of 'lemma' come with the sentence needed.
-  // Might be able to grab everything from the starting line.
+  out.str = NULL;
+  out.len = out.size = 0;
 
-  /*
-  char ** assume;
-  char * show;
+  err = isar_emit (term, &out);
+  isar_term_destroy (term);
 
-  assume = (char **) calloc (1024, sizeof (char *));
-  if (!assume)
+  if (err == -1 || vec_add_obj (sens, &out.str) < 0)
     {
-      perror (NULL);
+      free (out.str);
       return -1;
     }
 
-  char * find_tmp, * show_pos;
-  int i, pos;
-  i = pos = 0;
+  return 0;
+}
 
-  find_tmp = strstr (proof, "assume");
-  show_pos = strstr (proof, "show");
+/* Converts a list of terms of a theory to sentences.
+ *  input:
+ *    lex - the lexer, for errors.
+ *    props - the tokens of the terms.
+ *    assms - the tokens of the assumptions, or NULL.
+ *    sens - receives the sentences.
+ *    strict - whether terms that can't be read are errors, rather than
+ *      being skipped.
+ *  output:
+ *    0 on success, -1 on error.
+ */
+static int
+isar_add_sentences (isar_lexer * lex, vec_t * props, vec_t * assms,
+		    vec_t * sens, int strict)
+{
+  struct isar_token * prop;
+  int i, ret;
 
-  while (find_tmp < show_pos)
+  for (i = 0; i < props->num_stuff; i++)
     {
-      // Find the next newline or the next instance of the word 'and'.
-      // Copy from find_tmp to the newline into assume[i]
-      pos = 0;
-
-      while (find_tmp[pos] != '\n' && strncmp (find_tmp + pos, "and", 3))
-	pos++;
+      prop = vec_nth (props, i);
 
-      int init_pos = 0;
-      if (!strncmp (find_tmp, "assume", 6))
-	init_pos = 6;
-      if (!strncmp (find_tmp, "and", 3))
-	init_pos = 3;
+      ret = isar_add_sentence (prop, assms, sens);
+      if (ret == -1)
+	return -1;
 
-      assume[i] = (char *) calloc (pos - init_pos, sizeof (char));
-      if (!assume[i])
-	{
-	  perror (NULL);
-	  return -1;
-	}
+      if (ret == -2 && strict)
+	return isar_error (lex, prop->line, "the term can't be read.");
 
-      strncpy (assume[i], find_tmp + init_pos, pos - init_pos);
-      assume[i][pos - init_pos] = '\0';
+      if (ret == -2)
+	fprintf (stderr, "Theory Warning - %s:%i: %s\n", lex->file,
+		 prop->line, "ignoring a term that can't be read.");
+    }
 
-      if (find_tmp[pos] == '\n')
-	find_tmp = strstr (find_tmp + pos, "assume");
-      else
-	find_tmp += pos;
+  return 0;
+}
 
-      i++;
-    }
+/* Parses the statement of a lemma or theorem.  A statement with
+ * assumptions becomes a conditional from them to what it shows.
+ *  input:
+ *    lex - the lexer, positioned after the command.
+ *    goals - receives the sentences of the statement.
+ *  output:
+ *    0 on success, -1 on error.
+ */
+static int
+isar_parse_statement (isar_lexer * lex, vec_t * goals)
+{
+  vec_t * assms, * shows;
+  int ret = 0;
 
-  pos = 0;
-  // Also might want to check for '..' at the end of the show statement.
-  while (show_pos[pos] != '\n' && strncmp (show_pos + pos, "by", 2))
-    pos++;
+  assms = init_vec (sizeof (struct isar_token));
+  if (!assms)
+    return -1;
 
-  show = (char *) calloc (pos, sizeof (char *));
-  if (!show)
+  shows = init_vec (sizeof (struct isar_token));
+  if (!shows)
     {
-      perror (NULL);
+      destroy_vec (assms);
       return -1;
     }
 
-  strncpy (show, show_pos + 4, pos - 4);
-  show[pos - 4] = '\0';
+  isar_skip_fact_name (lex);
 
-  // For each instance of assume, load a premise.
+  if (!isar_is (&lex->tok, "fixes") && !isar_is (&lex->tok, "assumes")
+      && !isar_is (&lex->tok, "shows"))
+    {
+      ret = isar_parse_props (lex, NULL, shows);
+    }
+  else
+    {
+      while (isar_is (&lex->tok, "fixes") || isar_is (&lex->tok, "and")
+	     || (lex->tok.type != ISAR_TOK_END
+		 && lex->tok.type != ISAR_TOK_ERROR
+		 && !isar_is (&lex->tok, "assumes")
+		 && !isar_is (&lex->tok, "shows")))
+	isar_next (lex);
+
+      if (isar_is (&lex->tok, "assumes"))
+	{
+	  isar_next (lex);
+	  ret = isar_parse_props (lex, NULL, assms);
+	}
 
-  unsigned char ** prems, * conc;
+      if (ret == 0 && !isar_is (&lex->tok, "shows"))
+	ret = isar_error (lex, lex->tok.line, "expected 'shows'.");
 
-  prems = (unsigned char **) calloc (i + 1, sizeof (char *));
-  if (!prems)
-    {
-      perror (NULL);
-      return -1;
+      if (ret == 0)
+	{
+	  isar_next (lex);
+	  ret = isar_parse_props (lex, NULL, shows);
+	}
     }
 
-  //printf ("Proof: %i\n", count);
-  for (i = 0; assume[i]; i++)
+  if (ret == 0)
+    ret = isar_add_sentences (lex, shows, assms, goals, 0);
+
+  destroy_vec (assms);
+  destroy_vec (shows);
+  return ret;
+}
+
+/* Parses the terms of a definition, function or axiomatization, whose
+ * terms follow 'where'.
+ *  input:
+ *    lex - the lexer, positioned after the command.
+ *    sep - the separator of the terms other than 'and', or NULL.
+ *    prems - receives the sentences of the terms.
+ *  output:
+ *    0 on success, -1 on error.
+ */
+static int
+isar_parse_where (isar_lexer * lex, const char * sep, vec_t * prems)
+{
+  vec_t * props;
+  int ret;
+
+  // A definition may be given without a name, as just its term.
+
+  if (lex->tok.type != ISAR_TOK_STRING && lex->tok.type != ISAR_TOK_CARTOUCHE)
     {
-      //isar is an anagram of aris.
-      //SO COOL!!
-      printf ("assume[%i]: %s\n", i, assume[i]);
-      prems[i] = isar_to_aris (assume[i]);
-      if (!prems[i])
-	return -1;
-      printf ("prems[%i]: %s\n", i, prems[i]);
+      while (!isar_is (&lex->tok, "where"))
+	{
+	  if (lex->tok.type == ISAR_TOK_END || lex->tok.type == ISAR_TOK_ERROR
+	      || isar_is_command (&lex->tok))
+	    return 0;
+	  isar_next (lex);
+	}
+
+      isar_next (lex);
     }
-  prems[i] = NULL;
 
-  printf ("show: %s\n", show);
-  conc = isar_to_aris (show);
-  if (!conc)
+  props = init_vec (sizeof (struct isar_token));
+  if (!props)
     return -1;
 
-  printf ("conc: %s\n", conc);
+  ret = isar_parse_props (lex, sep, props);
+  if (ret == 0)
+    ret = isar_add_sentences (lex, props, NULL, prems, 1);
 
-  int out_pos = 0;
+  destroy_vec (props);
+  return ret;
+}
 
-  if (prems[1])
-    out_pos += sprintf (*out_str + out_pos, "(");
+/* Parses the body of a theory, up to its 'end'.
+ *  input:
+ *    lex - the lexer, positioned after 'begin'.
+ *    prems - receives the sentences of the definitions.
+ *    goals - receives the sentences of the lemmas and theorems.
+ *  output:
+ *    0 on success, -1 on error.
+ */
+static int
+isar_parse_body (isar_lexer * lex, vec_t * prems, vec_t * goals)
+{
+  static const char * goal_cmds[] = {
+    "lemma", "theorem", "corollary", "proposition", "schematic_goal", NULL
+  };
+  static const char * def_cmds[] = { "definition", "abbreviation", NULL };
+  static const char * fun_cmds[] = { "fun", "function", "primrec", NULL };
+  int i, depth = 0, ret;
 
-  for (i = 0; prems[i]; i++)
+  while (1)
     {
-      out_pos += sprintf (*out_str + out_pos, "%s", prems[i]);
-      if (prems[i + 1])
-	out_pos += sprintf (*out_str + out_pos, "%s", AND);
-    }
+      if (lex->tok.type == ISAR_TOK_END)
+	return isar_error (lex, lex->tok.line, "expected 'end'.");
 
-  if (prems[1])
-    out_pos += sprintf (*out_str + out_pos, ")");
+      if (lex->tok.type == ISAR_TOK_ERROR)
+	return isar_error (lex, lex->tok.line, ISAR_UNTERMINATED);
 
-  */
+      // Contexts, locales and the like have their own begin and end.
 
-  // In order to determine the end of the lemma,
-  // find 'qed' or 'done',
-  // although that might not work.
+      if (isar_is (&lex->tok, "end"))
+	{
+	  if (depth == 0)
+	    return 0;
+	  depth--;
+	  isar_next (lex);
+	  continue;
+	}
 
-  return pos;
+      if (isar_is (&lex->tok, "begin"))
+	{
+	  depth++;
+	  isar_next (lex);
+	  continue;
+	}
+
+      ret = 0;
+
+      for (i = 0; goal_cmds[i]; i++)
+	if (isar_is (&lex->tok, goal_cmds[i]))
+	  break;
+
+      if (goal_cmds[i])
+	{
+	  isar_next (lex);
+	  ret = isar_parse_statement (lex, goals);
+	}
+      else
+	{
+	  for (i = 0; def_cmds[i]; i++)
+	    if (isar_is (&lex->tok, def_cmds[i]))
+	      break;
+
+	  if (def_cmds[i] || isar_is (&lex->tok, "axiomatization"))
+	    {
+	      isar_next (lex);
+	      ret = isar_parse_where (lex, NULL, prems);
+	    }
+	  else
+	    {
+	      for (i = 0; fun_cmds[i]; i++)
+		if (isar_is (&lex->tok, fun_cmds[i]))
+		  break;
+
+	      isar_next (lex);
+	      if (fun_cmds[i])
+		ret = isar_parse_where (lex, "|", prems);
+	    }
+	}
+
+      if (ret == -1)
+	return -1;
+
+      // Skip the rest of the command, such as its proof.
+
+      while (lex->tok.type != ISAR_TOK_END && lex->tok.type != ISAR_TOK_ERROR
+	     && !isar_is_command (&lex->tok))
+	isar_next (lex);
+    }
 }
 
-int
-isar_parse_theorem (char * thm, char ** out_str)
+/* Frees a list of sentences.
+ *  input:
+ *    sens - the list of sentences.
+ *  output:
+ *    none.
+ */
+static void
+isar_free_sentences (vec_t * sens)
 {
-  int pos;
-
-  pos = isar_parse_lemma (thm + 2, out_str);
-  if (pos == -1)
-    return -1;
+  int i;
 
-  return pos + 2;
+  for (i = 0; i < sens->num_stuff; i++)
+    free (*((char **) vec_nth (sens, i)));
+  destroy_vec (sens);
 }
 
+/* Sets the directories that imported theories are looked for in, after
+ * the directory of the theory that imports them.
+ *  input:
+ *    dirs - the directories, separated as in PATH.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
 int
-isar_parse_datatype (char * type, vec_t * constructors)
+isar_set_path (const char * dirs)
 {
-  int init_pos, pos;
-  int i, chk;
+  const char * end;
+  char * dir;
+  int len;
+
+  pthread_mutex_lock (&isar_lock);
+
+  if (isar_path)
+    destroy_str_vec (isar_path);
 
-  init_pos = 0;
+  isar_path = init_vec (sizeof (char *));
+  if (!isar_path)
+    {
+      pthread_mutex_unlock (&isar_lock);
+      return -1;
+    }
 
-  // Determine the type name.
-  // Determine the constructors.
+  while (*dirs)
+    {
+      end = strchr (dirs, ISAR_PATH_SEP);
+      len = end ? end - dirs : (int) strlen (dirs);
 
-  // Create a sequence, ts_n, for the new datatype.
-  // After that, most of it is just syntax and notations.
-  // Add the new functions to the function definitons.
+      if (len > 0)
+	{
+	  dir = strndup (dirs, len);
+	  if (!dir || vec_str_add_obj (isar_path, (unsigned char *) dir) < 0)
+	    {
+	      free (dir);
+	      pthread_mutex_unlock (&isar_lock);
+	      return -1;
+	    }
+	  free (dir);
+	}
 
-  //IDEA: For each constructor with n args, create the string:
-  // @x0@x1...@xn(#y0(y0 = v(tk, x0)) & ... & #yn(yn = v(tk, xn)) $ #z(z = constructor(x0,...,xn)))
+      dirs += len;
+      if (*dirs)
+	dirs++;
+    }
 
-  return pos;
+  pthread_mutex_unlock (&isar_lock);
+  return 0;
 }
 
-int
-isar_parse_primrec (char * prim, char ** out_str)
+/* Gets the canonical path of a file, if it is a regular file.
+ *  input:
+ *    file - the path of the file.
+ *  output:
+ *    the canonical path, or NULL if it isn't a readable file.
+ */
+static char *
+isar_canonical (const char * file)
 {
-  //Should be similar to isar_parse_fun
-  int ret;
-  ret = isar_parse_fun (prim + 4, out_str);
-  if (ret == -1)
-    return -1;
+  struct stat st;
+
+  if (stat (file, &st) == -1 || !S_ISREG (st.st_mode))
+    return NULL;
 
-  return ret + 4;
+#ifndef WIN32
+  return realpath (file, NULL);
+#else
+  return _fullpath (NULL, file, 0);
+#endif
 }
 
-int
-isar_parse_case (char * cs, char ** out_str)
+/* Finds the file of an imported theory, first in the directory of the
+ * theory that imports it, then in the search path.
+ *  input:
+ *    dir - the directory of the importing theory.
+ *    name - the name of the imported theory, such as Foo or "lib/Foo".
+ *    len - the length of the name.
+ *  output:
+ *    the canonical path of the theory, or NULL if it can't be found.
+ */
+static char *
+isar_resolve (const char * dir, const char * name, int len)
 {
-  vec_t * pre, * post;
-  int i, pos, init_pos;
-  char * var;
-  int out_pos;
+  char * file, * path = NULL;
+  const char * cur_dir;
+  int i, dir_len;
 
-  // get var
+  // Theories of the Isabelle distribution aren't looked for.
 
-  init_pos = pos = 5;
+  if (len >= 2 && !strncmp (name, "~~", 2))
+    return NULL;
 
-  while (!isspace (cs[pos]))
-    pos++;
+  for (i = -1; !path && i < (isar_path ? (int) isar_path->num_stuff : 0); i++)
+    {
+      cur_dir = (i == -1) ? dir : (char *) vec_str_nth (isar_path, i);
+      dir_len = strlen (cur_dir);
 
-  var = (char *) calloc (pos - init_pos + 1, sizeof (char));
-  CHECK_ALLOC (var, -1);
+      file = (char *) calloc (dir_len + len + 6, sizeof (char));
+      CHECK_ALLOC (file, NULL);
 
-  strncpy (var, cs + init_pos, pos - init_pos);
-  var[pos - init_pos] = '\0';
+      sprintf (file, "%s%s%.*s.thy", cur_dir, (dir_len > 0) ? "/" : "",
+	       len, name);
 
-  pos = init_pos + 4;
+      path = isar_canonical (file);
+      free (file);
+    }
 
-  // case 'var' of arg0 | arg1 | ... | argn
+  return path;
+}
 
-  // parse the arguments.
-  // get the pred variable
+/* Gets the entry of a theory, adding one if it hasn't been seen yet.
+ * The cache must be locked.
+ *  input:
+ *    path - the canonical path of the theory.
+ *  output:
+ *    the entry, or NULL on memory error.
+ */
+static isar_theory *
+isar_theory_get (const char * path)
+{
+  hash_entry_t * ent;
+  isar_theory * thy;
 
-  while (1)
+  if (!isar_theories)
     {
-      char * tmp_str;
-
-      init_pos = pos;
+      isar_theories = init_hash (64);
+      if (!isar_theories)
+	return NULL;
+    }
 
-      while (cs[pos] != '|')
-	pos++;
+  ent = hash_find (isar_theories, (const unsigned char *) path);
+  if (ent)
+    return ent->value;
 
-      tmp_str = (char *) calloc (pos - init_pos + 1, sizeof (char));
-      CHECK_ALLOC (tmp_str, -1);
+  thy = (isar_theory *) calloc (1, sizeof (isar_theory));
+  CHECK_ALLOC (thy, NULL);
 
-      strncpy (tmp_str, cs + init_pos, pos - init_pos);
-      tmp_str[pos - init_pos] = '\0';
+  thy->path = strdup (path);
+  thy->imports = init_vec (sizeof (isar_theory *));
+  if (!thy->path || !thy->imports)
+    return NULL;
 
-      // Process it, converting it to a notation aris will recognize.
-      char * new_str;
-      //new_str = isar_convert (tmp_str);
-      //if (!new_str)
-      //  return -1;
+  ent = hash_add_obj (isar_theories, (const unsigned char *) path, thy);
+  if (!ent)
+    return NULL;
 
-      free (tmp_str);
+  return thy;
+}
 
-      int gg;
-      unsigned char * lsen, * rsen;
+/* Forgets what was read from a theory, so that it is read again.
+ *  input:
+ *    thy - the theory.
+ *  output:
+ *    none.
+ */
+static void
+isar_theory_forget (isar_theory * thy)
+{
+  if (thy->prems)
+    isar_free_sentences (thy->prems);
+  if (thy->goals)
+    isar_free_sentences (thy->goals);
 
-      gg = get_gen (new_str, 0, &lsen);
-      if (gg == -1)
-	return -1;
+  thy->prems = thy->goals = NULL;
+  thy->imports->num_stuff = 0;
 
-      strcpy (rsen, new_str + gg + CL);
+  if (thy->buf)
+    isar_unmap (thy->buf, thy->len, thy->mapped);
+  thy->buf = NULL;
+}
 
-      free (new_str);
+/* Reads the header of a theory, up to 'begin', and finds its imports.
+ *  input:
+ *    thy - the theory, whose file has been mapped.
+ *    names - receives the tokens of the imports.
+ *  output:
+ *    0 on success, -1 on error.
+ */
+static int
+isar_parse_header (isar_theory * thy, vec_t * names)
+{
+  isar_lexer * lex = &thy->lex;
+  int imports = 0;
 
-      gg = vec_str_add_obj (pre, lsen);
-      if (gg < 0)
-	return -1;
+  lex->file = thy->path;
+  lex->buf = thy->buf;
+  lex->len = thy->len;
+  lex->pos = 0;
+  lex->line = 1;
 
-      gg = vec_str_add_obj (post, rsen);
-      if (gg < 0)
-	return -1;
+  isar_lex (lex, &lex->ahead);
+  isar_next (lex);
 
-      free (lsen);
-      free (rsen);
+  // Anything before the theory's header, such as its title, is skipped.
 
-      break;
-    }
+  while (lex->tok.type != ISAR_TOK_END && lex->tok.type != ISAR_TOK_ERROR
+	 && !isar_is (&lex->tok, "theory"))
+    isar_next (lex);
 
-  int fin_pos = pos;
+  if (!isar_is (&lex->tok, "theory") || lex->ahead.type != ISAR_TOK_NAME)
+    return isar_error (lex, lex->tok.line, "expected 'theory' and a name.");
 
-  // Get the last argument.
+  isar_next (lex);
+  isar_next (lex);
 
-  // case(xs) = y % ((xs = pre0 $ y = post0) & ...)
+  // The imports end with 'keywords' or 'begin'.
 
-  for (i = 0; i < pre->num_stuff; i++)
+  while (!isar_is (&lex->tok, "begin"))
     {
+      if (lex->tok.type == ISAR_TOK_END || lex->tok.type == ISAR_TOK_ERROR)
+	return isar_error (lex, lex->tok.line, "expected 'begin'.");
+
+      if (isar_is (&lex->tok, "imports"))
+	imports = 1;
+      else if (isar_is (&lex->tok, "keywords"))
+	imports = 0;
+      else if (imports && (lex->tok.type == ISAR_TOK_NAME
+			   || lex->tok.type == ISAR_TOK_STRING))
+	{
+	  if (vec_add_obj (names, &lex->tok) < 0)
+	    return -1;
+	}
+
+      isar_next (lex);
     }
 
-  return fin_pos;
+  isar_next (lex);
+  return 0;
 }
 
-int
-isar_parse_def (char * def, char ** out_str)
+/* Opens a theory that hasn't been read, or has changed since it was,
+ * and finds the theories that it imports.  The cache must be locked.
+ *  input:
+ *    thy - the theory.
+ *  output:
+ *    0 on success, -1 on error.
+ */
+static int
+isar_theory_open (isar_theory * thy)
 {
-  // Definition keyword.
-  // Not particularly certain what to do with this yet,
-  // since I'm not sure how definitions are used in Isabelle.
+  struct isar_token * name;
+  isar_theory * import;
+  vec_t * names;
+  char * dir, * path, * slash;
+  int i, ret;
 
-  //definition def where "stuff = more"
-  // Logical eq (three horizontal lines) MUST be used in this.
+  isar_theory_forget (thy);
 
-  // Basic parsing.
+  thy->buf = isar_map (thy->path, &thy->len, &thy->mapped);
+  if (!thy->buf)
+    return -1;
 
-  int pos, init_pos;
-  char * defn;
+  names = init_vec (sizeof (struct isar_token));
+  if (!names)
+    return -1;
 
-  init_pos = 10;
+  ret = isar_parse_header (thy, names);
 
-  while (isspace(def[init_pos]))
-    init_pos++;
+  dir = strdup (thy->path);
+  if (!dir)
+    ret = -1;
+  else
+    {
+      slash = strrchr (dir, '/');
+#ifdef WIN32
+      if (!slash || strrchr (dir, '\\') > slash)
+	slash = strrchr (dir, '\\');
+#endif
+      if (slash)
+	*slash = '\0';
+      else
+	dir[0] = '\0';
+    }
 
-  pos = init_pos;
-  while (strncmp (def + pos, "where", 5))
-    pos++;
+  for (i = 0; ret == 0 && i < names->num_stuff; i++)
+    {
+      name = vec_nth (names, i);
 
-  defn = (char *) calloc (pos - init_pos + 1, sizeof (char));
-  CHECK_ALLOC (defn, -1);
+      path = isar_resolve (dir, name->text, name->len);
+      if (!path)
+	{
+	  // Theories of sessions, such as Main or HOL-Library.Multiset,
+	  // can't be read, and are left to the user.
 
-  strncpy (defn, def + init_pos, pos - init_pos);
-  defn[pos - init_pos] = '\0';
+	  if (name->type == ISAR_TOK_STRING || !memchr (name->text, '.', name->len))
+	    {
+	      if (!isar_is (name, "Main") && !isar_is (name, "Complex_Main")
+		  && !isar_is (name, "Pure") && !isar_is (name, "HOL"))
+		fprintf (stderr, "Theory Warning - %s:%i: %s '%.*s'.\n",
+			 thy->path, name->line,
+			 "ignoring a theory that can't be found,",
+			 name->len, name->text);
+	    }
+	  continue;
+	}
 
-  // Need to check for '::',
-  // and possibly determine the sequences (again).
+      import = isar_theory_get (path);
+      free (path);
 
-  init_pos += 6;
-  if (def[init_pos] == '\"')
-    init_pos++;
-  pos = init_pos;
+      if (!import || vec_add_obj (thy->imports, &import) < 0)
+	ret = -1;
+    }
 
-  while (def[pos] != '\"')
-    pos++;
+  free (dir);
+  destroy_vec (names);
 
-  char * defin;
-  int fin_pos = pos;
+  return ret;
+}
 
-  defin = (char *) calloc (pos - init_pos + 1, sizeof (char));
-  CHECK_ALLOC (defin, -1);
-  strncpy (defin, def + init_pos, pos - init_pos);
-  defin[pos - init_pos] = '\0';
+/* Visits a theory and the theories that it imports, listing each once
+ * after the theories that it imports.  The cache must be locked.
+ *  input:
+ *    thy - the theory to visit.
+ *    order - receives the theories, in the order they must be added.
+ *    todo - receives the theories that must be read.
+ *  output:
+ *    0 on success, -1 on error.
+ */
+static int
+isar_theory_visit (isar_theory * thy, vec_t * order, vec_t * todo)
+{
+  isar_theory * import;
+  struct stat st;
+  int i;
 
-  // Parse the definition for the logical eq symbol.
+  thy->visit = isar_visits;
+  thy->state = ISAR_VISITING;
 
-  free (defn);
-  free (defin);
+  if (stat (thy->path, &st) == -1)
+    {
+      perror (thy->path);
+      return -1;
+    }
 
-  return fin_pos;
-}
+  // A theory is only read again once its file has changed.
 
-unsigned char *
-isar_to_aris (char * isar)
-{
-  printf ("isar = '%s'\n", isar);
+  if (!thy->prems || thy->mtime != st.st_mtime || thy->size != st.st_size)
+    {
+      thy->mtime = st.st_mtime;
+      thy->size = st.st_size;
 
-  unsigned char * aris;
-  int i, j, is_len;
+      if (isar_theory_open (thy) == -1)
+	return -1;
 
-  is_len = strlen (isar);
-  aris = (unsigned char *) calloc (is_len, sizeof (char *));
-  CHECK_ALLOC (aris, NULL);
+      if (vec_add_obj (todo, &thy) < 0)
+	return -1;
+    }
 
-  for (i = 0, j = 0; i < is_len; i++)
+  for (i = 0; i < thy->imports->num_stuff; i++)
     {
-      if (isar[i] == '\"')
-	continue;
+      import = *((isar_theory **) vec_nth (thy->imports, i));
 
-      if (!strncmp (isar + i, "-->", 3) || !strncmp (isar + i, "==>", 3))
+      if (import->visit == isar_visits && import->state == ISAR_VISITING)
 	{
-	  strcpy (aris + j, CON);
-	  j += CL;
-	  i += 2;
-	  continue;
+	  fprintf (stderr, "Theory Error - %s: %s '%s'.\n", thy->path,
+		   "the imports form a cycle through", import->path);
+	  return -1;
 	}
 
-      if (!strncmp (isar + i, "\\<longrightarrow>", 17))
-	{
-	  strcpy (aris + j, CON);
-	  j += CL;
-	  i += 16;
-	  continue;
-	}
+      if (import->visit == isar_visits)
+	continue;
 
-      if (isar[i] == '&')
-	{
-	  strcpy (aris + j, AND);
-	  j += CL;
-	  continue;
-	}
+      if (isar_theory_visit (import, order, todo) == -1)
+	return -1;
+    }
 
-      if (isar[i] == '|')
-	{
-	  strcpy (aris + j, OR);
-	  j += CL;
-	  continue;
-	}
+  thy->state = ISAR_DONE;
 
-      //TODO: For quantifiers;
-      //1.  Check for a parenthesis BEFORE the quantifier.
-      //2.  If there is one, remove it from the aris string,
-      //3.  and make a note of this somehow,
-      //      so the processor knows how to handle it later.
+  if (vec_add_obj (order, &thy) < 0)
+    return -1;
 
-      if (!strncmp (isar + i, "EX", 2)
-	  || !strncmp (isar + i, "\\<exists>", 9))
-	{
-	  if (j != 0 && aris[j - 1] == '(')
-	    j--;
-
-	  int size = 0;
-
-	  if (!strncmp (isar + i, "EX", 2))
-	    size = 2;
-	  if (!strncmp (isar + i, "\\<exists>", 9))
-	    size = 9;
-
-	  int new_pos;
-	  char * new_str;
-	  new_pos = parse_quant (isar + i, size, EXL, &new_str);
-	  if (new_pos == -1)
-	    return NULL;
-
-	  strcpy (aris + j, new_str);
-	  j += strlen (new_str);
-	  free (new_str);
-	  i += new_pos;
-	  continue;
+  return 0;
+}
 
-	}
+/* Gets the amount of processors available.
+ *  input:
+ *    none.
+ *  output:
+ *    the amount of processors, at least one.
+ */
+static int
+isar_num_cpus ()
+{
+  long num = 1;
 
-      if (!strncmp (isar + i, "!!", 2)
-	  || !strncmp (isar + i, "\\<And>", 6)
-	  || !strncmp (isar + i, "ALL", 3)
-	  || !strncmp (isar + i, "\\<forall>", 9))
-	{
-	  if (j != 0 && aris[j - 1] == '(')
-	    j--;
-
-	  int size = 0;
-	  if (!strncmp (isar + i, "!!", 2))
-	    size = 2;
-	  if (!strncmp (isar + i, "\\<And>", 6))
-	    size = 6;
-	  if (!strncmp (isar + i, "ALL", 3))
-	    size = 3;
-	  if (!strncmp (isar + i, "\\<forall>", 9))
-	    size = 9;
-
-	  int new_pos;
-	  char * new_str;
-	  new_pos = parse_quant (isar + i, size, UNV, &new_str);
-	  if (new_pos == -1)
-	    return NULL;
-
-	  strcpy (aris + j, new_str);
-	  j += strlen (new_str);
-	  free (new_str);
-	  i += new_pos;
-	  continue;
-	}
+#ifdef _SC_NPROCESSORS_ONLN
+  num = sysconf (_SC_NPROCESSORS_ONLN);
+#endif
 
-      if (!strncmp (isar + i, "<->", 3))
-	{
-	  strcpy (aris + j, BIC);
-	  j += CL;
-	  i += 2;
-	  continue;
-	}
+  return (num > 0) ? (int) num : 1;
+}
 
-      if (!strncmp (isar + i, "\\<longleftrightarrow>", 21))
-	{
-	  strcpy (aris + j, BIC);
-	  j += CL;
-	  i += 20;
-	  continue;
-	}
+/* Reads the bodies of theories, taking them from a queue until it is
+ * empty.  Each theory's header has already been read.
+ *  input:
+ *    arg - the queue of theories.
+ *  output:
+ *    NULL.
+ */
+static void *
+isar_read_worker (void * arg)
+{
+  struct isar_queue * queue = arg;
+  isar_theory * thy;
+  int ret;
 
-      if (!strncmp (isar + i, "\\<not>", 6))
-	{
-	  strcpy (aris + j, NOT);
-	  j += NL;
-	  i += 5;
-	  continue;
-	}
+  mem_keep_begin ();
 
-      if (isar[i] == '~')
+  while (1)
+    {
+      pthread_mutex_lock (&queue->lock);
+      if (queue->next >= queue->todo->num_stuff)
 	{
-	  strcpy (aris + j, NOT);
-	  j += NL;
-	  continue;
+	  pthread_mutex_unlock (&queue->lock);
+	  break;
 	}
+      thy = *((isar_theory **) vec_nth (queue->todo, queue->next++));
+      pthread_mutex_unlock (&queue->lock);
 
-      if (isalpha (isar[i]))
-	{
-	  int new_pos, mod = 1;
-	  char * new_str;
-	  new_pos = parse_pred_func (isar + i, &new_str);
-	  if (new_pos == -1)
-	    return NULL;
-
-	  j += sprintf (aris + j, "%s", new_str);
-	  i += new_pos - mod;
-	  continue;
-	}
+      thy->prems = init_vec (sizeof (char *));
+      thy->goals = init_vec (sizeof (char *));
 
-      aris[j] = isar[i];
-      j++;
-    }
+      ret = -1;
+      if (thy->prems && thy->goals)
+	ret = isar_parse_body (&thy->lex, thy->prems, thy->goals);
 
-  aris[j] = '\0';
+      isar_unmap (thy->buf, thy->len, thy->mapped);
+      thy->buf = NULL;
 
-  printf ("aris = '%s'\n", aris);
+      if (ret == -1)
+	{
+	  pthread_mutex_lock (&queue->lock);
+	  queue->failed = 1;
+	  pthread_mutex_unlock (&queue->lock);
+	}
+    }
 
-  return aris;
+  mem_keep_end ();
+  return NULL;
 }
 
-int
-parse_thy (char * filename, proof_t * proof)
+/* Reads the bodies of theories in parallel.
+ *  input:
+ *    todo - the theories to read.
+ *  output:
+ *    0 on success, -1 on error.
+ */
+static int
+isar_read_theories (vec_t * todo)
 {
-  FILE * file;
+  struct isar_queue queue;
+  pthread_t * threads;
+  int i, jobs, num_threads;
 
-  file = fopen (filename, "r");
-  CHECK_ALLOC (file, -1);
+  queue.todo = todo;
+  queue.next = 0;
+  queue.failed = 0;
+  pthread_mutex_init (&queue.lock, NULL);
 
-  int chk;
-  long file_size;
-  chk = fseek (file, 0, SEEK_END);
-  if (chk)
-    {
-      fclose (file);
-      perror (NULL);
-      return -1;
-    }
+  jobs = isar_num_cpus ();
+  if (jobs > todo->num_stuff)
+    jobs = todo->num_stuff;
+
+  threads = (pthread_t *) calloc (jobs + 1, sizeof (pthread_t));
+  CHECK_ALLOC (threads, -1);
 
-  file_size = ftell (file);
+  // The calling thread takes part in the reading.
 
-  chk = fseek (file, 0, SEEK_SET);
-  if (chk)
+  num_threads = 0;
+  for (i = 1; i < jobs; i++)
     {
-      fclose (file);
-      perror (NULL);
-      return -1;
+      if (pthread_create (&threads[num_threads], NULL, isar_read_worker,
+			  &queue))
+	break;
+      num_threads++;
     }
 
-  char * buffer;
+  isar_read_worker (&queue);
 
-  buffer = (char *) calloc (file_size, sizeof (char));
-  CHECK_ALLOC (buffer, -1);
+  for (i = 0; i < num_threads; i++)
+    pthread_join (threads[i], NULL);
 
-  fread (buffer, 1, file_size, file);
-  fclose (file);
-  // Read in the file buffer to buffer.
+  free (threads);
+  pthread_mutex_destroy (&queue.lock);
+
+  return queue.failed ? -1 : 0;
+}
+
+/* Loads a theory and every theory that it imports, reading only those
+ * that haven't been read, or have changed since.  The cache must be
+ * locked.
+ *  input:
+ *    filename - the name of the theory's file.
+ *    order - receives the theories, each after those it imports.
+ *  output:
+ *    0 on success, -1 on error.
+ */
+static int
+isar_load (const char * filename, vec_t * order)
+{
+  isar_theory * root, * thy;
+  vec_t * todo;
+  char * path;
+  int i, ret;
 
-  // Determine the main start of the file.
-  char * ret_chk_str;
-  ret_chk_str = strstr (buffer, "theory");
-  if (!ret_chk_str)
+  path = isar_canonical (filename);
+  if (!path)
     {
-      // Invalid .thy file, return an error.
-      return -2;
+      fprintf (stderr, "Theory Error - %s: the file can't be read.\n",
+	       filename);
+      return -1;
     }
 
-  item_t * ls_chk;
-  int i;
-
-  //TODO: Check declarations (datatypes, functions, etc.)
-  //TODO: Create a seqlog sequence (n for nats, etc.) for each one.
-  //IDEA: Thinking t0, t1, (type 0, etc.) and store each in a map-like structure.
-  //      Makes it easier to determine the input from functions.
-  //NOTE: Datatypes are declared by constructor functions.
-  //NOTE: ALL functions are recursive.
-
-  vec_t * refs, * lms;
-
-  char * buf_pos = ret_chk_str;
-  //TODO: Parse the imports.
-  // Will need to keep track of which files have already been parsed.
-  // A chart of predefined files and their imports is shown here:
-  //http://isabelle.in.tum.de/dist/library/HOL/large.html
-  //EDIT: Only check the imports for definitions.
-  //DO NOT REQUIRE THE USER TO CREATE LINES FOR ALL OF THEM,
-  //or at least not for everything in Main.
-  //That would be INSANE.
-
-  chk = get_std_seqs ();
-  if (chk == -1)
+  root = isar_theory_get (path);
+  free (path);
+  if (!root)
     return -1;
 
-  refs = init_vec (sizeof (char *));
-  if (!refs)
+  todo = init_vec (sizeof (isar_theory *));
+  if (!todo)
     return -1;
 
-  lms = init_vec (sizeof (char *));
-  if (!lms)
-    return -1;
+  isar_visits++;
+  ret = isar_theory_visit (root, order, todo);
 
-  // After this, buf_pos will point to the position of 'begin'.
-  buf_pos = strstr (buffer, "begin");
+  if (ret == 0 && todo->num_stuff > 0)
+    ret = isar_read_theories (todo);
 
-  if (strncmp (buf_pos, "begin", 5))
+  // Theories that weren't read in full are read again next time.
+
+  if (ret == -1)
     {
-      // Error stuff.
-      return -2;
+      for (i = 0; i < todo->num_stuff; i++)
+	{
+	  thy = *((isar_theory **) vec_nth (todo, i));
+	  isar_theory_forget (thy);
+	}
     }
 
-  buf_pos += 5;
+  destroy_vec (todo);
+  return ret;
+}
 
-  while (isspace (*buf_pos))
-    buf_pos++;
+/* Adds sentences to a proof.
+ *  input:
+ *    proof - the proof to add to.
+ *    sens - the sentences to add.
+ *    premise - whether the sentences are premises, rather than goals.
+ *    line - the line number of the first sentence, which receives the
+ *      line number after the last.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+static int
+isar_add_lines (proof_t * proof, vec_t * sens, int premise, int * line)
+{
+  sen_data * sd;
+  item_t * itm;
+  char * text, * goal;
+  int i;
 
-  while (1)
+  for (i = 0; i < sens->num_stuff; i++)
     {
-      char * tmp_str, * cur_key;
-      // Determine how to handle the current keyword.
+      text = *((char **) vec_nth (sens, i));
+      sd = sen_data_init ((*line)++, -1, (unsigned char *) text, NULL,
+			  premise, NULL, 0, 0, NULL);
+      if (!sd)
+	return -1;
 
-      int pos = 0;
-      while (isalnum (buf_pos[pos]) || buf_pos[pos] == '_')
-	pos++;
+      itm = ls_push_obj (proof->everything, sd);
+      if (!itm)
+	return -1;
 
-      cur_key = (char *) calloc (pos + 1, sizeof (char));
-      CHECK_ALLOC (cur_key, -1);
-      strncpy (cur_key, buf_pos, pos);
-      cur_key[pos] = '\0';
+      if (premise)
+	continue;
 
-      // Determine the keyword.
+      goal = strdup (text);
+      CHECK_ALLOC (goal, -1);
 
-      if (!strcmp (cur_key, "end"))
-	{
-	  free (cur_key);
-	  break;
-	}
+      itm = ls_push_obj (proof->goals, goal);
+      if (!itm)
+	return -1;
+    }
 
-      pos = 0;
-      tmp_str = NULL;
+  return 0;
+}
 
-      for (i = 0; i < KF_NUM_FUNCS; i++)
-	{
-	  if (!strcmp (cur_key, kfs[i].key))
-	    {
-	      pos = kfs[i].func (buf_pos, &tmp_str);
-	      if (pos == -1)
-		return -1;
-	      break;
-	    }
-	}
+/* Reads an Isabelle theory into a proof.  The definitions, axioms and
+ * function equations of the theory, and of the theories it imports,
+ * become premises, and its lemmas and theorems become goals.  Each
+ * theory is only read once, until its file changes.
+ *  input:
+ *    filename - the name of the theory's file.
+ *    proof - the proof to read the theory into.
+ *  output:
+ *    0 on success, -1 on error.
+ */
+int
+parse_thy (char * filename, proof_t * proof)
+{
+  isar_theory * thy;
+  vec_t * order;
+  int i, line = 1, ret;
 
-      // Might need to parse brackets in the event of 'text', 'section', etc.
+  order = init_vec (sizeof (isar_theory *));
+  if (!order)
+    return -1;
 
-      for (i = 0; null_keys[i]; i++)
-	{
-	  if (!strcmp (cur_key, null_keys[i]))
-	    {
-	      pos = isar_parse_null (buf_pos);
-	      if (pos == -1)
-		return -1;
-	      break;
-	    }
-	}
+  pthread_mutex_lock (&isar_lock);
 
-      if (!null_keys[i])
-	{
-	  if (!strcmp (cur_key, "datatype"))
-	    {
-	      pos = isar_parse_datatype (buf_pos, refs);
-	      if (pos == -1)
-		return -1;
-	    }
-	  else if (!strcmp (cur_key, "lemma") || !strcmp (cur_key, "theorem"))
-	    {
-	      char * mod_str, * tmp_mod_str;
-	      tmp_mod_str = die_spaces_die (tmp_str);
-	      if (!tmp_mod_str)
-		return -1;
-
-	      chk = parse_connectives (tmp_mod_str, 0, &mod_str);
-	      if (chk == -1)
-		return -1;
-	      free (tmp_mod_str);
-
-	      printf ("lemma = '%s'\n", mod_str);
-	      chk = vec_str_add_obj (lms, mod_str);
-	      if (chk < 0)
-		return -1;
-	      free (mod_str);
-	    }
-	  else if (tmp_str)
-	    {
-	      chk = vec_str_add_obj (refs, tmp_str);
-	      if (chk < 0)
-		return -1;
-	    }
-	}
+  // The theories that are read are kept for the next time.
 
-      if (pos == 0)
-	{
-	  // Not a recognized keyword.
-	}
+  mem_keep_begin ();
+  ret = isar_load (filename, order);
+  mem_keep_end ();
 
-      while (strncmp (buf_pos + pos, "\n\n", 2))
-	buf_pos++;
+  // The imported definitions come first, each after those it uses.
 
-      // Find the next non-whitespace character.
-      while (isspace(buf_pos[pos]))
-	pos++;
+  for (i = 0; ret == 0 && i < order->num_stuff; i++)
+    {
+      thy = *((isar_theory **) vec_nth (order, i));
+      ret = isar_add_lines (proof, thy->prems, 1, &line);
+    }
 
-      buf_pos += pos;
-      free (tmp_str);
-      free (cur_key);
+  if (ret == 0)
+    {
+      thy = *((isar_theory **) vec_nth (order, order->num_stuff - 1));
+      ret = isar_add_lines (proof, thy->goals, 0, &line);
     }
 
-  // Construct the proof.
+  pthread_mutex_unlock (&isar_lock);
 
-  for (i = 0; i < refs->num_stuff; i++)
-    {
-      sen_data * sd;
-      sd = sen_data_init (i, -1, vec_str_nth (refs, i), NULL, 1, NULL, 0, 0, NULL);
-      if (!sd)
-	return -1;
+  destroy_vec (order);
+  return ret;
+}
 
-      ls_chk = ls_push_obj (proof->everything, sd);
-      if (!ls_chk)
-	return -1;
-    }
+/* Gets the files of a theory and of every theory that it imports.
+ *  input:
+ *    filename - the name of the theory's file.
+ *    files - receives the canonical paths of the files.
+ *  output:
+ *    0 on success, -1 on error.
+ */
+int
+isar_theory_files (const char * filename, vec_t * files)
+{
+  isar_theory * thy;
+  vec_t * order;
+  int i, ret;
 
-  int ln_offset = refs->num_stuff;
+  order = init_vec (sizeof (isar_theory *));
+  if (!order)
+    return -1;
 
-  for (i = 0; i < lms->num_stuff; i++)
-    {
-      sen_data * sd;
-      sd = sen_data_init (i + ln_offset, -1, vec_str_nth (lms, i),
-			  NULL, 0, NULL, 0, 0, NULL);
-      if (!sd)
-	return -1;
+  pthread_mutex_lock (&isar_lock);
 
-      ls_chk = ls_push_obj (proof->everything, sd);
-      if (!ls_chk)
-	return -1;
+  // The theories that are read are kept for the next time.
 
-      ls_chk = ls_push_obj (proof->goals, vec_str_nth (lms, i));
-      if (!ls_chk)
-	return -1;
+  mem_keep_begin ();
+  ret = isar_load (filename, order);
+  mem_keep_end ();
+
+  for (i = 0; ret == 0 && i < order->num_stuff; i++)
+    {
+      thy = *((isar_theory **) vec_nth (order, i));
+      if (vec_str_add_obj (files, (unsigned char *) thy->path) < 0)
+	ret = -1;
     }
 
-  //destroy_str_vec (refs);
-  //destroy_str_vec (lms);
-  free (buffer);
+  pthread_mutex_unlock (&isar_lock);
 
-  //destroy_vec (seqs);
-  return 0;
+  destroy_vec (order);
+  return ret;
 }
@@ -0,0 +1,524 @@
+/* Functions for exporting proofs to LaTeX.
+
+   Copyright (C) 2012 Ian Dunn.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <libxml/parser.h>
+
+#include "latex.h"
+#include "proof.h"
+#include "sen-data.h"
+#include "list.h"
+#include "aio.h"
+#include "rules.h"
+#include "process.h"
+
+#define MEM_SUBSYSTEM MEM_IO
+#include "mem.h"
+
+/* Main Idea:
+ *  Each proof is written into one growing buffer, which is written out
+ *  at once.  The connectives of a sentence are found by their first
+ *  byte in a table built from the GUI connectives, so that a sentence
+ *  is converted in one pass without changing main_conns.  Files are
+ *  exported in parallel, each by a single thread.
+ */
+
+// A growing string.
+
+struct latex_buf {
+  char * str;           // The string.
+  size_t len;           // The length of the string.
+  size_t size;          // The space allocated for the string.
+};
+
+// A connective and its LaTeX command.
+
+struct latex_sym {
+  const char * text;    // The connective, as shown in the GUI.
+  int len;              // The length of the connective.
+  const char * tex;     // The LaTeX command.
+  int next;             // The next connective with the same first byte,
+			// plus one, or zero.
+};
+
+// The connectives, filled in by latex_init_syms.
+
+static struct latex_sym latex_syms[11];
+
+// For each byte, the first connective that begins with it, plus one, or
+// zero if none does.
+
+static unsigned char latex_first[256];
+
+// Makes sure the table is only filled in once.
+
+static pthread_once_t latex_once = PTHREAD_ONCE_INIT;
+
+// The files that are waiting to be exported.
+
+struct latex_queue {
+  char ** names;        // The names of the files.
+  int num_names;        // The amount of files.
+  int next;             // The index of the next file to export.
+  int failed;           // Set when a file couldn't be exported.
+  pthread_mutex_t lock; // Guards the above.
+};
+
+/* Fills in the table of connectives.
+ *  input:
+ *    none.
+ *  output:
+ *    none.
+ */
+static void
+latex_init_syms ()
+{
+  const char * texts[] = {
+    gui_conns.and, gui_conns.or, gui_conns.not, gui_conns.con,
+    gui_conns.bic, gui_conns.unv, gui_conns.exl, gui_conns.tau,
+    gui_conns.ctr, gui_conns.elm, gui_conns.nil
+  };
+  const char * texs[] = {
+    "\\land ", "\\lor ", "\\neg ", "\\rightarrow ", "\\leftrightarrow ",
+    "\\forall ", "\\exists ", "\\top ", "\\bot ", "\\in ", " nil "
+  };
+  unsigned char c;
+  int i;
+
+  // Later connectives are added to the front of their chain, so the
+  // chains are built backwards to keep the original order.
+
+  for (i = 10; i >= 0; i--)
+    {
+      c = (unsigned char) texts[i][0];
+
+      latex_syms[i].text = texts[i];
+      latex_syms[i].len = strlen (texts[i]);
+      latex_syms[i].tex = texs[i];
+      latex_syms[i].next = latex_first[c];
+      latex_first[c] = i + 1;
+    }
+}
+
+/* Adds text to a buffer, growing it as needed.
+ *  input:
+ *    out - the buffer.
+ *    text - the text to add.
+ *    len - the length of the text.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+static int
+latex_buf_add (struct latex_buf * out, const char * text, size_t len)
+{
+  char * str;
+  size_t size;
+
+  if (out->len + len + 1 > out->size)
+    {
+      size = out->size ? out->size : 256;
+      while (out->len + len + 1 > size)
+	size *= 2;
+
+      str = (char *) realloc (out->str, size);
+      CHECK_ALLOC (str, -1);
+
+      out->str = str;
+      out->size = size;
+    }
+
+  memcpy (out->str + out->len, text, len);
+  out->len += len;
+  out->str[out->len] = '\0';
+
+  return 0;
+}
+
+/* Adds a string to a buffer.
+ *  input:
+ *    out - the buffer.
+ *    str - the string to add.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+static int
+latex_buf_str (struct latex_buf * out, const char * str)
+{
+  return latex_buf_add (out, str, strlen (str));
+}
+
+/* Adds a number to a buffer.
+ *  input:
+ *    out - the buffer.
+ *    num - the number to add.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+static int
+latex_buf_int (struct latex_buf * out, int num)
+{
+  char str[16];
+  int len;
+
+  len = sprintf (str, "%i", num);
+  return latex_buf_add (out, str, len);
+}
+
+/* Adds the LaTeX text of a sentence to a buffer.
+ *  input:
+ *    out - the buffer.
+ *    sd - the sentence data to convert.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+static int
+latex_add_sen (struct latex_buf * out, sen_data * sd)
+{
+  const unsigned char * text;
+  struct latex_sym * sym;
+  int i, pos, sym_idx;
+
+  pthread_once (&latex_once, latex_init_syms);
+
+  for (i = 0; i < sd->depth; i++)
+    if (latex_buf_add (out, "\\quad ", 6) == -1)
+      return -1;
+
+  // Spaces are left out, and so aren't counted for the line breaks.
+
+  text = sd->text;
+  pos = 0;
+
+  for (i = 0; text[i]; i++)
+    {
+      if (isspace (text[i]))
+	continue;
+
+      if (pos > 0 && pos % 80 == 0)
+	{
+	  if (latex_buf_add (out, "\\\\\n&", 4) == -1)
+	    return -1;
+	}
+
+      for (sym_idx = latex_first[text[i]]; sym_idx; sym_idx = sym->next)
+	{
+	  sym = latex_syms + sym_idx - 1;
+	  if (!strncmp ((const char *) text + i, sym->text, sym->len))
+	    break;
+	}
+
+      if (sym_idx)
+	{
+	  if (latex_buf_str (out, sym->tex) == -1)
+	    return -1;
+
+	  i += sym->len - 1;
+	  pos += sym->len;
+	  continue;
+	}
+
+      if (latex_buf_add (out, (const char *) text + i, 1) == -1)
+	return -1;
+      pos++;
+    }
+
+  return 0;
+}
+
+/* Adds the LaTeX document of a proof to a buffer.
+ *  input:
+ *    out - the buffer.
+ *    proof - the proof to convert.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+static int
+latex_add_proof (struct latex_buf * out, proof_t * proof)
+{
+  static const char * header =
+    "\\documentclass{article}\n"
+    "\\usepackage{amsmath}\n"
+    "\\usepackage{amsfonts}\n"
+    "\\begin{document}\n"
+    "\\newcommand{\\eline}{--------}\n"
+    "\\newcommand{\\prmline}[2]{\\text{#1.}&\\quad #2 &}\n"
+    "\\newcommand{\\stdline}[3]{\\text{#1.}&\\quad #2 & \\texttt{#3 }}\n"
+    "\n"
+    "{\\allowdisplaybreaks\n"
+    "  \\begin{align*}\n";
+  static const char * footer =
+    "  \\end{align*}\n"
+    "}\n"
+    "\\end{document}\n";
+  item_t * ev_itr;
+  sen_data * sd;
+  const char * rule;
+  int i, ret;
+
+  ret = latex_buf_str (out, header);
+
+  for (ev_itr = proof->everything->head; ret == 0 && ev_itr;
+       ev_itr = ev_itr->next)
+    {
+      sd = ev_itr->value;
+      if (!sd->premise)
+	break;
+
+      if (latex_buf_str (out, "    \\prmline{") == -1
+	  || latex_buf_int (out, sd->line_num) == -1
+	  || latex_buf_str (out, "}{") == -1
+	  || latex_add_sen (out, sd) == -1
+	  || latex_buf_str (out, "}\\\\\n") == -1)
+	ret = -1;
+    }
+
+  if (ret == 0)
+    ret = latex_buf_str (out, "    &\\eline\\\\\n");
+
+  for (; ret == 0 && ev_itr; ev_itr = ev_itr->next)
+    {
+      sd = ev_itr->value;
+      rule = sd->subproof ? "assume" : rules_list[sd->rule];
+
+      if (latex_buf_str (out, "    \\stdline{") == -1
+	  || latex_buf_int (out, sd->line_num) == -1
+	  || latex_buf_str (out, "}{") == -1
+	  || latex_add_sen (out, sd) == -1
+	  || latex_buf_str (out, "}{") == -1
+	  || latex_buf_str (out, rule) == -1
+	  || latex_buf_str (out, "} ") == -1)
+	{
+	  ret = -1;
+	  break;
+	}
+
+      if (!(sd->rule == RULE_EX || sd->rule == RULE_II
+	    || sd->rule == RULE_SQ || sd->subproof))
+	{
+	  for (i = 0; ret == 0 && sd->refs[i] != -1; i++)
+	    {
+	      if (latex_buf_str (out, "(") == -1
+		  || latex_buf_int (out, sd->refs[i]) == -1
+		  || latex_buf_str (out, (sd->refs[i + 1] != -1)
+				    ? ")," : ")") == -1)
+		ret = -1;
+	    }
+	}
+
+      if (ret == 0)
+	ret = latex_buf_str (out, "\\\\\n");
+    }
+
+  if (ret == 0)
+    ret = latex_buf_str (out, footer);
+
+  return ret;
+}
+
+/* Converts a proof into a LaTeX file.
+ *  input:
+ *    proof - the proof to convert.
+ *    file - the file to write to.
+ *  output:
+ *    0 on success, -1 on error.
+ */
+int
+latex_write_proof (proof_t * proof, FILE * file)
+{
+  struct latex_buf out = { NULL, 0, 0 };
+  int ret;
+
+  ret = latex_add_proof (&out, proof);
+  if (ret == 0 && fwrite (out.str, 1, out.len, file) != out.len)
+    {
+      perror (NULL);
+      ret = -1;
+    }
+
+  free (out.str);
+  return ret;
+}
+
+/* Exports one file to LaTeX, next to the file with the extension 'tex'.
+ *  input:
+ *    name - the name of the file to export.
+ *  output:
+ *    0 on success, -1 on error.
+ */
+static int
+latex_export_file (const char * name)
+{
+  proof_t * proof;
+  FILE * file;
+  char * fname;
+  unsigned long mark;
+  int n_len, ret;
+
+  mark = mem_mark ();
+  proof = aio_open (name);
+  if (!proof)
+    return -1;
+
+  n_len = strlen (name);
+  fname = (char *) calloc (n_len + 4, sizeof (char));
+  CHECK_ALLOC (fname, -1);
+
+  // The last three characters, normally the extension, are replaced.
+
+  if (n_len > 3)
+    n_len -= 3;
+  strncpy (fname, name, n_len);
+  strcpy (fname + n_len, "tex");
+
+  file = fopen (fname, "w");
+  if (!file)
+    {
+      perror (fname);
+      free (fname);
+      proof_destroy (proof);
+      return -1;
+    }
+
+  ret = latex_write_proof (proof, file);
+
+  if (fclose (file) == EOF && ret == 0)
+    {
+      perror (fname);
+      ret = -1;
+    }
+
+  free (fname);
+  proof_destroy (proof);
+
+  mem_check_live (name, mark);
+  return ret;
+}
+
+/* Exports files taken from a queue, until it is empty.
+ *  input:
+ *    arg - the queue of files.
+ *  output:
+ *    NULL.
+ */
+static void *
+latex_worker (void * arg)
+{
+  struct latex_queue * queue = arg;
+  int i, ret;
+
+  while (1)
+    {
+      pthread_mutex_lock (&queue->lock);
+      i = queue->next++;
+      pthread_mutex_unlock (&queue->lock);
+
+      if (i >= queue->num_names)
+	break;
+
+      ret = latex_export_file (queue->names[i]);
+      if (ret == -1)
+	{
+	  pthread_mutex_lock (&queue->lock);
+	  queue->failed = 1;
+	  pthread_mutex_unlock (&queue->lock);
+	}
+    }
+
+  return NULL;
+}
+
+/* Gets the amount of processors available.
+ *  input:
+ *    none.
+ *  output:
+ *    the amount of processors, at least one.
+ */
+static int
+latex_num_cpus ()
+{
+  long num = 1;
+
+#ifdef _SC_NPROCESSORS_ONLN
+  num = sysconf (_SC_NPROCESSORS_ONLN);
+#endif
+
+  return (num > 0) ? (int) num : 1;
+}
+
+/* Exports files to LaTeX, each next to the file with the extension 'tex'.
+ * Files that can't be exported are skipped.
+ *  input:
+ *    names - the names of the files to export.
+ *    num_names - the amount of files.
+ *    jobs - the amount of files to export at once, or 0 for one per
+ *      processor.
+ *  output:
+ *    0 on success, -1 if any file couldn't be exported.
+ */
+int
+latex_export_files (char ** names, int num_names, int jobs)
+{
+  struct latex_queue queue;
+  pthread_t * threads;
+  int i, num_threads;
+
+  if (jobs < 1)
+    jobs = latex_num_cpus ();
+
+  if (jobs > num_names)
+    jobs = num_names;
+
+  queue.names = names;
+  queue.num_names = num_names;
+  queue.next = 0;
+  queue.failed = 0;
+
+  threads = (pthread_t *) calloc (jobs + 1, sizeof (pthread_t));
+  CHECK_ALLOC (threads, -1);
+
+  pthread_mutex_init (&queue.lock, NULL);
+
+  // libxml2 must be initialized before it is used from several threads.
+
+  xmlInitParser ();
+
+  // The calling thread exports files as well.
+
+  num_threads = 0;
+  for (i = 1; i < jobs; i++)
+    {
+      if (pthread_create (&threads[num_threads], NULL, latex_worker, &queue))
+	break;
+      num_threads++;
+    }
+
+  latex_worker (&queue);
+
+  for (i = 0; i < num_threads; i++)
+    pthread_join (threads[i], NULL);
+
+  pthread_mutex_destroy (&queue.lock);
+  free (threads);
+
+  return queue.failed ? -1 : 0;
+}
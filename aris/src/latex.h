@@ -0,0 +1,29 @@
+/* Functions for exporting proofs to LaTeX.
+
+   Copyright (C) 2012 Ian Dunn.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ARIS_LATEX_H
+#define ARIS_LATEX_H
+
+#include <stdio.h>
+
+typedef struct proof proof_t;
+
+int latex_write_proof (proof_t * proof, FILE * file);
+int latex_export_files (char ** names, int num_names, int jobs);
+
+#endif /* ARIS_LATEX_H */
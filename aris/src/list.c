@@ -23,6 +23,27 @@
 
 #include "list.h"
 
+#define MEM_SUBSYSTEM MEM_STRUCTS
+#include "mem.h"
+
+/* Main Idea:
+ *  Walking a list to find the item at an index made every loop over the
+ *  lines of a proof that followed references quadratic.  A list that is
+ *  indexed is given an index as well: the items in order, split into
+ *  chunks of at most LS_CHUNK_SIZE, each item knowing the chunk it's in.
+ *  The sizes of the chunks are kept in a Fenwick tree, so that finding
+ *  the chunk of an index, and counting an item in or out of its chunk,
+ *  take time logarithmic in the amount of chunks.  Inserting or
+ *  removing an item only moves the items of its chunk; when a chunk is
+ *  split or emptied, which happens at most once every LS_CHUNK_SIZE / 2
+ *  changes to it, the chunks after it are moved and the tree is rebuilt.  Items are still linked, so iterating and
+ *  keeping items as handles work as before.  Short lists aren't indexed.
+ */
+
+// The least amount of items for which a list is indexed.
+
+#define LS_INDEX_MIN 32
+
 /* Initializes a list structure.
  *  input:
  *    none.
@@ -45,9 +66,302 @@ init_list ()
 
   ls->head = ls->tail = NULL;
 
+  ls->chunks = NULL;
+  ls->sizes = NULL;
+  ls->num_chunks = ls->alloc_chunks = 0;
+
   return ls;
 }
 
+/* Frees the index of a list.
+ *  input:
+ *    ls - the list whose index is being freed.
+ *  output:
+ *    none.
+ */
+static void
+ls_index_free (list_t * ls)
+{
+  unsigned int i, j;
+
+  if (!ls->chunks)
+    return;
+
+  for (i = 0; i < ls->num_chunks; i++)
+    {
+      for (j = 0; j < ls->chunks[i]->num_stuff; j++)
+	ls->chunks[i]->stuff[j]->chunk = NULL;
+      free (ls->chunks[i]);
+    }
+
+  free (ls->chunks);
+  free (ls->sizes);
+  ls->chunks = NULL;
+  ls->sizes = NULL;
+  ls->sizes = NULL;
+  ls->num_chunks = ls->alloc_chunks = 0;
+}
+
+/* Rebuilds the tree of the sizes of the chunks of a list, and numbers
+ * the chunks by their positions.
+ *  input:
+ *    ls - the list, whose index has been built.
+ *  output:
+ *    none.
+ */
+static void
+ls_tree_build (list_t * ls)
+{
+  unsigned int i, j;
+
+  for (i = 1; i <= ls->num_chunks; i++)
+    {
+      ls->sizes[i] = ls->chunks[i - 1]->num_stuff;
+      ls->chunks[i - 1]->pos = i - 1;
+    }
+
+  for (i = 1; i <= ls->num_chunks; i++)
+    {
+      j = i + (i & -i);
+      if (j <= ls->num_chunks)
+	ls->sizes[j] += ls->sizes[i];
+    }
+}
+
+/* Counts an item in or out of a chunk in the tree of a list.
+ *  input:
+ *    ls - the list.
+ *    cpos - the position of the chunk.
+ *    add - 1 if an item was added to the chunk, -1 if one was removed.
+ *  output:
+ *    none.
+ */
+static void
+ls_tree_add (list_t * ls, unsigned int cpos, int add)
+{
+  unsigned int i;
+
+  for (i = cpos + 1; i <= ls->num_chunks; i += i & -i)
+    ls->sizes[i] += add;
+}
+
+/* Finds the chunk that holds an index of a list.
+ *  input:
+ *    ls - the list, whose index has been built.
+ *    n - the index, which is less than the size of the list.  Receives
+ *      the index of the item in its chunk.
+ *  output:
+ *    the position of the chunk.
+ */
+static unsigned int
+ls_tree_find (list_t * ls, unsigned int * n)
+{
+  unsigned int cpos = 0, step = 1;
+
+  while (step * 2 <= ls->num_chunks)
+    step *= 2;
+
+  for (; step > 0; step /= 2)
+    {
+      if (cpos + step <= ls->num_chunks && ls->sizes[cpos + step] <= *n)
+	{
+	  cpos += step;
+	  *n -= ls->sizes[cpos];
+	}
+    }
+
+  return cpos;
+}
+
+/* Builds the index of a list.  The chunks are left half full, so that
+ * inserting doesn't split them right away.
+ *  input:
+ *    ls - the list to index.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+static int
+ls_index_build (list_t * ls)
+{
+  unsigned int num_chunks, i, half = LS_CHUNK_SIZE / 2;
+  item_t * itm;
+
+  num_chunks = (ls->num_stuff + half - 1) / half;
+
+  ls->chunks = (ls_chunk_t **) calloc (num_chunks, sizeof (ls_chunk_t *));
+  ls->sizes = (unsigned int *) calloc (num_chunks + 1, sizeof (unsigned int));
+  if (!ls->chunks || !ls->sizes)
+    {
+      perror (NULL);
+      free (ls->chunks);
+      free (ls->sizes);
+      ls->chunks = NULL;
+      ls->sizes = NULL;
+      return -1;
+    }
+
+  ls->alloc_chunks = num_chunks;
+  ls->num_chunks = 0;
+
+  itm = ls->head;
+  for (i = 0; i < num_chunks; i++)
+    {
+      ls_chunk_t * chunk;
+
+      chunk = (ls_chunk_t *) calloc (1, sizeof (ls_chunk_t));
+      if (!chunk)
+	{
+	  perror (NULL);
+	  ls_index_free (ls);
+	  return -1;
+	}
+
+      ls->chunks[ls->num_chunks++] = chunk;
+
+      for (; itm && chunk->num_stuff < half; itm = itm->next)
+	{
+	  chunk->stuff[chunk->num_stuff++] = itm;
+	  itm->chunk = chunk;
+	}
+    }
+
+  ls_tree_build (ls);
+  return 0;
+}
+
+/* Puts an item that was just inserted into the index of a list.
+ *  input:
+ *    ls - the list.
+ *    itm - the new item.
+ *    it - the item that it was inserted after.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+static int
+ls_index_insert (list_t * ls, item_t * itm, item_t * it)
+{
+  ls_chunk_t * chunk = it->chunk;
+  unsigned int pos;
+  int split = 0;
+
+  for (pos = 0; chunk->stuff[pos] != it; pos++);
+  pos++;
+
+  if (chunk->num_stuff == LS_CHUNK_SIZE)
+    {
+      // Split the chunk in half.
+      ls_chunk_t * new_chunk;
+      unsigned int cpos, half = LS_CHUNK_SIZE / 2, i;
+
+      if (ls->num_chunks == ls->alloc_chunks)
+	{
+	  ls_chunk_t ** new_chunks;
+	  unsigned int * new_sizes;
+
+	  new_chunks = (ls_chunk_t **) realloc (ls->chunks,
+						2 * ls->alloc_chunks
+						* sizeof (ls_chunk_t *));
+	  if (!new_chunks)
+	    {
+	      perror (NULL);
+	      return -1;
+	    }
+	  ls->chunks = new_chunks;
+
+	  new_sizes = (unsigned int *) realloc (ls->sizes,
+						(2 * ls->alloc_chunks + 1)
+						* sizeof (unsigned int));
+	  if (!new_sizes)
+	    {
+	      perror (NULL);
+	      return -1;
+	    }
+	  ls->sizes = new_sizes;
+
+	  ls->alloc_chunks *= 2;
+	}
+
+      new_chunk = (ls_chunk_t *) calloc (1, sizeof (ls_chunk_t));
+      if (!new_chunk)
+	{
+	  perror (NULL);
+	  return -1;
+	}
+
+      cpos = chunk->pos;
+      memmove (ls->chunks + cpos + 2, ls->chunks + cpos + 1,
+	       (ls->num_chunks - cpos - 1) * sizeof (ls_chunk_t *));
+      ls->chunks[cpos + 1] = new_chunk;
+      ls->num_chunks++;
+
+      memcpy (new_chunk->stuff, chunk->stuff + half, half * sizeof (item_t *));
+      new_chunk->num_stuff = half;
+      chunk->num_stuff = half;
+
+      for (i = 0; i < half; i++)
+	new_chunk->stuff[i]->chunk = new_chunk;
+
+      if (pos > half)
+	{
+	  chunk = new_chunk;
+	  pos -= half;
+	}
+      split = 1;
+    }
+
+  memmove (chunk->stuff + pos + 1, chunk->stuff + pos,
+	   (chunk->num_stuff - pos) * sizeof (item_t *));
+  chunk->stuff[pos] = itm;
+  chunk->num_stuff++;
+  itm->chunk = chunk;
+
+  if (split)
+    ls_tree_build (ls);
+  else
+    ls_tree_add (ls, chunk->pos, 1);
+
+  return 0;
+}
+
+/* Takes an item that is being removed out of the index of a list.
+ *  input:
+ *    ls - the list.
+ *    it - the item being removed.
+ *  output:
+ *    none.
+ */
+static void
+ls_index_remove (list_t * ls, item_t * it)
+{
+  ls_chunk_t * chunk = it->chunk;
+  unsigned int pos;
+
+  for (pos = 0; chunk->stuff[pos] != it; pos++);
+
+  chunk->num_stuff--;
+  memmove (chunk->stuff + pos, chunk->stuff + pos + 1,
+	   (chunk->num_stuff - pos) * sizeof (item_t *));
+  it->chunk = NULL;
+
+  if (chunk->num_stuff == 0)
+    {
+      unsigned int cpos;
+
+      cpos = chunk->pos;
+      ls->num_chunks--;
+      memmove (ls->chunks + cpos, ls->chunks + cpos + 1,
+	       (ls->num_chunks - cpos) * sizeof (ls_chunk_t *));
+      free (chunk);
+
+      if (ls->num_chunks == 0)
+	ls_index_free (ls);
+      else
+	ls_tree_build (ls);
+    }
+  else
+    ls_tree_add (ls, chunk->pos, -1);
+}
+
 /* Copies a list from an old one.
  *  input:
  *    ls_old - the old doubly-linked list.
@@ -132,6 +446,10 @@ ls_ins_obj (list_t * ls, void * obj, item_t * it)
       it->next = ins_itm;
     }
 
+  // If the index can't be kept, it is built again when it is needed.
+  if (ls->chunks && ls_index_insert (ls, ins_itm, it) < 0)
+    ls_index_free (ls);
+
   ls->num_stuff += 1;
   return ins_itm;
 }
@@ -164,6 +482,9 @@ ls_rem_obj (list_t * ls, item_t * it)
 
   ls->num_stuff--;
 
+  if (it->chunk)
+    ls_index_remove (ls, it);
+
   if (!ls->head)
     {
       ls->head = ls->tail = NULL;
@@ -214,14 +535,17 @@ ls_clear (list_t * ls)
 {
   item_t * itm, * n_itm;
 
+  ls_index_free (ls);
+
   for (itm = ls->head; itm; itm = n_itm)
     {
-      item_t * n_itm = itm->next;
+      n_itm = itm->next;
       itm->next = itm->prev = NULL;
       free (itm);
     }
 
   ls->head = ls->tail = NULL;
+  ls->num_stuff = 0;
 }
 
 /* Obtains an item in a list by the item's index.
@@ -236,6 +560,21 @@ ls_nth (list_t * ls, int n)
 {
   int i = 0;
   item_t * itm;
+
+  if (n < 0 || n >= ls->num_stuff)
+    return NULL;
+
+  if (!ls->chunks && ls->num_stuff >= LS_INDEX_MIN)
+    ls_index_build (ls);
+
+  if (ls->chunks)
+    {
+      unsigned int c, m = n;
+
+      c = ls_tree_find (ls, &m);
+      return ls->chunks[c]->stuff[m];
+    }
+
   for (itm = ls->head; itm; itm = itm->next, i++)
     {
       if (i == n)
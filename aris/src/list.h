@@ -21,6 +21,11 @@
 
 typedef struct item item_t;
 typedef struct list list_t;
+typedef struct ls_chunk ls_chunk_t;
+
+// The most items in a chunk of the index of a list.
+
+#define LS_CHUNK_SIZE 64
 
 // The item structure of the doubly-linked list.
 
@@ -30,6 +35,17 @@ struct item
   struct item * next;
 
   void * value;
+
+  ls_chunk_t * chunk;  // The chunk of the index that holds this, or NULL.
+};
+
+// A chunk of the index of a list, holding a run of its items in order.
+
+struct ls_chunk
+{
+  unsigned int num_stuff;
+  unsigned int pos;    // The position of this chunk in the index.
+  item_t * stuff[LS_CHUNK_SIZE];
 };
 
 // The doubly-linked list structure itself.
@@ -39,6 +55,11 @@ struct list
   unsigned int num_stuff;
 
   item_t * head, * tail;
+
+  ls_chunk_t ** chunks;      // The index of the items, or NULL if not built.
+  unsigned int * sizes;      // The sizes of the chunks, as a Fenwick tree.
+  unsigned int num_chunks;   // The amount of chunks in the index.
+  unsigned int alloc_chunks; // The allocated amount of chunks.
 };
 
 list_t * init_list ();
@@ -0,0 +1,769 @@
+/* Functions for accounting the allocations.
+
+   Copyright (C) 2012 Ian Dunn.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "mem.h"
+
+/* Main Idea:
+ *  Every file of Aris includes mem.h, which sends its allocations here,
+ *  along with the subsystem of the file and the place of the call.
+ *  Unless the mem-stats flag is given, they are passed straight on.
+ *  With it, each block is kept in a table by its address, so that the
+ *  live bytes, the peak bytes and the amount of allocations of each
+ *  subsystem are known, and so that the blocks still live when a proof
+ *  has been destroyed can be found.  Blocks that are meant to last,
+ *  such as those of the caches, are allocated between mem_keep_begin
+ *  and mem_keep_end, or handed to mem_keep, and are never reported.
+ *  This file doesn't define MEM_SUBSYSTEM, so it uses the C library.
+ */
+
+// An allocated block.
+
+struct mem_block {
+  void * ptr;                // The address of the block.
+  size_t size;               // The size of the block.
+  const char * file;         // The file that allocated the block.
+  int line;                  // The line that allocated the block.
+  int sys;                   // The subsystem of the block.
+  int kept;                  // Whether the block is meant to last.
+  unsigned long serial;      // The order in which the block was made.
+  pthread_t thread;          // The thread that allocated the block.
+  struct mem_block * next;   // The next block in the same bucket.
+};
+
+// The counts of a subsystem.
+
+struct mem_count {
+  unsigned long allocs;  // The amount of allocations.
+  unsigned long frees;   // The amount of blocks freed.
+  size_t live;           // The bytes allocated and not yet freed.
+  size_t peak;           // The most bytes that were ever live.
+};
+
+// The blocks of a place that are still live.
+
+struct mem_site {
+  const char * file;
+  int line;
+  unsigned long count;
+  size_t bytes;
+};
+
+// The amount of buckets the table starts with.
+
+#define MEM_INIT_BUCKETS 4096
+
+// The most places reported by mem_check_live.
+
+#define MEM_CHECK_SITES 8
+
+static const char * mem_names[MEM_NUM] =
+  { "parser", "rules", "I/O", "GUI", "structures" };
+
+// The table, and the counts, shared by every thread.
+
+static int mem_enabled = 0;
+static pthread_mutex_t mem_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct mem_block ** mem_buckets = NULL;
+static size_t mem_num_buckets = 0;
+static size_t mem_num_blocks = 0;
+static unsigned long mem_serial = 0;
+static struct mem_count mem_counts[MEM_NUM];
+static size_t mem_live = 0;
+static size_t mem_peak = 0;
+
+// The bytes live when mem_peak_begin was called, and the most live since.
+
+static int mem_quiet = 0;
+static size_t mem_run_base = 0;
+static size_t mem_run_peak = 0;
+
+// The depth of mem_keep_begin in each thread.
+
+static pthread_key_t mem_keep_key;
+static pthread_once_t mem_keep_once = PTHREAD_ONCE_INIT;
+
+/* Gets the bucket of an address.
+ *  input:
+ *    ptr - the address.
+ *  output:
+ *    the index of the bucket of ptr.
+ */
+static size_t
+mem_bucket (void * ptr)
+{
+  uintptr_t key = (uintptr_t) ptr >> 4;
+
+  key ^= key >> 15;
+  key *= 0x9e3779b1u;
+  return (size_t) (key ^ (key >> 13)) & (mem_num_buckets - 1);
+}
+
+/* Doubles the amount of buckets in the table.  The table must be locked.
+ *  input:
+ *    none.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+static int
+mem_grow ()
+{
+  struct mem_block ** old_buckets = mem_buckets;
+  size_t i, old_num = mem_num_buckets;
+
+  mem_num_buckets = (old_num) ? old_num * 2 : MEM_INIT_BUCKETS;
+  mem_buckets = (struct mem_block **) calloc (mem_num_buckets,
+					      sizeof (struct mem_block *));
+  if (!mem_buckets)
+    {
+      mem_buckets = old_buckets;
+      mem_num_buckets = old_num;
+      return -1;
+    }
+
+  for (i = 0; i < old_num; i++)
+    {
+      struct mem_block * block, * next;
+
+      for (block = old_buckets[i]; block; block = next)
+	{
+	  size_t b = mem_bucket (block->ptr);
+
+	  next = block->next;
+	  block->next = mem_buckets[b];
+	  mem_buckets[b] = block;
+	}
+    }
+
+  free (old_buckets);
+  return 0;
+}
+
+/* Adds a block to the table, and counts it.  The table must be locked.
+ *  input:
+ *    block - the block, whose address, size and subsystem are set.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+static int
+mem_insert (struct mem_block * block)
+{
+  struct mem_count * count = mem_counts + block->sys;
+  size_t b;
+
+  if (mem_num_blocks >= mem_num_buckets && mem_grow () == -1
+      && !mem_buckets)
+    return -1;
+
+  b = mem_bucket (block->ptr);
+  block->next = mem_buckets[b];
+  mem_buckets[b] = block;
+  mem_num_blocks++;
+
+  count->live += block->size;
+  if (count->live > count->peak)
+    count->peak = count->live;
+
+  mem_live += block->size;
+  if (mem_live > mem_peak)
+    mem_peak = mem_live;
+  if (mem_live > mem_run_peak)
+    mem_run_peak = mem_live;
+
+  return 0;
+}
+
+/* Removes a block from the table, and uncounts it.  The table must be
+ * locked.
+ *  input:
+ *    ptr - the address of the block.
+ *  output:
+ *    the block, or NULL if ptr wasn't allocated here.
+ */
+static struct mem_block *
+mem_remove (void * ptr)
+{
+  struct mem_block ** link;
+
+  if (!mem_buckets)
+    return NULL;
+
+  for (link = mem_buckets + mem_bucket (ptr); *link; link = &(*link)->next)
+    {
+      struct mem_block * block = *link;
+
+      if (block->ptr != ptr)
+	continue;
+
+      *link = block->next;
+      mem_num_blocks--;
+
+      mem_counts[block->sys].live -= block->size;
+      mem_live -= block->size;
+
+      return block;
+    }
+
+  return NULL;
+}
+
+/* Creates the key of the depth of mem_keep_begin.
+ *  input:
+ *    none.
+ *  output:
+ *    none.
+ */
+static void
+mem_keep_init ()
+{
+  pthread_key_create (&mem_keep_key, NULL);
+}
+
+/* Gets the depth of mem_keep_begin in this thread.
+ *  input:
+ *    none.
+ *  output:
+ *    the depth.
+ */
+static intptr_t
+mem_keep_depth ()
+{
+  pthread_once (&mem_keep_once, mem_keep_init);
+  return (intptr_t) pthread_getspecific (mem_keep_key);
+}
+
+/* Records a new block.
+ *  input:
+ *    ptr - the address of the block, or NULL.
+ *    size - the size of the block.
+ *    sys - the subsystem of the block.
+ *    file, line - the place of the allocation.
+ *  output:
+ *    none.  If the record can't be made, the block isn't counted.
+ */
+static void
+mem_track (void * ptr, size_t size, int sys, const char * file, int line)
+{
+  struct mem_block * block;
+
+  if (!ptr)
+    return;
+
+  block = (struct mem_block *) malloc (sizeof (struct mem_block));
+  if (!block)
+    return;
+
+  block->ptr = ptr;
+  block->size = size;
+  block->file = file;
+  block->line = line;
+  block->sys = sys;
+  block->kept = (mem_keep_depth () > 0);
+  block->thread = pthread_self ();
+
+  pthread_mutex_lock (&mem_lock);
+
+  block->serial = ++mem_serial;
+  mem_counts[sys].allocs++;
+  if (mem_insert (block) == -1)
+    free (block);
+
+  pthread_mutex_unlock (&mem_lock);
+}
+
+/* Prints the counts of each subsystem to stderr, at exit.
+ *  input:
+ *    none.
+ *  output:
+ *    none.
+ */
+static void
+mem_stats_exit ()
+{
+  mem_stats_print (stderr);
+}
+
+/* Starts counting allocations, and prints the counts at exit.  This
+ * must be called before any other thread is started.
+ *  input:
+ *    none.
+ *  output:
+ *    none.
+ */
+void
+mem_stats_enable ()
+{
+  if (mem_enabled)
+    return;
+
+  mem_enabled = 1;
+  atexit (mem_stats_exit);
+}
+
+/* Prints the counts of each subsystem.
+ *  input:
+ *    out - the file to print to.
+ *  output:
+ *    none.
+ */
+void
+mem_stats_print (FILE * out)
+{
+  struct mem_count counts[MEM_NUM], total;
+  int i;
+
+  if (!mem_enabled)
+    return;
+
+  pthread_mutex_lock (&mem_lock);
+  memcpy (counts, mem_counts, sizeof (counts));
+  total.live = mem_live;
+  total.peak = mem_peak;
+  pthread_mutex_unlock (&mem_lock);
+
+  total.allocs = total.frees = 0;
+
+  fprintf (out, "%-12s %12s %12s %14s %14s\n",
+	   "subsystem", "allocations", "frees", "live bytes", "peak bytes");
+  for (i = 0; i < MEM_NUM; i++)
+    {
+      fprintf (out, "%-12s %12lu %12lu %14lu %14lu\n", mem_names[i],
+	       counts[i].allocs, counts[i].frees,
+	       (unsigned long) counts[i].live, (unsigned long) counts[i].peak);
+      total.allocs += counts[i].allocs;
+      total.frees += counts[i].frees;
+    }
+  fprintf (out, "%-12s %12lu %12lu %14lu %14lu\n", "total",
+	   total.allocs, total.frees,
+	   (unsigned long) total.live, (unsigned long) total.peak);
+}
+
+/* Starts measuring the most bytes that are live at once, such as while
+ * a proof is evaluated.  Unless the mem-stats flag was given, blocks are
+ * counted from here until mem_peak_end only, so that only the blocks
+ * allocated in between are measured.  No other thread may be running.
+ *  input:
+ *    none.
+ *  output:
+ *    none.
+ */
+void
+mem_peak_begin ()
+{
+  if (!mem_enabled)
+    {
+      mem_enabled = 1;
+      mem_quiet = 1;
+    }
+
+  pthread_mutex_lock (&mem_lock);
+  mem_run_base = mem_run_peak = mem_live;
+  pthread_mutex_unlock (&mem_lock);
+}
+
+/* Stops measuring the most bytes that are live at once.  If counting was
+ * started by mem_peak_begin, it is stopped, and the table is emptied.
+ * No other thread may be running.
+ *  input:
+ *    none.
+ *  output:
+ *    the most bytes that were live at once since mem_peak_begin, beyond
+ *    those that were already live then.
+ */
+size_t
+mem_peak_end ()
+{
+  size_t peak, i;
+
+  pthread_mutex_lock (&mem_lock);
+  peak = mem_run_peak - mem_run_base;
+
+  if (mem_quiet)
+    {
+      for (i = 0; i < mem_num_buckets; i++)
+	{
+	  struct mem_block * block, * next;
+
+	  for (block = mem_buckets[i]; block; block = next)
+	    {
+	      next = block->next;
+	      free (block);
+	    }
+	}
+
+      free (mem_buckets);
+      mem_buckets = NULL;
+      mem_num_buckets = mem_num_blocks = 0;
+      memset (mem_counts, 0, sizeof (mem_counts));
+      mem_live = mem_peak = mem_run_peak = 0;
+
+      mem_enabled = 0;
+      mem_quiet = 0;
+    }
+
+  pthread_mutex_unlock (&mem_lock);
+  return peak;
+}
+
+/* Marks the current point, to find the blocks allocated after it.
+ *  input:
+ *    none.
+ *  output:
+ *    the mark, to be passed to mem_check_live.
+ */
+unsigned long
+mem_mark ()
+{
+  unsigned long mark;
+
+  if (!mem_enabled)
+    return 0;
+
+  pthread_mutex_lock (&mem_lock);
+  mark = mem_serial;
+  pthread_mutex_unlock (&mem_lock);
+
+  return mark;
+}
+
+/* Compares the bytes of two places, for qsort.
+ *  input:
+ *    a, b - the places.
+ *  output:
+ *    less than, equal to, or greater than 0 as a has more, the same, or
+ *    fewer bytes than b.
+ */
+static int
+mem_cmp_site (const void * a, const void * b)
+{
+  const struct mem_site * sa = a, * sb = b;
+
+  return (sa->bytes < sb->bytes) - (sa->bytes > sb->bytes);
+}
+
+/* Reports the blocks allocated by this thread since a mark, that are
+ * still live and aren't meant to last.  This is used once a proof has
+ * been destroyed, when nothing made for it should remain.
+ *  input:
+ *    name - the name of the proof, for the report.
+ *    mark - the mark from mem_mark, taken before the proof was opened.
+ *  output:
+ *    the amount of blocks that are still live.
+ */
+unsigned long
+mem_check_live (const char * name, unsigned long mark)
+{
+  struct mem_site * sites = NULL;
+  unsigned long num_live = 0;
+  size_t i, bytes = 0;
+  int num_sites = 0, alloc_sites = 0, s;
+  pthread_t self = pthread_self ();
+
+  if (!mem_enabled)
+    return 0;
+
+  pthread_mutex_lock (&mem_lock);
+
+  for (i = 0; i < mem_num_buckets; i++)
+    {
+      struct mem_block * block;
+
+      for (block = mem_buckets[i]; block; block = block->next)
+	{
+	  if (block->serial <= mark || block->kept
+	      || !pthread_equal (block->thread, self))
+	    continue;
+
+	  num_live++;
+	  bytes += block->size;
+
+	  for (s = 0; s < num_sites; s++)
+	    if (sites[s].line == block->line
+		&& !strcmp (sites[s].file, block->file))
+	      break;
+
+	  if (s == num_sites)
+	    {
+	      if (num_sites == alloc_sites)
+		{
+		  struct mem_site * new_sites;
+
+		  alloc_sites = (alloc_sites) ? alloc_sites * 2 : 16;
+		  new_sites = (struct mem_site *)
+		    realloc (sites, alloc_sites * sizeof (struct mem_site));
+		  if (!new_sites)
+		    {
+		      alloc_sites = num_sites;
+		      continue;
+		    }
+		  sites = new_sites;
+		}
+
+	      sites[s].file = block->file;
+	      sites[s].line = block->line;
+	      sites[s].count = 0;
+	      sites[s].bytes = 0;
+	      num_sites++;
+	    }
+
+	  sites[s].count++;
+	  sites[s].bytes += block->size;
+	}
+    }
+
+  pthread_mutex_unlock (&mem_lock);
+
+  if (num_live > 0)
+    {
+      fprintf (stderr, "Memory Warning - %s: %lu blocks of %lu bytes are still live after the proof was destroyed.\n",
+	       name, num_live, (unsigned long) bytes);
+
+      qsort (sites, num_sites, sizeof (struct mem_site), mem_cmp_site);
+      for (s = 0; s < num_sites && s < MEM_CHECK_SITES; s++)
+	fprintf (stderr, "  %s:%i: %lu blocks of %lu bytes\n",
+		 sites[s].file, sites[s].line, sites[s].count,
+		 (unsigned long) sites[s].bytes);
+    }
+
+  free (sites);
+  return num_live;
+}
+
+/* Starts allocating blocks that are meant to last, in this thread.
+ *  input:
+ *    none.
+ *  output:
+ *    none.
+ */
+void
+mem_keep_begin ()
+{
+  if (!mem_enabled)
+    return;
+
+  pthread_setspecific (mem_keep_key, (void *) (mem_keep_depth () + 1));
+}
+
+/* Stops allocating blocks that are meant to last, in this thread.
+ *  input:
+ *    none.
+ *  output:
+ *    none.
+ */
+void
+mem_keep_end ()
+{
+  if (!mem_enabled)
+    return;
+
+  pthread_setspecific (mem_keep_key, (void *) (mem_keep_depth () - 1));
+}
+
+/* Marks a block as meant to last, such as one handed over to a cache.
+ *  input:
+ *    ptr - the block.
+ *  output:
+ *    none.
+ */
+void
+mem_keep (void * ptr)
+{
+  struct mem_block * block;
+
+  if (!mem_enabled || !ptr)
+    return;
+
+  pthread_mutex_lock (&mem_lock);
+
+  block = (mem_buckets) ? mem_buckets[mem_bucket (ptr)] : NULL;
+  for (; block; block = block->next)
+    {
+      if (block->ptr == ptr)
+	{
+	  block->kept = 1;
+	  break;
+	}
+    }
+
+  pthread_mutex_unlock (&mem_lock);
+}
+
+/* Allocates a zeroed array.
+ *  input:
+ *    num - the amount of elements.
+ *    size - the size of each element.
+ *    sys - the subsystem of the allocation.
+ *    file, line - the place of the allocation.
+ *  output:
+ *    the array, or NULL on error.
+ */
+void *
+mem_calloc (size_t num, size_t size, int sys, const char * file, int line)
+{
+  void * ptr = calloc (num, size);
+
+  if (mem_enabled)
+    mem_track (ptr, num * size, sys, file, line);
+  return ptr;
+}
+
+/* Allocates a block.
+ *  input:
+ *    size - the size of the block.
+ *    sys - the subsystem of the allocation.
+ *    file, line - the place of the allocation.
+ *  output:
+ *    the block, or NULL on error.
+ */
+void *
+mem_malloc (size_t size, int sys, const char * file, int line)
+{
+  void * ptr = malloc (size);
+
+  if (mem_enabled)
+    mem_track (ptr, size, sys, file, line);
+  return ptr;
+}
+
+/* Resizes a block.
+ *  input:
+ *    ptr - the block, or NULL.
+ *    size - the new size of the block.
+ *    sys - the subsystem of the allocation.
+ *    file, line - the place of the allocation.
+ *  output:
+ *    the resized block, or NULL on error, in which case ptr is kept.
+ */
+void *
+mem_realloc (void * ptr, size_t size, int sys, const char * file, int line)
+{
+  struct mem_block * block;
+  void * new_ptr;
+
+  if (!mem_enabled)
+    return realloc (ptr, size);
+
+  if (!ptr)
+    return mem_malloc (size, sys, file, line);
+
+  // The table is locked across the resize, so that no other thread
+  // can be given the old address before its block is moved.
+
+  pthread_mutex_lock (&mem_lock);
+
+  block = mem_remove (ptr);
+  new_ptr = realloc (ptr, size);
+  if (!new_ptr && size > 0)
+    {
+      if (block && mem_insert (block) == -1)
+	free (block);
+      pthread_mutex_unlock (&mem_lock);
+      return NULL;
+    }
+
+  if (block)
+    {
+      block->ptr = new_ptr;
+      block->size = size;
+      if (!new_ptr || mem_insert (block) == -1)
+	{
+	  mem_counts[block->sys].frees++;
+	  free (block);
+	}
+    }
+
+  pthread_mutex_unlock (&mem_lock);
+
+  if (!block)
+    mem_track (new_ptr, size, sys, file, line);
+
+  return new_ptr;
+}
+
+/* Copies a string.
+ *  input:
+ *    str - the string.
+ *    sys - the subsystem of the allocation.
+ *    file, line - the place of the allocation.
+ *  output:
+ *    the copy, or NULL on error.
+ */
+char *
+mem_strdup (const char * str, int sys, const char * file, int line)
+{
+  return mem_strndup (str, strlen (str), sys, file, line);
+}
+
+/* Copies at most the first characters of a string.
+ *  input:
+ *    str - the string.
+ *    len - the most characters to copy.
+ *    sys - the subsystem of the allocation.
+ *    file, line - the place of the allocation.
+ *  output:
+ *    the copy, or NULL on error.
+ */
+char *
+mem_strndup (const char * str, size_t len, int sys,
+	     const char * file, int line)
+{
+  const char * end = memchr (str, '\0', len);
+  char * copy;
+
+  if (end)
+    len = end - str;
+
+  copy = (char *) mem_malloc (len + 1, sys, file, line);
+  if (!copy)
+    return NULL;
+
+  memcpy (copy, str, len);
+  copy[len] = '\0';
+  return copy;
+}
+
+/* Frees a block.  Blocks that weren't allocated here, such as those of
+ * the libraries, are freed as they are.
+ *  input:
+ *    ptr - the block, or NULL.
+ *  output:
+ *    none.
+ */
+void
+mem_free (void * ptr)
+{
+  struct mem_block * block;
+
+  if (mem_enabled && ptr)
+    {
+      pthread_mutex_lock (&mem_lock);
+      block = mem_remove (ptr);
+      if (block)
+	mem_counts[block->sys].frees++;
+      pthread_mutex_unlock (&mem_lock);
+
+      free (block);
+    }
+
+  free (ptr);
+}
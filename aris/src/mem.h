@@ -0,0 +1,77 @@
+/* Accounting of allocations.
+
+   Copyright (C) 2012 Ian Dunn.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ARIS_MEM_H
+#define ARIS_MEM_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+// The subsystems that allocations are counted against.
+
+enum MEM_SUBSYSTEMS {
+  MEM_PARSER = 0,  // Reading sentences into formulas.
+  MEM_RULES,       // Checking the rules, and evaluating proofs.
+  MEM_IO,          // Opening, saving, grading and exporting files.
+  MEM_GUI,         // The windows of the interface.
+  MEM_STRUCTS,     // The lists, vectors and tables used by the others.
+  MEM_NUM
+};
+
+void mem_stats_enable ();
+void mem_stats_print (FILE * out);
+void mem_peak_begin ();
+size_t mem_peak_end ();
+unsigned long mem_mark ();
+unsigned long mem_check_live (const char * name, unsigned long mark);
+void mem_keep_begin ();
+void mem_keep_end ();
+void mem_keep (void * ptr);
+
+void * mem_calloc (size_t num, size_t size, int sys,
+		   const char * file, int line);
+void * mem_malloc (size_t size, int sys, const char * file, int line);
+void * mem_realloc (void * ptr, size_t size, int sys,
+		    const char * file, int line);
+char * mem_strdup (const char * str, int sys, const char * file, int line);
+char * mem_strndup (const char * str, size_t len, int sys,
+		    const char * file, int line);
+void mem_free (void * ptr);
+
+// A file that defines MEM_SUBSYSTEM before including this header, after
+// every other header, has its allocations counted against that subsystem.
+
+#ifdef MEM_SUBSYSTEM
+
+#undef calloc
+#undef malloc
+#undef realloc
+#undef strdup
+#undef strndup
+#undef free
+
+#define calloc(n,s) mem_calloc ((n), (s), MEM_SUBSYSTEM, __FILE__, __LINE__)
+#define malloc(s) mem_malloc ((s), MEM_SUBSYSTEM, __FILE__, __LINE__)
+#define realloc(p,s) mem_realloc ((p), (s), MEM_SUBSYSTEM, __FILE__, __LINE__)
+#define strdup(s) mem_strdup ((s), MEM_SUBSYSTEM, __FILE__, __LINE__)
+#define strndup(s,n) mem_strndup ((s), (n), MEM_SUBSYSTEM, __FILE__, __LINE__)
+#define free(p) mem_free (p)
+
+#endif /* MEM_SUBSYSTEM */
+
+#endif /* ARIS_MEM_H */
@@ -41,8 +41,11 @@ enum MENU_ID {
   MENU_COPY,
   MENU_KILL,
   MENU_INSERT,
+  MENU_UNDO,
+  MENU_REDO,
   MENU_EVAL_LINE,
   MENU_EVAL_PROOF,
+  MENU_INFER_RULES,
   MENU_PROOF_SEP_0,
   MENU_GOAL,
   MENU_BOOLEAN,
@@ -0,0 +1,316 @@
+/* Functions for handling the order of the lines of a proof.
+
+   Copyright (C) 2012 Ian Dunn.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "order-tree.h"
+#include "process.h"
+
+#define MEM_SUBSYSTEM MEM_STRUCTS
+#include "mem.h"
+
+/* Main Idea:
+ *  The lines of a proof are numbered by their positions, so inserting or
+ *  removing a line used to renumber every line after it.  Instead, each
+ *  line has a node in a treap ordered by position, where each node knows
+ *  the size of its subtree and its parent.  The position of a line is
+ *  the amount of nodes before it, which is found by walking up from its
+ *  node, and the line at a position is found by walking down from the
+ *  root.  Inserting or removing a line only changes the nodes on one
+ *  path, so each of these takes O(log n).
+ */
+
+#define ORDER_SIZE(n) ((n) ? (n)->size : 0)
+
+/* Initializes an order tree.
+ *  input:
+ *    none.
+ *  output:
+ *    the new, empty order tree, or NULL on error.
+ */
+order_tree_t *
+order_tree_init ()
+{
+  order_tree_t * tree;
+
+  tree = (order_tree_t *) calloc (1, sizeof (order_tree_t));
+  CHECK_ALLOC (tree, NULL);
+
+  tree->root = NULL;
+  tree->count = 0;
+
+  return tree;
+}
+
+/* Destroys the nodes of a subtree.
+ *  input:
+ *    node - the root of the subtree.
+ *  output:
+ *    none.
+ */
+static void
+order_node_destroy (order_node_t * node)
+{
+  if (!node)
+    return;
+
+  order_node_destroy (node->left);
+  order_node_destroy (node->right);
+  free (node);
+}
+
+/* Destroys an order tree.  The objects in it are left alone.
+ *  input:
+ *    tree - the order tree to destroy.
+ *  output:
+ *    none.
+ */
+void
+order_tree_destroy (order_tree_t * tree)
+{
+  order_node_destroy (tree->root);
+  free (tree);
+}
+
+/* Gets the amount of nodes in an order tree.
+ *  input:
+ *    tree - the order tree.
+ *  output:
+ *    the amount of nodes.
+ */
+int
+order_tree_size (order_tree_t * tree)
+{
+  return ORDER_SIZE (tree->root);
+}
+
+/* Gets the priority of a new node, so that the treap stays balanced
+ * whatever order the nodes are inserted in.
+ *  input:
+ *    tree - the order tree the node is being made for.
+ *  output:
+ *    the priority.
+ */
+static unsigned int
+order_priority (order_tree_t * tree)
+{
+  unsigned int h = ++tree->count;
+
+  h ^= h >> 16;
+  h *= 0x7feb352du;
+  h ^= h >> 15;
+  h *= 0x846ca68bu;
+  h ^= h >> 16;
+
+  return h;
+}
+
+/* Updates the size of a node from its children.
+ *  input:
+ *    node - the node to update.
+ *  output:
+ *    none.
+ */
+static void
+order_update (order_node_t * node)
+{
+  node->size = ORDER_SIZE (node->left) + ORDER_SIZE (node->right) + 1;
+}
+
+/* Splits a subtree into the nodes before a position and the rest.
+ *  input:
+ *    node - the root of the subtree.
+ *    pos - the position to split at.
+ *    left - receives the nodes before pos.
+ *    right - receives the rest.
+ *  output:
+ *    none.
+ */
+static void
+order_split (order_node_t * node, int pos,
+	     order_node_t ** left, order_node_t ** right)
+{
+  if (!node)
+    {
+      *left = *right = NULL;
+      return;
+    }
+
+  node->parent = NULL;
+
+  if (ORDER_SIZE (node->left) < pos)
+    {
+      order_split (node->right, pos - ORDER_SIZE (node->left) - 1,
+		   &node->right, right);
+      if (node->right)
+	node->right->parent = node;
+      *left = node;
+    }
+  else
+    {
+      order_split (node->left, pos, left, &node->left);
+      if (node->left)
+	node->left->parent = node;
+      *right = node;
+    }
+
+  order_update (node);
+}
+
+/* Joins two subtrees, all of the nodes of the first coming first.
+ *  input:
+ *    left - the first subtree.
+ *    right - the second subtree.
+ *  output:
+ *    the root of the joined subtree.
+ */
+static order_node_t *
+order_merge (order_node_t * left, order_node_t * right)
+{
+  if (!left)
+    return right;
+  if (!right)
+    return left;
+
+  if (left->priority > right->priority)
+    {
+      left->right = order_merge (left->right, right);
+      left->right->parent = left;
+      order_update (left);
+      return left;
+    }
+
+  right->left = order_merge (left, right->left);
+  right->left->parent = right;
+  order_update (right);
+  return right;
+}
+
+/* Inserts an object into an order tree.
+ *  input:
+ *    tree - the order tree to insert into.
+ *    after - the node after which to insert, or NULL to insert first.
+ *    value - the object to insert.
+ *  output:
+ *    the node of the object, or NULL on error.
+ */
+order_node_t *
+order_tree_insert (order_tree_t * tree, order_node_t * after, void * value)
+{
+  order_node_t * node, * left, * right;
+  int pos;
+
+  node = (order_node_t *) calloc (1, sizeof (order_node_t));
+  CHECK_ALLOC (node, NULL);
+
+  node->parent = node->left = node->right = NULL;
+  node->size = 1;
+  node->priority = order_priority (tree);
+  node->value = value;
+
+  pos = (after) ? order_node_pos (after) + 1 : 0;
+
+  order_split (tree->root, pos, &left, &right);
+  tree->root = order_merge (order_merge (left, node), right);
+  tree->root->parent = NULL;
+
+  return node;
+}
+
+/* Removes a node from an order tree, and frees it.
+ *  input:
+ *    tree - the order tree to remove from.
+ *    node - the node to remove.
+ *  output:
+ *    none.
+ */
+void
+order_tree_remove (order_tree_t * tree, order_node_t * node)
+{
+  order_node_t * left, * mid, * right;
+  int pos;
+
+  pos = order_node_pos (node);
+
+  order_split (tree->root, pos, &left, &right);
+  order_split (right, 1, &mid, &right);
+  tree->root = order_merge (left, right);
+  if (tree->root)
+    tree->root->parent = NULL;
+
+  free (mid);
+}
+
+/* Gets the node at a position of an order tree.
+ *  input:
+ *    tree - the order tree.
+ *    pos - the position, starting from 0.
+ *  output:
+ *    the node at pos, or NULL if there isn't one.
+ */
+order_node_t *
+order_tree_nth (order_tree_t * tree, int pos)
+{
+  order_node_t * node = tree->root;
+
+  if (pos < 0)
+    return NULL;
+
+  while (node)
+    {
+      int left_size = ORDER_SIZE (node->left);
+
+      if (pos < left_size)
+	{
+	  node = node->left;
+	}
+      else if (pos == left_size)
+	{
+	  break;
+	}
+      else
+	{
+	  pos -= left_size + 1;
+	  node = node->right;
+	}
+    }
+
+  return node;
+}
+
+/* Gets the position of a node in its order tree.
+ *  input:
+ *    node - the node.
+ *  output:
+ *    the position of node, starting from 0.
+ */
+int
+order_node_pos (order_node_t * node)
+{
+  int pos;
+
+  pos = ORDER_SIZE (node->left);
+  for (; node->parent; node = node->parent)
+    {
+      if (node == node->parent->right)
+	pos += ORDER_SIZE (node->parent->left) + 1;
+    }
+
+  return pos;
+}
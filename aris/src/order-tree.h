@@ -0,0 +1,53 @@
+/* The order of the lines of a proof.
+
+   Copyright (C) 2012 Ian Dunn.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ARIS_ORDER_TREE_H
+#define ARIS_ORDER_TREE_H
+
+typedef struct order_node order_node_t;
+typedef struct order_tree order_tree_t;
+
+// A node of an order tree.  Its position is found from its parents.
+
+struct order_node {
+  order_node_t * parent;   // The parent of this node, or NULL for the root.
+  order_node_t * left;     // The nodes that come before this one.
+  order_node_t * right;    // The nodes that come after this one.
+  int size;                // The amount of nodes in this subtree.
+  unsigned int priority;   // The priority of the node in the treap.
+  void * value;            // The object at this position.
+};
+
+// A sequence that finds the position of an object, or the object at a
+// position, in O(log n).
+
+struct order_tree {
+  order_node_t * root;   // The root of the treap.
+  unsigned int count;    // The amount of nodes that have been made.
+};
+
+order_tree_t * order_tree_init ();
+void order_tree_destroy (order_tree_t * tree);
+int order_tree_size (order_tree_t * tree);
+order_node_t * order_tree_insert (order_tree_t * tree, order_node_t * after,
+				  void * value);
+void order_tree_remove (order_tree_t * tree, order_node_t * node);
+order_node_t * order_tree_nth (order_tree_t * tree, int pos);
+int order_node_pos (order_node_t * node);
+
+#endif /* ARIS_ORDER_TREE_H */
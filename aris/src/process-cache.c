@@ -0,0 +1,985 @@
+/* Functions for caching the results of the rules.
+
+   Copyright (C) 2012 Ian Dunn.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#ifndef WIN32
+#include <sys/mman.h>
+#endif
+
+#include "process-cache.h"
+#include "process.h"
+#include "hash.h"
+#include "vec.h"
+#include "var.h"
+#include "interop-isar.h"
+
+#define MEM_SUBSYSTEM MEM_RULES
+#include "mem.h"
+
+// A cached result.  The entries form a list from the most recently used
+// to the least recently used.
+
+struct cache_entry {
+  unsigned char * key;        // The key of the result, owned by the table.
+  char * result;              // The result of the rule.
+  struct cache_entry * prev;  // The more recently used entry.
+  struct cache_entry * next;  // The less recently used entry.
+};
+
+// The header of a cache file.  The header is followed by the records,
+// sorted by their digests, and then by the results of the records,
+// each ending with a null character.  Numbers are stored in the byte
+// order of the host, so that the file can be used as it is mapped.
+
+struct cache_file_header {
+  char magic[8];         // CACHE_FILE_MAGIC.
+  uint32_t version;      // The version of the rules that made the file.
+  uint32_t num_records;  // The amount of records.
+  uint32_t text_len;     // The length of the results.
+  uint32_t byte_order;   // CACHE_FILE_ORDER, as written by the host.
+};
+
+// A result in a cache file.
+
+struct cache_file_record {
+  uint64_t hi, lo;  // The digest of the key of the result.
+  uint32_t text;    // The offset of the result from the first result.
+  uint32_t pad;
+};
+
+// A result that is written to the cache file once it is closed.
+
+struct cache_file_result {
+  uint64_t hi, lo;       // The digest of the key of the result.
+  const char * result;   // The result.
+};
+
+#define CACHE_FILE_MAGIC "ARISRC01"
+#define CACHE_FILE_ORDER 0x01020304u
+
+// The rules whose references may be given in any order.
+
+static const char * cache_unordered[] = { "cn", NULL };
+
+// The rules whose results depend on the known variables.
+
+static const char * cache_var_rules[] = { "ug", "ei", "sq", NULL };
+
+// The cache, shared by every thread.
+
+static hash_t * cache_table = NULL;
+static struct cache_entry * cache_head = NULL;
+static struct cache_entry * cache_tail = NULL;
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// The cache file, if one is open.
+
+static char * file_name = NULL;                   // The name of the file.
+static unsigned char * file_data = NULL;          // The contents of the file.
+static size_t file_len = 0;                       // The length of the file.
+static int file_mapped = 0;                       // Whether it is mapped.
+static struct cache_file_record * file_records;   // The records of the file.
+static uint32_t file_num_records = 0;             // The amount of records.
+static const char * file_text;                    // The results of the file.
+static vec_t * file_added = NULL;                 // The results to add.
+
+/* Determines whether or not a rule is in a list of rules.
+ *  input:
+ *    rule - the rule.
+ *    rules - the list of rules, ending with NULL.
+ *  output:
+ *    1 if the rule is in the list, 0 otherwise.
+ */
+static int
+cache_has_rule (const char * rule, const char ** rules)
+{
+  int i;
+
+  for (i = 0; rules[i]; i++)
+    if (!strcmp (rule, rules[i]))
+      return 1;
+
+  return 0;
+}
+
+/* Compares two strings through pointers to them, for qsort.
+ *  input:
+ *    a, b - the pointers to the strings.
+ *  output:
+ *    the comparison of the strings.
+ */
+static int
+cache_cmp_str (const void * a, const void * b)
+{
+  return strcmp (*(const char **) a, *(const char **) b);
+}
+
+/* Compares two variables through pointers to them, for qsort.
+ *  input:
+ *    a, b - the pointers to the variables.
+ *  output:
+ *    the comparison of the texts of the variables.
+ */
+static int
+cache_cmp_var (const void * a, const void * b)
+{
+  const variable * var_a = *(const variable **) a;
+  const variable * var_b = *(const variable **) b;
+
+  return strcmp ((const char *) var_a->text, (const char *) var_b->text);
+}
+
+/* Builds the key of a check of a rule.  The key holds everything that the
+ * result of the rule depends on: the rule, the conclusion, the references,
+ * the known variables for the rules that use them, and the lemma.
+ *  input:
+ *    conc - the sexpr of the conclusion.
+ *    prems - the sexprs of the references.
+ *    rule - the rule.
+ *    vars - the known variables.
+ *    lemma - the digest of the lemma file from process_cache_lemma, or NULL.
+ *  output:
+ *    the key, or NULL on memory error.
+ */
+char *
+process_cache_key (unsigned char * conc, vec_t * prems, const char * rule,
+		   var_set_t * vars, const char * lemma)
+{
+  unsigned char ** refs;
+  vec_t * var_vec;
+  char * key;
+  int i, key_len, key_pos, ret;
+
+  refs = (unsigned char **) calloc (prems->num_stuff + 1,
+				    sizeof (unsigned char *));
+  CHECK_ALLOC (refs, NULL);
+
+  key_len = strlen (rule) + strlen ((const char *) conc) + 4;
+  if (lemma)
+    key_len += strlen (lemma);
+
+  for (i = 0; i < prems->num_stuff; i++)
+    {
+      refs[i] = vec_str_nth (prems, i);
+      key_len += strlen ((const char *) refs[i]) + 1;
+    }
+
+  if (cache_has_rule (rule, cache_unordered))
+    qsort (refs, prems->num_stuff, sizeof (unsigned char *), cache_cmp_str);
+
+  var_vec = init_vec (sizeof (variable *));
+  if (!var_vec)
+    return NULL;
+
+  if (cache_has_rule (rule, cache_var_rules))
+    {
+      ret = var_set_list (vars, var_vec);
+      if (ret == -1)
+	return NULL;
+
+      qsort (var_vec->stuff, var_vec->num_stuff, sizeof (variable *),
+	     cache_cmp_var);
+
+      for (i = 0; i < var_vec->num_stuff; i++)
+	{
+	  variable * var = *((variable **) vec_nth (var_vec, i));
+	  key_len += strlen ((const char *) var->text) + 2;
+	}
+    }
+
+  key = (char *) calloc (key_len + 1, sizeof (char));
+  CHECK_ALLOC (key, NULL);
+
+  // The parts are separated by lines, which sexprs don't contain.
+
+  key_pos = sprintf (key, "%s\n%s\n", rule, conc);
+
+  for (i = 0; i < prems->num_stuff; i++)
+    key_pos += sprintf (key + key_pos, "%s\n", refs[i]);
+
+  key[key_pos++] = '\n';
+
+  for (i = 0; i < var_vec->num_stuff; i++)
+    {
+      variable * var = *((variable **) vec_nth (var_vec, i));
+      key_pos += sprintf (key + key_pos, "%s%s ",
+			  var->arbitrary ? "*" : "", var->text);
+    }
+
+  key_pos += sprintf (key + key_pos, "\n%s", lemma ? lemma : "");
+
+  free (refs);
+  destroy_vec (var_vec);
+
+  return key;
+}
+
+/* Removes an entry from the list of entries.
+ *  input:
+ *    entry - the entry to remove.
+ *  output:
+ *    none.
+ */
+static void
+cache_unlink (struct cache_entry * entry)
+{
+  if (entry->prev)
+    entry->prev->next = entry->next;
+  else
+    cache_head = entry->next;
+
+  if (entry->next)
+    entry->next->prev = entry->prev;
+  else
+    cache_tail = entry->prev;
+
+  entry->prev = entry->next = NULL;
+}
+
+/* Adds an entry to the front of the list of entries.
+ *  input:
+ *    entry - the entry to add.
+ *  output:
+ *    none.
+ */
+static void
+cache_push (struct cache_entry * entry)
+{
+  entry->prev = NULL;
+  entry->next = cache_head;
+
+  if (cache_head)
+    cache_head->prev = entry;
+  else
+    cache_tail = entry;
+
+  cache_head = entry;
+}
+
+/* Hashes data with the 64 bit FNV-1a algorithm.
+ *  input:
+ *    data - the data to hash.
+ *    len - the length of the data.
+ *    step - 1 to hash the data forward, or -1 to hash it backward.
+ *    hash - the hash to start from.
+ *  output:
+ *    the hash of the data.
+ */
+static uint64_t
+cache_fnv (const unsigned char * data, size_t len, int step, uint64_t hash)
+{
+  size_t i;
+
+  for (i = 0; i < len; i++)
+    {
+      hash ^= data[(step > 0) ? i : len - i - 1];
+      hash *= 1099511628211ull;
+    }
+
+  return hash;
+}
+
+/* Gets the digest of a key, by which results are stored in a cache file.
+ *  input:
+ *    key - the key, from process_cache_key.
+ *    hi, lo - receive the halves of the digest.
+ *  output:
+ *    none.
+ */
+static void
+cache_digest (const char * key, uint64_t * hi, uint64_t * lo)
+{
+  size_t len = strlen (key);
+
+  *hi = cache_fnv ((const unsigned char *) key, len, 1,
+		   14695981039346656037ull);
+  *lo = cache_fnv ((const unsigned char *) key, len, -1,
+		   7809847782465536322ull);
+}
+
+/* Gets the version of the rules, which a cache file must have been made
+ * with.  This covers the language of the results, as well.
+ *  input:
+ *    none.
+ *  output:
+ *    the version.
+ */
+static uint32_t
+cache_version ()
+{
+  uint64_t hash;
+
+  hash = cache_fnv ((const unsigned char *) VERSION, strlen (VERSION), 1,
+		    14695981039346656037ull);
+  hash = cache_fnv ((const unsigned char *) CORRECT, strlen (CORRECT), 1,
+		    hash);
+
+  return (uint32_t) (hash ^ (hash >> 32));
+}
+
+/* Compares two records by their digests, for qsort and bsearch.
+ *  input:
+ *    a, b - the records.
+ *  output:
+ *    the comparison of the digests.
+ */
+static int
+cache_cmp_record (const void * a, const void * b)
+{
+  const struct cache_file_record * rec_a = a, * rec_b = b;
+
+  if (rec_a->hi != rec_b->hi)
+    return (rec_a->hi < rec_b->hi) ? -1 : 1;
+
+  if (rec_a->lo != rec_b->lo)
+    return (rec_a->lo < rec_b->lo) ? -1 : 1;
+
+  return 0;
+}
+
+/* Finds a result in the cache file.  The cache must be locked.
+ *  input:
+ *    key - the key of the check.
+ *  output:
+ *    the result, or NULL if it isn't in the file.
+ */
+static char *
+cache_file_find (const char * key)
+{
+  struct cache_file_record rec, * found;
+
+  if (file_num_records == 0)
+    return NULL;
+
+  cache_digest (key, &rec.hi, &rec.lo);
+
+  found = bsearch (&rec, file_records, file_num_records,
+		   sizeof (struct cache_file_record), cache_cmp_record);
+  if (!found)
+    return NULL;
+
+  // Correct results are given as the same string as the rules give.
+  if (!strcmp (file_text + found->text, CORRECT))
+    return CORRECT;
+
+  return (char *) file_text + found->text;
+}
+
+/* Adds a result to the cache.  The cache must be locked.
+ *  input:
+ *    key - the key of the check.
+ *    result - the result of the rule.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+static int
+cache_insert (const char * key, char * result)
+{
+  hash_entry_t * ent;
+  struct cache_entry * entry;
+
+  if (!cache_table)
+    {
+      cache_table = init_hash (PROCESS_CACHE_SIZE);
+      if (!cache_table)
+	return -1;
+    }
+
+  // Another thread may have cached the same check.
+  if (hash_find (cache_table, (const unsigned char *) key))
+    return 0;
+
+  if (cache_table->num_stuff >= PROCESS_CACHE_SIZE)
+    {
+      entry = cache_tail;
+      cache_unlink (entry);
+      hash_rem_obj (cache_table, entry->key, entry);
+    }
+  else
+    {
+      entry = (struct cache_entry *) calloc (1, sizeof (struct cache_entry));
+      CHECK_ALLOC (entry, -1);
+    }
+
+  ent = hash_add_obj (cache_table, (const unsigned char *) key, entry);
+  if (!ent)
+    {
+      free (entry);
+      return -1;
+    }
+
+  entry->key = ent->key;
+  entry->result = result;
+  cache_push (entry);
+
+  return 0;
+}
+
+/* Finds the cached result of a check, marking it as recently used.
+ * Results that aren't in memory are looked for in the cache file.
+ *  input:
+ *    key - the key of the check, from process_cache_key.
+ *  output:
+ *    the result of the rule, or NULL if it isn't cached.
+ */
+char *
+process_cache_find (const char * key)
+{
+  hash_entry_t * ent;
+  struct cache_entry * entry;
+  char * result = NULL;
+
+  pthread_mutex_lock (&cache_lock);
+
+  ent = cache_table ? hash_find (cache_table, (const unsigned char *) key)
+    : NULL;
+  if (ent)
+    {
+      entry = ent->value;
+      cache_unlink (entry);
+      cache_push (entry);
+      result = entry->result;
+    }
+  else
+    {
+      result = cache_file_find (key);
+
+      mem_keep_begin ();
+      if (result && cache_insert (key, result) == -1)
+	result = NULL;
+      mem_keep_end ();
+    }
+
+  pthread_mutex_unlock (&cache_lock);
+
+  return result;
+}
+
+/* Caches the result of a check, forgetting the least recently used
+ * result once the cache is full.  If a cache file is open, the result
+ * is added to it once it is closed.
+ *  input:
+ *    key - the key of the check, from process_cache_key.
+ *    result - the result of the rule, which must not be freed.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+int
+process_cache_add (const char * key, char * result)
+{
+  struct cache_file_result res;
+  int ret;
+
+  pthread_mutex_lock (&cache_lock);
+  mem_keep_begin ();
+
+  ret = cache_insert (key, result);
+  if (ret == 0)
+    mem_keep (result);
+
+  if (ret == 0 && file_added)
+    {
+      cache_digest (key, &res.hi, &res.lo);
+      res.result = result;
+
+      if (vec_add_obj (file_added, &res) < 0)
+	ret = -1;
+    }
+
+  mem_keep_end ();
+  pthread_mutex_unlock (&cache_lock);
+
+  return ret;
+}
+
+/* Forgets every cached result.  The cache must be locked.
+ *  input:
+ *    none.
+ *  output:
+ *    none.
+ */
+static void
+cache_forget ()
+{
+  struct cache_entry * entry, * next;
+
+  for (entry = cache_head; entry; entry = next)
+    {
+      next = entry->next;
+      free (entry);
+    }
+
+  cache_head = cache_tail = NULL;
+
+  if (cache_table)
+    {
+      destroy_hash (cache_table);
+      cache_table = NULL;
+    }
+}
+
+/* Forgets every cached result that is kept in memory.
+ *  input:
+ *    none.
+ *  output:
+ *    none.
+ */
+void
+process_cache_clear ()
+{
+  pthread_mutex_lock (&cache_lock);
+  cache_forget ();
+  pthread_mutex_unlock (&cache_lock);
+}
+
+/* Adds the contents of a file to a digest.
+ *  input:
+ *    file - the name of the file.
+ *    hash - the digest so far.
+ *  output:
+ *    0 on success, -1 if the file can't be read.
+ */
+static int
+cache_digest_file (const char * file, uint64_t * hash)
+{
+  FILE * in;
+  unsigned char buf[4096];
+  size_t len;
+
+  in = fopen (file, "rb");
+  if (!in)
+    return -1;
+
+  while ((len = fread (buf, 1, sizeof (buf), in)) > 0)
+    *hash = cache_fnv (buf, len, 1, *hash);
+
+  fclose (in);
+  return 0;
+}
+
+/* Gets the digest of the contents of a lemma file, so that the results
+ * of a lemma are forgotten once its file is changed.  The digest of a
+ * theory covers the theories that it imports as well.
+ *  input:
+ *    file - the name of the lemma file.
+ *  output:
+ *    the digest, or NULL if the file can't be read.
+ */
+char *
+process_cache_lemma (const char * file)
+{
+  uint64_t hash = 14695981039346656037ull;
+  vec_t * files;
+  char * digest;
+  int f_len, i, ret;
+
+  f_len = strlen (file);
+  if (f_len > 4 && !strcmp (file + f_len - 4, ".thy"))
+    {
+      files = init_vec (sizeof (char *));
+      if (!files)
+	return NULL;
+
+      ret = isar_theory_files (file, files);
+      for (i = 0; ret == 0 && i < files->num_stuff; i++)
+	ret = cache_digest_file ((char *) vec_str_nth (files, i), &hash);
+
+      destroy_str_vec (files);
+    }
+  else
+    {
+      ret = cache_digest_file (file, &hash);
+    }
+
+  if (ret == -1)
+    return NULL;
+
+  digest = (char *) calloc (17, sizeof (char));
+  CHECK_ALLOC (digest, NULL);
+
+  sprintf (digest, "%016llx", (unsigned long long) hash);
+  return digest;
+}
+
+/* Loads the contents of a cache file, mapping it where possible.
+ *  input:
+ *    fd - the opened file.
+ *    len - the length of the file.
+ *  output:
+ *    0 on success, -1 on error.
+ */
+static int
+cache_file_load (int fd, size_t len)
+{
+  size_t pos = 0;
+  ssize_t got;
+
+#ifndef WIN32
+  file_data = mmap (NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (file_data != MAP_FAILED)
+    {
+      file_mapped = 1;
+      file_len = len;
+      return 0;
+    }
+#endif
+
+  // Without mmap, the file is read into memory.
+
+  file_data = (unsigned char *) calloc (len, sizeof (char));
+  CHECK_ALLOC (file_data, -1);
+
+  while (pos < len)
+    {
+      got = read (fd, file_data + pos, len - pos);
+      if (got <= 0)
+	{
+	  free (file_data);
+	  file_data = NULL;
+	  return -1;
+	}
+      pos += got;
+    }
+
+  file_mapped = 0;
+  file_len = len;
+  return 0;
+}
+
+/* Checks the contents of the cache file, and finds its records.  Files
+ * that are damaged, or that were made by another version, are ignored.
+ *  input:
+ *    none.
+ *  output:
+ *    none.
+ */
+static void
+cache_file_check ()
+{
+  struct cache_file_header * head;
+  size_t rec_len;
+  uint32_t i;
+
+  file_num_records = 0;
+
+  if (file_len < sizeof (struct cache_file_header))
+    return;
+
+  head = (struct cache_file_header *) file_data;
+
+  if (memcmp (head->magic, CACHE_FILE_MAGIC, 8)
+      || head->byte_order != CACHE_FILE_ORDER
+      || head->version != cache_version ())
+    return;
+
+  rec_len = (size_t) head->num_records * sizeof (struct cache_file_record);
+  if (sizeof (struct cache_file_header) + rec_len + head->text_len != file_len)
+    return;
+
+  file_records = (struct cache_file_record *)
+    (file_data + sizeof (struct cache_file_header));
+  file_text = (const char *) file_data + sizeof (struct cache_file_header)
+    + rec_len;
+
+  // Every result must end within the file.
+  if (head->num_records > 0
+      && (head->text_len == 0 || file_text[head->text_len - 1] != '\0'))
+    return;
+
+  for (i = 0; i < head->num_records; i++)
+    if (file_records[i].text >= head->text_len)
+      return;
+
+  file_num_records = head->num_records;
+}
+
+/* Opens a cache file, in which results are looked for, and to which new
+ * results are written once it is closed.  The file need not exist.
+ *  input:
+ *    file - the name of the cache file.
+ *  output:
+ *    0 on success, -1 on error.
+ */
+int
+process_cache_open (const char * file)
+{
+  struct stat st;
+  int fd, ret = 0;
+
+  pthread_mutex_lock (&cache_lock);
+
+  file_name = strdup (file);
+  file_added = init_vec (sizeof (struct cache_file_result));
+
+  if (!file_name || !file_added)
+    {
+      perror (NULL);
+      ret = -1;
+    }
+
+  fd = (ret == 0) ? open (file, O_RDONLY) : -1;
+  if (fd != -1)
+    {
+      if (fstat (fd, &st) == -1
+	  || (st.st_size > 0 && cache_file_load (fd, st.st_size) == -1))
+	{
+	  perror (file);
+	  ret = -1;
+	}
+      else
+	{
+	  cache_file_check ();
+	}
+
+      close (fd);
+    }
+
+  pthread_mutex_unlock (&cache_lock);
+  return ret;
+}
+
+/* Compares two results by their digests, for qsort.
+ *  input:
+ *    a, b - the results.
+ *  output:
+ *    the comparison of the digests.
+ */
+static int
+cache_cmp_result (const void * a, const void * b)
+{
+  const struct cache_file_result * res_a = a, * res_b = b;
+
+  if (res_a->hi != res_b->hi)
+    return (res_a->hi < res_b->hi) ? -1 : 1;
+
+  if (res_a->lo != res_b->lo)
+    return (res_a->lo < res_b->lo) ? -1 : 1;
+
+  return 0;
+}
+
+/* Writes the records of a cache file.
+ *  input:
+ *    out - the file to write to.
+ *    all - the results to write, sorted by their digests.
+ *    num_all - the amount of results.
+ *    texts - receives the offsets of the results.
+ *  output:
+ *    0 on success, -1 on error.
+ */
+static int
+cache_file_put (FILE * out, struct cache_file_result * all, uint32_t num_all,
+		hash_t * texts)
+{
+  struct cache_file_header head;
+  struct cache_file_record rec;
+  hash_entry_t * ent;
+  uint32_t i, text_len;
+
+  // Results that are the same are only written once.
+
+  text_len = 0;
+  for (i = 0; i < num_all; i++)
+    {
+      if (hash_find (texts, (const unsigned char *) all[i].result))
+	continue;
+
+      ent = hash_add_obj (texts, (const unsigned char *) all[i].result,
+			  (void *) (uintptr_t) text_len);
+      if (!ent)
+	return -1;
+
+      text_len += strlen (all[i].result) + 1;
+    }
+
+  memset (&head, 0, sizeof (head));
+  memcpy (head.magic, CACHE_FILE_MAGIC, 8);
+  head.version = cache_version ();
+  head.num_records = num_all;
+  head.text_len = text_len;
+  head.byte_order = CACHE_FILE_ORDER;
+
+  if (fwrite (&head, sizeof (head), 1, out) != 1)
+    return -1;
+
+  for (i = 0; i < num_all; i++)
+    {
+      ent = hash_find (texts, (const unsigned char *) all[i].result);
+
+      memset (&rec, 0, sizeof (rec));
+      rec.hi = all[i].hi;
+      rec.lo = all[i].lo;
+      rec.text = (uint32_t) (uintptr_t) ent->value;
+
+      if (fwrite (&rec, sizeof (rec), 1, out) != 1)
+	return -1;
+    }
+
+  // The results are written in the order that they were given offsets.
+
+  text_len = 0;
+  for (i = 0; i < num_all; i++)
+    {
+      ent = hash_find (texts, (const unsigned char *) all[i].result);
+      if ((uint32_t) (uintptr_t) ent->value != text_len)
+	continue;
+
+      if (fwrite (all[i].result, strlen (all[i].result) + 1, 1, out) != 1)
+	return -1;
+
+      text_len += strlen (all[i].result) + 1;
+    }
+
+  return 0;
+}
+
+/* Writes the results of the cache file, along with the new results.  The
+ * file is replaced at once, so that it is never left half written.
+ *  input:
+ *    none.
+ *  output:
+ *    0 on success, -1 on error.
+ */
+static int
+cache_file_write ()
+{
+  struct cache_file_result * all;
+  FILE * out;
+  hash_t * texts;
+  char * tmp_name;
+  uint32_t i, num_all, num_unique;
+  int ret;
+
+  num_all = file_num_records + file_added->num_stuff;
+  all = (struct cache_file_result *) calloc (num_all + 1,
+					     sizeof (struct cache_file_result));
+  CHECK_ALLOC (all, -1);
+
+  for (i = 0; i < file_num_records; i++)
+    {
+      all[i].hi = file_records[i].hi;
+      all[i].lo = file_records[i].lo;
+      all[i].result = file_text + file_records[i].text;
+    }
+
+  for (i = 0; i < file_added->num_stuff; i++)
+    all[file_num_records + i] = *((struct cache_file_result *)
+				  vec_nth (file_added, i));
+
+  qsort (all, num_all, sizeof (struct cache_file_result), cache_cmp_result);
+
+  num_unique = 0;
+  for (i = 0; i < num_all; i++)
+    if (num_unique == 0 || cache_cmp_result (&all[num_unique - 1], &all[i]))
+      all[num_unique++] = all[i];
+
+  tmp_name = (char *) calloc (strlen (file_name) + 5, sizeof (char));
+  CHECK_ALLOC (tmp_name, -1);
+  sprintf (tmp_name, "%s.tmp", file_name);
+
+  out = fopen (tmp_name, "wb");
+  if (!out)
+    {
+      perror (tmp_name);
+      free (tmp_name);
+      free (all);
+      return -1;
+    }
+
+  texts = init_hash (64);
+  ret = texts ? cache_file_put (out, all, num_unique, texts) : -1;
+  if (texts)
+    destroy_hash (texts);
+
+  if (fclose (out) != 0)
+    ret = -1;
+
+  if (ret == 0)
+    {
+#ifdef WIN32
+      remove (file_name);
+#endif
+      if (rename (tmp_name, file_name) != 0)
+	ret = -1;
+    }
+
+  if (ret == -1)
+    {
+      perror (file_name);
+      remove (tmp_name);
+    }
+
+  free (tmp_name);
+  free (all);
+
+  return ret;
+}
+
+/* Closes the cache file, writing the new results to it.  Every cached
+ * result is forgotten, since some may have come from the file.
+ *  input:
+ *    none.
+ *  output:
+ *    0 on success, -1 on error.
+ */
+int
+process_cache_close ()
+{
+  int ret = 0;
+
+  pthread_mutex_lock (&cache_lock);
+
+  if (file_added && file_added->num_stuff > 0)
+    ret = cache_file_write ();
+
+  cache_forget ();
+
+  if (file_data)
+    {
+#ifndef WIN32
+      if (file_mapped)
+	munmap (file_data, file_len);
+      else
+#endif
+	free (file_data);
+    }
+
+  file_data = NULL;
+  file_len = 0;
+  file_num_records = 0;
+
+  if (file_added)
+    destroy_vec (file_added);
+  file_added = NULL;
+
+  free (file_name);
+  file_name = NULL;
+
+  pthread_mutex_unlock (&cache_lock);
+  return ret;
+}
@@ -0,0 +1,39 @@
+/* The cache of rule results.
+
+   Copyright (C) 2012 Ian Dunn.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ARIS_PROCESS_CACHE_H
+#define ARIS_PROCESS_CACHE_H
+
+typedef struct vector vec_t;
+typedef struct var_set var_set_t;
+
+// The most results kept by the cache.
+
+#define PROCESS_CACHE_SIZE 4096
+
+char * process_cache_key (unsigned char * conc, vec_t * prems,
+			  const char * rule, var_set_t * vars,
+			  const char * lemma);
+char * process_cache_find (const char * key);
+int process_cache_add (const char * key, char * result);
+void process_cache_clear ();
+char * process_cache_lemma (const char * file);
+int process_cache_open (const char * file);
+int process_cache_close ();
+
+#endif /* ARIS_PROCESS_CACHE_H */
@@ -17,11 +17,25 @@
 */
 
 #include "process.h"
+#include "process-cache.h"
 #include "vec.h"
 
-char *
-process (unsigned char * conc, vec_t * prems, const char * rule, vec_t * vars,
-	 proof_t * proof)
+#define MEM_SUBSYSTEM MEM_RULES
+#include "mem.h"
+
+/* Checks a rule against a conclusion and its references.
+ *  input:
+ *    conc - the sexpr of the conclusion.
+ *    prems - the sexprs of the references.
+ *    rule - the rule to check.
+ *    vars - the known variables.
+ *    proof - the proof of the lemma, or NULL.
+ *  output:
+ *    the result of the rule, or NULL on error.
+ */
+static char *
+process_rule (unsigned char * conc, vec_t * prems, const char * rule,
+	      var_set_t * vars, proof_t * proof)
 {
   unsigned int i;
   int ret;
@@ -86,3 +100,40 @@ process (unsigned char * conc, vec_t * prems, const char * rule, vec_t * vars,
 
   return "Rule not recognized.";
 }
+
+/* Checks a rule against a conclusion and its references, reusing the
+ * result of an identical check if it is cached.
+ *  input:
+ *    conc - the sexpr of the conclusion.
+ *    prems - the sexprs of the references.
+ *    rule - the rule to check.
+ *    vars - the known variables.
+ *    proof - the proof of the lemma, or NULL.
+ *  output:
+ *    the result of the rule, or NULL on error.
+ */
+char *
+process (unsigned char * conc, vec_t * prems, const char * rule, var_set_t * vars,
+	 proof_t * proof)
+{
+  char * key, * ret;
+
+  // The result of a lemma depends on the contents of its file.
+  if (proof)
+    return process_rule (conc, prems, rule, vars, proof);
+
+  key = process_cache_key (conc, prems, rule, vars, NULL);
+  if (!key)
+    return NULL;
+
+  ret = process_cache_find (key);
+  if (!ret)
+    {
+      ret = process_rule (conc, prems, rule, vars, proof);
+      if (ret && process_cache_add (key, ret) == -1)
+	ret = NULL;
+    }
+
+  free (key);
+  return ret;
+}
@@ -26,6 +26,9 @@
 #include <ctype.h>
 #include <math.h>
 
+#define MEM_SUBSYSTEM MEM_PARSER
+#include "mem.h"
+
 /* Eliminates a negation from a string.
  *  input:
  *    not_str - the string from which to eliminate the negation.
@@ -320,60 +323,21 @@ reverse_parse_parens (const unsigned char * in_str, const int init_pos, unsigned
 int
 check_parens (const unsigned char *chk_str)
 {
-  if (chk_str[0] == '\0')
-    return 0;
-
-  //Temporary strings for strstr.
-  unsigned char * o_str, * c_str;
-
-  //Position indicators and helpers.
-  unsigned int o_pos, c_pos, chk_pos;
+  int depth;
 
-  //Gets the string length of chk_str.
-  //Used to determine if o_str or c_str are finished.
-  unsigned int chk_len;
-
-  //Count the amount of parentheses.
-  unsigned int c_paren, o_paren;
-
-  //Initialize the variables.
-  o_pos = 0;
-  c_pos = 0;
-  chk_pos = 0;
-
-  c_paren = 0;
-  o_paren = 0;
-
-  //Set chk_len to the length of chk_str.
-  chk_len = strlen ((const char *) chk_str);
-
-  while (o_str != NULL || c_str != NULL)
+  //Count the depth of the parentheses, which must never drop below zero.
+  depth = 0;
+  for (; *chk_str; chk_str++)
     {
-      //If o_pos is alright, then get o_str.
-      if (o_pos != chk_len)
-	o_str = (unsigned char *) strchr ((const char *) chk_str + chk_pos, '(');
-
-      //If c_pos is alright, then get c_str.
-      if (c_pos != chk_len)
-	c_str = (unsigned char *) strchr ((const char *) chk_str + chk_pos, ')');
-
-      //Set o_pos and c_pos.
-      o_pos = (o_str != NULL) ? o_str - chk_str : chk_len;
-      c_pos = (c_str != NULL) ? c_str - chk_str : chk_len;
-
-      //Increment the apropriate counter.
-      if ( o_pos < c_pos && o_str != NULL)
-	o_paren++;
-      else if (c_str != NULL)
-	c_paren++;
-
-      //Set chk_pos.
-      chk_pos = (o_pos < c_pos) ? (o_pos + 1) : (c_pos + 1);
+      if (*chk_str == '(')
+	depth++;
+      else if (*chk_str == ')' && --depth < 0)
+	return 0;
     }
 
   //If there are an equal amount of opening and closing parentheses,
   //then return true.
-  if (o_paren == c_paren)
+  if (depth == 0)
     return 1;
 
   return 0;
@@ -463,7 +427,7 @@ check_sides_quant (const unsigned char * chk_str, const unsigned int init_pos)
 
   //If this is not at the beginning of the string,
   //then process the connective (if there is one) before it.
-  if (init_pos >= 0)
+  if (init_pos >= CL)
     {
       //Copy enough memory for a connective.
       strncpy (tmp_str, chk_str - CL, CL);
@@ -625,6 +589,8 @@ get_generalities (unsigned char * chk_str, unsigned char * conn, vec_t * vec)
 
       if (strncmp (chk_str + pos, conn, conn_len))
 	{
+	  free (lsen);
+
 	  ret = vec_str_add_obj (vec, chk_str);
 	  if (ret < 0)
 	    return -3;
@@ -675,6 +641,9 @@ get_generalities (unsigned char * chk_str, unsigned char * conn, vec_t * vec)
 	return -3;
     }
 
+  if (rsen)
+    free (rsen);
+
   return (int) vec->num_stuff;
 }
 
@@ -790,7 +759,10 @@ check_generalities (unsigned char * text)
   if (tmp_pos == -1)
     return -1;
 
-  if (!strcmp (tmp_str, text))
+  ret_chk = strcmp (tmp_str, text);
+  free (tmp_str);
+
+  if (!ret_chk)
     {
       // This is the entire scope, so strip away the preceding symbol,
       //  if one exists.
@@ -1464,6 +1436,37 @@ convert_sexpr (unsigned char * in_str)
   return out_str;
 }
 
+/* Checks a string, and converts it to the normalized sexpr form.
+ *  input:
+ *    text - the string to convert.
+ *    sexpr - receives the sexpr form of text, if it has no errors.
+ *  output:
+ *    0 on success, -1 on memory error, or the error code from check_text.
+ */
+int
+text_to_sexpr (unsigned char * text, unsigned char ** sexpr)
+{
+  unsigned char * tmp_str;
+  int ret;
+
+  *sexpr = NULL;
+
+  ret = check_text (text);
+  if (ret != 0)
+    return ret;
+
+  tmp_str = die_spaces_die (text);
+  if (!tmp_str)
+    return -1;
+
+  *sexpr = convert_sexpr (tmp_str);
+  free (tmp_str);
+  if (!*sexpr)
+    return -1;
+
+  return 0;
+}
+
 /* Converts a string from infix to prefix.
  *  input:
  *    in_str - the string to convert.
@@ -1767,6 +1770,7 @@ get_pred_func_args (unsigned char * in_str, int in_pos,
       i++;
     }
 
+  free (elim_str);
   return 0;
 }
 
@@ -186,6 +186,7 @@ typedef struct vector vec_t;
 typedef struct proof proof_t;
 typedef struct sen_data sen_data;
 typedef struct list list_t;
+typedef struct var_set var_set_t;
 
 /* Parse functions. */
 
@@ -242,7 +243,7 @@ int get_generalities (unsigned char * chk_str,
 char * process (unsigned char * conc,
 		vec_t * prems,
 		const char * rule,
-		vec_t * vars,
+		var_set_t * vars,
 		proof_t * proof);
 
 
@@ -257,12 +258,12 @@ char * process_equivalence (unsigned char * conc,
 char * process_quantifiers (unsigned char * conc,
 			    vec_t * prems,
 			    const char * rule,
-			    vec_t * vars);
+			    var_set_t * vars);
 
 char * process_misc (unsigned char * conc,
 		     vec_t * prems,
 		     const char * rule,
-		     vec_t * vars,
+		     var_set_t * vars,
 		     proof_t * proof);
 
 char * process_bool (unsigned char * conc,
@@ -274,6 +275,8 @@ char * process_bool (unsigned char * conc,
 
 unsigned char * convert_sexpr (unsigned char * in_str);
 
+int text_to_sexpr (unsigned char * text, unsigned char ** sexpr);
+
 int get_pred_func_args (unsigned char * in_str, int init_pos,
 			unsigned char ** sym, vec_t * args);
 
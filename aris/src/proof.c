@@ -18,6 +18,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "proof.h"
 #include "sen-data.h"
@@ -27,6 +28,13 @@
 #include "rules.h"
 #include "process.h"
 #include "sexpr-process.h"
+#include "trace.h"
+#include "hash.h"
+#include "subproof.h"
+#include "rule-search.h"
+
+#define MEM_SUBSYSTEM MEM_RULES
+#include "mem.h"
 
 /* Initializes a proof.
  *  input:
@@ -64,59 +72,106 @@ proof_init ()
 void
 proof_destroy (proof_t * proof)
 {
-  item_t * itm, * n_itm;
+  item_t * itm;
+
+  for (itm = proof->everything->head; itm != NULL; itm = itm->next)
+    sen_data_destroy (itm->value);
+  destroy_list (proof->everything);
+
+  for (itm = proof->goals->head; itm != NULL; itm = itm->next)
+    free (itm->value);
+  destroy_list (proof->goals);
+
+  if (proof->index)
+    destroy_hash (proof->index);
+
+  if (proof->subproofs)
+    subproof_tree_destroy (proof->subproofs);
+
+  free (proof);
+}
+
+/* Builds the subproof tree of a proof from the depths of its sentences.
+ *  input:
+ *    proof - the proof to build the tree of.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+static int
+proof_build_subproofs (proof_t * proof)
+{
+  item_t * sen_itr;
+  int ret;
 
-  for (itm = proof->everything->head; itm != NULL; itm = n_itm)
+  if (proof->subproofs)
+    subproof_tree_clear (proof->subproofs);
+  else
     {
-      item_t * n_itm;
-      n_itm = itm->next;
-      free (itm);
+      proof->subproofs = subproof_tree_init ();
+      if (!proof->subproofs)
+	return -1;
     }
 
-  itm = proof->goals->head;
-  for (itm = proof->goals->head; itm != NULL; itm = n_itm)
+  for (sen_itr = proof->everything->head; sen_itr; sen_itr = sen_itr->next)
     {
-      item_t * n_itm;
-      n_itm = itm->next;
-      free (itm->value);
+      sen_data * sd = sen_itr->value;
+
+      ret = subproof_tree_insert (proof->subproofs, sd->line_num, sd->depth,
+				  sd->subproof);
+      if (ret < 0)
+	return -1;
     }
+
+  return 0;
 }
 
-/* Evaluates a proof object.
+/* Converts the sentences of a proof to sexprs, and indexes them along
+ * with its subproofs.
  *  input:
- *    proof - The proof that is being evaluated.
- *    rets - A vector to store the lines that correctly evaluated.
- *    verbose - A flag denoting verbosity.
+ *    proof - the proof to convert the sentences of.
+ *    trace - the trace to record the conversion to, or NULL.
  *  output:
  *    0 on success, -1 on memory error.
  */
-int
-proof_eval (proof_t * proof, vec_t * rets, int verbose)
+static int
+proof_eval_sexprs (proof_t * proof, trace_t * trace)
 {
   item_t * sen_itr;
-  int got_prems, cur_line, num_correct;
-  list_t * pf_vars;
-  vec_t * sexpr_text;
   int ret;
 
-  got_prems = 0;
-  num_correct = cur_line = 0;
-
-  pf_vars = init_list ();
-  if (!pf_vars)
+  ret = proof_build_subproofs (proof);
+  if (ret < 0)
     return -1;
 
-  sexpr_text = init_vec (sizeof (char *));
-  if (!sexpr_text)
-    return -1;
+  if (proof->index)
+    hash_clear (proof->index);
+  else
+    {
+      proof->index = init_hash (proof->everything->num_stuff);
+      if (!proof->index)
+	return -1;
+    }
 
   for (sen_itr = proof->everything->head; sen_itr; sen_itr = sen_itr->next)
     {
       sen_data * sd;
+      double start;
       sd = sen_itr->value;
 
+      // Sentences copied from the GUI may already have been converted.
+      if (sd->sexpr)
+	{
+	  if (!hash_add_obj (proof->index, sd->sexpr, sd))
+	    return -1;
+	  continue;
+	}
+
+      // The text is validated again by sen_data_evaluate, which records
+      // the validate span, so the check here is counted with the sexpr.
+
+      start = trace_start (trace);
       ret = check_text (sd->text);
-      if (ret == -2)
+      if (ret == -1)
 	return -1;
 
       if (ret != 0)
@@ -132,80 +187,428 @@ proof_eval (proof_t * proof, vec_t * rets, int verbose)
 	return -1;
       sd->sexpr = sexpr;
       free (tmp_str);
+
+      if (!hash_add_obj (proof->index, sd->sexpr, sd))
+	return -1;
+
+      if (trace_span (trace, TRACE_SEXPR, sd->line_num, start, NULL) < 0)
+	return -1;
     }
 
+  return 0;
+}
+
+/* Moves the variables of a proof into the scope of a line.  The sets
+ * of the enclosing subproofs are kept in scopes, so that leaving a
+ * subproof restores the set from before it began.
+ *  input:
+ *    scopes - The sets of the subproofs that enclose the previous line,
+ *      from the outermost in.
+ *    vars - The set of the previous line, which receives the set of sd.
+ *    sd - The line whose scope is being entered.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+static int
+proof_eval_scope (vec_t * scopes, var_set_t ** vars, sen_data * sd)
+{
+  int depth;
+
+  // A subproof begins within the scope that encloses it.
+  depth = sd->subproof ? sd->depth - 1 : sd->depth;
+
+  while (scopes->num_stuff > 0 && scopes->num_stuff > depth)
+    {
+      var_set_unref (*vars);
+      *vars = *((var_set_t **) vec_nth (scopes, scopes->num_stuff - 1));
+      scopes->num_stuff--;
+    }
+
+  while (scopes->num_stuff < sd->depth)
+    {
+      var_set_t * saved = var_set_ref (*vars);
+      if (vec_add_obj (scopes, &saved) < 0)
+	return -1;
+    }
+
+  return 0;
+}
+
+/* Collects the variables of a line that has been evaluated.
+ *  input:
+ *    vars - The set of variables, which receives the new set.
+ *    sd - The line.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+static int
+proof_eval_collect (var_set_t ** vars, sen_data * sd)
+{
+  int arb;
+
+  // Lines with text errors have no sexpr, and no variables.
+  if (!sd->sexpr)
+    return 0;
+
+  arb = (sd->premise || sd->rule == RULE_EI || sd->subproof) ? 0 : 1;
+  return sexpr_collect_vars_to_proof (vars, sd->sexpr, arb);
+}
+
+/* Releases the sets of variables used to evaluate a proof.
+ *  input:
+ *    scopes - The sets of the enclosing subproofs.
+ *    vars - The current set.
+ *  output:
+ *    none.
+ */
+static void
+proof_eval_release (vec_t * scopes, var_set_t * vars)
+{
+  int i;
+
+  for (i = 0; i < scopes->num_stuff; i++)
+    var_set_unref (*((var_set_t **) vec_nth (scopes, i)));
+
+  destroy_vec (scopes);
+  var_set_unref (vars);
+}
+
+/* Evaluates each line of a proof object, in order.
+ *  input:
+ *    proof - The proof that is being evaluated.
+ *    fn - The function to call with the result of each line.
+ *      A non-zero return value stops the evaluation.
+ *    data - The data to pass to fn.
+ *    trace - The trace to record the evaluation to, or NULL.
+ *  output:
+ *    0 on success, -1 on memory error, or the non-zero value returned by fn.
+ */
+int
+proof_eval_each (proof_t * proof, proof_eval_fn fn, void * data,
+		 trace_t * trace)
+{
+  item_t * sen_itr;
+  var_set_t * pf_vars = NULL;
+  vec_t * scopes;
+  int ret = 0;
+
+  scopes = init_vec (sizeof (var_set_t *));
+  if (!scopes)
+    return -1;
+
+  ret = proof_eval_sexprs (proof, trace);
+  if (ret < 0)
+    return -1;
+
   for (sen_itr = proof->everything->head; sen_itr != NULL;
        sen_itr = sen_itr->next)
     {
-      // ln | text
-      //---------------------
-      // ln | text [rule <file> refs]
-      cur_line++;
       sen_data * sd;
       sd = sen_itr->value;
 
       char * ret_chk;
       int ret_val;
-      ret_chk = sen_data_evaluate (sd, &ret_val, pf_vars,
-				   proof->everything);
+      double start;
+
+      ret = proof_eval_scope (scopes, &pf_vars, sd);
+      if (ret < 0)
+	return -1;
+
+      start = trace_start (trace);
+      ret_chk = sen_data_evaluate (sd, &ret_val, pf_vars, proof->everything,
+				   proof->subproofs, trace);
 
       if (!ret_chk)
 	return -1;
 
-      if (verbose)
+      if (trace_span (trace, TRACE_LINE, sd->line_num, start, ret_chk) < 0)
+	return -1;
+
+      ret = fn (sd, ret_val, ret_chk, data);
+      if (ret != 0)
+	break;
+
+      ret = proof_eval_collect (&pf_vars, sd);
+      if (ret < 0)
+	return -1;
+    }
+
+  proof_eval_release (scopes, pf_vars);
+
+  return ret;
+}
+
+/* Evaluates a single line of a proof object, using the variables of the
+ * lines that it can reference.
+ *  input:
+ *    proof - The proof containing the line.
+ *    line_num - The line number of the line to evaluate.
+ *    ret_val - Receives the value type of the line.
+ *  output:
+ *    The result of the evaluation, or NULL on memory error or if no such
+ *    line exists.
+ */
+char *
+proof_eval_line (proof_t * proof, int line_num, int * ret_val)
+{
+  item_t * sen_itr;
+  var_set_t * pf_vars = NULL;
+  vec_t * scopes;
+  sen_data * target = NULL;
+  char * ret_chk;
+  int ret;
+
+  for (sen_itr = proof->everything->head; sen_itr; sen_itr = sen_itr->next)
+    {
+      if (((sen_data *) sen_itr->value)->line_num == line_num)
+	{
+	  target = sen_itr->value;
+	  break;
+	}
+    }
+
+  if (!target)
+    return NULL;
+
+  scopes = init_vec (sizeof (var_set_t *));
+  if (!scopes)
+    return NULL;
+
+  ret = proof_eval_sexprs (proof, NULL);
+  if (ret < 0)
+    return NULL;
+
+  // Only the lines in scope of the target contribute their variables.
+
+  for (sen_itr = proof->everything->head; ; sen_itr = sen_itr->next)
+    {
+      sen_data * sd = sen_itr->value;
+
+      ret = proof_eval_scope (scopes, &pf_vars, sd);
+      if (ret < 0)
+	return NULL;
+
+      if (sd == target)
+	break;
+
+      ret = proof_eval_collect (&pf_vars, sd);
+      if (ret < 0)
+	return NULL;
+    }
+
+  ret_chk = sen_data_evaluate (target, ret_val, pf_vars, proof->everything,
+			       proof->subproofs, NULL);
+  proof_eval_release (scopes, pf_vars);
+
+  return ret_chk;
+}
+
+/* Finds the rules that accept the lines of a proof object.
+ *  input:
+ *    proof - The proof whose lines are searched.
+ *    line_num - The line to search, or 0 for every line.
+ *    jobs - The amount of rules to check at once, or 0 for one per processor.
+ *    found - Receives a rule_search_line for each line that was searched.
+ *      Premises, subproofs and lines with text errors are skipped.
+ *      Each line must be cleared with rule_search_line_clear.
+ *  output:
+ *    0 on success, -1 on error.
+ */
+int
+proof_infer (proof_t * proof, int line_num, int jobs, vec_t * found)
+{
+  item_t * sen_itr;
+  var_set_t * pf_vars = NULL;
+  vec_t * scopes;
+  rule_search_line line;
+  int ret, in_sub, start;
+
+  start = found->num_stuff;
+
+  scopes = init_vec (sizeof (var_set_t *));
+  if (!scopes)
+    return -1;
+
+  ret = proof_eval_sexprs (proof, NULL);
+  if (ret < 0)
+    return -1;
+
+  for (sen_itr = proof->everything->head; sen_itr; sen_itr = sen_itr->next)
+    {
+      sen_data * sd = sen_itr->value;
+
+      ret = proof_eval_scope (scopes, &pf_vars, sd);
+      if (ret < 0)
+	return -1;
+
+      if ((line_num == 0 || sd->line_num == line_num)
+	  && !sd->premise && !sd->subproof && sd->sexpr)
 	{
-	  if (sd->premise)
+	  line.line_num = sd->line_num;
+	  line.conc = sd->sexpr;
+	  line.vars = NULL;
+	  line.lemma = NULL;
+	  line.rules = 0;
+
+	  line.prems = init_vec (sizeof (char *));
+	  if (!line.prems)
+	    return -1;
+
+	  ret = sen_data_collect_refs (sd, proof->everything,
+				       proof->subproofs, line.prems, &in_sub);
+	  if (ret == -1)
+	    return -1;
+
+	  if (ret == 0 && sd->file)
 	    {
-	      printf (" %3i | %s\n", cur_line, sd->text);
+	      line.lemma = sen_data_open_lemma (sd);
+	      if (!line.lemma)
+		return -1;
 	    }
 
-	  if (!sd->premise)
-	    {
-	      if (got_prems)
-		{
-		  if (verbose)
-		    printf ("----------------\n");
-		  got_prems = 0;
-		}
-
-	      printf (" %3i | %s %s", cur_line, sd->text,
-		      rules_list[sd->rule]);
-	      if (sd->rule == RULE_LM)
-		printf  (":%s", sd->file);
-
-	      printf (" ");
-
-	      int j;
-	      for (j = 0; sd->refs[j] != -1; j++)
-		{
-		  printf ("%i", sd->refs[j]);
-		  if (sd->refs[j + 1] != -1)
-		    printf (",");
-		}
-
-	      printf ("\n");
-	    }
-	}
+	  // A line whose references have text errors can't be accepted.
 
-      if (!strcmp (ret_chk, CORRECT))
-	{
-	  num_correct++;
-	  if (rets)
+	  if (ret == 0)
 	    {
-	      ret = vec_add_obj (rets, &cur_line);
+	      line.vars = var_set_ref (pf_vars);
+	      ret = vec_add_obj (found, &line);
 	      if (ret < 0)
 		return -1;
 	    }
+	  else
+	    {
+	      destroy_str_vec (line.prems);
+	    }
 
-	  if (verbose)
-	    printf ("%i: %s\n", sd->line_num, ret_chk);
+	  if (sd->line_num == line_num)
+	    break;
 	}
 
-      int arb = (sd->premise || sd->rule == RULE_EI || sd->subproof) ? 0 : 1;
-      ret = sexpr_collect_vars_to_proof (pf_vars, sd->sexpr, arb);
+      ret = proof_eval_collect (&pf_vars, sd);
       if (ret < 0)
 	return -1;
     }
 
+  proof_eval_release (scopes, pf_vars);
+
+  return rule_search ((rule_search_line *) vec_nth (found, start),
+		      found->num_stuff - start, jobs);
+}
+
+// The state of proof_eval, passed to proof_eval_report.
+
+struct proof_eval_state {
+  vec_t * rets;
+  int verbose;
+  int cur_line;
+  int got_prems;
+};
+
+/* Reports the result of a line for proof_eval.
+ *  input:
+ *    sd - The line that was evaluated.
+ *    ret_val - The value type of the line.
+ *    ret_chk - The result of the evaluation.
+ *    data - The state of proof_eval.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+static int
+proof_eval_report (sen_data * sd, int ret_val, char * ret_chk, void * data)
+{
+  struct proof_eval_state * st = data;
+  int ret;
+
+  // ln | text
+  //---------------------
+  // ln | text [rule <file> refs]
+  st->cur_line++;
+
+  if (st->verbose)
+    {
+      if (sd->premise)
+	{
+	  printf (" %3i | %s\n", st->cur_line, sd->text);
+	}
+
+      if (!sd->premise)
+	{
+	  if (st->got_prems)
+	    {
+	      printf ("----------------\n");
+	      st->got_prems = 0;
+	    }
+
+	  printf (" %3i | %s %s", st->cur_line, sd->text,
+		  rules_list[sd->rule]);
+	  if (sd->rule == RULE_LM)
+	    printf  (":%s", sd->file);
+
+	  printf (" ");
+
+	  int j;
+	  for (j = 0; sd->refs[j] != -1; j++)
+	    {
+	      printf ("%i", sd->refs[j]);
+	      if (sd->refs[j + 1] != -1)
+		printf (",");
+	    }
+
+	  printf ("\n");
+	}
+    }
+
+  if (!strcmp (ret_chk, CORRECT))
+    {
+      if (st->rets)
+	{
+	  ret = vec_add_obj (st->rets, &st->cur_line);
+	  if (ret < 0)
+	    return -1;
+	}
+
+      if (st->verbose)
+	printf ("%i: %s\n", sd->line_num, ret_chk);
+    }
+
   return 0;
 }
+
+/* Evaluates a proof object.
+ *  input:
+ *    proof - The proof that is being evaluated.
+ *    rets - A vector to store the lines that correctly evaluated.
+ *    verbose - A flag denoting verbosity.
+ *    trace - The trace to record the evaluation to, or NULL.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+int
+proof_eval (proof_t * proof, vec_t * rets, int verbose, trace_t * trace)
+{
+  struct proof_eval_state st;
+
+  st.rets = rets;
+  st.verbose = verbose;
+  st.cur_line = 0;
+  st.got_prems = 0;
+
+  return proof_eval_each (proof, proof_eval_report, &st, trace);
+}
+
+/* Finds the sentences of a proof with a given sexpr.
+ *  input:
+ *    proof - the proof to search, which must have been evaluated.
+ *    sexpr - the sexpr to search for.
+ *  output:
+ *    the first entry of the index whose value is such a sentence, or NULL
+ *    if there are none.  The rest are found with hash_find_next.
+ */
+hash_entry_t *
+proof_find_sexpr (proof_t * proof, unsigned char * sexpr)
+{
+  if (!proof->index)
+    return NULL;
+
+  return hash_find (proof->index, sexpr);
+}
@@ -23,17 +23,34 @@ typedef struct proof proof_t;
 typedef struct list list_t;
 typedef struct item item_t;
 typedef struct vector vec_t;
+typedef struct trace trace_t;
+typedef struct hash_table hash_t;
+typedef struct hash_entry hash_entry_t;
+typedef struct sen_data sen_data;
+typedef struct subproof_tree subproof_tree_t;
+
+// The function called with the result of each line by proof_eval_each.
+
+typedef int (* proof_eval_fn) (sen_data * sd, int ret_val, char * ret_chk,
+			       void * data);
 
 // Proof data structure.
 
 struct proof {
   list_t * everything;  // List of sentences of this proof.
   list_t * goals;       // List of goals for this proof.
+  hash_t * index;       // Index of the sentences by their sexprs.
+  subproof_tree_t * subproofs;  // The subproofs of this proof.
   int boolean : 1;      // Whether or not this is a boolean mode proof.
 };
 
 proof_t * proof_init ();
 void proof_destroy (proof_t * proof);
-int proof_eval (proof_t * proof, vec_t * rets, int verbose);
+int proof_eval (proof_t * proof, vec_t * rets, int verbose, trace_t * trace);
+int proof_eval_each (proof_t * proof, proof_eval_fn fn, void * data,
+		     trace_t * trace);
+char * proof_eval_line (proof_t * proof, int line_num, int * ret_val);
+int proof_infer (proof_t * proof, int line_num, int jobs, vec_t * found);
+hash_entry_t * proof_find_sexpr (proof_t * proof, unsigned char * sexpr);
 
 #endif  /*  PROOF_H  */
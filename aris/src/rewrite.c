@@ -0,0 +1,680 @@
+/* Functions for checking sentences against the table of rewrite rules.
+
+   Copyright (C) 2012 Ian Dunn.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "rewrite.h"
+#include "formula.h"
+#include "hash.h"
+#include "vec.h"
+#include "sexpr-process.h"
+
+#define MEM_SUBSYSTEM MEM_RULES
+#include "mem.h"
+
+// The marker that repeats the element before it.
+
+#define REWRITE_REST "..."
+
+// A pair of equivalent patterns.  A pattern is a sexpr in which a single
+// capital letter stands for any sentence, and in which a list that ends
+// in "..." repeats the element before it at least twice.  A capital
+// letter must occur under the same quantifiers on both sides.
+
+struct rewrite_entry {
+  int rule;           // The rule that justifies the rewrite.
+  const char * lhs;   // One side of the rewrite.
+  const char * rhs;   // The other side of the rewrite.
+};
+
+static struct rewrite_entry rewrite_table[] = {
+  {REWRITE_IM, "(<i> A B)", "(<o> (<n> A) B)"},
+
+  {REWRITE_DM, "(<n> (<a> A ...))", "(<o> (<n> A) ...)"},
+  {REWRITE_DM, "(<n> (<o> A ...))", "(<a> (<n> A) ...)"},
+  {REWRITE_DM, "(<n> ((<u> x) A))", "((<e> x) (<n> A))"},
+  {REWRITE_DM, "(<n> ((<e> x) A))", "((<u> x) (<n> A))"},
+
+  {REWRITE_DT, "(<a> A (<o> B ...))", "(<o> (<a> A B) ...)"},
+  {REWRITE_DT, "(<o> A (<a> B ...))", "(<a> (<o> A B) ...)"},
+  {REWRITE_DT, "(<a> A (<a> B ...))", "(<a> (<a> A B) ...)"},
+  {REWRITE_DT, "(<o> A (<o> B ...))", "(<o> (<o> A B) ...)"},
+  {REWRITE_DT, "(<a> A (<i> B C))", "(<i> (<a> A B) (<a> A C))"},
+  {REWRITE_DT, "(<o> A (<i> B C))", "(<i> (<o> A B) (<o> A C))"},
+  {REWRITE_DT, "(<a> A (<b> B C))", "(<b> (<a> A B) (<a> A C))"},
+  {REWRITE_DT, "(<o> A (<b> B C))", "(<b> (<o> A B) (<o> A C))"},
+  {REWRITE_DT, "((<u> x) (<a> A ...))", "(<a> ((<u> x) A) ...)"},
+  {REWRITE_DT, "((<e> x) (<o> A ...))", "(<o> ((<e> x) A) ...)"},
+
+  {REWRITE_EQ, "(<b> A B)", "(<a> (<i> A B) (<i> B A))"},
+
+  {REWRITE_DN, "(<n> (<n> A))", "A"}
+};
+
+// The name of each rule, and its error when the check of the difference
+// finds nothing wrong, but no pattern applies.
+
+struct rewrite_info {
+  const char * name;    // The name of the rule.
+  const char * wrong;   // The error if no pattern applies.
+};
+
+static struct rewrite_info rewrite_infos[REWRITE_NUM] = {
+  {"im", "Implication constructed incorrectly."},
+  {"dm", "DeMorgan constructed incorrectly."},
+  {"dt", "Distribution constructed incorrectly."},
+  {"eq", "Equivalence constructed incorrectly."},
+  {"dn", "Double Negation constructed incorrectly."}
+};
+
+// One direction of a rewrite, compiled to formula trees.
+
+struct rewrite_side {
+  int rule;                      // The rule that justifies the rewrite.
+  formula_t * from;              // The pattern of the sentence rewritten.
+  formula_t * to;                // The pattern of the result.
+  const unsigned char * to_key;  // The key of to, or NULL.
+};
+
+// A sentence matched by a capital letter of a pattern.
+
+struct rewrite_bind {
+  int var;         // The letter, from zero.
+  int k;           // The repetition of the letter, or -1 outside of one.
+  formula_t * fm;  // The sentence.
+};
+
+// The sides of the rewrites, by the key of the side that is rewritten,
+// and the sides that are only a capital letter.  These are compiled when
+// first used, and shared by every thread afterward.
+
+static hash_t * rewrite_index = NULL;
+static vec_t * rewrite_wild = NULL;
+static int rewrite_ready = 0;
+static pthread_once_t rewrite_once = PTHREAD_ONCE_INIT;
+
+static int rewrite_mask (formula_t * a, formula_t * b, unsigned int * mask);
+
+/* Gets the key of a formula, by which the rewrites are found.
+ *  input:
+ *    fm - the formula.
+ *  output:
+ *    the connective or quantifier at the top of fm, or NULL if there is none.
+ */
+static const unsigned char *
+rewrite_key (formula_t * fm)
+{
+  if (fm->type == FORMULA_QUANT)
+    return (fm->quant == FORMULA_UNV) ? S_UNV : S_EXL;
+
+  if (fm->type == FORMULA_LIST && fm->num_args > 0
+      && fm->args[0]->type == FORMULA_SYMBOL)
+    return fm->args[0]->text;
+
+  return NULL;
+}
+
+/* Determines whether or not a pattern node is a capital letter.
+ *  input:
+ *    pat - the pattern node.
+ *  output:
+ *    1 if it is, 0 otherwise.
+ */
+static int
+rewrite_is_var (formula_t * pat)
+{
+  return (pat->type == FORMULA_SYMBOL
+	  && pat->text[0] >= 'A' && pat->text[0] <= 'Z'
+	  && pat->text[1] == '\0');
+}
+
+/* Records the amount of quantifiers around each capital letter of a pattern.
+ *  input:
+ *    pat - the pattern.
+ *    depth - the amount of quantifiers around pat.
+ *    depths - receives the depth of each letter, -1 for a letter that
+ *      doesn't occur, and -2 for one that occurs at different depths.
+ *  output:
+ *    none.
+ */
+static void
+rewrite_depths (formula_t * pat, int depth, int * depths)
+{
+  int i, var;
+
+  if (rewrite_is_var (pat))
+    {
+      var = pat->text[0] - 'A';
+      depths[var] = (depths[var] == -1 || depths[var] == depth) ? depth : -2;
+      return;
+    }
+
+  for (i = 0; i < pat->num_args; i++)
+    rewrite_depths (pat->args[i], depth + (pat->type == FORMULA_QUANT),
+		    depths);
+}
+
+/* Adds one direction of a rewrite to the index.
+ *  input:
+ *    rule - the rule of the rewrite.
+ *    from - the pattern of the sentence rewritten.
+ *    to - the pattern of the result.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+static int
+rewrite_add_side (int rule, formula_t * from, formula_t * to)
+{
+  struct rewrite_side * side;
+  const unsigned char * key;
+  hash_entry_t * entry;
+  int ret;
+
+  side = (struct rewrite_side *) calloc (1, sizeof (struct rewrite_side));
+  CHECK_ALLOC (side, -1);
+
+  side->rule = rule;
+  side->from = from;
+  side->to = to;
+  side->to_key = rewrite_key (to);
+
+  key = rewrite_key (from);
+  if (key)
+    {
+      entry = hash_add_obj (rewrite_index, key, side);
+      if (!entry)
+	return -1;
+    }
+  else
+    {
+      ret = vec_add_obj (rewrite_wild, &side);
+      if (ret < 0)
+	return -1;
+    }
+
+  return 0;
+}
+
+/* Compiles the table of rewrites into the index.  Called once.
+ *  input:
+ *    none.
+ *  output:
+ *    none.  Sets rewrite_ready to 1 on success, or to -1 on error.
+ */
+static void
+rewrite_compile (void)
+{
+  formula_t * lhs, * rhs;
+  int l_depths[26], r_depths[26];
+  int i, ret, num_entries;
+
+  rewrite_ready = -1;
+
+  rewrite_index = init_hash (16);
+  if (!rewrite_index)
+    return;
+
+  rewrite_wild = init_vec (sizeof (struct rewrite_side *));
+  if (!rewrite_wild)
+    return;
+
+  num_entries = sizeof (rewrite_table) / sizeof (struct rewrite_entry);
+
+  for (i = 0; i < num_entries; i++)
+    {
+      lhs = formula_init ((const unsigned char *) rewrite_table[i].lhs);
+      if (!lhs)
+	return;
+
+      rhs = formula_init ((const unsigned char *) rewrite_table[i].rhs);
+      if (!rhs)
+	return;
+
+      // The sentences of a letter can only be compared in place if
+      // their bound variables refer to the same quantifiers.
+
+      memset (l_depths, -1, sizeof (l_depths));
+      memset (r_depths, -1, sizeof (r_depths));
+      rewrite_depths (lhs, 0, l_depths);
+      rewrite_depths (rhs, 0, r_depths);
+
+      if (memcmp (l_depths, r_depths, sizeof (l_depths)))
+	return;
+
+      ret = rewrite_add_side (rewrite_table[i].rule, lhs, rhs);
+      if (ret < 0)
+	return;
+
+      ret = rewrite_add_side (rewrite_table[i].rule, rhs, lhs);
+      if (ret < 0)
+	return;
+    }
+
+  rewrite_ready = 1;
+}
+
+/* Binds a capital letter to a sentence.
+ *  input:
+ *    binds - the bindings made so far.
+ *    var - the letter, from zero.
+ *    k - the repetition of the letter, or -1.
+ *    fm - the sentence.
+ *  output:
+ *    1 if the letter can be bound to fm, 0 if it is already bound to
+ *    another sentence, -1 on memory error.
+ */
+static int
+rewrite_bind (vec_t * binds, int var, int k, formula_t * fm)
+{
+  struct rewrite_bind * bind, new_bind;
+  int i, ret;
+
+  for (i = 0; i < binds->num_stuff; i++)
+    {
+      bind = vec_nth (binds, i);
+      if (bind->var == var && bind->k == k)
+	return formula_equal (bind->fm, fm);
+    }
+
+  new_bind.var = var;
+  new_bind.k = k;
+  new_bind.fm = fm;
+
+  ret = vec_add_obj (binds, &new_bind);
+  if (ret < 0)
+    return -1;
+
+  return 1;
+}
+
+/* Matches a pattern against a formula.
+ *  input:
+ *    pat - the pattern.
+ *    fm - the formula.
+ *    k - the repetition that pat is in, or -1.
+ *    binds - receives the sentences of the capital letters.
+ *  output:
+ *    1 if the pattern matches, 0 if it doesn't, -1 on memory error.
+ */
+static int
+rewrite_match (formula_t * pat, formula_t * fm, int k, vec_t * binds)
+{
+  int i, fixed, ret;
+
+  switch (pat->type)
+    {
+    case FORMULA_SYMBOL:
+      if (rewrite_is_var (pat))
+	return rewrite_bind (binds, pat->text[0] - 'A', k, fm);
+
+      return (fm->type == FORMULA_SYMBOL && pat->sym == fm->sym);
+
+    case FORMULA_BOUND:
+      return (fm->type == FORMULA_BOUND && fm->index == pat->index);
+
+    case FORMULA_QUANT:
+      if (fm->type != FORMULA_QUANT || fm->quant != pat->quant)
+	return 0;
+
+      return rewrite_match (pat->args[0], fm->args[0], k, binds);
+    }
+
+  if (fm->type != FORMULA_LIST)
+    return 0;
+
+  // The element before a trailing marker matches the rest of the list.
+
+  fixed = pat->num_args;
+  if (fixed > 1 && pat->args[fixed - 1]->type == FORMULA_SYMBOL
+      && !strcmp (pat->args[fixed - 1]->text, REWRITE_REST))
+    {
+      fixed -= 2;
+      if (fm->num_args < fixed + 2)
+	return 0;
+    }
+  else if (fm->num_args != fixed)
+    {
+      return 0;
+    }
+
+  for (i = 0; i < fm->num_args; i++)
+    {
+      if (i < fixed)
+	ret = rewrite_match (pat->args[i], fm->args[i], k, binds);
+      else
+	ret = rewrite_match (pat->args[fixed], fm->args[i], i - fixed, binds);
+
+      if (ret != 1)
+	return ret;
+    }
+
+  return 1;
+}
+
+/* Determines whether or not two bindings are of the same part of a rewrite.
+ *  input:
+ *    a, b - the bindings.
+ *  output:
+ *    1 if they are, 0 otherwise.
+ */
+static int
+rewrite_same_part (struct rewrite_bind * a, struct rewrite_bind * b)
+{
+  return (a->var == b->var && (a->k == b->k || a->k == -1 || b->k == -1));
+}
+
+/* Checks that the parts of a rewrite are the same up to its rule.
+ *  input:
+ *    from - the bindings of the sentence rewritten.
+ *    to - the bindings of the result.
+ *    rule - the rule of the rewrite.
+ *  output:
+ *    1 if they are, 0 if they aren't, -1 on memory error.
+ */
+static int
+rewrite_parts (vec_t * from, vec_t * to, int rule)
+{
+  struct rewrite_bind * f_bind, * t_bind;
+  unsigned int mask;
+  int i, j, found, ret;
+
+  for (i = 0; i < from->num_stuff; i++)
+    {
+      f_bind = vec_nth (from, i);
+      found = 0;
+
+      for (j = 0; j < to->num_stuff; j++)
+	{
+	  t_bind = vec_nth (to, j);
+	  if (!rewrite_same_part (f_bind, t_bind))
+	    continue;
+
+	  found = 1;
+
+	  ret = rewrite_mask (f_bind->fm, t_bind->fm, &mask);
+	  if (ret == -1)
+	    return -1;
+
+	  if (!(mask & REWRITE_BIT (rule)))
+	    return 0;
+	}
+
+      if (!found)
+	return 0;
+    }
+
+  // Every part of the result must come from the sentence rewritten.
+
+  for (j = 0; j < to->num_stuff; j++)
+    {
+      t_bind = vec_nth (to, j);
+
+      for (i = 0; i < from->num_stuff; i++)
+	if (rewrite_same_part (vec_nth (from, i), t_bind))
+	  break;
+
+      if (i == from->num_stuff)
+	return 0;
+    }
+
+  return 1;
+}
+
+/* Tries one direction of a rewrite at a difference.
+ *  input:
+ *    side - the direction of the rewrite.
+ *    a, b - the differing parts.
+ *  output:
+ *    1 if the rewrite turns a into b, 0 if it doesn't, -1 on memory error.
+ */
+static int
+rewrite_try (struct rewrite_side * side, formula_t * a, formula_t * b)
+{
+  vec_t * from, * to;
+  int ret;
+
+  from = init_vec (sizeof (struct rewrite_bind));
+  if (!from)
+    return -1;
+
+  to = init_vec (sizeof (struct rewrite_bind));
+  if (!to)
+    {
+      destroy_vec (from);
+      return -1;
+    }
+
+  ret = rewrite_match (side->from, a, -1, from);
+  if (ret == 1)
+    ret = rewrite_match (side->to, b, -1, to);
+  if (ret == 1)
+    ret = rewrite_parts (from, to, side->rule);
+
+  destroy_vec (from);
+  destroy_vec (to);
+
+  return ret;
+}
+
+/* Tries one direction of a rewrite, unless its rule is already known.
+ *  input:
+ *    side - the direction of the rewrite.
+ *    a, b - the differing parts.
+ *    b_key - the key of b.
+ *    mask - the rules known to justify the difference, which receives
+ *      the rule of side if it does.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+static int
+rewrite_try_side (struct rewrite_side * side, formula_t * a, formula_t * b,
+		  const unsigned char * b_key, unsigned int * mask)
+{
+  int ret;
+
+  if (*mask & REWRITE_BIT (side->rule))
+    return 0;
+
+  if (side->to_key && (!b_key || strcmp (side->to_key, b_key)))
+    return 0;
+
+  ret = rewrite_try (side, a, b);
+  if (ret == -1)
+    return -1;
+
+  if (ret)
+    *mask |= REWRITE_BIT (side->rule);
+
+  return 0;
+}
+
+/* Finds every rule that turns one formula into another, in a single walk.
+ *  input:
+ *    a, b - the formulas.
+ *    mask - receives the bits of the rules.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+static int
+rewrite_mask (formula_t * a, formula_t * b, unsigned int * mask)
+{
+  formula_t * da, * db;
+  const unsigned char * a_key, * b_key;
+  hash_entry_t * entry;
+  unsigned int found, kids, kid;
+  int i, ret;
+
+  ret = formula_diff (a, b, &da, &db, NULL);
+  if (ret == -1)
+    return -1;
+
+  if (ret == 0)
+    {
+      *mask = REWRITE_ALL;
+      return 0;
+    }
+
+  found = 0;
+  a_key = rewrite_key (da);
+  b_key = rewrite_key (db);
+
+  if (a_key)
+    {
+      for (entry = hash_find (rewrite_index, a_key); entry;
+	   entry = hash_find_next (entry))
+	{
+	  ret = rewrite_try_side (entry->value, da, db, b_key, &found);
+	  if (ret == -1)
+	    return -1;
+	}
+    }
+
+  for (i = 0; i < rewrite_wild->num_stuff; i++)
+    {
+      ret = rewrite_try_side (*((struct rewrite_side **)
+				vec_nth (rewrite_wild, i)),
+			      da, db, b_key, &found);
+      if (ret == -1)
+	return -1;
+    }
+
+  // Several parts of the difference may have been rewritten separately.
+
+  if (found != REWRITE_ALL && formula_same_shape (da, db))
+    {
+      kids = REWRITE_ALL;
+      for (i = 0; kids && i < da->num_args; i++)
+	{
+	  ret = rewrite_mask (da->args[i], db->args[i], &kid);
+	  if (ret == -1)
+	    return -1;
+
+	  kids &= kid;
+	}
+
+      found |= kids;
+    }
+
+  *mask = found;
+  return 0;
+}
+
+/* Finds every rewrite rule that justifies a conclusion from a premise.
+ *  input:
+ *    prem - the tree of the premise.
+ *    conc - the tree of the conclusion.
+ *    rules - receives the bits of the rules, as by REWRITE_BIT.
+ *  output:
+ *    1 if the sentences differ, 0 if they don't, -1 on error.
+ */
+int
+rewrite_find (formula_t * prem, formula_t * conc, unsigned int * rules)
+{
+  int ret;
+
+  mem_keep_begin ();
+  pthread_once (&rewrite_once, rewrite_compile);
+  mem_keep_end ();
+  if (rewrite_ready != 1)
+    return -1;
+
+  if (formula_equal (prem, conc))
+    {
+      *rules = REWRITE_ALL;
+      return 0;
+    }
+
+  ret = rewrite_mask (prem, conc, rules);
+  if (ret == -1)
+    return -1;
+
+  return 1;
+}
+
+/* Checks two sentences against a rewrite rule.
+ *  input:
+ *    prem - the premise.
+ *    conc - the conclusion.
+ *    rule - the rule.
+ *    explain - the check of the rule at a difference, which gives the
+ *      error when no pattern fits.
+ *  output:
+ *    CORRECT if the rule justifies every difference,
+ *    NO_DIFFERENCE if there are no differences,
+ *    an error message otherwise, or NULL on memory error.
+ */
+char *
+rewrite_check (unsigned char * prem, unsigned char * conc, int rule,
+	       diff_rule explain)
+{
+  formula_t * p_fm, * c_fm;
+  unsigned int rules;
+  char * ret_str;
+  int ret;
+
+  p_fm = formula_init (prem);
+  if (!p_fm)
+    return NULL;
+
+  c_fm = formula_init (conc);
+  if (!c_fm)
+    {
+      formula_destroy (p_fm);
+      return NULL;
+    }
+
+  ret = rewrite_find (p_fm, c_fm, &rules);
+  if (ret == -1)
+    {
+      ret_str = NULL;
+    }
+  else if (ret == 0)
+    {
+      ret_str = NO_DIFFERENCE;
+    }
+  else if (rules & REWRITE_BIT (rule))
+    {
+      ret_str = CORRECT;
+    }
+  else
+    {
+      // The check of the difference names the part that doesn't fit.
+      ret_str = sexpr_diff_check (p_fm, c_fm, explain);
+      if (ret_str == CORRECT || ret_str == NO_DIFFERENCE)
+	ret_str = (char *) _(rewrite_infos[rule].wrong);
+    }
+
+  formula_destroy (p_fm);
+  formula_destroy (c_fm);
+
+  return ret_str;
+}
+
+/* Gets the name of a rewrite rule.
+ *  input:
+ *    rule - the rule.
+ *  output:
+ *    the name of the rule, as used in a proof file.
+ */
+const char *
+rewrite_name (int rule)
+{
+  return rewrite_infos[rule].name;
+}
@@ -0,0 +1,45 @@
+/* The table of rewrite rules.
+
+   Copyright (C) 2012 Ian Dunn.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ARIS_REWRITE_H
+#define ARIS_REWRITE_H
+
+#include "sexpr-process.h"
+
+typedef struct formula formula_t;
+
+// The equivalence rules that are given by rewrite patterns.
+
+enum REWRITE_RULES {
+  REWRITE_IM = 0,
+  REWRITE_DM,
+  REWRITE_DT,
+  REWRITE_EQ,
+  REWRITE_DN,
+  REWRITE_NUM
+};
+
+#define REWRITE_BIT(r) (1u << (r))
+#define REWRITE_ALL (REWRITE_BIT (REWRITE_NUM) - 1)
+
+int rewrite_find (formula_t * prem, formula_t * conc, unsigned int * rules);
+char * rewrite_check (unsigned char * prem, unsigned char * conc, int rule,
+		      diff_rule explain);
+const char * rewrite_name (int rule);
+
+#endif /* ARIS_REWRITE_H */
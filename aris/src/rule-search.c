@@ -0,0 +1,548 @@
+/* Functions for finding the rules that justify a line.
+
+   Copyright (C) 2012 Ian Dunn.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "rule-search.h"
+#include "rewrite.h"
+#include "formula.h"
+#include "proof.h"
+#include "rules.h"
+#include "vec.h"
+#include "var.h"
+#include "sexpr-process.h"
+
+#define MEM_SUBSYSTEM MEM_RULES
+#include "mem.h"
+
+// The connectives at the top of a conclusion, by which rules are rejected.
+
+enum RULE_SEARCH_TOPS {
+  RULE_TOP_ATOM = 0,  // A symbol, or a predicate.
+  RULE_TOP_AND,
+  RULE_TOP_OR,
+  RULE_TOP_NOT,
+  RULE_TOP_CON,
+  RULE_TOP_BIC,
+  RULE_TOP_UNV,
+  RULE_TOP_EXL,
+  RULE_NUM_TOPS
+};
+
+#define RULE_TOP(t) (1u << (t))
+#define RULE_TOP_ANY (RULE_TOP (RULE_NUM_TOPS) - 1)
+
+// Lines with at least this many references are indexed together.
+
+#define RULE_SEARCH_MAX_REFS 3
+
+// The equivalence rules that are checked together by rewrite_find.
+
+#define RULE_SEARCH_REWRITE -1
+
+// What a rule requires of a line: the amount of its references, and the
+// connective at the top of its sentence.
+
+struct rule_shape {
+  int min_refs;       // The least amount of references.
+  int max_refs;       // The most amount of references, or -1 for any.
+  unsigned int tops;  // The connectives that the sentence may have.
+};
+
+static struct rule_shape rule_shapes[NUM_RULES] = {
+  {2, 2, RULE_TOP_ANY},                              // mp
+  {1, 1, RULE_TOP (RULE_TOP_OR)},                    // ad
+  {1, 1, RULE_TOP_ANY},                              // sm
+  {2, -1, RULE_TOP (RULE_TOP_AND)},                  // cn
+  {2, -1, RULE_TOP (RULE_TOP_CON)},                  // hs
+  {2, -1, RULE_TOP_ANY},                             // ds
+  {0, 0, RULE_TOP (RULE_TOP_OR)},                    // ex
+  {3, -1, RULE_TOP_ANY},                             // cd
+  {1, 1, RULE_TOP_ANY},                              // im
+  {1, 1, RULE_TOP_ANY},                              // dm
+  {1, 1, RULE_TOP_ANY},                              // as
+  {1, 1, RULE_TOP_ANY},                              // co
+  {1, 1, RULE_TOP_ANY},                              // id
+  {1, 1, RULE_TOP_ANY},                              // dt
+  {1, 1, RULE_TOP_ANY},                              // eq
+  {1, 1, RULE_TOP_ANY},                              // dn
+  {1, 1, RULE_TOP_ANY},                              // ep
+  {1, 1, RULE_TOP_ANY},                              // sb
+  {1, 1, RULE_TOP (RULE_TOP_UNV)},                   // ug
+  {1, 1, RULE_TOP_ANY},                              // ui
+  {1, 1, RULE_TOP (RULE_TOP_EXL)},                   // eg
+  {1, 1, RULE_TOP_ANY},                              // ei
+  {1, 1, RULE_TOP_ANY},                              // bv
+  {1, 1, RULE_TOP_ANY},                              // nq
+  {1, 1, RULE_TOP_ANY},                              // pr
+  {0, 0, RULE_TOP (RULE_TOP_ATOM)},                  // ii
+  {2, 2, RULE_TOP_ANY},                              // fv
+  {0, -1, RULE_TOP_ANY},                             // lm
+  {2, -1, RULE_TOP_ANY},                             // sp
+  {0, 0, RULE_TOP_ANY},                              // sq
+  {1, 1, RULE_TOP_ANY},                              // in
+  {1, 1, RULE_TOP_ANY},                              // bi
+  {1, 1, RULE_TOP_ANY},                              // bn
+  {1, 1, RULE_TOP_ANY},                              // bd
+  {1, 1, RULE_TOP_ANY}                               // sn
+};
+
+// The rules given by rewrite patterns, by their rewrite rule.
+
+static int rule_rewrites[REWRITE_NUM] = {
+  RULE_IM, RULE_DM, RULE_DT, RULE_EQ, RULE_DN
+};
+
+// The candidate rules, by the amount of references and the top connective.
+
+static unsigned long long rule_index[RULE_SEARCH_MAX_REFS + 1][RULE_NUM_TOPS];
+static pthread_once_t rule_index_once = PTHREAD_ONCE_INIT;
+
+// A single check of a rule against a line.
+
+struct rule_search_task {
+  int line;  // The index of the line.
+  int rule;  // The rule, or RULE_SEARCH_REWRITE.
+};
+
+// The state shared by the searching threads.
+
+struct rule_search_queue {
+  rule_search_line * lines;  // The lines being searched.
+  vec_t * tasks;             // The checks to run.
+  int next;                  // The index of the next check.
+  int failed;                // Set on memory error.
+  pthread_mutex_t lock;
+};
+
+/* Builds the index of the candidate rules.  Called once.
+ *  input:
+ *    none.
+ *  output:
+ *    none.
+ */
+static void
+rule_search_build_index (void)
+{
+  int refs, top, rule;
+
+  for (refs = 0; refs <= RULE_SEARCH_MAX_REFS; refs++)
+    {
+      for (top = 0; top < RULE_NUM_TOPS; top++)
+	{
+	  rule_index[refs][top] = 0;
+
+	  for (rule = 0; rule < NUM_RULES; rule++)
+	    {
+	      struct rule_shape * shape = &rule_shapes[rule];
+
+	      if (refs < shape->min_refs)
+		continue;
+
+	      // The last bucket holds every larger amount.
+	      if (shape->max_refs != -1 && refs > shape->max_refs)
+		continue;
+
+	      if (!(shape->tops & RULE_TOP (top)))
+		continue;
+
+	      rule_index[refs][top] |= RULE_SEARCH_BIT (rule);
+	    }
+	}
+    }
+}
+
+/* Gets the connective at the top of a sexpr.
+ *  input:
+ *    sexpr - the sexpr.
+ *  output:
+ *    the connective, one of RULE_SEARCH_TOPS.
+ */
+static int
+rule_search_top (const unsigned char * sexpr)
+{
+  const unsigned char * c;
+
+  if (sexpr[0] != '(')
+    return RULE_TOP_ATOM;
+
+  if (sexpr[1] == '(')
+    {
+      if (!strncmp (sexpr + 2, S_UNV, S_CL))
+	return RULE_TOP_UNV;
+      if (!strncmp (sexpr + 2, S_EXL, S_CL))
+	return RULE_TOP_EXL;
+      return RULE_TOP_ATOM;
+    }
+
+  c = sexpr + 1;
+
+  if (!strncmp (c, S_AND, S_CL))
+    return RULE_TOP_AND;
+  if (!strncmp (c, S_OR, S_CL))
+    return RULE_TOP_OR;
+  if (!strncmp (c, S_NOT, S_NL))
+    return RULE_TOP_NOT;
+  if (!strncmp (c, S_CON, S_CL))
+    return RULE_TOP_CON;
+  if (!strncmp (c, S_BIC, S_CL))
+    return RULE_TOP_BIC;
+
+  return RULE_TOP_ATOM;
+}
+
+/* Finds the rules that could accept a line, by the amount of its
+ * references and the connective at the top of its sentence.
+ *  input:
+ *    line - the line.
+ *  output:
+ *    the set of the candidate rules.
+ */
+unsigned long long
+rule_search_candidates (rule_search_line * line)
+{
+  unsigned long long cands;
+  int refs;
+
+  pthread_once (&rule_index_once, rule_search_build_index);
+
+  refs = line->prems->num_stuff;
+  if (refs > RULE_SEARCH_MAX_REFS)
+    refs = RULE_SEARCH_MAX_REFS;
+
+  cands = rule_index[refs][rule_search_top (line->conc)];
+
+  if (!line->lemma)
+    cands &= ~RULE_SEARCH_BIT (RULE_LM);
+
+  return cands;
+}
+
+/* Checks the rewrite rules against a line, all at once.
+ *  input:
+ *    line - the line, which has one reference.
+ *    rules - receives the rules that accept the line.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+static int
+rule_search_rewrites (rule_search_line * line, unsigned long long * rules)
+{
+  formula_t * p_fm, * c_fm;
+  unsigned int found;
+  int i, ret;
+
+  *rules = 0;
+
+  p_fm = formula_init (vec_str_nth (line->prems, 0));
+  if (!p_fm)
+    return -1;
+
+  c_fm = formula_init (line->conc);
+  if (!c_fm)
+    {
+      formula_destroy (p_fm);
+      return -1;
+    }
+
+  ret = rewrite_find (p_fm, c_fm, &found);
+
+  formula_destroy (p_fm);
+  formula_destroy (c_fm);
+
+  if (ret == -1)
+    return -1;
+
+  // A sentence can't be rewritten into itself.
+  if (ret == 0)
+    return 0;
+
+  for (i = 0; i < REWRITE_NUM; i++)
+    if (found & REWRITE_BIT (i))
+      *rules |= RULE_SEARCH_BIT (rule_rewrites[i]);
+
+  return 0;
+}
+
+/* Checks a single rule against a line.
+ *  input:
+ *    line - the line.
+ *    rule - the rule, or RULE_SEARCH_REWRITE.
+ *    rules - receives the rules that accept the line.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+static int
+rule_search_check (rule_search_line * line, int rule,
+		   unsigned long long * rules)
+{
+  vec_t * prems;
+  char * ret_chk;
+  int i, ret;
+
+  if (rule == RULE_SEARCH_REWRITE)
+    return rule_search_rewrites (line, rules);
+
+  *rules = 0;
+
+  // The rules are given their own copy of the references.
+
+  prems = init_vec (sizeof (char *));
+  if (!prems)
+    return -1;
+
+  for (i = 0; i < line->prems->num_stuff; i++)
+    {
+      ret = vec_str_add_obj (prems, vec_str_nth (line->prems, i));
+      if (ret == -1)
+	{
+	  destroy_str_vec (prems);
+	  return -1;
+	}
+    }
+
+  ret_chk = process (line->conc, prems, rules_list[rule], line->vars,
+		     line->lemma);
+  destroy_str_vec (prems);
+
+  if (!ret_chk)
+    return -1;
+
+  if (!strcmp (ret_chk, CORRECT))
+    *rules = RULE_SEARCH_BIT (rule);
+
+  return 0;
+}
+
+/* Runs checks taken from a search queue, until it is empty.
+ *  input:
+ *    arg - the search queue.
+ *  output:
+ *    NULL.
+ */
+static void *
+rule_search_worker (void * arg)
+{
+  struct rule_search_queue * queue = arg;
+  struct rule_search_task * task;
+  unsigned long long rules;
+  int i, ret;
+
+  while (1)
+    {
+      pthread_mutex_lock (&queue->lock);
+      i = queue->next++;
+      pthread_mutex_unlock (&queue->lock);
+
+      if (i >= queue->tasks->num_stuff)
+	break;
+
+      task = vec_nth (queue->tasks, i);
+      ret = rule_search_check (&queue->lines[task->line], task->rule, &rules);
+
+      pthread_mutex_lock (&queue->lock);
+      if (ret < 0)
+	queue->failed = 1;
+      else
+	queue->lines[task->line].rules |= rules;
+      pthread_mutex_unlock (&queue->lock);
+    }
+
+  return NULL;
+}
+
+/* Gets the amount of processors available.
+ *  input:
+ *    none.
+ *  output:
+ *    the amount of processors, at least one.
+ */
+static int
+rule_search_num_cpus ()
+{
+  long num = 1;
+
+#ifdef _SC_NPROCESSORS_ONLN
+  num = sysconf (_SC_NPROCESSORS_ONLN);
+#endif
+
+  return (num > 0) ? (int) num : 1;
+}
+
+/* Finds every rule that accepts each of a set of lines.  The rules that
+ * can't accept a line are rejected through the index, and the rest are
+ * checked in parallel.
+ *  input:
+ *    lines - the lines, whose rules receive the rules that accept them.
+ *    num_lines - the amount of lines.
+ *    jobs - the amount of rules to check at once, or 0 for one per processor.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+int
+rule_search (rule_search_line * lines, int num_lines, int jobs)
+{
+  struct rule_search_queue queue;
+  struct rule_search_task task;
+  unsigned long long cands;
+  pthread_t * threads;
+  int i, rule, ret, num_threads;
+
+  queue.tasks = init_vec (sizeof (struct rule_search_task));
+  if (!queue.tasks)
+    return -1;
+
+  for (i = 0; i < num_lines; i++)
+    {
+      lines[i].rules = 0;
+      cands = rule_search_candidates (&lines[i]);
+      task.line = i;
+
+      // Implication, DeMorgan, distribution, equivalence and double
+      // negation are found by a single walk of the sentences.
+
+      if (lines[i].prems->num_stuff == 1)
+	{
+	  task.rule = RULE_SEARCH_REWRITE;
+	  ret = vec_add_obj (queue.tasks, &task);
+	  if (ret < 0)
+	    {
+	      destroy_vec (queue.tasks);
+	      return -1;
+	    }
+
+	  for (rule = 0; rule < REWRITE_NUM; rule++)
+	    cands &= ~RULE_SEARCH_BIT (rule_rewrites[rule]);
+	}
+
+      for (rule = 0; rule < NUM_RULES; rule++)
+	{
+	  if (!(cands & RULE_SEARCH_BIT (rule)))
+	    continue;
+
+	  task.rule = rule;
+	  ret = vec_add_obj (queue.tasks, &task);
+	  if (ret < 0)
+	    {
+	      destroy_vec (queue.tasks);
+	      return -1;
+	    }
+	}
+    }
+
+  if (jobs < 1)
+    jobs = rule_search_num_cpus ();
+
+  if (jobs > queue.tasks->num_stuff)
+    jobs = queue.tasks->num_stuff;
+
+  queue.lines = lines;
+  queue.next = 0;
+  queue.failed = 0;
+  pthread_mutex_init (&queue.lock, NULL);
+
+  threads = (pthread_t *) calloc (jobs + 1, sizeof (pthread_t));
+  if (!threads)
+    {
+      perror (NULL);
+      pthread_mutex_destroy (&queue.lock);
+      destroy_vec (queue.tasks);
+      return -1;
+    }
+
+  // The calling thread takes part in the search.
+
+  num_threads = 0;
+  if (jobs > 1)
+    {
+      for (i = 1; i < jobs; i++)
+	{
+	  if (pthread_create (&threads[num_threads], NULL, rule_search_worker,
+			      &queue))
+	    break;
+	  num_threads++;
+	}
+    }
+
+  rule_search_worker (&queue);
+
+  for (i = 0; i < num_threads; i++)
+    pthread_join (threads[i], NULL);
+
+  pthread_mutex_destroy (&queue.lock);
+  free (threads);
+  destroy_vec (queue.tasks);
+
+  return queue.failed ? -1 : 0;
+}
+
+/* Releases the references, variables and lemma of a line.
+ *  input:
+ *    line - the line to clear.
+ *  output:
+ *    none.
+ */
+void
+rule_search_line_clear (rule_search_line * line)
+{
+  if (line->prems)
+    destroy_str_vec (line->prems);
+  line->prems = NULL;
+
+  var_set_unref (line->vars);
+  line->vars = NULL;
+
+  if (line->lemma)
+    proof_destroy (line->lemma);
+  line->lemma = NULL;
+}
+
+/* Lists a set of rules by their names.
+ *  input:
+ *    rules - the set of rules.
+ *  output:
+ *    the names of the rules, separated by spaces, or NULL on memory error.
+ */
+char *
+rule_search_names (unsigned long long rules)
+{
+  char * out_str;
+  int rule, out_pos;
+
+  out_str = (char *) calloc (NUM_RULES * 3 + 1, sizeof (char));
+  CHECK_ALLOC (out_str, NULL);
+
+  out_pos = 0;
+  for (rule = 0; rule < NUM_RULES; rule++)
+    {
+      if (!(rules & RULE_SEARCH_BIT (rule)))
+	continue;
+
+      if (out_pos > 0)
+	out_str[out_pos++] = ' ';
+
+      memcpy (out_str + out_pos, rules_list[rule], 2);
+      out_pos += 2;
+    }
+
+  out_str[out_pos] = '\0';
+  return out_str;
+}
@@ -0,0 +1,47 @@
+/* Functions for finding the rules that justify a line.
+
+   Copyright (C) 2012 Ian Dunn.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ARIS_RULE_SEARCH_H
+#define ARIS_RULE_SEARCH_H
+
+typedef struct rule_search_line rule_search_line;
+typedef struct vector vec_t;
+typedef struct var_set var_set_t;
+typedef struct proof proof_t;
+
+// The bit of a rule in a set of rules.
+
+#define RULE_SEARCH_BIT(r) (1ull << (r))
+
+// A line whose rules are being searched for.
+
+struct rule_search_line {
+  int line_num;              // The line number, or 0 outside of a proof.
+  unsigned char * conc;      // The sexpr of the line.
+  vec_t * prems;             // The sexprs of the line's references.
+  var_set_t * vars;          // The variables in scope of the line.
+  proof_t * lemma;           // The proof of the line's lemma, or NULL.
+  unsigned long long rules;  // The rules that accept the line.
+};
+
+unsigned long long rule_search_candidates (rule_search_line * line);
+int rule_search (rule_search_line * lines, int num_lines, int jobs);
+void rule_search_line_clear (rule_search_line * line);
+char * rule_search_names (unsigned long long rules);
+
+#endif /* ARIS_RULE_SEARCH_H */
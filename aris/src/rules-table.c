@@ -31,6 +31,9 @@
 #include "proof.h"
 #include "aio.h"
 
+#define MEM_SUBSYSTEM MEM_GUI
+#include "mem.h"
+
 /* Begin menu arrays */
 
 mid_t menu_heads[3] =
@@ -285,6 +288,9 @@ rule_toggled (int index)
 
 	  if (the_app->focused)
 	    {
+	      if (aris_proof_history_mark (the_app->focused, sen, 1) < 0)
+		return;
+
 	      sen->rule = -1;
 
 	      int ret = 0;
@@ -297,9 +303,13 @@ rule_toggled (int index)
 		{
 		  if (sen->proof)
 		    proof_destroy (sen->proof);
+		  sen->proof = NULL;
 		  free (sen->file);
 		  sen->file = NULL;
 		}
+
+	      if (aris_proof_history_commit (the_app->focused) < 0)
+		return;
 	    }
 	}
 
@@ -332,9 +342,13 @@ rule_toggled (int index)
 
   if (user)
     {
+      int ret = aris_proof_history_mark (the_app->focused, sen, 1);
+      if (ret < 0)
+	return;
+
       sen->rule = index;
 
-      int ret = aris_proof_set_changed (the_app->focused, 1);
+      ret = aris_proof_set_changed (the_app->focused, 1);
       if (ret < 0)
 	return;
 
@@ -389,6 +403,9 @@ rule_toggled (int index)
 
 	  gtk_widget_destroy (file_chooser);
 	}
+
+      if (aris_proof_history_commit (the_app->focused) < 0)
+	return;
     }
 
   the_app->rt->toggled = index;
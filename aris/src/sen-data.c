@@ -20,6 +20,7 @@
 #include <string.h>
 #include "sen-data.h"
 #include "process.h"
+#include "process-cache.h"
 #include "list.h"
 #include "vec.h"
 #include "rules.h"
@@ -27,6 +28,11 @@
 #include "aio.h"
 #include "proof.h"
 #include "interop-isar.h"
+#include "trace.h"
+#include "subproof.h"
+
+#define MEM_SUBSYSTEM MEM_RULES
+#include "mem.h"
 
 /* Initializes the sentence data.
  *  input:
@@ -38,7 +44,6 @@
  *    file - the file name to set, in the event that rule == RULE_LM.
  *    subproof - whether or not this starts a subproof.
  *    depth - the depth of this sentence.
- *    indices - the indices of the sentence.
  *    sexpr - the sexpr text of this sentence.
  *  output:
  *    the newly initialized sentence data, or NULL on error.
@@ -91,7 +96,6 @@ sen_data_init (int line_num, int rule, unsigned char * text,
   sd->premise = premise;
   sd->depth = depth;
   sd->subproof = subproof;
-  sd->indices = NULL;
 
   return sd;
 }
@@ -129,24 +133,147 @@ sen_data_destroy (sen_data * sd)
       free (sd->vars);
     }
 
-  if (sd->indices)
-    free (sd->indices);
-  sd->indices = NULL;
-
   free (sd);
 }
 
+/* Collects the sexprs of the references of a sentence.  A subproof that
+ * has ended is referenced by both its first and its last line.
+ *  input:
+ *    sd - the sentence whose references are collected.
+ *    lines - the lines from the proof.
+ *    subproofs - the subproofs of the proof.
+ *    refs - receives the sexprs of the references.
+ *    in_sub - receives whether or not a subproof is referenced from
+ *      within it.
+ *  output:
+ *    0 on success, -2 if a reference has a text error, -1 on error.
+ */
+int
+sen_data_collect_refs (sen_data * sd, list_t * lines,
+		       subproof_tree_t * subproofs, vec_t * refs,
+		       int * in_sub)
+{
+  sen_data * ref_data;
+  int i, ret;
+
+  *in_sub = 0;
+
+  for (i = 0; sd->refs[i] != -1; i++)
+    {
+      if (sd->refs[i] > lines->num_stuff)
+	return -1;
+
+      ref_data = ls_nth (lines, sd->refs[i] - 1)->value;
+
+      ret = check_text (ref_data->text);
+      if (ret == -1)
+	return -1;
+
+      if (ret < 0)
+	return -2;
+
+      ret = vec_str_add_obj (refs, ref_data->sexpr);
+      if (ret == -1)
+	return -1;
+
+      if (!ref_data->subproof)
+	continue;
+
+      ret = subproof_tree_can_select (subproofs, sd->line_num,
+				      ref_data->line_num);
+      if (ret < 0)
+	{
+	  sen_data * sen_0;
+	  int last_line;
+
+	  last_line = subproof_tree_last_line (subproofs, ref_data->line_num);
+	  if (last_line < 0)
+	    last_line = ref_data->line_num;
+
+	  sen_0 = ls_nth (lines, last_line - 1)->value;
+	  ret = check_text (sen_0->text);
+	  if (ret == -1)
+	    return -1;
+
+	  if (ret < 0)
+	    return -2;
+
+	  ret = vec_str_add_obj (refs, sen_0->sexpr);
+	  if (ret == -1)
+	    return -1;
+	}
+      else
+	{
+	  *in_sub = 1;
+	}
+    }
+
+  return 0;
+}
+
+/* Opens the proof of the lemma used by a sentence.
+ *  input:
+ *    sd - the sentence, whose file is set.
+ *  output:
+ *    the proof of the lemma, or NULL on error.
+ */
+proof_t *
+sen_data_open_lemma (sen_data * sd)
+{
+  proof_t * proof;
+  int f_len, ret;
+
+  f_len = strlen (sd->file);
+
+  if (!strncmp (sd->file + f_len - 4, ".thy", 4))
+    {
+      proof = proof_init ();
+      if (!proof)
+	return NULL;
+
+      ret = parse_thy (sd->file, proof);
+      if (ret == -1)
+	return NULL;
+    }
+  else
+    {
+      // Only switch the connectives when needed, so that proofs that
+      // are being evaluated in parallel don't write to main_conns.
+
+      struct connectives_list current_conns;
+      int switch_conns;
+
+      current_conns = main_conns;
+      switch_conns = strcmp (AND, gui_conns.and);
+      if (switch_conns)
+	main_conns = gui_conns;
+
+      proof = aio_open (sd->file);
+      if (!proof)
+	return NULL;
+
+      if (switch_conns)
+	main_conns = current_conns;
+    }
+
+  return proof;
+}
+
 /* Evaluates a sentence given its data.
  *  input:
  *   sd - The sentence data to evaluate.
  *   ret_val - The return value.
- *   pf_vars - The variables from the proof.
+ *   pf_vars - The variables from the lines that precede it.
  *   lines - The lines from the proof.
+ *   subproofs - The subproofs of the proof.
+ *   trace - The trace to record the evaluation to, or NULL.
  *  output:
  *   The status message to output.
  */
 char *
-sen_data_evaluate (sen_data * sd, int * ret_val, list_t * pf_vars, list_t * lines)
+sen_data_evaluate (sen_data * sd, int * ret_val, var_set_t * pf_vars,
+		   list_t * lines, subproof_tree_t * subproofs,
+		   trace_t * trace)
 {
   if (sd->text[0] == '\0')
     {
@@ -163,10 +290,16 @@ sen_data_evaluate (sen_data * sd, int * ret_val, list_t * pf_vars, list_t * line
     }
 
   int ret;
+  double start;
+
+  start = trace_start (trace);
   ret = check_text (sd->text);
   if (ret == -1)
     return NULL;
 
+  if (trace_span (trace, TRACE_VALIDATE, sd->line_num, start, NULL) < 0)
+    return NULL;
+
   *ret_val = VALUE_TYPE_ERROR;
 
   switch (ret)
@@ -200,99 +333,43 @@ sen_data_evaluate (sen_data * sd, int * ret_val, list_t * pf_vars, list_t * line
   *ret_val = VALUE_TYPE_ERROR;
   const char * rule = rules_list[sd->rule];
 
-  vec_t * refs;
-
-  refs = init_vec (sizeof (char *));
-  if (!refs)
-    return NULL;
+  vec_t refs;
+  int in_sub;
 
-  int i;
+  // The references are only needed while the line is checked, so they
+  // borrow the sexprs of the lines.
+  vec_init_borrowed (&refs);
 
-  for (i = 0; sd->refs[i] != -1; i++)
-    {
-      item_t * cur_ref;
-      sen_data * ref_data;
+  start = trace_start (trace);
 
-      if (sd->refs[i] > lines->num_stuff)
-	return NULL;
-
-      cur_ref = ls_nth (lines, sd->refs[i] - 1);
-      ref_data = cur_ref->value;
-
-      ret = check_text (ref_data->text);
-      if (ret == -1)
-	return NULL;
-
-      if (ret < 0)
-	{
-	  destroy_str_vec (refs);
-	  *ret_val = VALUE_TYPE_REF;
-
-	  return _("One of the sentence's references has a text error.");
-	}
+  ret = sen_data_collect_refs (sd, lines, subproofs, &refs, &in_sub);
+  if (ret == -1)
+    return NULL;
 
-      unsigned char * ref_text;
-      ref_text = ref_data->sexpr;
+  if (ret == -2)
+    {
+      vec_str_fini (&refs);
+      *ret_val = VALUE_TYPE_REF;
 
-      ret = vec_str_add_obj (refs, ref_text);
-      if (ret == -1)
-	return NULL;
+      return _("One of the sentence's references has a text error.");
+    }
 
-      if (ref_data->subproof)
-	{
-	  ret = sen_data_can_select_as_ref (sd, ref_data);
-	  if (ret < 0)
-	    {
-	      sen_data * sen_0;
-	      item_t * ev_itr;
-
-	      ev_itr = ls_nth (lines, ref_data->line_num);
-	      while (((sen_data *) ev_itr->next->value)->depth >= ref_data->depth)
-		ev_itr = ev_itr->next;
-
-	      sen_0 = ev_itr->value;
-	      ret = check_text (sen_0->text);
-	      if (ret == -1)
-		return NULL;
-
-	      if (ret < 0)
-		{
-		  *ret_val = VALUE_TYPE_REF;
-		  destroy_str_vec (refs);
-		  return _("One of the sentence's references has a text error.");
-		}
-
-	      unsigned char * ref_text;
-	      ref_text = sen_0->sexpr;
-
-	      ret = vec_str_add_obj (refs, ref_text);
-	      if (ret == -1)
-		return NULL;
-	    }
-	  else if (sd->rule == RULE_SP)
-	    {
-	      return _("\'sp\' can only be used with a subproof as a reference.");
-	    }
-	}
+  if (in_sub && sd->rule == RULE_SP)
+    {
+      vec_str_fini (&refs);
+      return _("\'sp\' can only be used with a subproof as a reference.");
     }
 
-  // Next, get the variables.
+  if (trace_span (trace, TRACE_REFS, sd->line_num, start, NULL) < 0)
+    return NULL;
 
-  vec_t * vars = init_vec (sizeof (variable));
-  item_t * var_itr;
   proof_t * proof = NULL;
 
-  for (var_itr = pf_vars->head; var_itr; var_itr = var_itr->next)
-    {
-      variable * var = var_itr->value;
-      ret = vec_add_obj (vars, var);
-      if (ret == -1)
-	return NULL;
-    }
-
   char * eval_text, * fin_text;
   if (!sd->sexpr)
     {
+      start = trace_start (trace);
+
       eval_text = die_spaces_die (sd->text);
       if (!eval_text)
 	return NULL;
@@ -302,46 +379,64 @@ sen_data_evaluate (sen_data * sd, int * ret_val, list_t * pf_vars, list_t * line
 	return NULL;
       free (eval_text);
       sd->sexpr = fin_text;
+
+      if (trace_span (trace, TRACE_SEXPR, sd->line_num, start, NULL) < 0)
+	return NULL;
     }
   fin_text = sd->sexpr;
 
-  // Check for a file.
+  // Check for a file, whose result is cached by the file's contents.
+
+  char * proc_ret = NULL, * key = NULL;
 
   if (sd->file)
     {
-      // Obtain the extension.
-      int f_len;
-      f_len = strlen (sd->file);
+      char * lemma;
 
-      if (!strncmp (sd->file + f_len - 4, ".thy", 4))
+      lemma = process_cache_lemma (sd->file);
+      if (lemma)
 	{
-	  proof = proof_init ();
-	  if (!proof)
+	  key = process_cache_key (fin_text, &refs, rule, pf_vars, lemma);
+	  free (lemma);
+	  if (!key)
 	    return NULL;
 
-	  ret = parse_thy (sd->file, proof);
-	  if (ret == -1)
-	    return NULL;
+	  proc_ret = process_cache_find (key);
 	}
-      else
+
+      if (!proc_ret)
 	{
-	  struct connectives_list current_conns;
-	  current_conns = main_conns;
-	  main_conns = gui_conns;
+	  start = trace_start (trace);
 
-	  proof = aio_open (sd->file);
+	  proof = sen_data_open_lemma (sd);
 	  if (!proof)
 	    return NULL;
-	  main_conns = current_conns;
+
+	  if (trace_span (trace, TRACE_LEMMA, sd->line_num, start,
+			  sd->file) < 0)
+	    return NULL;
 	}
     }
 
-  char * proc_ret = process (fin_text, refs, rule, vars, proof);
   if (!proc_ret)
-    return NULL;
+    {
+      start = trace_start (trace);
+
+      proc_ret = process (fin_text, &refs, rule, pf_vars, proof);
+      if (!proc_ret)
+	return NULL;
+
+      if (trace_span (trace, TRACE_RULE, sd->line_num, start, rule) < 0)
+	return NULL;
+
+      if (key && process_cache_add (key, proc_ret) == -1)
+	return NULL;
+    }
+
+  if (key)
+    free (key);
 
-  destroy_str_vec (refs);
-  destroy_vec (vars);
+  vec_str_fini (&refs);
   if (proof)
     proof_destroy (proof);
 
@@ -352,59 +447,3 @@ sen_data_evaluate (sen_data * sd, int * ret_val, list_t * pf_vars, list_t * line
 
   return proc_ret;
 }
-
-/* Determines whether a sentence can select another one.
- *  input:
- *    sen - The sentence selecting.
- *    ref - The sentence being selected.
- *  output:
- *    The line number of the line to be selected.
- *    The negation of the line number if the entire subproof is to be selected.
- *    0 if ref can not be selected by sen.
- */
-int
-sen_data_can_select_as_ref (sen_data * sen, sen_data * ref)
-{
-  if (ref->line_num >= sen->line_num)
-    return 0;
-
-  int entire;
-
-  // Get indices of each.
-  // This isn't necessary if the sentence is a premise, or if it has depth == zero.
-  if (ref->premise || ref->depth == 0)
-    return ref->line_num;
-
-  int common_line;
-  int i;
-
-  common_line = 0;
-  for (i = 0; sen->indices[i] != -1 && ref->indices[i] != -1; i++)
-    {
-      if (sen->indices[i] != ref->indices[i])
-	break;
-    }
-
-  // If the set of the reference sentence's indices is a subset of
-  // the set of the focused sentence's indices, then the sentence can
-  // be selected as a reference.
-
-  if (ref->indices[i] == -1)
-    {
-      common_line = ref->line_num;
-      entire = 0;
-    }
-  else
-    {
-      common_line = ref->indices[i];
-      entire = 1;
-    }
-
-  if (ref->indices[i] != -1 && sen->indices[i] == -1)
-    entire = 1;
-
-  if (entire == 1)
-    common_line *= -1;
-
-  return common_line;
-}
@@ -35,6 +35,11 @@ enum VALUE_TYPES {
 
 typedef struct sen_data sen_data;
 typedef struct list list_t;
+typedef struct var_set var_set_t;
+typedef struct trace trace_t;
+typedef struct subproof_tree subproof_tree_t;
+typedef struct vector vec_t;
+typedef struct proof proof_t;
 
 // The sentence data structure.
 struct sen_data {
@@ -49,7 +54,6 @@ struct sen_data {
   int premise : 1;   // Whether or not this sentence is a premise.
   int subproof : 1;  // Whether or not this sentence starts a subproof.
   int depth;         // The depth of this sentence.  0 for all top levels.
-  int * indices;     // The line numbers of the subproofs that contain this sentence.
 
   int * refs;            // A list of sentences that are references.
 
@@ -65,8 +69,12 @@ sen_data * sen_data_init (int line_num, int rule, unsigned char * text,
 			  int subproof, int depth, unsigned char * sexpr);
 void sen_data_destroy (sen_data * sd);
 
+int sen_data_collect_refs (sen_data * sd, list_t * lines,
+			   subproof_tree_t * subproofs, vec_t * refs,
+			   int * in_sub);
+proof_t * sen_data_open_lemma (sen_data * sd);
 char * sen_data_evaluate (sen_data * sd, int * ret_val,
-			  list_t * vars, list_t * lines);
-int sen_data_can_select_as_ref (sen_data * sen, sen_data * ref);
+			  var_set_t * vars, list_t * lines,
+			  subproof_tree_t * subproofs, trace_t * trace);
 
 #endif /* ARIS_SEN_DATA_H */
@@ -22,7 +22,13 @@
 #include "sen-data.h"
 #include "app.h"
 #include "list.h"
+#include "vec.h"
+#include "order-tree.h"
 #include "process.h"
+#include "callbacks.h"
+
+#define MEM_SUBSYSTEM MEM_GUI
+#include "mem.h"
 
 /* Initializes a sentence parent.
  *  input:
@@ -83,6 +89,36 @@ sen_parent_init (sen_parent * sp, const char * title,
   sp->focused = NULL;
 
   sp->type = type;
+
+  sp->order = NULL;
+  sp->top_space = sp->bottom_space = NULL;
+  sp->shown = NULL;
+  sp->spare = NULL;
+  sp->row_height = SEN_PARENT_ROW_HEIGHT;
+  sp->top_height = sp->bottom_height = 0;
+  sp->layout_id = 0;
+  sp->focus_pending = 0;
+
+  // A proof can be long, so only the lines that are in or near the view
+  // are given widgets.  The spaces take up the room of the others.
+  if (type == SEN_PARENT_TYPE_PROOF)
+    {
+      sp->order = order_tree_init ();
+      sp->shown = init_list ();
+      sp->spare = init_vec (sizeof (sen_widgets));
+
+      sp->top_space = gtk_drawing_area_new ();
+      gtk_box_pack_start (GTK_BOX (sp->container), sp->top_space,
+			  FALSE, FALSE, 0);
+      sp->bottom_space = gtk_drawing_area_new ();
+      gtk_box_pack_end (GTK_BOX (sp->container), sp->bottom_space,
+			FALSE, FALSE, 0);
+
+      g_signal_connect (G_OBJECT (f_adj), "value-changed",
+			G_CALLBACK (sen_parent_scrolled), (gpointer) sp);
+      g_signal_connect (G_OBJECT (f_adj), "changed",
+			G_CALLBACK (sen_parent_scrolled), (gpointer) sp);
+    }
 }
 
 /* Destroys a sentence parent.
@@ -94,19 +130,51 @@ sen_parent_init (sen_parent * sp, const char * title,
 void
 sen_parent_destroy (sen_parent * sp)
 {
-  item_t * ev_itr, * nev_itr;
+  item_t * ev_itr;
 
-  for (ev_itr = sp->everything->head; ev_itr; ev_itr = nev_itr)
+  if (sp->shown)
     {
-      nev_itr = ev_itr->next;
-      sentence_destroy ((sentence *) ev_itr->value);
-      ev_itr->prev = ev_itr->next = ev_itr->value = NULL;
-      free (ev_itr);
+      GtkAdjustment * adj;
+      adj = gtk_scrolled_window_get_vadjustment (GTK_SCROLLED_WINDOW (sp->scrolledwindow));
+      g_signal_handlers_disconnect_matched (G_OBJECT (adj), G_SIGNAL_MATCH_DATA,
+					    0, 0, NULL, NULL, sp);
     }
 
-  free (sp->everything);
+  if (sp->layout_id)
+    g_source_remove (sp->layout_id);
+  sp->layout_id = 0;
+
+  for (ev_itr = sp->everything->head; ev_itr; ev_itr = ev_itr->next)
+    sentence_destroy ((sentence *) ev_itr->value);
+
+  destroy_list (sp->everything);
   sp->everything = NULL;
 
+  if (sp->order)
+    order_tree_destroy (sp->order);
+  sp->order = NULL;
+
+  if (sp->shown)
+    {
+      while (sp->shown->head)
+	ls_rem_obj (sp->shown, sp->shown->head);
+      free (sp->shown);
+    }
+  sp->shown = NULL;
+
+  if (sp->spare)
+    {
+      int i;
+      for (i = 0; i < sp->spare->num_stuff; i++)
+	{
+	  sen_widgets * w = vec_nth (sp->spare, i);
+	  gtk_widget_destroy (w->panel);
+	  g_object_unref (w->panel);
+	}
+      destroy_vec (sp->spare);
+    }
+  sp->spare = NULL;
+
   sp->font = -1;
   sp->focused = NULL;
   gtk_widget_destroy (sp->window);
@@ -131,6 +199,9 @@ sen_parent_set_font (sen_parent * sp, int new_font)
     sentence_set_font (ev_itr->value, new_font);
 
   sp->font = new_font;
+
+  // The height of the lines changes with the font.
+  sen_parent_queue_layout (sp);
 }
 
 /* Inserts a sentence into a sentence parent.
@@ -138,13 +209,11 @@ sen_parent_set_font (sen_parent * sp, int new_font)
  *    sp - the sentence parent into which the sentence is being inserted.
  *    sd - the sentence data from which to initialize the sentence.
  *    fcs - the item after which to insert the new sentence.
- *    new_order - the new order in the container in which this sentence will be.
  *  output:
  *    the iterator in sp->everything that the sentence will be, or NULL on error.
  */
 item_t *
-sen_parent_ins_sentence (sen_parent * sp, sen_data * sd,
-			 item_t * fcs, int new_order)
+sen_parent_ins_sentence (sen_parent * sp, sen_data * sd, item_t * fcs)
 {
   item_t * itm;
   sentence * sen;
@@ -153,13 +222,34 @@ sen_parent_ins_sentence (sen_parent * sp, sen_data * sd,
   if (!sen)
     return NULL;
 
-  gtk_box_pack_start (GTK_BOX (sp->container), sen->panel, FALSE, FALSE, 0);
-  gtk_box_reorder_child (GTK_BOX (sp->container), sen->panel, new_order);
-
   itm = ls_ins_obj (sp->everything, sen, fcs);
+  if (!itm)
+    return NULL;
+
+  if (sp->order)
+    {
+      sen->order = order_tree_insert (sp->order,
+				      (fcs) ? SENTENCE (fcs->value)->order : NULL,
+				      itm);
+      if (!sen->order)
+	return NULL;
+    }
+
   sp->focused = itm;
 
-  gtk_widget_show_all (sen->panel);
+  // The new line is given widgets, and focus, once the lines after it
+  // have been renumbered.
+  if (sp->shown)
+    {
+      sp->focus_pending = 1;
+      sen_parent_queue_layout (sp);
+    }
+  else
+    {
+      gtk_box_pack_start (GTK_BOX (sp->container), sen->panel,
+			  FALSE, FALSE, 0);
+      gtk_widget_show_all (sen->panel);
+    }
 
   return itm;
 }
@@ -176,7 +266,7 @@ sen_parent_rem_sentence (sen_parent * sp, sentence * sen)
 {
   item_t * ev_itr, * target = NULL;
 
-  target = ls_find (sp->everything, sen);
+  target = sen_parent_find (sp, sen);
 
   // Only need to start this past the target sentence.
   for (ev_itr = target->next; ev_itr; ev_itr = ev_itr->next)
@@ -203,12 +293,53 @@ sen_parent_rem_sentence (sen_parent * sp, sentence * sen)
 	sen_parent_set_focus (sp, new_focus);
     }
 
+  if (sen->order)
+    order_tree_remove (sp->order, sen->order);
+  sen->order = NULL;
+
   ls_rem_obj (sp->everything, target);
   sentence_destroy (sen);
+  sen_parent_queue_layout (sp);
 
   return new_focus;
 }
 
+/* Gets the item at a position of a sentence parent.
+ *  input:
+ *    sp - the sentence parent.
+ *    n - the position, starting from 0.
+ *  output:
+ *    the item at position n, or NULL if there isn't one.
+ */
+item_t *
+sen_parent_nth (sen_parent * sp, int n)
+{
+  order_node_t * node;
+
+  if (!sp->order)
+    return ls_nth (sp->everything, n);
+
+  node = order_tree_nth (sp->order, n);
+  return (node) ? node->value : NULL;
+}
+
+/* Finds the item of a sentence in a sentence parent.
+ *  input:
+ *    sp - the sentence parent.
+ *    sen - the sentence to find.
+ *  output:
+ *    the item of sen, or NULL if it isn't in sp.
+ */
+item_t *
+sen_parent_find (sen_parent * sp, sentence * sen)
+{
+  // Proof lines know their node in the order tree.
+  if (sen->order)
+    return sen->order->value;
+
+  return ls_find (sp->everything, sen);
+}
+
 /* Sets an item as the focus of a sentence parent.
  *  input:
  *    sp - the sentence parent which is having its focus changed.
@@ -220,9 +351,246 @@ void
 sen_parent_set_focus (sen_parent * sp, item_t * focus)
 {
   sp->focused = focus;
+
+  // The line might not have widgets yet, so scroll to it first.
+  if (sp->shown)
+    {
+      sp->focus_pending = 1;
+      sen_parent_layout (sp);
+      return;
+    }
+
   gtk_widget_grab_focus (((sentence *) focus->value)->entry);
 }
 
+/* Lays out a sentence parent the next time the main loop is idle.
+ *  input:
+ *    data - the sentence parent to lay out.
+ *  output:
+ *    FALSE, so that it is only called once.
+ */
+static gboolean
+sen_parent_layout_idle (gpointer data)
+{
+  sen_parent * sp = data;
+
+  sp->layout_id = 0;
+  sen_parent_layout (sp);
+
+  return FALSE;
+}
+
+/* Queues the layout of a sentence parent, so that many changes to its
+ *  lines only lay it out once.
+ *  input:
+ *    sp - the sentence parent to lay out.
+ *  output:
+ *    none.
+ */
+void
+sen_parent_queue_layout (sen_parent * sp)
+{
+  if (!sp->shown || sp->layout_id)
+    return;
+
+  // This runs before the window is redrawn, so the spaces are never seen.
+  sp->layout_id = g_idle_add_full (G_PRIORITY_HIGH_IDLE,
+				   sen_parent_layout_idle, sp, NULL);
+}
+
+/* Sets the height of one of the spaces of a sentence parent.
+ *  input:
+ *    space - the space to set the height of.
+ *    cur_height - the current height of the space.
+ *    height - the new height of the space.
+ *  output:
+ *    none.
+ */
+static void
+sen_parent_set_space (GtkWidget * space, int * cur_height, int height)
+{
+  if (*cur_height == height)
+    return;
+
+  *cur_height = height;
+  gtk_widget_set_size_request (space, -1, height);
+
+  if (height > 0)
+    gtk_widget_show (space);
+  else
+    gtk_widget_hide (space);
+}
+
+/* Gives widgets to the lines of a sentence parent that are in or near its
+ *  view, and takes them from the rest.  The lines are laid out a page above
+ *  and below the view, so that scrolling doesn't show the spaces.
+ *  input:
+ *    sp - the sentence parent to lay out.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+int
+sen_parent_layout (sen_parent * sp)
+{
+  GtkAdjustment * adj;
+  item_t * itm, * next;
+  sentence * sen;
+  int num_lines, page, first, last, i, pos, fcs_line, sep_shown;
+  double value, page_size;
+
+  if (!sp->shown)
+    return 0;
+
+  if (sp->layout_id)
+    g_source_remove (sp->layout_id);
+  sp->layout_id = 0;
+
+  // Measure a shown line, since the height depends on the font.
+  if (sp->shown->head)
+    {
+      GtkAllocation alloc;
+      gtk_widget_get_allocation (SENTENCE (sp->shown->head->value)->panel,
+				 &alloc);
+      if (alloc.height > 1)
+	sp->row_height = alloc.height
+	  + gtk_box_get_spacing (GTK_BOX (sp->container));
+    }
+
+  adj = gtk_scrolled_window_get_vadjustment (GTK_SCROLLED_WINDOW (sp->scrolledwindow));
+  value = gtk_adjustment_get_value (adj);
+  page_size = gtk_adjustment_get_page_size (adj);
+
+  // Until the window is shown, the view is as tall as it was asked to be.
+  if (page_size < sp->row_height)
+    {
+      int height;
+      gtk_widget_get_size_request (sp->window, NULL, &height);
+      page_size = height;
+    }
+
+  num_lines = sp->everything->num_stuff;
+  page = (int) page_size / sp->row_height + 1;
+
+  // Scroll to the focused line, if it is out of view.
+  fcs_line = -1;
+  if (sp->focus_pending && sp->focused)
+    {
+      fcs_line = sentence_get_line_no (SENTENCE (sp->focused->value)) - 1;
+
+      if (fcs_line * sp->row_height < value
+	  || (fcs_line + 1) * sp->row_height > value + page_size)
+	{
+	  double upper;
+
+	  value = fcs_line * sp->row_height - (page_size - sp->row_height) / 2;
+	  upper = gtk_adjustment_get_upper (adj) - page_size;
+	  if (value > upper)
+	    value = upper;
+	  if (value < 0)
+	    value = 0;
+
+	  gtk_adjustment_set_value (adj, value);
+	}
+    }
+
+  first = (int) value / sp->row_height - page;
+  if (fcs_line >= 0 && (fcs_line < first || fcs_line >= first + 3 * page))
+    first = fcs_line - page;
+  if (first < 0)
+    first = 0;
+
+  last = first + 3 * page;
+  if (last > num_lines)
+    {
+      last = num_lines;
+      first = (last > 3 * page) ? last - 3 * page : 0;
+    }
+
+  // Take the widgets from the lines that are no longer near the view.
+  for (itm = sp->shown->head; itm; itm = next)
+    {
+      int line;
+
+      next = itm->next;
+      sen = itm->value;
+      line = sentence_get_line_no (sen) - 1;
+
+      if (line < first || line >= last)
+	{
+	  sentence_gui_release (sen);
+	  ls_rem_obj (sp->shown, itm);
+	}
+    }
+
+  // Give widgets to the lines that are, and put them in order.
+  pos = 1;
+  sep_shown = 0;
+  itm = sen_parent_nth (sp, first);
+
+  for (i = first; itm && i < last; i++, itm = itm->next)
+    {
+      sen = itm->value;
+
+      if (!sen->panel)
+	{
+	  sentence_gui_init (sen);
+	  if (!sen->panel)
+	    return -1;
+
+	  if (!ls_push_obj (sp->shown, sen))
+	    return -1;
+
+	  gtk_widget_show_all (sen->panel);
+
+	  // A new line can only take focus once it has a place.
+	  if (sp->focus_pending && itm == sp->focused)
+	    {
+	      sen->sig_id = g_signal_connect (G_OBJECT (sen->entry),
+					      "size-allocate",
+					      G_CALLBACK (sentence_mapped),
+					      (gpointer) sen);
+	      sp->focus_pending = 0;
+	    }
+	}
+
+      // Lines are numbered by their positions, so only the labels of
+      // the lines that are shown are kept up to date.
+      if (sen->line_num != i + 1)
+	sentence_set_line_no (sen, i + 1);
+
+      gtk_box_reorder_child (GTK_BOX (sp->container), sen->panel, pos++);
+
+      // The separator comes after the last premise.
+      if (sp->separator && sen->premise
+	  && (!itm->next || !SENTENCE (itm->next->value)->premise))
+	{
+	  gtk_box_reorder_child (GTK_BOX (sp->container), sp->separator, pos++);
+	  sep_shown = 1;
+	}
+    }
+
+  if (sp->separator)
+    {
+      if (sep_shown)
+	gtk_widget_show (sp->separator);
+      else
+	gtk_widget_hide (sp->separator);
+    }
+
+  sen_parent_set_space (sp->top_space, &sp->top_height,
+			first * sp->row_height);
+  sen_parent_set_space (sp->bottom_space, &sp->bottom_height,
+			(num_lines - last) * sp->row_height);
+
+  if (sp->focus_pending && sp->focused)
+    {
+      sp->focus_pending = 0;
+      gtk_widget_grab_focus (SENTENCE (sp->focused->value)->entry);
+    }
+
+  return 0;
+}
+
 /* Sets the status bar message of a sentence parent.
  *  input:
  *    sp - the sentence parent for which to set the status bar text.
@@ -32,6 +32,22 @@ typedef struct sen_parent sen_parent;
 typedef struct sentence sentence;
 typedef struct item item_t;
 typedef struct sen_data sen_data;
+typedef struct sen_widgets sen_widgets;
+
+// The amount of pixels a line is assumed to take up until one is shown.
+
+#define SEN_PARENT_ROW_HEIGHT 28
+
+// The widgets of a line, kept to show another line with once it is hidden.
+
+struct sen_widgets {
+  GtkWidget * panel;     // The container of the other widgets.
+  GtkWidget * eventbox;  // Contains the line number label.
+  GtkWidget * line_no;   // The line number label.
+  GtkWidget * indent;    // Indents the line by its depth.
+  GtkWidget * entry;     // The text view.
+  GtkWidget * value;     // The value label.
+};
 
 // The data structure that goal and aris_proof 'inherit' from.
 
@@ -46,11 +62,23 @@ struct sen_parent {
   GtkWidget * container;       // The container of the sentences.
   GtkWidget * separator;       // The separator that separates prems from concs.
   GtkAccelGroup * accel;       // The accelerator for the keybindings.
+  GtkWidget * top_space;       // Stands in for the lines above those shown.
+  GtkWidget * bottom_space;    // Stands in for the lines below those shown.
 
   struct list * everything;  // The list of sentences.
+  struct order_tree * order; // The positions of the sentences of a proof.
   struct item * focused;     // The currently focused sentence.
   int font;                  // The index of the font in the_app->fonts.
   int type;                  // The type of sentence parent.
+
+  // Only the lines of a proof that are in or near the view have widgets.
+  struct list * shown;       // The sentences that have widgets.
+  struct vector * spare;     // The widgets of hidden lines, for reuse.
+  int row_height;            // The height of a line, with its spacing.
+  int top_height;            // The height of the top space.
+  int bottom_height;         // The height of the bottom space.
+  unsigned int layout_id;    // The source of the pending layout, or 0.
+  int focus_pending : 1;     // Whether the focused line still needs focus.
 };
 
 void sen_parent_init (sen_parent * sp, const char * title,
@@ -61,8 +89,12 @@ void sen_parent_destroy (sen_parent * sp);
 void sen_parent_set_font (sen_parent * sp, int new_font);
 void sen_parent_set_sb (sen_parent * sp, char * sb_text);
 item_t * sen_parent_ins_sentence (sen_parent * sp, sen_data * sd,
-				  item_t * fcs, int new_order);
+				  item_t * fcs);
 item_t * sen_parent_rem_sentence (sen_parent * sp, sentence * sen);
+item_t * sen_parent_nth (sen_parent * sp, int n);
+item_t * sen_parent_find (sen_parent * sp, sentence * sen);
 void sen_parent_set_focus (sen_parent * sp, item_t * focus);
+void sen_parent_queue_layout (sen_parent * sp);
+int sen_parent_layout (sen_parent * sp);
 
 #endif
@@ -31,9 +31,18 @@
 #include "process.h"
 #include "goal.h"
 #include "vec.h"
+#include "token.h"
+#include "subproof.h"
+#include "order-tree.h"
+
+#define MEM_SUBSYSTEM MEM_GUI
+#include "mem.h"
 
 static char * sen_values[6] = {" ", "T", "F", "*", "?", "#"};
 
+// The id of the last sentence that was initialized.
+static int sen_last_id = 0;
+
 // GTextCharPredicate for determining the location of the comment.
 static gboolean
 comment_predicate (gunichar ch, gpointer user_data)
@@ -70,41 +79,17 @@ sentence_init (sen_data * sd, sen_parent * sp, item_t * fcs)
       if (!fcs)
 	ln = 1;
       else
-	ln = SENTENCE (fcs->value)->line_num + 1;
+	ln = sentence_get_line_no (fcs->value) + 1;
     }
 
-  // Initialize the GUI components.
   sen->premise = sd->premise;
   sen->depth = sd->depth;
-  sentence_gui_init (sen);
   sen->parent = sp;
   sen->value_type = VALUE_TYPE_BLANK;
+  sen->line_bg = -1;
   sen->selected = 0;
   sen->sexpr = NULL;
-
-  sen->indices = (int *) calloc (sen->depth + 1, sizeof (int));
-  CHECK_ALLOC (sen->indices, NULL);
-
-  int i = 0;
-
-  if (!sen->premise)
-    {
-      sentence * fcs_sen;
-
-      int index_copy_end;
-
-      fcs_sen = fcs->value;
-
-      index_copy_end = (fcs_sen->depth < sen->depth) ? fcs_sen->depth : sen->depth;
-
-      for (i = 0; i < index_copy_end; i++)
-	sen->indices[i] = fcs_sen->indices[i];
-
-      if (sd->subproof)
-	sen->indices[i++] = ln;
-    }
-
-  sen->indices[i] = -1;
+  sen->id = ++sen_last_id;
 
   // Set the data components.
   ret = sentence_set_line_no (sen, ln);
@@ -118,8 +103,6 @@ sentence_init (sen_data * sd, sen_parent * sp, item_t * fcs)
       sen->text = (unsigned char *) calloc (strlen (sd->text) + 1, sizeof (char));
       CHECK_ALLOC (sen->text, NULL);
       strcpy (sen->text, sd->text);
-      gtk_text_buffer_set_text (gtk_text_view_get_buffer (GTK_TEXT_VIEW (sen->entry)),
-				(const char *) sd->text, -1);
     }
   else
     {
@@ -128,37 +111,35 @@ sentence_init (sen_data * sd, sen_parent * sp, item_t * fcs)
       sen->text[0] = '\0';
     }
 
+  sen->tokens = token_list_init (sen->text);
+  if (!sen->tokens)
+    return NULL;
+
   sen->refs = init_list ();
   if (!sen->refs)
     return NULL;
 
   if (sd->refs)
     {
+      int i;
+
       for (i = 0; sd->refs[i] != -1; i++)
 	{
 	  int cur_line;
 	  item_t * ev_itr;
 
 	  cur_line = sd->refs[i];
-	  ev_itr = sen->parent->everything->head;
 
-	  if (cur_line > ln)
+	  if (cur_line > ln || cur_line < 1)
 	    continue;
 
-	  for (; ev_itr != NULL; ev_itr = ev_itr->next)
+	  ev_itr = sen_parent_nth (sen->parent, cur_line - 1);
+	  if (ev_itr)
 	    {
-	      sentence * ref_sen;
-	      ref_sen = ev_itr->value;
-
-	      if (ref_sen->line_num == cur_line)
-		{
-		  item_t * itm;
-		  itm = ls_push_obj (sen->refs, ref_sen);
-		  if (!itm)
-		    return NULL;
-
-		  break;
-		}
+	      item_t * itm;
+	      itm = ls_push_obj (sen->refs, ev_itr->value);
+	      if (!itm)
+		return NULL;
 	    }
 	}
     }
@@ -179,19 +160,35 @@ sentence_init (sen_data * sd, sen_parent * sp, item_t * fcs)
   sen->reference = 0;
   sen->subproof = sd->subproof;
 
-  sentence_set_font (sen, sen->parent->font);
-
   if (!sd->premise)
-    sentence_set_bg (sen, BG_COLOR_CYAN);
+    sen->bg_color = BG_COLOR_CYAN;
   else
-    sentence_set_bg (sen, BG_COLOR_WHITE);
+    sen->bg_color = BG_COLOR_WHITE;
 
-  sentence_connect_signals (sen);
+  if (sp->type == SEN_PARENT_TYPE_PROOF)
+    {
+      ret = aris_proof_index_mark (ARIS_PROOF (sp), sen);
+      if (ret < 0)
+	return NULL;
+    }
+  else
+    {
+      // The lines of a proof are given widgets once they come into view,
+      // but goals are short enough to be shown all at once.
+      sentence_gui_init (sen);
+      if (!sen->panel)
+	return NULL;
+
+      sen->sig_id = g_signal_connect (G_OBJECT (sen->entry), "size-allocate",
+				      G_CALLBACK (sentence_mapped),
+				      (gpointer) sen);
+    }
 
   return sen;
 }
 
-/* Initializes the gui elements of a sentence.
+/* Initializes the gui elements of a sentence, reusing those of a hidden
+ *  sentence if its parent has any, and shows the sentence's data in them.
  * input:
  *   sen - the sentence to initialize the gui elements of.
  * output:
@@ -200,61 +197,144 @@ sentence_init (sen_data * sd, sen_parent * sp, item_t * fcs)
 void
 sentence_gui_init (sentence * sen)
 {
-  // Initialize the GUI components.
-  sen->panel = gtk_hbox_new (FALSE, 0);
-
-  sen->line_no = gtk_label_new (NULL);
-  gtk_label_set_justify (GTK_LABEL (sen->line_no), GTK_JUSTIFY_FILL);
-  gtk_label_set_width_chars (GTK_LABEL (sen->line_no), 3);
-
-  sen->eventbox = gtk_event_box_new ();
-  gtk_container_add (GTK_CONTAINER (sen->eventbox), sen->line_no);
-  gtk_event_box_set_above_child (GTK_EVENT_BOX (sen->eventbox), TRUE);
+  sen_parent * sp = sen->parent;
+  int reused = 0;
 
-  GtkWidget * widget;
-  if (sen->depth > 0)
+  if (sp->spare && sp->spare->num_stuff > 0)
     {
-      widget = gtk_label_new (NULL);
-      g_object_set (G_OBJECT (widget), "width-chars", 4 * sen->depth, NULL);
+      sen_widgets * w;
+
+      w = vec_nth (sp->spare, sp->spare->num_stuff - 1);
+      sen->panel = w->panel;
+      sen->eventbox = w->eventbox;
+      sen->line_no = w->line_no;
+      sen->indent = w->indent;
+      sen->entry = w->entry;
+      sen->value = w->value;
+      vec_pop_obj (sp->spare);
+      reused = 1;
     }
+  else
+    {
+      // Initialize the GUI components.
+      sen->panel = gtk_hbox_new (FALSE, 0);
 
-  sen->entry = gtk_text_view_new ();
+      sen->line_no = gtk_label_new (NULL);
+      gtk_label_set_justify (GTK_LABEL (sen->line_no), GTK_JUSTIFY_FILL);
+      gtk_label_set_width_chars (GTK_LABEL (sen->line_no), 3);
 
-  sen->value = gtk_label_new (NULL);
-  gtk_label_set_justify (GTK_LABEL (sen->value), GTK_JUSTIFY_FILL);
-  gtk_label_set_width_chars (GTK_LABEL (sen->value), 2);
+      sen->eventbox = gtk_event_box_new ();
+      gtk_container_add (GTK_CONTAINER (sen->eventbox), sen->line_no);
+      gtk_event_box_set_above_child (GTK_EVENT_BOX (sen->eventbox), TRUE);
 
-  gtk_box_pack_start (GTK_BOX (sen->panel), sen->eventbox, FALSE, FALSE, 0);
-  
-  if (sen->depth > 0)
-    {
-      gtk_box_pack_start (GTK_BOX (sen->panel), widget, FALSE, FALSE, 0);
-    }
+      sen->indent = gtk_label_new (NULL);
+
+      sen->entry = gtk_text_view_new ();
+
+      sen->value = gtk_label_new (NULL);
+      gtk_label_set_justify (GTK_LABEL (sen->value), GTK_JUSTIFY_FILL);
+      gtk_label_set_width_chars (GTK_LABEL (sen->value), 2);
+
+      gtk_box_pack_start (GTK_BOX (sen->panel), sen->eventbox, FALSE, FALSE, 0);
+      gtk_box_pack_start (GTK_BOX (sen->panel), sen->indent, FALSE, FALSE, 0);
+      gtk_box_pack_start (GTK_BOX (sen->panel), sen->entry, TRUE, TRUE, 0);
+      gtk_box_pack_start (GTK_BOX (sen->panel), sen->value, FALSE, FALSE, 0);
+
+      GtkTextTag * tag;
+      GtkTextTagTable * table;
+
+      table = gtk_text_buffer_get_tag_table (gtk_text_view_get_buffer
+					     (GTK_TEXT_VIEW (sen->entry)));
+
+      tag = gtk_text_tag_new ("hilight");
+      g_object_set (G_OBJECT (tag),
+		    "background-gdk", the_app->bg_colors[BG_COLOR_EMERALD],
+		    NULL);
 
-  gtk_box_pack_start (GTK_BOX (sen->panel), sen->entry, TRUE, TRUE, 0);
-  gtk_box_pack_start (GTK_BOX (sen->panel), sen->value, FALSE, FALSE, 0);
+      gtk_text_tag_table_add (table, tag);
+
+      tag = gtk_text_tag_new ("negative");
+      g_object_set (G_OBJECT (tag),
+		    "background-gdk", the_app->bg_colors[BG_COLOR_CRIMSON],
+		    NULL);
+
+      gtk_text_tag_table_add (table, tag);
+    }
 
   sen->mark = NULL;
 
-  GtkTextTag * tag;
-  GtkTextTagTable * table;
+  // Show the data of the sentence.
+  g_object_set (G_OBJECT (sen->indent), "width-chars", 4 * sen->depth, NULL);
+  gtk_text_buffer_set_text (gtk_text_view_get_buffer (GTK_TEXT_VIEW (sen->entry)),
+			    (const char *) sen->text, -1);
+
+  int line_num = sentence_get_line_no (sen);
+  gtk_label_set_text (GTK_LABEL (sen->line_no), NULL);
+  if (line_num > 0)
+    sentence_set_line_no (sen, line_num);
+
+  gtk_label_set_text (GTK_LABEL (sen->value), sen_values[sen->value_type]);
+  sentence_set_font (sen, sp->font);
+  sentence_set_bg (sen, sen->bg_color);
+  sentence_set_line_bg (sen, sen->line_bg);
+
+  sentence_connect_signals (sen);
 
-  table = gtk_text_buffer_get_tag_table (gtk_text_view_get_buffer
-					 (GTK_TEXT_VIEW (sen->entry)));
+  // The lines of a proof are put in order by its layout.
+  if (sp->shown)
+    {
+      gtk_box_pack_start (GTK_BOX (sp->container), sen->panel,
+			  FALSE, FALSE, 0);
+      if (reused)
+	g_object_unref (sen->panel);
+    }
+}
 
-  tag = gtk_text_tag_new ("hilight");
-  g_object_set (G_OBJECT (tag),
-		"background-gdk", the_app->bg_colors[BG_COLOR_EMERALD],
-		NULL);
+/* Hides a sentence, keeping its gui elements to show another sentence with.
+ *  input:
+ *    sen - the sentence to hide.
+ *  output:
+ *    none.
+ */
+void
+sentence_gui_release (sentence * sen)
+{
+  sen_parent * sp = sen->parent;
+  GtkTextBuffer * buffer;
+  sen_widgets w;
 
-  gtk_text_tag_table_add (table, tag);
+  if (!sen->panel)
+    return;
 
-  tag = gtk_text_tag_new ("negative");
-  g_object_set (G_OBJECT (tag),
-		"background-gdk", the_app->bg_colors[BG_COLOR_CRIMSON],
-		NULL);
+  // Removing the panel takes the focus from it, so keep the signals until
+  // the sentence has been left.
+  g_object_ref (sen->panel);
+  gtk_container_remove (GTK_CONTAINER (sp->container), sen->panel);
 
-  gtk_text_tag_table_add (table, tag);
+  buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (sen->entry));
+  g_signal_handlers_disconnect_matched (G_OBJECT (sen->entry),
+					G_SIGNAL_MATCH_DATA,
+					0, 0, NULL, NULL, sen);
+  g_signal_handlers_disconnect_matched (G_OBJECT (buffer),
+					G_SIGNAL_MATCH_DATA,
+					0, 0, NULL, NULL, sen);
+
+  w.panel = sen->panel;
+  w.eventbox = sen->eventbox;
+  w.line_no = sen->line_no;
+  w.indent = sen->indent;
+  w.entry = sen->entry;
+  w.value = sen->value;
+
+  if (!sp->spare || vec_add_obj (sp->spare, &w) < 0)
+    {
+      gtk_widget_destroy (sen->panel);
+      g_object_unref (sen->panel);
+    }
+
+  sen->panel = sen->eventbox = sen->line_no = NULL;
+  sen->indent = sen->entry = sen->value = NULL;
+  sen->mark = NULL;
 }
 
 /* Destroys a sentence.
@@ -267,6 +347,12 @@ sentence_gui_init (sentence * sen)
 void
 sentence_destroy (sentence * sen)
 {
+  if (sen->parent && sen->parent->type == SEN_PARENT_TYPE_PROOF)
+    aris_proof_index_remove (ARIS_PROOF (sen->parent), sen);
+
+  if (sen->parent && sen->parent->shown && sen->panel)
+    ls_rem_obj_value (sen->parent->shown, sen);
+
   if (sen->refs)
     destroy_list (sen->refs);
   sen->refs = NULL;
@@ -287,15 +373,16 @@ sentence_destroy (sentence * sen)
 
   sen->parent = NULL;
 
-  if (sen->indices)
-    free (sen->indices);
-  sen->indices = NULL;
-
   if (sen->sexpr)
     free (sen->sexpr);
   sen->sexpr = NULL;
 
-  gtk_widget_destroy (sen->panel);
+  if (sen->tokens)
+    token_list_destroy (sen->tokens);
+  sen->tokens = NULL;
+
+  if (sen->panel)
+    gtk_widget_destroy (sen->panel);
   free (sen);
 }
 
@@ -326,7 +413,7 @@ sentence_copy_to_data (sentence * sen)
 	  int line_num;
 
 	  sen = ref_itr->value;
-	  line_num = sen->line_num;
+	  line_num = sentence_get_line_no (sen);
 	  refs[i++] = line_num;
 	}
     }
@@ -338,21 +425,30 @@ sentence_copy_to_data (sentence * sen)
 
   refs[i] = -1;
 
-  sd = sen_data_init (sen->line_num, sen->rule,
+  sd = sen_data_init (sentence_get_line_no (sen), sen->rule,
 		      sen->text, refs, sen->premise, sen->file,
 		      sen->subproof, sen->depth, sen->sexpr);
 
   if (!sd)
     return NULL;
 
-  sd->indices = (int *) calloc (sen->depth + 1, sizeof (int));
-  CHECK_ALLOC (sd->indices, NULL);
+  return sd;
+}
 
-  for (i = 0; i < sen->depth; i++)
-    sd->indices[i] = sen->indices[i];
-  sd->indices[i] = -1;
+/* Gets the line number of a sentence.  The lines of a proof are numbered
+ *  by their positions, which are found in O(log n).
+ *  input:
+ *    sen - the sentence to get the line number of.
+ *  output:
+ *    the line number.
+ */
+int
+sentence_get_line_no (sentence * sen)
+{
+  if (!sen->order)
+    return sen->line_num;
 
-  return sd;
+  return order_node_pos (sen->order) + 1;
 }
 
 /* Sets the line number of a sentence.
@@ -371,14 +467,20 @@ sentence_set_line_no (sentence * sen, int new_line_no)
 	return -2;
 
       sen->line_num = -1;
-      gtk_label_set_text (GTK_LABEL (sen->line_no), NULL);
+      if (sen->line_no)
+	gtk_label_set_text (GTK_LABEL (sen->line_no), NULL);
       return 0;
     }
 
+  sen->line_num = new_line_no;
+
+  // The label is set once the sentence is shown.
+  if (!sen->line_no)
+    return 0;
+
   char * new_label;
   double label_len = log10 ((double) new_line_no);
   int sp_chk = 0;
-  sen->line_num = new_line_no;
 
   //The length of any number in base 10 will be log10(n) + 1
   new_label = (char *) calloc ((int)label_len + 2, sizeof (char));
@@ -397,6 +499,7 @@ sentence_set_line_no (sentence * sen, int new_line_no)
 
   //Free the memory from new_label.
   free (new_label);
+  return 0;
 }
 
 /* Sets the font of a sentence.
@@ -409,6 +512,9 @@ sentence_set_line_no (sentence * sen, int new_line_no)
 void
 sentence_set_font (sentence * sen, int font)
 {
+  if (!sen->panel)
+    return;
+
   LABEL_SET_FONT (sen->line_no, the_app->fonts[font]);
   ENTRY_SET_FONT (sen->entry, the_app->fonts[font]);
   LABEL_SET_FONT (sen->value, the_app->fonts[font]);
@@ -424,12 +530,33 @@ sentence_set_font (sentence * sen, int font)
 void
 sentence_set_bg (sentence * sen, int bg_color)
 {
+  sen->bg_color = bg_color;
+  if (!sen->panel)
+    return;
+
   COLOR_TYPE inv;
   INVERT (the_app->bg_colors[bg_color], inv);
   gtk_widget_modify_bg (sen->entry, GTK_STATE_NORMAL, the_app->bg_colors[bg_color]);
   gtk_widget_modify_base (sen->entry, GTK_STATE_NORMAL, the_app->bg_colors[bg_color]);
   gtk_widget_modify_bg (sen->entry, GTK_STATE_SELECTED, inv);
-  sen->bg_color = bg_color;
+}
+
+/* Sets the background color of the line number of a sentence.
+ *  input:
+ *    sen - the sentence to change the line number background of.
+ *    line_bg - the index in the_app->bg_colors, or -1 for the default.
+ *  output:
+ *    none.
+ */
+void
+sentence_set_line_bg (sentence * sen, int line_bg)
+{
+  sen->line_bg = line_bg;
+  if (!sen->panel)
+    return;
+
+  gtk_widget_modify_bg (sen->eventbox, GTK_STATE_NORMAL,
+			(line_bg < 0) ? NULL : the_app->bg_colors[line_bg]);
 }
 
 /* Sets the evaluation value of a sentence.
@@ -443,7 +570,11 @@ void
 sentence_set_value (sentence * sen, int value_type)
 {
   sen->value_type = value_type;
-  gtk_label_set_text (GTK_LABEL (sen->value), sen_values[value_type]);
+  if (sen->panel)
+    gtk_label_set_text (GTK_LABEL (sen->value), sen_values[value_type]);
+
+  if (sen->parent && sen->parent->type == SEN_PARENT_TYPE_PROOF)
+    aris_proof_history_mark (ARIS_PROOF (sen->parent), sen, 0);
 }
 
 /* Connects the callback signals to a sentence.
@@ -468,8 +599,6 @@ sentence_connect_signals (sentence * sen)
   g_signal_connect (G_OBJECT (gtk_text_view_get_buffer (GTK_TEXT_VIEW (sen->entry))),
 		    "changed",
 		    G_CALLBACK (sentence_changed), (gpointer) sen);
-  sen->sig_id = g_signal_connect (G_OBJECT (sen->entry), "size-allocate",
-				  G_CALLBACK (sentence_mapped), (gpointer) sen);
 }
 
 /* Selects the references and rule of a sentence when it is selected.
@@ -482,7 +611,7 @@ int
 sentence_in (sentence * sen)
 {
   sen_parent * sp = sen->parent;
-  item_t * e_itr = ls_find (sp->everything, sen);
+  item_t * e_itr = sen_parent_find (sp, sen);
   // Find the item in everything that corresponds to this sentence.
 
   sp->focused = e_itr;
@@ -543,15 +672,24 @@ sentence_out (sentence * sen)
   if (!sp)
     return -1;
 
-  GtkTextBuffer * buffer;
-  GtkTextIter start, end;
+  if (sen->entry)
+    {
+      GtkTextBuffer * buffer;
+      GtkTextIter start, end;
 
-  buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (sen->entry));
+      buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (sen->entry));
 
-  gtk_text_buffer_get_bounds (buffer, &start, &end);
-  gtk_text_buffer_remove_tag_by_name (buffer, "hilight", &start, &end);
-  gtk_text_buffer_remove_tag_by_name (buffer, "negative", &start, &end);
+      gtk_text_buffer_get_bounds (buffer, &start, &end);
+      gtk_text_buffer_remove_tag_by_name (buffer, "hilight", &start, &end);
+      gtk_text_buffer_remove_tag_by_name (buffer, "negative", &start, &end);
+    }
 
+  // Leaving a line finishes the edit of it.
+  if (sp->type == SEN_PARENT_TYPE_PROOF)
+    {
+      if (aris_proof_history_commit (ARIS_PROOF (sp)) < 0)
+	return -1;
+    }
 
   if (!sen->premise)
     {
@@ -597,7 +735,7 @@ select_reference (sentence * sen)
   sentence * fcs_sen;
   fcs_sen = sp->focused->value;
 
-  if (sen->line_num >= fcs_sen->line_num)
+  if (sentence_get_line_no (sen) >= sentence_get_line_no (fcs_sen))
     {
       if (the_app->verbose)
 	printf ("Must select reference that comes before focused.\n");
@@ -607,8 +745,7 @@ select_reference (sentence * sen)
   sentence * ref_sen = sen;
   int entire, ret;
 
-  // Get indices of each.
-  // This isn't necessary if the sentence is a premise, or if it has depth == zero.
+  // Selecting a line in a subproof that has ended selects the subproof.
   ret = sentence_can_select_as_ref (fcs_sen, sen);
   if (ret < 0)
     {
@@ -621,9 +758,15 @@ select_reference (sentence * sen)
     }
 
   item_t * ref_itr;
-  ref_itr = ls_nth (sp->everything, ret - 1);
+  ref_itr = sen_parent_nth (sp, ret - 1);
   ref_sen = ref_itr->value;
 
+  if (sp->type == SEN_PARENT_TYPE_PROOF)
+    {
+      if (aris_proof_history_mark ((aris_proof *) sp, fcs_sen, 1) < 0)
+	return -2;
+    }
+
   if (ref_sen->reference)
     {
       // Remove sen from focused's references.
@@ -652,6 +795,10 @@ select_reference (sentence * sen)
       ret = aris_proof_set_changed ((aris_proof *) sp, 1);
       if (ret < 0)
 	return -2;
+
+      ret = aris_proof_history_commit ((aris_proof *) sp);
+      if (ret < 0)
+	return -2;
     }
 
   return 0;
@@ -689,7 +836,7 @@ select_sentence (sentence * sen)
 	  sen_depth = sen->depth;
 
 	  item_t * ev_itr;
-	  ev_itr = ls_find (sp->everything, sen);
+	  ev_itr = sen_parent_find (sp, sen);
 	  for (; ev_itr; ev_itr = ev_itr->next)
 	    {
 	      sentence * ev_sen;
@@ -719,7 +866,7 @@ select_sentence (sentence * sen)
 	  sen_depth = sen->depth;
 
 	  item_t * ev_itr;
-	  ev_itr = ls_find (sp->everything, sen);
+	  ev_itr = sen_parent_find (sp, sen);
 	  for (ev_itr = ev_itr->next; ev_itr; ev_itr = ev_itr->next)
 	    {
 	      sentence * ev_sen;
@@ -875,7 +1022,7 @@ sentence_key (sentence * sen, int key, int ctrl)
 	    ? sp->everything->tail : sp->focused->prev;
 	  if (the_app->verbose)
 	    printf ("Got Key Up\n");
-	  gtk_widget_grab_focus (SENTENCE (dst->value)->entry);
+	  sen_parent_set_focus (sp, dst);
 	  ret = 0;
 	  break;
 	case GDK_KEY_Down:
@@ -883,7 +1030,7 @@ sentence_key (sentence * sen, int key, int ctrl)
 	    ? sp->everything->head : sp->focused->next;
 	  if (the_app->verbose)
 	    printf ("Got Key Down\n");
-	  gtk_widget_grab_focus (SENTENCE (dst->value)->entry);
+	  sen_parent_set_focus (sp, dst);
 	  ret = 0;
 	  break;
 	case GDK_KEY_Left:
@@ -1009,7 +1156,7 @@ sentence_set_reference (sentence * sen, int reference, int entire_subproof)
     {
       item_t * sub_itr;
 
-      sub_itr = ls_find (sen->parent->everything, sen);
+      sub_itr = sen_parent_find (sen->parent, sen);
 
       for (sub_itr = sub_itr->next; sub_itr; sub_itr = sub_itr->next)
 	{
@@ -1048,7 +1195,7 @@ sentence_set_selected (sentence * sen, int selected)
     {
       item_t * sub_itr;
 
-      sub_itr = ls_find (sen->parent->everything, sen);
+      sub_itr = sen_parent_find (sen->parent, sen);
 
       for (sub_itr = sub_itr->next; sub_itr; sub_itr = sub_itr->next)
 	{
@@ -1068,20 +1215,49 @@ sentence_set_selected (sentence * sen, int selected)
   sen->selected = selected;
 }
 
+/* Gets a message describing the syntax errors found in the tokens of a sentence.
+ *  input:
+ *    sen - the sentence to check.
+ *  output:
+ *    the message to display.
+ */
+static char *
+sentence_token_error (sentence * sen)
+{
+  switch (token_list_check (sen->tokens))
+    {
+    case -2:
+      return _("The sentence has mismatched parenthesis.");
+    case -3:
+      return _("The sentence has invalid connectives.");
+    case -4:
+      return _("The sentence has invalid quantifiers.");
+    }
+
+  return _("Ready");
+}
+
 /* Processes a text change in a sentence.
  *  input:
  *    sen - the sentence to process a change in.
+ *    text - the new text of the sentence.
  *  ouput:
  *    0 on success, -1 on memory error.
  */
-
-int
-sentence_text_changed (sentence * sen)
+static int
+sentence_update_text (sentence * sen, const char * text)
 {
   sen_parent * sp = sen->parent;
+
+  if (sp->type == SEN_PARENT_TYPE_PROOF)
+    {
+      if (aris_proof_history_mark (ARIS_PROOF (sp), sen, 1) < 0)
+	return -1;
+    }
+
   sentence_set_value (sen, VALUE_TYPE_BLANK);
 
-  item_t * e_itr = ls_find (sp->everything, sen);
+  item_t * e_itr = sen_parent_find (sp, sen);
 
   for (e_itr = e_itr->next; e_itr; e_itr = e_itr->next)
     {
@@ -1097,27 +1273,38 @@ sentence_text_changed (sentence * sen)
 	}
     }
 
+  if (sp->type == SEN_PARENT_TYPE_PROOF)
+    {
+      int ret;
+      ret = aris_proof_index_mark (ARIS_PROOF (sp), sen);
+      if (ret < 0)
+	return -1;
+    }
+
   if (sen->sexpr)
     {
       free (sen->sexpr);
       sen->sexpr = NULL;
     }
 
-  const char * text;
-  GtkTextBuffer * buffer;
-  GtkTextIter start, end, semi;
+  GtkTextBuffer * buffer = NULL;
+  GtkTextIter semi;
   int text_len, old_len;
 
-  buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (sen->entry));
-  gtk_text_buffer_get_bounds (buffer, &start, &end);
-  text = gtk_text_buffer_get_text (buffer, &start, &end, FALSE);
+  if (sen->entry)
+    buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (sen->entry));
   text_len = strlen (text);
 
-  int diff_pos;
+  int diff_pos, ret_tok;
 
   old_len = strlen (sen->text);
   diff_pos = find_difference (sen->text, (unsigned char *) text);
 
+  ret_tok = token_list_update (sen->tokens, sen->text,
+			       (const unsigned char *) text, diff_pos);
+  if (ret_tok < 0)
+    return -1;
+
   if (0)
     {
       //TODO: Check for semi-colon and set mark.
@@ -1169,7 +1356,11 @@ sentence_text_changed (sentence * sen)
       if (ret < 0)
 	return -1;
 
-      gtk_widget_modify_bg (sen->eventbox, GTK_STATE_NORMAL, NULL);
+      sentence_set_line_bg (sen, -1);
+
+      // Give feedback on the syntax of the sentence as it is typed.
+      if (text_len > 0)
+	aris_proof_set_sb (ARIS_PROOF (sp), sentence_token_error (sen));
 
       if (ARIS_PROOF (sp)->goal->goals->num_stuff > 0)
 	{
@@ -1177,7 +1368,7 @@ sentence_text_changed (sentence * sen)
 	  mod_itm = ARIS_PROOF (sp)->goal->goals->head;
 	  for (; mod_itm; mod_itm = mod_itm->next)
 	    {
-	      if (SENTENCE (mod_itm->value)->line_num == sen->line_num)
+	      if (SENTENCE (mod_itm->value)->line_num == sentence_get_line_no (sen))
 		{
 		  sentence_set_line_no (SENTENCE (mod_itm->value), -1);
 		  sentence_set_value (SENTENCE (mod_itm->value), VALUE_TYPE_BLANK);
@@ -1196,17 +1387,18 @@ sentence_text_changed (sentence * sen)
 
       item_t * mod_itm;
       sentence * mod_sen;
-      mod_itm = ls_nth ((SEN_PARENT (GOAL (sp)->parent)->everything), sen->line_num);
+      mod_itm = sen_parent_nth (SEN_PARENT (GOAL (sp)->parent), sen->line_num - 1);
       if (mod_itm)
 	{
 
 	  mod_sen = mod_itm->value;
-	  gtk_widget_modify_bg (mod_sen->eventbox, GTK_STATE_NORMAL, NULL);
+	  sentence_set_line_bg (mod_sen, -1);
 	  gtk_label_set_text (GTK_LABEL (sen->line_no), "");
 	  sen->line_num = 0;
 	}
     }
 
+  free (sen->text);
   sen->text = (unsigned char *) calloc (text_len + 1, sizeof (char));
   CHECK_ALLOC (sen->text, -1);
 
@@ -1214,6 +1406,52 @@ sentence_text_changed (sentence * sen)
   return 0;
 }
 
+/* Processes a text change in the text view of a sentence.
+ *  input:
+ *    sen - the sentence to process a change in.
+ *  ouput:
+ *    0 on success, -1 on memory error.
+ */
+int
+sentence_text_changed (sentence * sen)
+{
+  GtkTextBuffer * buffer;
+  GtkTextIter start, end;
+  char * text;
+  int ret;
+
+  buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (sen->entry));
+  gtk_text_buffer_get_bounds (buffer, &start, &end);
+  text = gtk_text_buffer_get_text (buffer, &start, &end, FALSE);
+
+  ret = sentence_update_text (sen, text);
+  g_free (text);
+
+  return ret;
+}
+
+/* Sets the text of a sentence, whether or not it is shown.
+ *  input:
+ *    sen - the sentence to set the text of.
+ *    text - the new text.
+ *  ouput:
+ *    0 on success, -1 on memory error.
+ */
+int
+sentence_set_text (sentence * sen, const unsigned char * text)
+{
+  // A shown sentence is updated through its text view.
+  if (sen->entry)
+    {
+      GtkTextBuffer * buffer;
+      buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (sen->entry));
+      gtk_text_buffer_set_text (buffer, (const char *) text, -1);
+      return 0;
+    }
+
+  return sentence_update_text (sen, (const char *) text);
+}
+
 /* Checks if only the subproof premise or the entire subproof should be selected.
  *  input:
  *    sen - the sentence that is adding a reference.
@@ -1227,23 +1465,14 @@ sentence_check_entire (sentence * sen, sentence * ref)
   if (!ref->subproof)
     return 0;
 
-  if (ref->depth > sen->depth)
-    return 1;
+  int last_line, line_num, ref_line;
 
-  int i;
-  for (i = 0; i < ref->depth; i++)
-    {
-      if (ref->indices[i] != sen->indices[i])
-	break;
-    }
+  line_num = sentence_get_line_no (sen);
+  ref_line = sentence_get_line_no (ref);
+  last_line = subproof_tree_last_line (ARIS_PROOF (sen->parent)->subproofs,
+				       ref_line);
 
-  int ret;
-  if (ref->indices[i] == -1)
-    ret = 0;
-  else
-    ret = 1;
-
-  return ret;
+  return (line_num < ref_line || line_num > last_line);
 }
 
 /* Checks a sentence's rule against the boolean rules.
@@ -1280,50 +1509,18 @@ sentence_check_boolean_rule (sentence * sen, int boolean)
 int
 sentence_can_select_as_ref (sentence * sen, sentence * ref)
 {
-  if (ref->line_num >= sen->line_num)
+  int line_num, ref_line;
+
+  line_num = sentence_get_line_no (sen);
+  ref_line = sentence_get_line_no (ref);
+
+  if (ref_line >= line_num)
     {
       if (the_app->verbose)
 	printf ("Must select reference that comes before focused.\n");
       return 0;
     }
 
-  int entire;
-
-  // Get indices of each.
-  // This isn't necessary if the sentence is a premise, or if it has depth == zero.
-  if (ref->premise || ref->indices[0] == -1)
-    return ref->line_num;
-
-  int common_line;
-  int i;
-
-  common_line = 0;
-  for (i = 0; sen->indices[i] != -1 && ref->indices[i] != -1; i++)
-    {
-      if (sen->indices[i] != ref->indices[i])
-	break;
-    }
-
-  // If the set of the reference sentence's indices is a subset of
-  // the set of the focused sentence's indices, then the sentence can
-  // be selected as a reference.
-
-  if (ref->indices[i] == -1)
-    {
-      common_line = ref->line_num;
-      entire = 0;
-    }
-  else
-    {
-      common_line = ref->indices[i];
-      entire = 1;
-    }
-
-  if (ref->indices[i] != -1 && sen->indices[i] == -1)
-    entire = 1;
-
-  if (entire == 1)
-    common_line *= -1;
-
-  return common_line;
+  return subproof_tree_can_select (ARIS_PROOF (sen->parent)->subproofs,
+				   line_num, ref_line);
 }
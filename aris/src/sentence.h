@@ -30,22 +30,26 @@ typedef struct sen_data sen_data;
 typedef struct list list_t;
 typedef struct item item_t;
 typedef struct proof proof_t;
+typedef struct token_list token_list_t;
+typedef struct history_line history_line_t;
+typedef struct order_node order_node_t;
 
 
 struct sentence {
   // Data components
-  int line_num;           // Keeps track of the line number.
+  int line_num;           // The line number of a goal, or the one last
+                          // shown for a line of a proof.
   int rule;               // Index of the rule of this sentence.
   unsigned char * text;   // Contains the text of this item.
   int reference : 1;      // Whether or not this sentence is a reference.
   unsigned char * sexpr;  // The sexpr text of this sentence.
+  token_list_t * tokens;  // The tokens of the text, kept up to date while editing.
 
   unsigned char ** vars;  // The variables used in this sentence.
 
   int premise : 1;   // Whether or not this sentence is a premise.
   int subproof : 1;  // Whether or not this sentence starts a subproof.
   int depth;         // The depth of this sentence.  0 for all top levels.
-  int * indices;     // The line numbers of the subproofs that contain this sentence.
 
   list_t * refs;         // A list of sentences that are references.
 
@@ -53,26 +57,37 @@ struct sentence {
 
   proof_t * proof;        // The proof for this sentence, if lemma is used.
 
-  // GUI components
+  // GUI components, which are NULL while the line is out of view.
   GtkWidget * panel;      // Contains the other items. - GtkHBox
   GtkWidget * entry;      // Actual Text Entry. - GtkTextView
   GtkWidget * line_no;    // The line number of this sentence. - GtkLabel
   GtkWidget * value;      // True / False indicator. - GtkLabel
   GtkWidget * eventbox;   // Contains the line number label.
+  GtkWidget * indent;     // Indents the sentence by its depth. - GtkLabel
   GtkTextMark * mark;     // The mark that keeps track of the semi-colon in a sentence.
   int selected : 1;       // Whether or not this sentence is selected.
   int bg_color;    // The index in the_app->bg_colors of the background color.
   int value_type;  // The index of the value type of this sentence.
+  int line_bg;     // The index of the line number's background color, or -1.
 
   sen_parent * parent;  // The parent of this sentence.
 
   int sig_id;  // The signal id of the mapping signal for this sentence.
 
   int matching_parens : 1;  // Whether or not parentheses are being matched.
+
+  int indexed : 1;      // Whether or not this sentence is in its proof's index.
+  int index_dirty : 1;  // Whether or not this sentence needs to be re-indexed.
+
+  int id;                  // Identifies this sentence while line numbers change.
+  order_node_t * order;    // The node of this sentence in its proof's order.
+  history_line_t * hist;   // The record of this sentence in its proof's history.
+  int hist_dirty : 1;      // Whether or not this sentence needs a new record.
 };
 
 sentence * sentence_init (sen_data * sd, sen_parent * sp, item_t * fcs);
 void sentence_gui_init (sentence * sen);
+void sentence_gui_release (sentence * sen);
 void sentence_destroy (sentence * sen);
 
 sen_data * sentence_copy_to_data (sentence * sen);
@@ -81,13 +96,16 @@ int sentence_out (sentence * sen);
 int sentence_in (sentence * sen);
 int sentence_key (sentence * sen, int key, int ctrl);
 int sentence_text_changed (sentence * sen);
+int sentence_set_text (sentence * sen, const unsigned char * text);
 
 int select_reference (sentence * sen);
 int select_sentence (sentence * sen);
 
+int sentence_get_line_no (sentence * sen);
 int sentence_set_line_no (sentence * sen, int new_line_no);
 void sentence_set_font (sentence * sen, int font);
 void sentence_set_bg (sentence * sen, int bg_color);
+void sentence_set_line_bg (sentence * sen, int line_bg);
 void sentence_set_value (sentence * sen, int value_type);
 int sentence_collect_variables (sentence * sen);
 void sentence_set_reference (sentence * sen, int reference, int entire_subproof);
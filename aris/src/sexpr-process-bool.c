@@ -18,6 +18,10 @@
 
 #include "sexpr-process.h"
 #include "vec.h"
+#include "formula.h"
+
+#define MEM_SUBSYSTEM MEM_RULES
+#include "mem.h"
 
 // Boolean rules follow the same structure as equivalence rules.
 
@@ -74,154 +78,79 @@ process_bool (unsigned char * conc, vec_t * prems, const char * rule)
   return ret;
 }
 
-char *
-proc_bi (unsigned char * prem, unsigned char * conc)
+/* Determines whether or not a formula is a conjunction with a tautology,
+ * or a disjunction with a contradiction.
+ *  input:
+ *    fm - the formula.
+ *  output:
+ *    1 if it is, 0 otherwise.
+ */
+static int
+bool_is_identity (formula_t * fm)
 {
-  // Standard long-short sentence setup.
-
-  unsigned char * ln_sen, * sh_sen;
-  int p_len, c_len, l_len;
+  formula_t * gen;
 
-  p_len = strlen (prem);
-  c_len = strlen (conc);
+  if (fm->type != FORMULA_LIST || fm->num_args != 3)
+    return 0;
 
-  if (p_len > c_len)
-    {
-      ln_sen = prem;  l_len = p_len;
-      sh_sen = conc;
-    }
-  else
-    {
-      ln_sen = conc;  l_len = c_len;
-      sh_sen = prem;
-    }
-
-  int i;
-  i = find_difference (ln_sen, sh_sen);
-  if (i == -1)
-    return NO_DIFFERENCE;
+  gen = fm->args[2];
+  if (gen->type != FORMULA_SYMBOL)
+    return 0;
 
-  int li, si;
-
-  si = li = i;
-  if (sh_sen[si] == '(')
-    {
-      si--;
-      if (si < 0)
-	return _("Boolean Identity constructed incorrectly.");
-    }
-  else if (si > 0
-	   && (!strncmp (sh_sen + si - 1, S_AND, S_CL)
-	       || !strncmp (sh_sen + si - 1, S_OR, S_CL)
-	       || !strncmp (sh_sen + si - 1, S_CON, S_CL)
-	       || !strncmp (sh_sen + si - 1, S_BIC, S_CL)))
-    {
-      while (sh_sen[si] != '(')
-	si--;
-      si--;
-    }
-
-  si = find_unmatched_o_paren (sh_sen, si);
-  if (si == -1)
-    {
-      // This is the entire sentence.
-      li = 0;
-    }
-  else
-    {
-      if (ln_sen[li] != '(')
-	{
-	  li = find_unmatched_o_paren (ln_sen, li);
-	  if (li == -1)
-	    return _("There must be a connective in the longer sentence.");
-	}
-
-      int ret_chk;
-      ret_chk = sexpr_find_unmatched (ln_sen, sh_sen, &li, &si);
-      if (ret_chk == -1)
-	return NULL;
-
-      if (li < 0)
-	return _("Boolean Identity constructed incorrectly.");
-    }
-
-  if (ln_sen[li] != '(')
-    return _("Boolean Identity constructed incorrectly.");
-
-  int tmp_pos;
-  unsigned char * tmp_str;
-
-  tmp_pos = parse_parens (ln_sen, li, &tmp_str);
-  if (tmp_pos == -2)
-    return NULL;
-
-  int ftc;
-  unsigned char * lsen, * rsen, conn[S_CL + 1];
-
-  conn[0] = '\0';
-  lsen = rsen = NULL;
-
-  ftc = sexpr_find_top_connective (tmp_str, conn, &lsen, &rsen);
-  if (ftc == -1)
-    return NULL;
-  free (tmp_str);
-
-  if (ftc < 0)
-    {
-      if (lsen)  free (lsen);
-      if (rsen)  free (rsen);
+  return ((formula_is_conn (fm, S_AND) && !strcmp (gen->text, S_TAU))
+	  || (formula_is_conn (fm, S_OR) && !strcmp (gen->text, S_CTR)));
+}
 
-      return _("There must be generalities at the difference.");
-    }
+/* Checks boolean identity at a difference.
+ *  input:
+ *    prem, conc - the differing parts of the premise and conclusion.
+ *  output:
+ *    CORRECT, an error message, or NULL on memory error.
+ */
+static char *
+diff_bi (formula_t * prem, formula_t * conc)
+{
+  formula_t * ln_sen;
+  int ret;
 
-  if (strcmp (conn, S_AND) && strcmp (conn, S_OR))
+  if (bool_is_identity (prem))
     {
-      free (lsen);
-      free (rsen);
-
-      return _("There must be a conjunction or a disjunction in one sentence.");
+      ret = sexpr_diff_parts (prem->args[1], conc, diff_bi);
+      if (ret != 0)
+	return (ret == -1) ? NULL : CORRECT;
     }
 
-  if ((!strcmp (conn, S_AND) && strcmp (rsen, S_TAU))
-      && (!strcmp (conn, S_OR) && strcmp (rsen, S_CTR)))
+  if (bool_is_identity (conc))
     {
-      free (lsen);
-      free (rsen);
-
-      return _("There must be a tautology or a contradiction in the generalities.");
+      ret = sexpr_diff_parts (conc->args[1], prem, diff_bi);
+      if (ret != 0)
+	return (ret == -1) ? NULL : CORRECT;
     }
-  free (rsen);
-
-  unsigned char * oth_sen;
-  int oth_pos;
-
-  oth_sen = (unsigned char *) calloc (l_len - 2 * S_CL - 3, sizeof (char));
-  CHECK_ALLOC (oth_sen, NULL);
-  strncpy (oth_sen, ln_sen, li);
-  oth_pos = li;
 
-  oth_pos += sprintf (oth_sen + oth_pos, "%s", lsen);
-  free (lsen);
-
-  strcpy (oth_sen + oth_pos, ln_sen + tmp_pos + 1);
-
-  char * ret_str;
+  // Find the error from whichever sentence has generalities.
 
-  if (ln_sen == conc)
-    ret_str = proc_bi (sh_sen, oth_sen);
+  if (prem->type == FORMULA_LIST && prem->num_args == 3)
+    ln_sen = prem;
+  else if (conc->type == FORMULA_LIST && conc->num_args == 3)
+    ln_sen = conc;
   else
-    ret_str = proc_bi (oth_sen, sh_sen);
+    return _("There must be generalities at the difference.");
 
-  if (!ret_str)
-    return NULL;
-  free (oth_sen);
+  if (!formula_is_conn (ln_sen, S_AND) && !formula_is_conn (ln_sen, S_OR))
+    return _("There must be a conjunction or a disjunction in one sentence.");
 
-  if (ret_str == NO_DIFFERENCE || ret_str == CORRECT)
-    return CORRECT;
+  if (!bool_is_identity (ln_sen))
+    return _("There must be a tautology or a contradiction in the generalities.");
 
   return _("Boolean Identity constructed incorrectly.");
 }
 
+char *
+proc_bi (unsigned char * prem, unsigned char * conc)
+{
+  return sexpr_diff_rule (prem, conc, diff_bi);
+}
+
 char *
 proc_bd (unsigned char * prem, unsigned char * conc)
 {
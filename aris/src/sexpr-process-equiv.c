@@ -33,10 +33,21 @@
  *  Using these, construct what should be the other sentence.
  *  run recursion, check for NO_DIFFERENCE or CORRECT.
  *  return generic error otherwise.
+ *
+ * Implication, DeMorgan, distribution, equivalence and double negation
+ * are instead given as patterns in the table of rewrite.c, and are checked
+ * by rewrite_check on the trees of the sentences.  When no pattern fits,
+ * the check of the difference of each rule, given to rewrite_check, finds
+ * what is wrong, so that the error names the part that doesn't fit.
  */
 
 #include "sexpr-process.h"
 #include "vec.h"
+#include "formula.h"
+#include "rewrite.h"
+
+#define MEM_SUBSYSTEM MEM_RULES
+#include "mem.h"
 
 int
 recurse_co (unsigned char * sen_0, unsigned char * sen_1)
@@ -131,6 +142,18 @@ recurse_co (unsigned char * sen_0, unsigned char * sen_1)
 	  if (!scope_1)
 	    return -1;
 
+	  // Only one of the sentences is a quantifier.
+	  if (scope_0[0] == '\0' || scope_1[0] == '\0')
+	    {
+	      if (scope_0[0] != '\0')
+		free (scope_0);
+	      if (scope_1[0] != '\0')
+		free (scope_1);
+	      if (var_0)  free (var_0);
+	      if (var_1)  free (var_1);
+	      return -2;
+	    }
+
 	  int cmp;
 	  cmp = !strcmp (var_0, var_1);
 
@@ -308,6 +331,18 @@ recurse_id (unsigned char * sen_0, unsigned char * sen_1)
 	  if (!scope_1)
 	    return -1;
 
+	  // Only one of the sentences is a quantifier.
+	  if (scope_0[0] == '\0' || scope_1[0] == '\0')
+	    {
+	      if (scope_0[0] != '\0')
+		free (scope_0);
+	      if (scope_1[0] != '\0')
+		free (scope_1);
+	      if (var_0)  free (var_0);
+	      if (var_1)  free (var_1);
+	      return -2;
+	    }
+
 	  int cmp;
 	  cmp = !strcmp (var_0, var_1);
 
@@ -421,7 +456,7 @@ process_equivalence (unsigned char * conc, vec_t * prems, const char * rule)
       if (prems->num_stuff != 1)
 	return _("DeMorgan requires one (1) reference.");
 
-      ret = proc_dm (prem, conc, -1);
+      ret = proc_dm (prem, conc);
       if (!ret)
 	return NULL;
     }
@@ -461,7 +496,7 @@ process_equivalence (unsigned char * conc, vec_t * prems, const char * rule)
       if (prems->num_stuff != 1)
 	return _("Distribution requires one (1) reference.");
 
-      ret = proc_dt (prem, conc, -1);
+      ret = proc_dt (prem, conc);
       if (!ret)
 	return NULL;
     } /* End of distribution. */
@@ -509,334 +544,142 @@ process_equivalence (unsigned char * conc, vec_t * prems, const char * rule)
   return ret;
 }
 
-char *
-proc_im (unsigned char * prem, unsigned char * conc)
+/* Checks implication at a difference.
+ *  input:
+ *    prem, conc - the differing parts of the premise and conclusion.
+ *  output:
+ *    CORRECT, an error message, or NULL on memory error.
+ */
+static char *
+diff_im (formula_t * prem, formula_t * conc)
 {
-  unsigned char * dis_sen, * con_sen;
-  int p_len, c_len, d_len;
-
-  p_len = strlen (prem);
-  c_len = strlen (conc);
+  formula_t * dis, * con;
+  int ret;
 
-  if (p_len > c_len)
+  if (formula_is_conn (prem, S_OR))
     {
-      dis_sen = prem;  d_len = p_len;
-      con_sen = conc;
+      dis = prem;
+      con = conc;
     }
-  else
+  else if (formula_is_conn (conc, S_OR))
     {
-      dis_sen = conc;  d_len = c_len;
-      con_sen = prem;
+      dis = conc;
+      con = prem;
     }
-
-  int i;
-
-  i = find_difference (dis_sen, con_sen);
-  if (i == -1)
-    return NO_DIFFERENCE;
-
-  // i might be zero if this is an incorrect usage of im.
-  // same with i == 1.
-  // Only occurs if there is no top connective on one, or a quantifier.
-
-  if (i < 2)
-    return _("Incorrect usage of implication.");
-
-  int tmp_pos;
-  unsigned char * tmp_str;
-
-  tmp_pos = parse_parens (dis_sen, i - 2, &tmp_str);
-  if (tmp_pos == -2)
-    return NULL;
-  if (!tmp_str)
-    return _("Implication constructed incorrectly.");
-
-  int ftc;
-  unsigned char * lsen, * rsen, * n_lsen;
-
-  ftc = sexpr_find_top_connective (tmp_str, S_OR, &lsen, &rsen);
-  if (ftc == -1)
-    return NULL;
-
-  free (tmp_str);
-
-  if (ftc < 0)
+  else
     {
-      if (lsen)  free (lsen);
-      if (rsen)  free (rsen);
-
       return _("One sentence must contain a disjunction.");
     }
 
-  if (!sexpr_not_check (lsen))
-    {
-      free (lsen);
-      free (rsen);
-      return _("The left disjunct must have a negation.");
-    }
-
-  n_lsen = sexpr_elim_not (lsen);
-  if (!n_lsen)
-    return NULL;
-
-  free (lsen);
+  if (dis->num_args != 3)
+    return _("One sentence must contain a disjunction.");
 
-  // Construct what should be the other sentence.
+  if (!formula_is_conn (dis->args[1], S_NOT))
+    return _("The left disjunct must have a negation.");
 
-  unsigned char * oth_sen;
-  int oth_pos;
+  if (!formula_is_conn (con, S_CON) || con->num_args != 3)
+    return _("Implication constructed incorrectly.");
 
-  oth_sen = (unsigned char * ) calloc (d_len - 2 - S_NL, sizeof (char));
-  CHECK_ALLOC (oth_sen, NULL);
-  strncpy (oth_sen, dis_sen, i - 1);
-  oth_pos = i - 1;
+  ret = sexpr_diff_parts (dis->args[1]->args[1], con->args[1], diff_im);
+  if (ret == 1)
+    ret = sexpr_diff_parts (dis->args[2], con->args[2], diff_im);
 
-  oth_pos += sprintf (oth_sen + oth_pos, "%s %s %s", S_CON, n_lsen, rsen);
-  free (n_lsen);
-  free (rsen);
-  strcpy (oth_sen + oth_pos, dis_sen + tmp_pos);
-
-  char * ret_str;
-  if (dis_sen == conc)
-    ret_str = proc_im (con_sen, oth_sen);
-  else
-    ret_str = proc_im (oth_sen, con_sen);
-  if (!ret_str)
+  if (ret == -1)
     return NULL;
 
-  free (oth_sen);
-  if (ret_str == NO_DIFFERENCE || ret_str == CORRECT)
-    return CORRECT;
+  if (!ret)
+    return _("Implication constructed incorrectly.");
 
-  return _("Implication constructed incorrectly.");
+  return CORRECT;
 }
 
 char *
-proc_dm (unsigned char * prem, unsigned char * conc, int mode_guess)
+proc_im (unsigned char * prem, unsigned char * conc)
 {
-  int i;
-  i = find_difference (prem, conc);
-  if (i == -1)
-    return NO_DIFFERENCE;
+  return rewrite_check (prem, conc, REWRITE_IM, diff_im);
+}
 
-  int p_len, c_len, mode;
+/* Checks DeMorgan at a difference.
+ *  input:
+ *    prem, conc - the differing parts of the premise and conclusion.
+ *  output:
+ *    CORRECT, an error message, or NULL on memory error.
+ */
+static char *
+diff_dm (formula_t * prem, formula_t * conc)
+{
+  formula_t * not_sen, * oth_sen, * neg;
+  int ret, j;
 
-  if (mode_guess == -1)
+  if (formula_is_conn (prem, S_NOT))
     {
-      p_len = strlen (prem);
-      c_len = strlen (conc);
-      if (p_len != c_len)
-	mode = 0;
-      else
-	mode = 1;
+      not_sen = prem;
+      oth_sen = conc;
     }
-  else
+  else if (formula_is_conn (conc, S_NOT))
     {
-      mode = mode_guess;
+      not_sen = conc;
+      oth_sen = prem;
     }
-
-  if (mode == 0)
+  else
     {
-      // Determine which sentence has the negation on it.
-
-      unsigned char * not_sen, * oth_sen;
-      int n_len;
-
-      if (i == 0)
-	return _("DeMorgan constructed incorrectly.");
-
-      if (!strncmp (prem + i - 1, S_NOT, S_NL))
-	{
-	  not_sen = prem;  n_len = p_len;
-	  oth_sen = conc;
-	}
-      else if (!strncmp (conc + i - 1, S_NOT, S_NL))
-	{
-	  not_sen = conc;  n_len = c_len;
-	  oth_sen = prem;
-	}
-      else
-	{
-	  return _("There must be a negation at the difference.");
-	}
+      return _("There must be a negation at the difference.");
+    }
 
-      // Determine the scope, and remove the negation.
+  neg = not_sen->args[1];
 
-      int tmp_pos;
-      unsigned char * tmp_str;
+  if (neg->type == FORMULA_QUANT)
+    {
+      // The other sentence must negate the scope of the other quantifier.
 
-      tmp_pos = parse_parens (not_sen, i - 2, &tmp_str);
-      if (tmp_pos == -2)
-	return NULL;
-      if (!tmp_str)
+      if (oth_sen->type != FORMULA_QUANT || oth_sen->quant == neg->quant
+	  || !formula_is_conn (oth_sen->args[0], S_NOT))
 	return _("DeMorgan constructed incorrectly.");
 
-      unsigned char * elim_sen;
-
-      elim_sen = sexpr_elim_not (tmp_str);
-      if (!elim_sen)
-	return NULL;
-      free (tmp_str);
-
-      int gg;
-      vec_t * gg_vec;
-      unsigned char conn[S_CL + 1];
-
-      gg_vec = init_vec (sizeof (char *));
-      if (!gg_vec)
-	return NULL;
-
-      conn[0] = '\0';
-      gg = sexpr_get_generalities (elim_sen, conn, gg_vec);
-      if (gg == -1)
+      ret = sexpr_diff_parts (neg->args[0], oth_sen->args[0]->args[1],
+			      diff_dm);
+      if (ret == -1)
 	return NULL;
-      free (elim_sen);
-
-      if (gg == 1)
-	{
-	  destroy_str_vec (gg_vec);
-	  return _("There must be generalities on the negation sentence.");
-	}
-
-      if (strcmp (conn, S_AND) && strcmp (conn, S_OR))
-	{
-	  destroy_str_vec (gg_vec);
-	  return _("The negation sentence must be negating either a conjunction or a disjunction.");
-	}
-
-      unsigned char oth_conn[S_CL + 1];
-      int j;
-
-      if (!strcmp (conn, S_AND))
-	strcpy (oth_conn, S_OR);
-      else
-	strcpy (oth_conn, S_AND);
 
-      // Construct what should be the other sentence.
-
-      unsigned char * cons_sen;
-      int cons_pos, alloc_size;
-
-      alloc_size = n_len + (gg_vec->num_stuff - 1) * (S_NL + 3);
-      cons_sen = (unsigned char *) calloc (alloc_size + 1, sizeof (char));
-      CHECK_ALLOC (cons_sen, NULL);
-      strncpy (cons_sen, not_sen, i - 1);
-      cons_pos = i - 1;
-
-      cons_pos += sprintf (cons_sen + cons_pos, "%s", oth_conn);
+      if (!ret)
+	return _("DeMorgan constructed incorrectly.");
 
-      for (j = 0; j < gg_vec->num_stuff; j++)
-	{
-	  cons_pos += sprintf (cons_sen + cons_pos, " (%s %s)",
-			       S_NOT, vec_str_nth (gg_vec, j));
-	}
+      return CORRECT;
+    }
 
-      strcpy (cons_sen + cons_pos, not_sen + tmp_pos);
+  if (neg->type != FORMULA_LIST || neg->num_args < 3)
+    return _("There must be generalities on the negation sentence.");
 
-      destroy_str_vec (gg_vec);
+  if (!formula_is_conn (neg, S_AND) && !formula_is_conn (neg, S_OR))
+    return _("The negation sentence must be negating either a conjunction or a disjunction.");
 
-      char * ret_str;
-      if (not_sen == conc)
-	ret_str = proc_dm (oth_sen, cons_sen, 0);
-      else
-	ret_str = proc_dm (cons_sen, oth_sen, 0);
-      if (!ret_str)
-	return NULL;
+  // The other sentence must negate each generality under the other connective.
 
-      free (cons_sen);
-      if (ret_str == NO_DIFFERENCE || ret_str == CORRECT)
-	return CORRECT;
+  if (!formula_is_conn (oth_sen, formula_is_conn (neg, S_AND) ? S_OR : S_AND)
+      || oth_sen->num_args != neg->num_args)
+    return _("DeMorgan constructed incorrectly.");
 
-      return _("DeMorgan constructed incorrectly.");
-    }
-  else
+  for (j = 1; j < neg->num_args; j++)
     {
-      unsigned char * not_sen, * oth_sen;
-      int n_len;
-
-      if (!strncmp (prem + i, S_NOT, S_NL))
-	{
-	  not_sen = prem;  n_len = p_len;
-	  oth_sen = conc;
-	}
-      else if (!strncmp (conc + i, S_NOT, S_NL))
-	{
-	  not_sen = conc;  n_len = c_len;
-	  oth_sen = prem;
-	}
-      else
-	{
-	  return _("There must be a negation at the difference.");
-	}
-
-      int tmp_pos;
-      unsigned char * tmp_str, * elim_sen;
-
-      tmp_pos = parse_parens (not_sen, i - 1, &tmp_str);
-      if (tmp_pos == -2)
-	return NULL;
-      if (!tmp_str)
+      if (!formula_is_conn (oth_sen->args[j], S_NOT))
 	return _("DeMorgan constructed incorrectly.");
 
-      elim_sen = sexpr_elim_not (tmp_str);
-      if (!elim_sen)
-	return NULL;
-      free (tmp_str);
-
-      if (elim_sen[1] != '(')
-	return _("There must be a quantifier after the negation.");
-
-      unsigned char * cmp_str;
-      int oth_pos;
-      unsigned char quant[S_CL + 1], oth_quant[S_CL + 1];
-      unsigned char * var;
-
-      cmp_str = sexpr_elim_quant (elim_sen, quant, &var);
-      if (!cmp_str)
+      ret = sexpr_diff_parts (neg->args[j], oth_sen->args[j]->args[1],
+			      diff_dm);
+      if (ret == -1)
 	return NULL;
 
-      if (cmp_str[0] == '\0')
+      if (!ret)
 	return _("DeMorgan constructed incorrectly.");
+    }
 
-      if (!strncmp (quant, S_UNV, S_CL))
-	strcpy (oth_quant, S_EXL);
-      else if (!strncmp (quant, S_EXL, S_CL))
-	strcpy (oth_quant, S_UNV);
-      else
-	return _("There must be a quantifier after the negation.");
-
-      // Construct what should be the other sentence.
-
-      unsigned char * cons_sen;
-      int cons_pos;
-
-      cons_sen = (unsigned char *) calloc (n_len, sizeof (char));
-      CHECK_ALLOC (cons_sen, NULL);
-      strncpy (cons_sen, not_sen, i - 1);
-      cons_pos = i - 1;
-      cons_pos += sprintf (cons_sen + cons_pos, "((%s %s) (%s %s))",
-			   oth_quant, var, S_NOT, cmp_str);
-      free (cmp_str);
-      free (var);
-
-      strcpy (cons_sen + cons_pos, not_sen + tmp_pos + 1);
-
-      char * ret_str;
-
-      if (not_sen == conc)
-	ret_str = proc_dm (oth_sen, cons_sen, 1);
-      else
-	ret_str = proc_dm (cons_sen, oth_sen, 1);
-      if (!ret_str)
-	return NULL;
-
-      free (cons_sen);
-
-      if (ret_str == NO_DIFFERENCE || ret_str == CORRECT)
-	return CORRECT;
+  return CORRECT;
+}
 
-      return _("DeMorgan constructed incorrectly.");
-    }
+char *
+proc_dm (unsigned char * prem, unsigned char * conc)
+{
+  return rewrite_check (prem, conc, REWRITE_DM, diff_dm);
 }
 
 char *
@@ -999,422 +842,236 @@ proc_id (unsigned char * prem, unsigned char * conc)
     }
 }
 
-char *
-proc_dt (unsigned char * prem, unsigned char * conc, int mode_guess)
+static char * diff_dt (formula_t * prem, formula_t * conc);
+
+/* Checks distribution from one side of a difference.
+ *  input:
+ *    sh_sen - the part that is distributed.
+ *    ln_sen - the part that it is distributed into.
+ *    shaped - receives whether or not sh_sen can be distributed.
+ *  output:
+ *    CORRECT, an error message, or NULL on memory error.
+ */
+static char *
+diff_dt_short (formula_t * sh_sen, formula_t * ln_sen, int * shaped)
 {
-  unsigned char * ln_sen, * sh_sen;
-  int p_len, c_len, s_len;
+  formula_t * gens, * cur;
+  int ret, j;
 
-  p_len = strlen (prem);
-  c_len = strlen (conc);
+  *shaped = 0;
 
-  if (p_len < c_len)
-    {
-      sh_sen = prem;  s_len = p_len;
-      ln_sen = conc;
-    }
-  else
+  if (sh_sen->type == FORMULA_QUANT)
     {
-      sh_sen = conc;  s_len = c_len;
-      ln_sen = prem;
-    }
-
-  int mode, i;
+      // Distribute a quantifier over its scope.
 
-  i = find_difference (ln_sen, sh_sen);
-  if (i == -1)
-    return NO_DIFFERENCE;
+      gens = sh_sen->args[0];
+      if (gens->type != FORMULA_LIST || gens->num_args < 3)
+	return _("There must be generalities.");
 
-  if (p_len == c_len)
-    return _("The two sentences must be of different lengths.");
+      if ((sh_sen->quant == FORMULA_UNV && !formula_is_conn (gens, S_AND))
+	  || (sh_sen->quant == FORMULA_EXL && !formula_is_conn (gens, S_OR)))
+	return _("The connective must be a conjunction or disjunction.");
 
-  if (mode_guess == -1)
-    {
-      if (sh_sen[i] == '(')
-	mode = 1;
-      else
-	mode = 0;
-    }
-  else
-    {
-      mode = mode_guess;
-    }
+      *shaped = 1;
 
-  if (mode == 0)
-    {
-      int tmp_pos;
-      unsigned char * tmp_str;
-
-      if (i < 2
-	  || (strncmp (sh_sen + i - 1, S_AND, S_CL)
-	      &&  strncmp (sh_sen + i - 1, S_OR, S_CL)))
-	{
-	  return _("There must be a connective at the difference.");
-	}
-
-      tmp_pos = parse_parens (sh_sen, i - S_CL + 1, &tmp_str);
-      if (tmp_pos == -2)
-	return NULL;
-      if (!tmp_str)
+      if (!formula_same_shape (gens, ln_sen))
 	return _("Distribution constructed incorrectly.");
 
-      int ftc;
-      unsigned char * lsen, * rsen, mc[S_CL + 1];
-      
-      mc[0] = '\0';
-
-      ftc = sexpr_find_top_connective (tmp_str, mc, &lsen, &rsen);
-      if (ftc == -1)
-	return NULL;
-      free (tmp_str);
-
-      if (ftc < 0)
+      for (j = 1; j < gens->num_args; j++)
 	{
-	  if (lsen)  free (lsen);
-	  if (rsen)  free (rsen);
+	  cur = ln_sen->args[j];
+	  if (cur->type != FORMULA_QUANT || cur->quant != sh_sen->quant)
+	    return _("Distribution constructed incorrectly.");
 
-	  return _("There must be only two parts for distribution.");
-	}
-
-      if (strcmp (mc, S_AND) && strcmp (mc, S_OR))
-	{
-	  free (lsen);
-	  free (rsen);
-
-	  return _("Distribution must be done around a conjunction or a disjunction.");
-	}
-
-      int r_gg, r_len;
-      unsigned char rc[S_CL + 1];
-      vec_t * rsens;
-
-      r_len = strlen (rsen);
-      rsens = init_vec (sizeof (char *));
-      if (!rsens)
-	return NULL;
-
-      rc[0] = '\0';
-      r_gg = sexpr_get_generalities (rsen, rc, rsens);
-      if (r_gg == -1)
-	return NULL;
-      free (rsen);
-
-      if (r_gg == 1)
-	{
-	  free (lsen);
-	  destroy_str_vec (rsens);
+	  ret = sexpr_diff_parts (gens->args[j], cur->args[0], diff_dt);
+	  if (ret == -1)
+	    return NULL;
 
-	  return _("There must be more than one generality for distribution.");
+	  if (!ret)
+	    return _("Distribution constructed incorrectly.");
 	}
 
-      unsigned char * oth_sen;
-      int oth_pos, j, alloc_size;
-
-      // length of lsen + S_CL (mc) + 4 (two spaces, two parens)
-      // r_len - 1 (both of the parentheses, plus one for the null byte).
-      alloc_size = s_len + (strlen (lsen) + S_CL + 4) * rsens->num_stuff + r_len - 1;
-      oth_sen = (unsigned char *) calloc (alloc_size,  sizeof (char));
-      CHECK_ALLOC (oth_sen, NULL);
-      strncpy (oth_sen, sh_sen, i - 1);
-      oth_pos = i - 1;
-
-      oth_pos += sprintf (oth_sen + oth_pos, "%s", rc);
-
-      for (j = 0; j < rsens->num_stuff; j++)
-	{
-	  oth_pos += sprintf (oth_sen + oth_pos, " (%s %s %s)",
-			      mc, lsen, vec_str_nth (rsens, j));
-	}
+      return CORRECT;
+    }
 
-      strcpy (oth_sen + oth_pos, sh_sen + tmp_pos);
+  // Distribute the left generality over the right one.
 
-      free (lsen);
-      destroy_str_vec (rsens);
+  if (sh_sen->type != FORMULA_LIST || sh_sen->num_args != 3)
+    return _("There must be only two parts for distribution.");
 
-      char * ret_str;
+  if (!formula_is_conn (sh_sen, S_AND) && !formula_is_conn (sh_sen, S_OR))
+    return _("Distribution must be done around a conjunction or a disjunction.");
 
-      if (sh_sen == conc)
-	ret_str = proc_dt (ln_sen, oth_sen, 0);
-      else
-	ret_str = proc_dt (oth_sen, ln_sen, 0);
+  gens = sh_sen->args[2];
+  if (gens->type != FORMULA_LIST || gens->num_args < 3)
+    return _("There must be more than one generality for distribution.");
 
-      if (!ret_str)
-	return NULL;
+  *shaped = 1;
 
-      free (oth_sen);
-      if (ret_str == NO_DIFFERENCE || ret_str == CORRECT)
-	return CORRECT;
+  if (!formula_same_shape (gens, ln_sen))
+    return _("Distribution constructed incorrectly.");
 
-      return _("Distribution constructed incorrectly.");
-    }
-  else
+  for (j = 1; j < gens->num_args; j++)
     {
-      unsigned char * tmp_str;
-      int tmp_pos;
-
-      if (mode_guess != -1)
-	{
-	  if (sh_sen[i] != '(')
-	    return _("The difference must be a quantifier.");
-	}
-
-      tmp_pos = parse_parens (sh_sen, i - 1, &tmp_str);
-      if (tmp_pos == -2)
-	return NULL;
-
-      unsigned char * scope, * var, quant[S_CL + 1];
-      int v_len;
-
-      scope = sexpr_elim_quant (tmp_str, quant, &var);
-      if (!scope)
-	return NULL;
-      if (scope[0] == '\0')
+      cur = ln_sen->args[j];
+      if (!formula_same_shape (sh_sen, cur))
 	return _("Distribution constructed incorrectly.");
-      v_len = strlen (var);
-      free (tmp_str);
 
-      int gg;
-      vec_t * gg_vec;
-      unsigned char conn[S_CL + 1];
+      ret = sexpr_diff_parts (sh_sen->args[1], cur->args[1], diff_dt);
+      if (ret == 1)
+	ret = sexpr_diff_parts (gens->args[j], cur->args[2], diff_dt);
 
-      conn[0] = '\0';
-      gg_vec = init_vec (sizeof (char *));
-      if (!gg_vec)
-	return NULL;
-
-      gg = sexpr_get_generalities (scope, conn, gg_vec);
-      if (gg == -1)
+      if (ret == -1)
 	return NULL;
-      free (scope);
 
-      if (gg == 1)
-	{
-	  destroy_str_vec (gg_vec);
-	  return _("There must be generalities.");
-	}
-
-      if ((!strcmp (quant, S_UNV) && strcmp (conn, S_AND))
-	  || (!strcmp (quant, S_EXL) && strcmp (conn, S_OR)))
-	{
-	  destroy_str_vec (gg_vec);
-	  return _("The connective must be a conjunction or disjunction.");
-	}
-
-      unsigned char * oth_sen;
-      int oth_pos, j, alloc_size;
-
-      alloc_size = s_len + (gg_vec->num_stuff * (6 + S_CL + strlen (var)));
-      oth_sen = (unsigned char *) calloc (alloc_size + 1, sizeof (char));
-      CHECK_ALLOC (oth_sen, NULL);
-      strncpy (oth_sen, sh_sen, i - 1);
-      oth_pos = i - 1;
-
-      oth_pos += sprintf (oth_sen + oth_pos, "(%s", conn);
-
-      for (j = 0; j < gg_vec->num_stuff; j++)
-	{
-	  unsigned char * cur_gen, * str;
-	  cur_gen = vec_str_nth (gg_vec, j);
-	  oth_pos += sprintf (oth_sen + oth_pos, " ((%s %s) %s)",
-			      quant, var, cur_gen);
-	}
+      if (!ret)
+	return _("Distribution constructed incorrectly.");
+    }
 
-      oth_pos += sprintf (oth_sen + oth_pos, ")");
+  return CORRECT;
+}
 
-      strcpy (oth_sen + oth_pos, sh_sen + tmp_pos + 1);
+/* Checks distribution at a difference.
+ *  input:
+ *    prem, conc - the differing parts of the premise and conclusion.
+ *  output:
+ *    CORRECT, an error message, or NULL on memory error.
+ */
+static char *
+diff_dt (formula_t * prem, formula_t * conc)
+{
+  char * p_str, * c_str;
+  int p_shaped, c_shaped;
 
-      free (var);
-      destroy_str_vec (gg_vec);
+  // Either side may be the distributed one.
 
-      char * ret_str;
-      if (sh_sen == conc)
-	ret_str = proc_dt (ln_sen, oth_sen, 1);
-      else
-	ret_str = proc_dt (oth_sen, ln_sen, 1);
-      if (!ret_str)
-	return NULL;
+  p_str = diff_dt_short (prem, conc, &p_shaped);
+  if (!p_str || p_str == CORRECT)
+    return p_str;
 
-      free (oth_sen);
-      if (ret_str == NO_DIFFERENCE || ret_str == CORRECT)
-	return CORRECT;
+  c_str = diff_dt_short (conc, prem, &c_shaped);
+  if (!c_str || c_str == CORRECT)
+    return c_str;
 
-      return _("Distribution constructed incorrectly.");      
-    }
+  return (c_shaped && !p_shaped) ? c_str : p_str;
 }
 
 char *
-proc_eq (unsigned char * prem, unsigned char * conc)
+proc_dt (unsigned char * prem, unsigned char * conc)
 {
-  unsigned char * bic_sen, * oth_sen;
-  int p_len, c_len, b_len;
+  return rewrite_check (prem, conc, REWRITE_DT, diff_dt);
+}
 
-  c_len = strlen (conc);
-  p_len = strlen (prem);
+/* Checks equivalence at a difference.
+ *  input:
+ *    prem, conc - the differing parts of the premise and conclusion.
+ *  output:
+ *    CORRECT, an error message, or NULL on memory error.
+ */
+static char *
+diff_eq (formula_t * prem, formula_t * conc)
+{
+  formula_t * bic_sen, * oth_sen, * l_con, * r_con;
+  int ret;
 
-  if (c_len < p_len)
+  if (formula_is_conn (prem, S_BIC) && prem->num_args == 3)
     {
-      bic_sen = conc;  b_len = c_len;
+      bic_sen = prem;
+      oth_sen = conc;
+    }
+  else if (formula_is_conn (conc, S_BIC) && conc->num_args == 3)
+    {
+      bic_sen = conc;
       oth_sen = prem;
     }
   else
     {
-      bic_sen = prem;  b_len = p_len;
-      oth_sen = conc;
+      return _("There must be a biconditional in one sentence.");
     }
 
-  int i;
-  i = find_difference (bic_sen, oth_sen);
-  if (i == -1)
-    return NO_DIFFERENCE;
+  // The other sentence must be the conjunction of both conditionals.
 
-  if (i < 2)
+  if (!formula_is_conn (oth_sen, S_AND) || oth_sen->num_args != 3)
     return _("Equivalence constructed incorrectly.");
 
-  int tmp_pos;
-  unsigned char * tmp_str;
+  l_con = oth_sen->args[1];
+  r_con = oth_sen->args[2];
 
-  tmp_pos = parse_parens (bic_sen, i - 2, &tmp_str);
-  if (tmp_pos == -2)
-    return NULL;
-  if (!tmp_str)
+  if (!formula_is_conn (l_con, S_CON) || l_con->num_args != 3
+      || !formula_is_conn (r_con, S_CON) || r_con->num_args != 3)
     return _("Equivalence constructed incorrectly.");
 
-  int ftc;
-  unsigned char * lsen, * rsen;
+  ret = sexpr_diff_parts (bic_sen->args[1], l_con->args[1], diff_eq);
+  if (ret == 1)
+    ret = sexpr_diff_parts (bic_sen->args[2], l_con->args[2], diff_eq);
+  if (ret == 1)
+    ret = sexpr_diff_parts (bic_sen->args[2], r_con->args[1], diff_eq);
+  if (ret == 1)
+    ret = sexpr_diff_parts (bic_sen->args[1], r_con->args[2], diff_eq);
 
-  lsen = rsen = NULL;
-  ftc = sexpr_find_top_connective (tmp_str, S_BIC, &lsen, &rsen);
-  if (ftc == -1)
+  if (ret == -1)
     return NULL;
 
-  if (ftc < 0)
-    {
-      if (lsen)  free (lsen);
-      if (rsen)  free (rsen);
-
-      return _("There must be a biconditional in one sentence.");
-    }
-
-  unsigned char * cons_sen;
-  int cons_pos, alloc_size;
-
-  alloc_size = b_len + (tmp_pos - (i - 2) + 1) + S_CL + 4;
-  cons_sen = (unsigned char *) calloc (alloc_size + 1, sizeof (char));
-  CHECK_ALLOC (cons_sen, NULL);
-  strncpy (cons_sen, bic_sen, i - 1);
-  cons_pos = i - 1;
-
-  cons_pos += sprintf (cons_sen, "(%s (%s %s %s) (%s %s %s))",
-		       S_AND, S_CON, lsen, rsen, S_CON, rsen, lsen);
-  free (lsen);
-  free (rsen);
-
-  strcpy (cons_sen + cons_pos, bic_sen + tmp_pos);
-
-  char * ret_str;
-
-  if (bic_sen == conc)
-    ret_str = proc_eq (oth_sen, cons_sen);
-  else
-    ret_str = proc_eq (cons_sen, oth_sen);
-
-  free (cons_sen);
-
-  if (ret_str == NO_DIFFERENCE || ret_str == CORRECT)
-    return CORRECT;
+  if (!ret)
+    return _("Equivalence constructed incorrectly.");
 
-  return _("Equivalence constructed incorrectly.");
+  return CORRECT;
 }
 
 char *
-proc_dn (unsigned char * prem, unsigned char * conc)
+proc_eq (unsigned char * prem, unsigned char * conc)
 {
-  // Standard long-short setup.
-
-  unsigned char * ln_sen, * sh_sen;
-  int p_len, c_len, l_len;
+  return rewrite_check (prem, conc, REWRITE_EQ, diff_eq);
+}
 
-  p_len = strlen (prem);
-  c_len = strlen (conc);
+/* Checks double negation at a difference.
+ *  input:
+ *    prem, conc - the differing parts of the premise and conclusion.
+ *  output:
+ *    CORRECT, an error message, or NULL on memory error.
+ */
+static char *
+diff_dn (formula_t * prem, formula_t * conc)
+{
+  formula_t * ln_sen, * sh_sen;
+  int ret;
 
-  if (p_len > c_len)
+  if (formula_is_conn (prem, S_NOT) && formula_is_conn (prem->args[1], S_NOT))
     {
-      ln_sen = prem;  l_len = p_len;
+      ln_sen = prem;
       sh_sen = conc;
     }
-  else
+  else if (formula_is_conn (conc, S_NOT)
+	   && formula_is_conn (conc->args[1], S_NOT))
     {
-      ln_sen = conc;  l_len = c_len;
+      ln_sen = conc;
       sh_sen = prem;
     }
-
-  int i;
-  i = find_difference (ln_sen, sh_sen);
-  if (i == -1)
-    return NO_DIFFERENCE;
-
-  if (ln_sen[i] != '(' && strncmp (ln_sen + i, S_NOT, S_NL)
-      && (i > 0 && l_len > S_NL && strncmp (ln_sen + i - 1, S_NOT, S_NL)))
+  else if (!formula_is_conn (prem, S_NOT) && !formula_is_conn (conc, S_NOT))
     {
       return _("The difference must be at a negation.");
     }
-
-  if (ln_sen[i] != '(')
-    {
-      if (!strncmp (ln_sen + i, S_NOT, S_NL))
-	i--;
-      else
-	i -= 2;
-    }
-
-  int tmp_pos;
-  unsigned char * tmp_str;
-  tmp_pos = parse_parens (ln_sen, i, &tmp_str);
-  if (tmp_pos == -2)
-    return NULL;
-  if (!tmp_str)
-    return _("Double Negation constructed incorrectly.");
-
-  int pos, num_negs;
-  unsigned char * oth_sen;
-  int oth_pos;
-
-  pos = i;
-  if (!sexpr_not_check (tmp_str) || strncmp (tmp_str + S_NL + 3, S_NOT, S_NL))
+  else
     {
-      free (tmp_str);
       return _("There must be at least two negations at the difference.");
     }
 
-  free (tmp_str);
-  pos = i + 4 + 2 * S_NL;
-  // Begin removing pairs of negations, until there are no more pairs.
-
-  oth_sen = (unsigned char *) calloc (l_len - S_NL * 2 - 5, sizeof (char));
-  CHECK_ALLOC (oth_sen, NULL);
-  strncpy (oth_sen, ln_sen, i);
-  oth_pos = i;
-
-  strncpy (oth_sen + oth_pos, ln_sen + pos, tmp_pos - pos - 1);
-  oth_pos += tmp_pos - pos - 1;
-
-  strcpy (oth_sen + oth_pos, ln_sen + tmp_pos + 1);
-
-  char * ret_str;
+  // Further pairs of negations are removed by the recursion.
 
-  if (ln_sen == conc)
-    ret_str = proc_dn (sh_sen, oth_sen);
-  else
-    ret_str = proc_dn (oth_sen, sh_sen);
-
-  if (!ret_str)
+  ret = sexpr_diff_parts (ln_sen->args[1]->args[1], sh_sen, diff_dn);
+  if (ret == -1)
     return NULL;
 
-  free (oth_sen);
-  if (ret_str == NO_DIFFERENCE || ret_str == CORRECT)
-    return CORRECT;
+  if (!ret)
+    return _("Double Negation constructed incorrectly.");
 
-  return _("Double Negation constructed incorrectly.");
+  return CORRECT;
+}
+
+char *
+proc_dn (unsigned char * prem, unsigned char * conc)
+{
+  return rewrite_check (prem, conc, REWRITE_DN, diff_dn);
 }
 
 char *
@@ -1430,14 +1087,15 @@ proc_ep (unsigned char * prem, unsigned char * conc)
 
   int i, c_cons, p_cons;
 
+  c_cons = p_cons = 0;
+
   for (i = 0; i < p_len; i++)
-    {
-      if (!strncmp (prem + i, S_CON, S_CL))
-	p_cons++;
+    if (!strncmp (prem + i, S_CON, S_CL))
+      p_cons++;
 
-      if (!strncmp (conc + i, S_CON, S_CL))
-	c_cons++;
-    }
+  for (i = 0; i < c_len; i++)
+    if (!strncmp (conc + i, S_CON, S_CL))
+      c_cons++;
 
   if (c_cons > p_cons)
     {
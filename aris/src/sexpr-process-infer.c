@@ -19,6 +19,9 @@
 #include "sexpr-process.h"
 #include "vec.h"
 
+#define MEM_SUBSYSTEM MEM_RULES
+#include "mem.h"
+
 char *
 process_inference (unsigned char * conc, vec_t * prems, const char * rule)
 {
@@ -178,29 +181,27 @@ char *
 proc_ad (unsigned char * prem, unsigned char * conc)
 {
   int gg;
-  vec_t * gg_vec;
+  vec_t gg_vec;
 
-  gg_vec = init_vec (sizeof (char *));
-  if (!gg_vec)
-    return NULL;
+  vec_init_local (&gg_vec, sizeof (char *));
 
-  gg = sexpr_get_generalities (conc, S_OR, gg_vec);
+  gg = sexpr_get_generalities (conc, S_OR, &gg_vec);
   if (gg == -1)
     return NULL;
 
   if (gg == 1)
     {
-      destroy_str_vec (gg_vec);
+      vec_str_fini (&gg_vec);
       return _("There must be a disjunction in the conclusion.");
     }
 
   int str_chk;
   unsigned char * gen_0;
 
-  gen_0 = vec_str_nth (gg_vec, 0);
+  gen_0 = vec_str_nth (&gg_vec, 0);
   str_chk = !strcmp (gen_0, prem);
 
-  destroy_str_vec (gg_vec);
+  vec_str_fini (&gg_vec);
   if (!str_chk)
     return _("The reference must be the first generality in the conclusion.");
 
@@ -211,38 +212,36 @@ char *
 proc_sm (unsigned char * prem, unsigned char * conc)
 {
   int gg;
-  vec_t * gg_vec;
+  vec_t gg_vec;
 
-  gg_vec = init_vec (sizeof (char *));
-  if (!gg_vec)
-    return  NULL;
+  vec_init_local (&gg_vec, sizeof (char *));
 
-  gg = sexpr_get_generalities (prem, S_AND, gg_vec);
+  gg = sexpr_get_generalities (prem, S_AND, &gg_vec);
   if (gg == -1)
     return NULL;
 
   if (gg == 1)
     {
-      destroy_str_vec (gg_vec);
+      vec_str_fini (&gg_vec);
       return _("There must be a conjunction in the reference.");
     }
 
   int i;
 
-  for (i = 0; i < gg_vec->num_stuff; i++)
+  for (i = 0; i < gg_vec.num_stuff; i++)
     {
       unsigned char * cur_gen;
 
-      cur_gen = vec_str_nth (gg_vec, i);
+      cur_gen = vec_str_nth (&gg_vec, i);
 
       if (!strcmp (cur_gen, conc))
 	{
-	  destroy_str_vec (gg_vec);
+	  vec_str_fini (&gg_vec);
 	  return CORRECT;
 	}
     }
 
-  destroy_str_vec (gg_vec);
+  vec_str_fini (&gg_vec);
   return _("One of the generalities in the reference must match the conclusion.");
 }
 
@@ -250,28 +249,26 @@ char *
 proc_cn (vec_t * prems, unsigned char * conc)
 {
   int gg;
-  vec_t * gg_vec;
+  vec_t gg_vec;
 
-  gg_vec = init_vec (sizeof (char *));
-  if (!gg_vec)
-    return NULL;
+  vec_init_local (&gg_vec, sizeof (char *));
 
-  gg = sexpr_get_generalities (conc, S_AND, gg_vec);
+  gg = sexpr_get_generalities (conc, S_AND, &gg_vec);
   if (gg == -1)
     return NULL;
 
   if (gg == 1)
     {
-      destroy_str_vec (gg_vec);
+      vec_str_fini (&gg_vec);
       return _("There must be a conjunction in the conclusion.");
     }
 
   int cmp_chk;
-  cmp_chk = vec_str_cmp (prems, gg_vec);
+  cmp_chk = vec_str_cmp (prems, &gg_vec);
   if (cmp_chk == -1)
     return NULL;
 
-  destroy_str_vec (gg_vec);
+  vec_str_fini (&gg_vec);
 
   switch (cmp_chk)
     {
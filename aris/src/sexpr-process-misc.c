@@ -27,8 +27,11 @@
 #include "sen-data.h"
 #include "var.h"
 
+#define MEM_SUBSYSTEM MEM_RULES
+#include "mem.h"
+
 char *
-process_misc (unsigned char * conc, vec_t * prems, const char * rule, vec_t * vars,
+process_misc (unsigned char * conc, vec_t * prems, const char * rule, var_set_t * vars,
 	      proof_t * proof)
 {
   char * ret = NOT_MINE;
@@ -450,7 +453,7 @@ proc_sp (unsigned char * prem_0, unsigned char * prem_1, unsigned char * conc)
 }
 
 char *
-proc_sq (unsigned char * conc, vec_t * vars)
+proc_sq (unsigned char * conc, var_set_t * vars)
 {
   unsigned char * scope, * var, quant[S_CL + 1];
 
@@ -523,16 +526,7 @@ proc_sq (unsigned char * conc, vec_t * vars)
       return _("The first argument must be a value function.");
     }
 
-  int i;
-  for (i = 0; i < vars->num_stuff; i++)
-    {
-      variable * cur_var;
-      cur_var = vec_nth (vars, i);
-      if (!strcmp (cur_var->text, vec_str_nth (args_0, 0)))
-	break;
-    }
-
-  if (i != vars->num_stuff)
+  if (var_set_find (vars, vec_str_nth (args_0, 0)))
     {
       destroy_str_vec (args);
       destroy_str_vec (args_0);
@@ -552,6 +546,7 @@ proc_sq (unsigned char * conc, vec_t * vars)
 
   vec_t * args_1;
   unsigned char * tmp_arg = arg_1;
+  int i;
 
   while (1)
     {
@@ -19,93 +19,45 @@
 #include "sexpr-process.h"
 #include "vec.h"
 #include "var.h"
-
-int
-help_fv (unsigned char * eq_sen, unsigned char * oth_sen, unsigned char * conc)
+#include "formula.h"
+#include "congruence.h"
+
+#define MEM_SUBSYSTEM MEM_RULES
+#include "mem.h"
+
+/* Checks a free variable substitution with several identities.
+ *  input:
+ *    oth_fm - the sentence that is substituted into.
+ *    conc_fm - the conclusion.
+ *    eqs - the identities, each of the form (= x y).
+ *    num_eqs - the amount of identities.
+ *  output:
+ *    0 if the conclusion is the other sentence with any of the
+ *    occurrences of either side of each identity replaced by the other,
+ *    1 if the two are the same, -2 if it isn't, -1 on memory error.
+ */
+static int
+help_fv (formula_t * oth_fm, formula_t * conc_fm, formula_t ** eqs,
+	 int num_eqs)
 {
-  unsigned char * var_0, * var_1, * pred, * oth_var, * conc_var;
-  vec_t * args;
-  int cmp, i, v0_len, v1_len;
+  int ret;
 
-  i = find_difference (oth_sen, conc);
-  if (i == -1)
+  if (formula_equal (oth_fm, conc_fm))
     return 1;
 
-  args = init_vec (sizeof (char *));
-  if (!args)
-    return -1;
-
-  cmp = sexpr_get_pred_args (eq_sen, &pred, args);
-  if (cmp == -1)
-    return -1;
-  free (pred);
-
-  if (cmp != 2)
-    {
-      destroy_str_vec (args);
-      return -2;
-    }
-
-  var_0 = vec_str_nth (args, 0);
-  var_1 = vec_str_nth (args, 1);
-
-  v0_len = strlen (var_0);
-  v1_len = strlen (var_1);
-
-  cmp = find_difference (var_0, var_1);
-
-  int o_cmp_0, o_cmp_1, c_cmp_0, c_cmp_1;
-
-  o_cmp_0 = !strncmp (oth_sen + i - cmp, var_0, v0_len);
-  o_cmp_1 = !strncmp (oth_sen + i - cmp, var_1, v1_len);
-  c_cmp_0 = !strncmp (conc + i - cmp, var_0, v0_len);
-  c_cmp_1 = !strncmp (conc + i - cmp, var_1, v1_len);
-
-  if (!((o_cmp_0 && c_cmp_1) || (o_cmp_1 && c_cmp_0)))
-    {
-      destroy_str_vec (args);
-      return -2;
-    }
-
-  if (!strncmp (oth_sen + i - cmp, var_0, v0_len))
-    {
-      oth_var = var_0;
-      conc_var = var_1;
-    }
-  else
-    {
-      oth_var = var_1;
-      conc_var = var_0;
-    }
-
-  unsigned char * cons_sen;
-  int cons_pos;
-
-  cons_sen = (unsigned char *) calloc (strlen (oth_sen) + strlen (conc_var) + 1,
-				       sizeof (char));
-  CHECK_ALLOC (cons_sen, -1);
-
-  strncpy (cons_sen, oth_sen, i - cmp);
-  cons_pos = i - cmp;
+  // Every occurrence is substituted at once, by checking that the two
+  // sentences are congruent once the sides of each identity are equal.
+  // Identities that share a side are chained by the closure.
 
-  cons_pos += sprintf (cons_sen + cons_pos, "%s", conc_var);
-  strcpy (cons_sen + cons_pos, oth_sen + i - cmp + strlen (oth_var));
-  destroy_str_vec (args);
-
-  int ret_chk;
-  ret_chk = help_fv (eq_sen, cons_sen, conc);
-  if (ret_chk == -1)
+  ret = congruence_check (oth_fm, conc_fm, eqs, num_eqs);
+  if (ret == -1)
     return -1;
 
-  free (cons_sen);
-  if (ret_chk == 0 || ret_chk == 1)
-    return 0;
-
-  return -2;
+  return ret ? 0 : -2;
 }
 
 char *
-process_quantifiers (unsigned char * conc, vec_t * prems, const char * rule, vec_t * vars)
+process_quantifiers (unsigned char * conc, vec_t * prems, const char * rule, var_set_t * vars)
 {
   char * ret = NOT_MINE;
   unsigned char * prem;
@@ -193,13 +145,10 @@ process_quantifiers (unsigned char * conc, vec_t * prems, const char * rule, vec
 
   if (!strcmp (rule, "fv"))
     {
-      if (prems->num_stuff != 2)
-	return _("Free Variable requires one two (2) references.");
-
-      unsigned char * prem_0;
-      prem_0 = vec_str_nth (prems, 1);
+      if (prems->num_stuff < 2)
+	return _("Free Variable requires at least two (2) references.");
 
-      ret = proc_fv (prem, prem_0, conc);
+      ret = proc_fv (prems, conc);
       if (!ret)
 	return NULL;
     }
@@ -208,7 +157,7 @@ process_quantifiers (unsigned char * conc, vec_t * prems, const char * rule, vec
 }
 
 char *
-proc_ug (unsigned char * prem, unsigned char * conc, vec_t * vars)
+proc_ug (unsigned char * prem, unsigned char * conc, var_set_t * vars)
 {
   int ret_chk;
 
@@ -253,7 +202,7 @@ proc_eg (unsigned char * prem, unsigned char * conc)
 }
 
 char *
-proc_ei (unsigned char * prem, unsigned char * conc, vec_t * vars)
+proc_ei (unsigned char * prem, unsigned char * conc, var_set_t * vars)
 {
   int ret_chk;
   ret_chk = sexpr_quant_infer (prem, conc, S_EXL, 2, vars);
@@ -288,204 +237,152 @@ proc_bv (unsigned char * prem, unsigned char * conc)
   pi -= S_CL + 2;
   ci -= S_CL + 2;
 
-  if (prem[pi] != '(' || conc[ci] != '(')
+  if (pi < 0 || ci < 0 || prem[pi] != '(' || conc[ci] != '(')
     return _("The difference must be a bound variable.");
 
-  int tmp_p, tmp_c;
-  unsigned char * p_str, * c_str;
+  // Bound variables are kept by index, so renaming them leaves the tree
+  // the same, as long as no other variable is captured.
 
-  tmp_p = parse_parens (prem, pi, &p_str);
-  if (tmp_p == -2)
-    return NULL;
-
-  tmp_c = parse_parens (conc, ci, &c_str);
-  if (tmp_c == -2)
-    return NULL;
-
-  if (strcmp (prem + tmp_p, conc + tmp_c))
-    {
-      free (p_str);
-      free (c_str);
-      return _("The rest of the sentences must be the same.");
-    }
-
-  unsigned char * p_var, * c_var, * p_scope, * c_scope;
-  unsigned char p_quant[S_CL + 1], c_quant[S_CL + 1];
+  formula_t * p_fm, * c_fm;
+  int cmp;
 
-  p_scope = sexpr_elim_quant (p_str, p_quant, &p_var);
-  if (!p_scope)
+  p_fm = formula_init (prem);
+  if (!p_fm)
     return NULL;
 
-  c_scope = sexpr_elim_quant (c_str, c_quant, &c_var);
-  if (!c_scope)
+  c_fm = formula_init (conc);
+  if (!c_fm)
     return NULL;
-  free (c_str);
 
-  if (p_scope[0] == '\0' || c_scope[0] == '\0')
-    {
-      if (c_var)  free (c_var);
-      if (p_var)  free (p_var);
-
-      free (c_scope);
-      free (p_scope);
-      free (p_str);
+  cmp = formula_equal (p_fm, c_fm);
 
-      return _("There must be quantifiers at the difference.");
-    }
+  formula_destroy (p_fm);
+  formula_destroy (c_fm);
 
-  if (strcmp (p_quant, c_quant))
-    {
-      free (c_var);
-      free (p_var);
-      free (c_scope);
-      free (p_scope);
-      free (p_str);
+  if (!cmp)
+    return _("Bound Variable Substitution constructed incorrectly.");
 
-      return _("The quantifiers must be the same.");
-    }
+  return CORRECT;
+}
 
-  vec_t * p_vars;
+/* Removes the quantifier that begins at a position of a sentence.
+ *  input:
+ *    sen - the sentence.
+ *    pos - the position of the opening parenthesis of the quantifier.
+ *    diff - the position that the quantifier must reach.
+ *    out_str - receives the sentence with the quantifier replaced by its
+ *      scope.
+ *    appears - receives whether the quantifier's variable appears in its
+ *      scope.
+ *  output:
+ *    0 on success, 1 if no quantifier that reaches diff begins at pos,
+ *    -1 on memory error.
+ */
+static int
+help_nq (unsigned char * sen, int pos, int diff, unsigned char ** out_str,
+	 int * appears)
+{
+  unsigned char * var;
+  int var_pos, var_len, end, sc_pos, sc_len, i;
 
-  p_vars = init_vec (sizeof (int));
-  if (!p_vars)
-    return NULL;
+  if (sen[pos] != '(' || sen[pos + 1] != '('
+      || (strncmp (sen + pos + 2, S_UNV, S_CL)
+	  && strncmp (sen + pos + 2, S_EXL, S_CL)))
+    return 1;
 
-  tmp_p = sexpr_get_quant_vars (p_str, p_vars);
-  if (tmp_p == -1)
-    return NULL;
-  free (p_str);
+  end = parse_parens (sen, pos, NULL);
+  if (end < diff)
+    return 1;
 
-  unsigned char * oth_sen;
-  int cmp;
+  // The construct is ((<quantifier> <variable>) <scope>).
+  var_pos = pos + 3 + S_CL;
+  var = (unsigned char *) strchr ((const char *) sen + var_pos, ')');
+  if (!var || var - sen >= end)
+    return 1;
 
-  tmp_p = sexpr_replace_var (p_scope, c_var, p_var, p_vars, &oth_sen);
-  if (tmp_p == -1)
-    return NULL;
+  var_len = var - sen - var_pos;
+  sc_pos = var - sen + 2;
+  sc_len = end - sc_pos;
+  if (sc_len <= 0)
+    return 1;
 
-  destroy_vec (p_vars);
-  free (c_var);
-  free (p_var);
-  free (p_scope);
+  *appears = 0;
+  for (i = sc_pos; i + var_len <= end; i++)
+    {
+      if (sen[i - 1] != ' ' || strncmp (sen + i, sen + var_pos, var_len))
+	continue;
 
-  cmp = !strcmp (oth_sen, c_scope);
+      if (sen[i + var_len] == ' ' || sen[i + var_len] == ')')
+	{
+	  *appears = 1;
+	  break;
+	}
+    }
 
-  free (oth_sen);
-  free (c_scope);
+  *out_str = (unsigned char *) calloc (strlen (sen) + 1, sizeof (char));
+  CHECK_ALLOC (*out_str, -1);
 
-  if (!cmp)
-    return _("Bound Variable Substitution constructed incorrectly.");
+  strncpy (*out_str, sen, pos);
+  strncpy (*out_str + pos, sen + sc_pos, sc_len);
+  strcpy (*out_str + pos + sc_len, sen + end + 1);
 
-  return CORRECT;
+  return 0;
 }
 
 char *
 proc_nq (unsigned char * prem, unsigned char * conc)
 {
   unsigned char * ln_sen, * sh_sen;
-  int p_len, c_len, l_len;
-
-  p_len = strlen (prem);
-  c_len = strlen (conc);
+  int i, li, ret, appears, any_appears;
 
-  if (p_len > c_len)
+  if (strlen (prem) > strlen (conc))
     {
-      ln_sen = prem;  l_len = p_len;
+      ln_sen = prem;
       sh_sen = conc;
     }
   else
     {
-      ln_sen = conc;  l_len = c_len;
+      ln_sen = conc;
       sh_sen = prem;
     }
 
-  int i, li;
   i = find_difference (ln_sen, sh_sen);
   if (i == -1)
     return NO_DIFFERENCE;
 
-  if (ln_sen[i] != '(' && strncmp (ln_sen + i - 1, S_UNV, S_CL)
-      && strncmp (ln_sen + i - 1, S_EXL, S_CL) && !islower (ln_sen[i]))
-    {
-      return _("DIFFERENCE_ERROR");
-    }
+  // The removed quantifier begins at or before the difference, possibly
+  // at the start of the sentence, and must reach past it.
 
-  if (ln_sen[i] == '(')
+  any_appears = 0;
+  for (li = i; li >= 0; li--)
     {
-      li = i - 1;
-    }
-  else if (!strncmp (ln_sen + i - 1, S_UNV, S_CL)
-	   || !strncmp (ln_sen + i - 1, S_EXL, S_CL))
-    {
-      li = i - 3;
-    }
-  else
-    {
-      //backtrack to the quantifier.
-      li = i;
-      while (!isspace (ln_sen[li]))
-	li--;
-
-      li -= 2 + S_CL;
-    }
-
-  unsigned char * tmp_str;
-  int tmp_pos;
+      unsigned char * oth_sen;
+      char * ret_str;
 
-  tmp_pos = parse_parens (ln_sen, li, &tmp_str);
-  if (tmp_pos == -2)
-    return NULL;
-
-  unsigned char * scope, * var, quant[S_CL + 1];
-  scope = sexpr_elim_quant (tmp_str, quant, &var);
-  if (!scope)
-    return NULL;
-  free (var);
-
-  int gqv;
-  vec_t * offsets;
+      ret = help_nq (ln_sen, li, i, &oth_sen, &appears);
+      if (ret == -1)
+	return NULL;
+      if (ret == 1)
+	continue;
 
-  offsets = init_vec (sizeof (int));
-  if (!offsets)
-    return NULL;
+      if (ln_sen == conc)
+	ret_str = proc_nq (sh_sen, oth_sen);
+      else
+	ret_str = proc_nq (oth_sen, sh_sen);
+      free (oth_sen);
+      if (!ret_str)
+	return NULL;
 
-  gqv = sexpr_get_quant_vars (tmp_str, offsets);
-  if (gqv == -1)
-    return NULL;
-  free (tmp_str);
-  destroy_vec (offsets);
+      if (ret_str != NO_DIFFERENCE && ret_str != CORRECT)
+	continue;
 
-  if (gqv != 0)
-    {
-      free (scope);
-      return _("The variables must not appear.");
+      if (!appears)
+	return CORRECT;
+      any_appears = 1;
     }
 
-  unsigned char * oth_sen;
-  int oth_pos, alloc_size;
-
-  alloc_size = l_len - strlen (var) - S_CL - 5;
-  oth_sen = (unsigned char *) calloc (alloc_size + 1, sizeof (char));
-  CHECK_ALLOC (oth_sen, NULL);
-
-  strncpy (oth_sen, ln_sen, li);
-  oth_pos = li;
-
-  oth_pos += sprintf (oth_sen + oth_pos, "%s", scope);
-  strcpy (oth_sen + oth_pos, ln_sen + tmp_pos + 1);
-
-  free (scope);
-
-  char * ret_str;
-  if (ln_sen == conc)
-    ret_str = proc_nq (sh_sen, oth_sen);
-  else
-    ret_str = proc_nq (oth_sen, sh_sen);
-  if (!ret_str)
-    return NULL;
-
-  free (oth_sen);
-  if (ret_str == NO_DIFFERENCE || ret_str == CORRECT)
-    return CORRECT;
+  if (any_appears)
+    return _("The variables must not appear.");
 
   return _("Null Quantifier constructed incorrectly.");
 }
@@ -529,6 +426,9 @@ proc_pr (unsigned char * prem, unsigned char * conc)
   if (tmp_pos == -2)
     return NULL;
 
+  if (tmp_pos == -1)
+    return _("Prenex constructed incorrectly.");
+
   unsigned char * scope, * var, quant[S_CL + 1];
   int v_len;
 
@@ -727,53 +627,98 @@ proc_ii (unsigned char * conc)
 }
 
 char *
-proc_fv (unsigned char * prem_0, unsigned char * prem_1, unsigned char * conc)
+proc_fv (vec_t * prems, unsigned char * conc)
 {
-  int first_0, first_1;
-  unsigned char * eq_sen, * oth_sen;
+  formula_t ** fms, ** eqs, * oth_fm, * conc_fm, * tmp;
+  int i, num_fms, num_eqs, num_oth, ret;
+  char * ret_str;
 
-  first_0 = (prem_0[1] == '=') ? 1 : 0;
-  first_1 = (prem_1[1] == '=') ? 1 : 0;
+  conc_fm = formula_init (conc);
+  if (!conc_fm)
+    return NULL;
 
-  if (first_0 && first_1)
-    {
-      int ret_0, ret_1;
+  num_fms = prems->num_stuff;
+  fms = (formula_t **) calloc (num_fms * 2, sizeof (formula_t *));
+  CHECK_ALLOC (fms, NULL);
+  eqs = fms + num_fms;
 
-      ret_0 = help_fv (prem_0, prem_1, conc);
-      if (ret_0 == -1)
-	return NULL;
+  // Sort the references into the identities and the other sentence.
 
-      ret_1 = help_fv (prem_1, prem_0, conc);
-      if (ret_1 == -1)
-	return NULL;
+  num_eqs = num_oth = 0;
+  oth_fm = NULL;
+  ret = 0;
 
-      if (ret_0 == 0 || ret_1 == 0)
-	return CORRECT;
+  for (i = 0; i < num_fms; i++)
+    {
+      fms[i] = formula_init (vec_str_nth (prems, i));
+      if (!fms[i])
+	{
+	  ret = -1;
+	  break;
+	}
 
-      return _("Free Variable substitution constructed incorrectly.");
+      if (formula_is_conn (fms[i], (const unsigned char *) "=")
+	  && fms[i]->num_args == 3)
+	{
+	  eqs[num_eqs++] = fms[i];
+	}
+      else
+	{
+	  oth_fm = fms[i];
+	  num_oth++;
+	}
     }
-  else if (first_0)
+
+  if (ret == -1)
     {
-      eq_sen = prem_0;
-      oth_sen = prem_1;
+      ret_str = NULL;
     }
-  else if (first_1)
+  else if (num_eqs == 0)
     {
-      eq_sen = prem_1;
-      oth_sen = prem_0;
+      ret_str = _("One of the premises must contain an identity predicate.");
     }
-  else
+  else if (num_oth > 1)
     {
-      return _("One of the premises must contain an identity predicate.");
+      ret_str = _("Only one of the references may be other than an identity.");
     }
+  else
+    {
+      if (num_oth == 1)
+	{
+	  ret = help_fv (oth_fm, conc_fm, eqs, num_eqs);
+	}
+      else
+	{
+	  // Each of the identities may be the sentence that is substituted
+	  // into, by the others.
 
-  int ret;
-  ret = help_fv (eq_sen, oth_sen, conc);
-  if (ret == -1)
-    return NULL;
+	  ret = -2;
+	  for (i = 0; (ret == -2 || ret == 1) && i < num_eqs; i++)
+	    {
+	      tmp = eqs[i];
+	      eqs[i] = eqs[num_eqs - 1];
+	      eqs[num_eqs - 1] = tmp;
 
-  if (ret == 0)
-    return CORRECT;
+	      ret = help_fv (tmp, conc_fm, eqs, num_eqs - 1);
+
+	      eqs[num_eqs - 1] = eqs[i];
+	      eqs[i] = tmp;
+	    }
+	}
+
+      if (ret == -1)
+	ret_str = NULL;
+      else if (ret == 0)
+	ret_str = CORRECT;
+      else
+	ret_str = _("Free Variable substitution constructed incorrectly.");
+    }
+
+  for (i = 0; i < num_fms; i++)
+    if (fms[i])
+      formula_destroy (fms[i]);
+  free (fms);
+  formula_destroy (conc_fm);
 
-  return _("ERROR.");
+  return ret_str;
 }
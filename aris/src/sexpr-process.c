@@ -21,6 +21,11 @@
 #include "vec.h"
 #include "var.h"
 #include "list.h"
+#include "formula.h"
+#include "symbol.h"
+
+#define MEM_SUBSYSTEM MEM_PARSER
+#include "mem.h"
 
 /* Checks for a negation on a sexpr string.
  *  input:
@@ -53,7 +58,7 @@ sexpr_add_not (unsigned char * in_str)
 {
   unsigned char * not_in_str;
 
-  not_in_str = (unsigned char *) calloc (strlen (in_str) + S_NL + 3, sizeof (char));
+  not_in_str = (unsigned char *) calloc (strlen (in_str) + S_NL + 4, sizeof (char));
   CHECK_ALLOC (not_in_str, NULL);
   sprintf (not_in_str, "(%s %s)\0", S_NOT, in_str);
 
@@ -85,7 +90,8 @@ sexpr_elim_not (unsigned char * in_str)
  *  input:
  *    in_str - the sexpr text from which to obtain the generalities.
  *    conn - the connective to check for, or an empty string to check for any.
- *    vec - the string vector to hold the generalities.
+ *    vec - the string vector to hold the generalities, which must own
+ *      its strings.
  *  output:
  *    The size of vec, or -1 on memory error.
  */
@@ -108,6 +114,20 @@ sexpr_get_generalities (unsigned char * in_str, unsigned char * conn, vec_t * ve
 
   if (conn[0] == '\0')
     {
+      // A predicate has no generalities.
+      if (strncmp (in_str + pos, S_AND, S_CL)
+	  && strncmp (in_str + pos, S_OR, S_CL)
+	  && strncmp (in_str + pos, S_CON, S_CL)
+	  && strncmp (in_str + pos, S_BIC, S_CL)
+	  && strncmp (in_str + pos, S_NOT, S_NL))
+	{
+	  ret_chk = vec_str_add_obj (vec, in_str);
+	  if (ret_chk < 0)
+	    return -1;
+
+	  return 1;
+	}
+
       strncpy (conn, in_str + pos, S_CL);
       conn[S_CL] = '\0';
     }
@@ -138,7 +158,7 @@ sexpr_get_generalities (unsigned char * in_str, unsigned char * conn, vec_t * ve
 	  if (tmp_pos == -2)
 	    return -1;
 
-	  ret_chk = vec_str_add_obj (vec, tmp_str);
+	  ret_chk = vec_str_take_obj (vec, tmp_str);
 	  if (ret_chk < 0)
 	    return -1;
 
@@ -159,7 +179,7 @@ sexpr_get_generalities (unsigned char * in_str, unsigned char * conn, vec_t * ve
 	  strncpy (tmp_str, in_str + pos, tmp_pos - pos);
 	  tmp_str[tmp_pos - pos] = '\0';
 
-	  ret_chk = vec_str_add_obj (vec, tmp_str);
+	  ret_chk = vec_str_take_obj (vec, tmp_str);
 	  if (ret_chk < 0)
 	    return -1;
 
@@ -185,40 +205,27 @@ sexpr_find_top_connective (unsigned char * in_str, unsigned char * conn,
 			   unsigned char ** lsen, unsigned char ** rsen)
 {
   int gg;
-  vec_t * vec;
+  vec_t vec;
 
-  vec = init_vec (sizeof (char *));
-  if (!vec)
-    return -1;
+  *lsen = *rsen = NULL;
+
+  vec_init_local (&vec, sizeof (char *));
 
-  gg = sexpr_get_generalities (in_str, conn, vec);
+  gg = sexpr_get_generalities (in_str, conn, &vec);
   if (gg == -1)
     return -1;
 
   if (gg == 1 || gg > 2)
     {
-      destroy_str_vec (vec);
+      vec_str_fini (&vec);
       return -2;
     }
 
-  unsigned char * gen_0, * gen_1;
-  int g0_len, g1_len;
-
-  gen_0 = vec_str_nth (vec, 0);
-  gen_1 = vec_str_nth (vec, 1);
-
-  g0_len = strlen (gen_0);
-  g1_len = strlen (gen_1);
-
-  *lsen = (unsigned char *) calloc (g0_len + 1, sizeof (char));
-  CHECK_ALLOC (*lsen, -1);
-  strcpy (*lsen, gen_0);
+  // The generalities are handed to the caller as they are.
+  *lsen = vec_str_nth (&vec, 0);
+  *rsen = vec_str_nth (&vec, 1);
 
-  *rsen = (unsigned char *) calloc (g1_len + 1, sizeof (char));
-  CHECK_ALLOC (*rsen, -1);
-  strcpy (*rsen, gen_1);
-
-  destroy_str_vec (vec);
+  vec_fini (&vec);
 
   return 0;
 }
@@ -309,7 +316,8 @@ sexpr_find_unmatched (unsigned char * sen_a, unsigned char * sen_b,
  *  input:
  *    in_str - the sexpr text from which to get the predicate arguments.
  *    pred - a string pointer that receives the predicate symbol.
- *    vec - a string vector that receives the arguments.
+ *    vec - a string vector that receives the arguments, which must own
+ *      its strings.
  *  output:
  *    The number of arguments on success,
  *    0 on error,
@@ -357,10 +365,9 @@ sexpr_get_pred_args (unsigned char * in_str, unsigned char ** pred, vec_t * vec)
 	  if (tmp_pos == -2)
 	    return -1;
 
-	  ret_chk = vec_str_add_obj (vec, tmp_str);
+	  ret_chk = vec_str_take_obj (vec, tmp_str);
 	  if (ret_chk < 0)
 	    return -1;
-	  free (tmp_str);
 
 	  pos = tmp_pos + 1;
 	  break;
@@ -379,15 +386,15 @@ sexpr_get_pred_args (unsigned char * in_str, unsigned char ** pred, vec_t * vec)
 	  strncpy (tmp_str, elm_str + pos, tmp_pos - pos);
 	  tmp_str[tmp_pos - pos] = '\0';
 
-	  ret_chk = vec_str_add_obj (vec, tmp_str);
+	  ret_chk = vec_str_take_obj (vec, tmp_str);
 	  if (ret_chk < 0)
 	    return -1;
-	  free (tmp_str);
 	  pos = tmp_pos;
 	  break;
 	}
     }
 
+  free (elm_str);
   return vec->num_stuff;
 }
 
@@ -406,6 +413,12 @@ sexpr_elim_quant (unsigned char * in_str, unsigned char * quant,
   int tmp_pos;
   unsigned char * tmp_str;
 
+  *var = NULL;
+
+  // Only a quantifier begins with two parentheses.
+  if (in_str[0] != '(' || in_str[1] != '(')
+    return "\0";
+
   tmp_pos = parse_parens (in_str, 0, &tmp_str);
   if (tmp_pos == -2)
     return NULL;
@@ -537,174 +550,88 @@ sexpr_replace_var (unsigned char * in_str, unsigned char * new_var,
  */
 int
 sexpr_quant_infer (unsigned char * quant_sen, unsigned char * elim_sen,
-		   unsigned char * quant, int cons, vec_t * cur_vars)
+		   unsigned char * quant, int cons, var_set_t * cur_vars)
 {
   if (!strcmp (quant_sen, elim_sen))
     return 1;
 
-  if (quant_sen[0] != '(' || quant_sen[1] != '(')
-    return -2;
+  formula_t * q_fm, * e_fm, * scope, ** terms;
+  int q_type, num_vars, n, i, ret_chk;
 
-  unsigned char * var, * elm_sen, qs_quant[S_CL + 1];
-  int tmp_pos;
+  q_type = strcmp (quant, S_UNV) ? FORMULA_EXL : FORMULA_UNV;
 
-  elm_sen = sexpr_elim_quant (quant_sen, qs_quant, &var);
-  if (!elm_sen)
+  q_fm = formula_init (quant_sen);
+  if (!q_fm)
     return -1;
 
-  if (elm_sen[0] == '\0' || strcmp (qs_quant, quant))
-    return -2;
-
-  int q_pos, e_pos, cmp, tmp_0;
-
-  cmp = 0;
-  tmp_0 = -2;
-
-  while (!cmp)
-    {
-      int tmp_1;
-      unsigned char * str_0, * str_1;
-
-      q_pos = tmp_0 + 2;
-
-      if (elm_sen[q_pos + 1] != '(')
-	break;
-
-      tmp_0 = parse_parens (elm_sen, q_pos + 1, &str_0);
-      if (tmp_0 == -2)
-	return -1;
-
-      if (elim_sen[1] != '(')
-	{
-	  free (str_0);
-	  q_pos = tmp_0 + 2;
-	  continue;
-	}
-
-      tmp_1 = parse_parens (elim_sen, 1, &str_1);
-      if (tmp_1 == -2)
-	return -1;
-
-      cmp = !strcmp (str_0, str_1);
-      free (str_0);
-      free (str_1);
-    }
-
-  // Determine the offset, and get the quantifier's variable positions.
-
-  int offset, ret_chk;
-  vec_t * var_offs;
-
-  offset = q_pos;
-  var_offs = init_vec (sizeof (int));
-  if (!var_offs)
-    return -1;
-
-  ret_chk = sexpr_get_quant_vars (quant_sen, var_offs);
-  if (ret_chk == -1)
+  e_fm = formula_init (elim_sen);
+  if (!e_fm)
     return -1;
 
-  // Use the offset to determine the position of the first variable in elim_sen.
-  // Get the variable from elim_sen.
+  // Several quantifiers may be instantiated at once, except with ei.
 
-  int * off_0;
-  unsigned char * oth_sen, * new_var = NULL;
-
-  off_0 = vec_nth (var_offs, 0);
-  if (!off_0)
+  num_vars = 0;
+  for (scope = q_fm; scope->type == FORMULA_QUANT && scope->quant == q_type;
+       scope = scope->args[0])
     {
-      destroy_vec (var_offs);
-      free (elm_sen);
-      return -2;
+      num_vars++;
+      if (cons == 2)
+	break;
     }
-  q_pos = e_pos = *off_0 - offset;
 
-  if (elim_sen[e_pos] == '(')
-    {
-      q_pos = parse_parens (elim_sen, e_pos, &new_var);
-      if (q_pos == -2)
-	return -1;
-    }
-  else
-    {
-      while (elim_sen[q_pos] != ' ' && elim_sen[q_pos] != ')')
-	q_pos++;
+  terms = (formula_t **) calloc (num_vars + 1, sizeof (formula_t *));
+  CHECK_ALLOC (terms, -1);
 
-      new_var = (unsigned char *) calloc (q_pos - e_pos + 1, sizeof (char));
-      CHECK_ALLOC (new_var, -1);
+  // Match the scope of each amount of quantifiers against elim_sen,
+  // which finds the terms that the variables were instantiated with.
 
-      strncpy (new_var, elim_sen + e_pos, q_pos - e_pos);
-      new_var[q_pos - e_pos] = '\0';
-    }
+  ret_chk = -2;
+  scope = q_fm;
 
-  // If there are constraints, then check them.
-
-  if (cons)
+  for (n = 1; n <= num_vars; n++)
     {
-      int i;
-
-      for (i = 0; new_var[i] != '\0'; i++)
-	if (new_var[i] == ' ')
-	  break;
+      scope = scope->args[0];
 
-      if (new_var[i] != '\0')
-	{
-	  free (new_var);
-	  destroy_vec (var_offs);
-	  free (elm_sen);
-	  return -3;
-	}
-
-      for (i = 0; i < cur_vars->num_stuff; i++)
-	{
-	  variable * cur_var;
-	  cur_var = vec_nth (cur_vars, i);
-	  if (!strcmp (cur_var->text, new_var))
-	    break;
-	}
+      if (!formula_quant_match (scope, e_fm, n, terms))
+	continue;
 
-      if (i != cur_vars->num_stuff)
+      ret_chk = 0;
+      for (i = 0; i < n; i++)
 	{
 	  variable * cur_var;
-	  cur_var = vec_nth (cur_vars, i);
 
-	  if (cons == 2 || (cons == 1 && !cur_var->arbitrary))
+	  // Each quantifier must bind something.
+	  if (!terms[i])
 	    {
-	      free (new_var);
-	      destroy_vec (var_offs);
-	      free (elm_sen);
-	      return -3;
+	      ret_chk = -2;
+	      break;
 	    }
-	}
-    }
 
-  ret_chk = sexpr_replace_var (elm_sen, new_var, var, var_offs, &oth_sen);
-  if (ret_chk == -1)
-    return -1;
+	  if (!cons)
+	    continue;
 
-  free (var);
-  free (elm_sen);
-  destroy_vec (var_offs);
-  free (new_var);
+	  if (terms[i]->type != FORMULA_SYMBOL)
+	    {
+	      ret_chk = -3;
+	      break;
+	    }
 
-  if (cons != 2)
-    {
-      ret_chk = sexpr_quant_infer (oth_sen, elim_sen, quant, cons, cur_vars);
-      if (ret_chk == -1)
-	return -1;
+	  cur_var = var_set_find_sym (cur_vars, terms[i]->sym);
+	  if (cur_var && (cons == 2 || !cur_var->arbitrary))
+	    {
+	      ret_chk = -3;
+	      break;
+	    }
+	}
 
-      ret_chk = (ret_chk == 1) ? 0 : ret_chk;
-    }
-  else
-    {
-      ret_chk = strcmp (oth_sen, elim_sen);
+      break;
     }
 
-  free (oth_sen);
-  if (ret_chk)
-    return -2;
+  free (terms);
+  formula_destroy (q_fm);
+  formula_destroy (e_fm);
 
-  return 0;
+  return ret_chk;
 }
 
 /* Determines the positions in a string of a variable.
@@ -744,7 +671,7 @@ sexpr_find_vars (unsigned char * in_str, unsigned char * var, vec_t * offsets)
 /* Collects variables from a sexpr string.
  *  input:
  *    in_str - the sexpr text from which to collect variables.
- *    vars - a string vector that holds the variables.
+ *    vars - an integer vector that receives the symbols of the variables.
  *    quant - whether or not quantifier variables are being looked for.
  *  output:
  *    The size of vars on success, -1 on memory error.
@@ -777,99 +704,69 @@ sexpr_parse_vars (unsigned char * in_str, vec_t * vars, int quant)
 	  continue;
 	}
 
-      int pos = i;
-      unsigned char * new_var;
+      int pos = i, sym;
 
       while (in_str[pos] != ' ' && in_str[pos] != ')')
 	pos++;
 
-      new_var = (unsigned char *) calloc (pos - i + 1, sizeof (char));
-      CHECK_ALLOC (new_var, -1);
-      strncpy (new_var, in_str + i, pos - i);
-      new_var[pos - i] = '\0';
+      sym = symbol_intern (in_str + i, pos - i);
+      if (sym == -1)
+	return -1;
       i = pos;
 
       for (j = 0; j < vars->num_stuff; j++)
-	if (!strcmp (new_var, vec_str_nth (vars, j)))
+	if (*((int *) vec_nth (vars, j)) == sym)
 	  break;
 
-      if (j == vars->num_stuff)
-	{
-	  pos = vec_str_add_obj (vars, new_var);
-	  if (pos < 0)
-	    return -1;
-	}
+      if (j < vars->num_stuff)
+	continue;
 
-      free (new_var);
+      pos = vec_add_obj (vars, &sym);
+      if (pos < 0)
+	return -1;
     }
 
   return vars->num_stuff;
 }
 
-/* Collect variables from a sentence to a list.
+/* Collect variables from a sentence to a set.
  *  input:
- *    vars - the list of variables from a proof.
+ *    vars - the set of variables from a proof, which receives the new set.
  *    text - the text of the sentence.
  *    arb - whether or not the variables are arbitrary.
  *  output:
  *    0 on success, -1 on memory error.
  */
 int
-sexpr_collect_vars_to_proof (list_t * vars, unsigned char * text, int arb)
+sexpr_collect_vars_to_proof (var_set_t ** vars, unsigned char * text, int arb)
 {
   int ret, i, is_arbitrary;
-  vec_t * sen_vars;
+  vec_t sen_vars;
   unsigned char * sp_text, * sexpr_text;
 
-  sen_vars = init_vec (sizeof (char *));
-  if (!sen_vars)
-    return -1;
+  vec_init_local (&sen_vars, sizeof (int));
 
-  ret = sexpr_parse_vars (text, sen_vars, 0);
+  ret = sexpr_parse_vars (text, &sen_vars, 0);
   if (ret == -1)
     return -1;
 
   is_arbitrary = arb;
 
-  if (sen_vars->num_stuff == 0)
+  if (sen_vars.num_stuff == 0)
     {
-      destroy_str_vec (sen_vars);
+      vec_fini (&sen_vars);
       return 0;
     }
 
-  for (i = 0; i < sen_vars->num_stuff; i++)
+  for (i = 0; i < sen_vars.num_stuff; i++)
     {
-      unsigned char * cur_var;
-      item_t * ap_var_itr;
-
-      cur_var = vec_str_nth (sen_vars, i);
-      ap_var_itr = vars->head;
-
-      for (; ap_var_itr; ap_var_itr = ap_var_itr->next)
-	{
-	  variable * var;
-
-	  var = ap_var_itr->value;
-	  if (!strcmp (var->text, cur_var))
-	    break;
-	}
-
-      if (!ap_var_itr)
-	{
-	  variable * var;
-	  item_t * itm;
-
-	  var = variable_init (cur_var, is_arbitrary);
-	  if (!var)
-	    return -1;
-
-	  itm = ls_push_obj (vars, var);
-	  if (!itm)
-	    return -1;
-	}
+      ret = var_set_add_sym (vars, *((int *) vec_nth (&sen_vars, i)),
+			     is_arbitrary);
+      if (ret < 0)
+	return -1;
     }
 
-  destroy_str_vec (sen_vars);
+  vec_fini (&sen_vars);
   return 0;
 }
 
@@ -1058,3 +955,100 @@ sexpr_get_ids (unsigned char * sen, int ** ids, vec_t * sen_ids)
 
   return 0;
 }
+
+/* Checks the differences between two sentences against a rule.
+ *  input:
+ *    prem - the tree of the premise.
+ *    conc - the tree of the conclusion.
+ *    rule - the check of the rule at a difference.
+ *  output:
+ *    CORRECT if every difference follows from the rule,
+ *    NO_DIFFERENCE if there are no differences,
+ *    an error message otherwise, or NULL on memory error.
+ */
+char *
+sexpr_diff_check (formula_t * prem, formula_t * conc, diff_rule rule)
+{
+  formula_t * dp, * dc;
+  char * ret_str, * part;
+  int i, ret;
+
+  ret = formula_diff (prem, conc, &dp, &dc, NULL);
+  if (ret == -1)
+    return NULL;
+
+  if (ret == 0)
+    return NO_DIFFERENCE;
+
+  ret_str = rule (dp, dc);
+  if (!ret_str || ret_str == CORRECT)
+    return ret_str;
+
+  // Several parts of the difference may have been changed separately.
+
+  if (!formula_same_shape (dp, dc))
+    return ret_str;
+
+  for (i = (dp->type == FORMULA_LIST) ? 1 : 0; i < dp->num_args; i++)
+    {
+      part = sexpr_diff_check (dp->args[i], dc->args[i], rule);
+      if (!part)
+	return NULL;
+
+      if (part != CORRECT && part != NO_DIFFERENCE)
+	return part;
+    }
+
+  return CORRECT;
+}
+
+/* Determines whether or not two parts of sentences are the same,
+ * up to the changes made by a rule.
+ *  input:
+ *    prem - the part of the premise.
+ *    conc - the part of the conclusion.
+ *    rule - the check of the rule at a difference.
+ *  output:
+ *    1 if they are, 0 if they aren't, -1 on memory error.
+ */
+int
+sexpr_diff_parts (formula_t * prem, formula_t * conc, diff_rule rule)
+{
+  char * ret_str;
+
+  ret_str = sexpr_diff_check (prem, conc, rule);
+  if (!ret_str)
+    return -1;
+
+  return (ret_str == CORRECT || ret_str == NO_DIFFERENCE);
+}
+
+/* Checks two sentences against a rule.
+ *  input:
+ *    prem - the premise.
+ *    conc - the conclusion.
+ *    rule - the check of the rule at a difference.
+ *  output:
+ *    the result of sexpr_diff_check.
+ */
+char *
+sexpr_diff_rule (unsigned char * prem, unsigned char * conc, diff_rule rule)
+{
+  formula_t * p_fm, * c_fm;
+  char * ret_str;
+
+  p_fm = formula_init (prem);
+  if (!p_fm)
+    return NULL;
+
+  c_fm = formula_init (conc);
+  if (!c_fm)
+    return NULL;
+
+  ret_str = sexpr_diff_check (p_fm, c_fm, rule);
+
+  formula_destroy (p_fm);
+  formula_destroy (c_fm);
+
+  return ret_str;
+}
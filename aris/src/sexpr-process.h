@@ -38,6 +38,12 @@
 typedef struct vector vec_t;
 typedef struct proof proof_t;
 typedef struct list list_t;
+typedef struct formula formula_t;
+
+// The check of a rule at the difference between two sentences.  Returns
+// CORRECT, an error message, or NULL on memory error.
+
+typedef char * (* diff_rule) (formula_t * prem, formula_t * conc);
 
 int sexpr_not_check (unsigned char * in_str);
 
@@ -66,16 +72,22 @@ int sexpr_replace_var (unsigned char * in_str, unsigned char * new_var,
 		       unsigned char ** out_str);
 
 int sexpr_quant_infer (unsigned char * quant_sen, unsigned char * elim_sen,
-		       unsigned char * quant, int cons, vec_t * cur_vars);
+		       unsigned char * quant, int cons, var_set_t * cur_vars);
 
 int sexpr_find_vars (unsigned char * in_str, unsigned char * var, vec_t * offsets);
 
 int sexpr_parse_vars (unsigned char * in_str, vec_t * vars, int quant);
 
-int sexpr_collect_vars_to_proof (list_t * vars, unsigned char * text, int arb);
+int sexpr_collect_vars_to_proof (var_set_t ** vars, unsigned char * text, int arb);
 
 int sexpr_get_ids (unsigned char * sen, int ** ids, vec_t * sen_ids);
 
+char * sexpr_diff_check (formula_t * prem, formula_t * conc, diff_rule rule);
+
+int sexpr_diff_parts (formula_t * prem, formula_t * conc, diff_rule rule);
+
+char * sexpr_diff_rule (unsigned char * prem, unsigned char * conc, diff_rule rule);
+
 /* Inference rule functions. */
 
 char * proc_mp (unsigned char * prem_0, unsigned char * prem_1, unsigned char * conc);
@@ -98,7 +110,7 @@ char * proc_cd (vec_t * prems, unsigned char * conc);
 
 char * proc_im (unsigned char * prem, unsigned char * conc);
 
-char * proc_dm (unsigned char * prem, unsigned char * conc, int mode_guess);
+char * proc_dm (unsigned char * prem, unsigned char * conc);
 
 char * proc_as (unsigned char * prem, unsigned char * conc);
 
@@ -106,7 +118,7 @@ char * proc_co (unsigned char * prem, unsigned char * conc);
 
 char * proc_id (unsigned char * prem, unsigned char * conc);
 
-char * proc_dt (unsigned char * prem, unsigned char * conc, int mode_guess);
+char * proc_dt (unsigned char * prem, unsigned char * conc);
 
 char * proc_eq (unsigned char * prem, unsigned char * conc);
 
@@ -118,13 +130,13 @@ char * proc_sb (unsigned char * prem, unsigned char * conc);
 
 /* Predicate rule functions. */
 
-char * proc_ug (unsigned char * prem, unsigned char * conc, vec_t * vars);
+char * proc_ug (unsigned char * prem, unsigned char * conc, var_set_t * vars);
 
 char * proc_ui (unsigned char * prem, unsigned char * conc);
 
 char * proc_eg (unsigned char * prem, unsigned char * conc);
 
-char * proc_ei (unsigned char * prem, unsigned char * conc, vec_t * vars);
+char * proc_ei (unsigned char * prem, unsigned char * conc, var_set_t * vars);
 
 char * proc_bv (unsigned char * prem, unsigned char * conc);
 
@@ -134,7 +146,7 @@ char * proc_pr (unsigned char * prem, unsigned char * conc);
 
 char * proc_ii (unsigned char * conc);
 
-char * proc_fv (unsigned char * prem_0,  unsigned char * prem_1, unsigned char * conc);
+char * proc_fv (vec_t * prems, unsigned char * conc);
 
 /* Boolean rule functions. */
 
@@ -152,7 +164,7 @@ char * proc_lm (vec_t * prems, unsigned char * conc, proof_t * proof);
 
 char * proc_sp (unsigned char * prem_0, unsigned char * prem_1, unsigned char * conc);
 
-char * proc_sq (unsigned char * conc, vec_t * vars);
+char * proc_sq (unsigned char * conc, var_set_t * vars);
 
 char * proc_in (unsigned char * prem, unsigned char * conc);
 #endif  /*  ARIS_SEXPR_PROCESS_H  */
@@ -0,0 +1,297 @@
+/* Functions for handling the subproofs of a proof.
+
+   Copyright (C) 2012 Ian Dunn.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "subproof.h"
+#include "vec.h"
+#include "process.h"
+
+#define MEM_SUBSYSTEM MEM_RULES
+#include "mem.h"
+
+#define SUBPROOF_NTH(t,n) ((subproof_t *) vec_nth ((t)->subproofs, (n)))
+
+/* Initializes an empty subproof tree.
+ *  input:
+ *    none.
+ *  output:
+ *    the newly initialized tree, or NULL on error.
+ */
+subproof_tree_t *
+subproof_tree_init ()
+{
+  subproof_tree_t * tree;
+
+  tree = (subproof_tree_t *) calloc (1, sizeof (subproof_tree_t));
+  CHECK_ALLOC (tree, NULL);
+
+  tree->subproofs = init_vec (sizeof (subproof_t));
+  if (!tree->subproofs)
+    return NULL;
+
+  return tree;
+}
+
+/* Destroys a subproof tree.
+ *  input:
+ *    tree - the tree to destroy.
+ *  output:
+ *    none.
+ */
+void
+subproof_tree_destroy (subproof_tree_t * tree)
+{
+  destroy_vec (tree->subproofs);
+  free (tree);
+}
+
+/* Removes every subproof from a tree, so that it can be built again.
+ *  input:
+ *    tree - the tree to clear.
+ *  output:
+ *    none.
+ */
+void
+subproof_tree_clear (subproof_tree_t * tree)
+{
+  tree->subproofs->num_stuff = 0;
+}
+
+/* Finds the first subproof that starts on or after a line.
+ *  input:
+ *    tree - the tree to search.
+ *    line_num - the line number.
+ *  output:
+ *    the index of the subproof, or the amount of subproofs if there is none.
+ */
+static int
+subproof_tree_search (subproof_tree_t * tree, int line_num)
+{
+  int low, high, mid;
+
+  low = 0;
+  high = tree->subproofs->num_stuff;
+
+  while (low < high)
+    {
+      mid = (low + high) / 2;
+      if (SUBPROOF_NTH (tree, mid)->start < line_num)
+	low = mid + 1;
+      else
+	high = mid;
+    }
+
+  return low;
+}
+
+/* Finds the innermost subproof that contains a line.
+ *  input:
+ *    tree - the tree to search.
+ *    line_num - the line number.
+ *  output:
+ *    the index of the subproof, or -1 if the line is not in a subproof.
+ */
+int
+subproof_tree_find (subproof_tree_t * tree, int line_num)
+{
+  int i;
+
+  // The last subproof to start before the line either contains it,
+  // or has ended, in which case one of its parents is the one.
+
+  i = subproof_tree_search (tree, line_num + 1) - 1;
+  while (i >= 0 && SUBPROOF_NTH (tree, i)->end < line_num)
+    i = SUBPROOF_NTH (tree, i)->parent;
+
+  return i;
+}
+
+/* Gets the last line of a subproof.
+ *  input:
+ *    tree - the tree to search.
+ *    line_num - the line number of the subproof's assumption.
+ *  output:
+ *    the line number of the last line of the subproof, or -1 if no
+ *    subproof starts on line_num.
+ */
+int
+subproof_tree_last_line (subproof_tree_t * tree, int line_num)
+{
+  subproof_t * sp;
+
+  sp = SUBPROOF_NTH (tree, subproof_tree_search (tree, line_num));
+  if (!sp || sp->start != line_num)
+    return -1;
+
+  return sp->end;
+}
+
+/* Determines whether or not one line can select another as a reference.
+ *  input:
+ *    tree - the subproofs of the proof containing the lines.
+ *    line_num - the line looking to select a reference.
+ *    ref_line - the line that is attempting to be selected.
+ *  output:
+ *    0 if ref_line comes after line_num,
+ *    ref_line if it can be selected by itself,
+ *    the negation of the line starting the subproof that must be selected
+ *    in its entirety otherwise.
+ */
+int
+subproof_tree_can_select (subproof_tree_t * tree, int line_num, int ref_line)
+{
+  int i, outer = -1;
+
+  if (ref_line >= line_num)
+    return 0;
+
+  // The subproofs containing ref_line that have ended before line_num
+  // are the innermost ones, so the last of them must be selected.
+
+  i = subproof_tree_find (tree, ref_line);
+  while (i >= 0 && SUBPROOF_NTH (tree, i)->end < line_num)
+    {
+      outer = i;
+      i = SUBPROOF_NTH (tree, i)->parent;
+    }
+
+  if (outer == -1)
+    return ref_line;
+
+  return -SUBPROOF_NTH (tree, outer)->start;
+}
+
+/* Patches a tree after a line has been inserted.  The new line is part
+ * of the subproofs of the line before it, up to its own depth.
+ * Appending each line of a proof in order builds its tree.
+ *  input:
+ *    tree - the tree to patch.
+ *    line_num - the line number of the new line.
+ *    depth - the depth of the new line.
+ *    subproof - whether or not the new line starts a subproof.
+ *  output:
+ *    0 on success, -1 on memory error, 1 if the new line splits a
+ *    subproof, in which case the tree must be built again.
+ */
+int
+subproof_tree_insert (subproof_tree_t * tree, int line_num, int depth,
+		      int subproof)
+{
+  int i, first, outer_depth, parent = -1;
+
+  outer_depth = subproof ? depth - 1 : depth;
+
+  // A subproof deeper than the new line can't continue past it.
+
+  for (i = subproof_tree_find (tree, line_num - 1); i >= 0;
+       i = SUBPROOF_NTH (tree, i)->parent)
+    {
+      subproof_t * sp = SUBPROOF_NTH (tree, i);
+      if (sp->depth > outer_depth && sp->end >= line_num)
+	return 1;
+    }
+
+  for (i = subproof_tree_find (tree, line_num - 1); i >= 0;
+       i = SUBPROOF_NTH (tree, i)->parent)
+    {
+      subproof_t * sp = SUBPROOF_NTH (tree, i);
+      if (sp->depth <= outer_depth)
+	{
+	  sp->end++;
+	  if (parent == -1)
+	    parent = i;
+	}
+    }
+
+  first = subproof_tree_search (tree, line_num);
+  for (i = first; i < tree->subproofs->num_stuff; i++)
+    {
+      subproof_t * sp = SUBPROOF_NTH (tree, i);
+
+      sp->start++;
+      sp->end++;
+      if (subproof && sp->parent >= first)
+	sp->parent++;
+    }
+
+  if (subproof)
+    {
+      subproof_t new_sp;
+      int ret;
+
+      new_sp.start = new_sp.end = line_num;
+      new_sp.depth = depth;
+      new_sp.parent = parent;
+
+      ret = vec_splice (tree->subproofs, first, 0, &new_sp, 1);
+      if (ret < 0)
+	return -1;
+    }
+
+  return 0;
+}
+
+/* Patches a tree after a line has been removed.
+ *  input:
+ *    tree - the tree to patch.
+ *    line_num - the line number that the removed line had.
+ *  output:
+ *    0 on success, -1 on memory error, 1 if the line started a subproof
+ *    with other lines in it, in which case the tree must be built again.
+ */
+int
+subproof_tree_remove (subproof_tree_t * tree, int line_num)
+{
+  int i, first, removed = 0;
+  subproof_t * sp;
+
+  first = subproof_tree_search (tree, line_num);
+  sp = SUBPROOF_NTH (tree, first);
+
+  if (sp && sp->start == line_num)
+    {
+      int ret;
+
+      if (sp->end > line_num)
+	return 1;
+
+      // An empty subproof has no children to fix.
+      ret = vec_splice (tree->subproofs, first, 1, NULL, 0);
+      if (ret < 0)
+	return -1;
+      removed = 1;
+    }
+
+  for (i = subproof_tree_find (tree, line_num); i >= 0;
+       i = SUBPROOF_NTH (tree, i)->parent)
+    SUBPROOF_NTH (tree, i)->end--;
+
+  for (i = first; i < tree->subproofs->num_stuff; i++)
+    {
+      sp = SUBPROOF_NTH (tree, i);
+
+      sp->start--;
+      sp->end--;
+      if (removed && sp->parent > first)
+	sp->parent--;
+    }
+
+  return 0;
+}
@@ -0,0 +1,57 @@
+/* Subproof tree data type.
+
+   Copyright (C) 2012 Ian Dunn.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ARIS_SUBPROOF_H
+#define ARIS_SUBPROOF_H
+
+typedef struct subproof subproof_t;
+typedef struct subproof_tree subproof_tree_t;
+typedef struct vector vec_t;
+
+// A single subproof, as the interval of lines that it spans.
+
+struct subproof {
+  int start;   // The line number of the assumption.
+  int end;     // The line number of the last line.
+  int depth;   // The depth of the assumption.
+  int parent;  // The index of the enclosing subproof, or -1.
+};
+
+// The subproofs of a proof.  Subproofs either nest or don't overlap, so
+// ordering them by their first line makes the innermost subproof that
+// contains a line the last one that starts before it, or one of its
+// parents.
+
+struct subproof_tree {
+  vec_t * subproofs;  // The subproofs, ordered by their first line.
+};
+
+subproof_tree_t * subproof_tree_init ();
+void subproof_tree_destroy (subproof_tree_t * tree);
+void subproof_tree_clear (subproof_tree_t * tree);
+
+int subproof_tree_insert (subproof_tree_t * tree, int line_num, int depth,
+			  int subproof);
+int subproof_tree_remove (subproof_tree_t * tree, int line_num);
+
+int subproof_tree_find (subproof_tree_t * tree, int line_num);
+int subproof_tree_last_line (subproof_tree_t * tree, int line_num);
+int subproof_tree_can_select (subproof_tree_t * tree, int line_num,
+			      int ref_line);
+
+#endif /* ARIS_SUBPROOF_H */
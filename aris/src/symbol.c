@@ -0,0 +1,184 @@
+/* Functions for handling the table of symbols.
+
+   Copyright (C) 2012 Ian Dunn.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "symbol.h"
+#include "hash.h"
+#include "process.h"
+
+#define MEM_SUBSYSTEM MEM_PARSER
+#include "mem.h"
+
+/* Main Idea:
+ *  The same few names, such as the variables and predicates of a proof,
+ *  occur in nearly every sentence.  Each name is kept once, in a table
+ *  shared by every thread, and is known by its symbol: its index in the
+ *  table.  Two names are the same exactly when their symbols are, and a
+ *  formula keeps the symbols of its names instead of copies of them.
+ *  Symbols are never removed, so a symbol and its text stay valid until
+ *  the program ends.
+ */
+
+// The longest name that is looked up without allocating.
+
+#define SYMBOL_LOCAL_LEN 64
+
+// The table, shared by every thread.  The text of each symbol is kept
+// in blocks that never move, so that it can be read without the lock.
+
+static hash_t * symbol_table = NULL;
+static unsigned char ** symbol_blocks[SYMBOL_MAX_BLOCKS];
+static int symbol_count = 0;
+static pthread_mutex_t symbol_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Finds the symbol of a name.  The table must be locked.
+ *  input:
+ *    text - the name.
+ *  output:
+ *    the symbol, or -1 if there is none.
+ */
+static int
+symbol_lookup (const unsigned char * text)
+{
+  hash_entry_t * entry;
+
+  if (!symbol_table)
+    return -1;
+
+  entry = hash_find (symbol_table, text);
+  return (entry) ? (int) (intptr_t) entry->value : -1;
+}
+
+/* Adds a name to the table.  The table must be locked.
+ *  input:
+ *    text - the name, which is not yet in the table.
+ *  output:
+ *    the new symbol, or -1 on error.
+ */
+static int
+symbol_add (const unsigned char * text)
+{
+  hash_entry_t * entry;
+  int block, sym = symbol_count;
+
+  block = sym / SYMBOL_BLOCK_SIZE;
+  if (block >= SYMBOL_MAX_BLOCKS)
+    {
+      fprintf (stderr, "Too many symbols.\n");
+      return -1;
+    }
+
+  if (!symbol_table)
+    {
+      symbol_table = init_hash (256);
+      if (!symbol_table)
+	return -1;
+    }
+
+  if (!symbol_blocks[block])
+    {
+      symbol_blocks[block] =
+	(unsigned char **) calloc (SYMBOL_BLOCK_SIZE, sizeof (unsigned char *));
+      CHECK_ALLOC (symbol_blocks[block], -1);
+    }
+
+  entry = hash_add_obj (symbol_table, text, (void *) (intptr_t) sym);
+  if (!entry)
+    return -1;
+
+  symbol_blocks[block][sym % SYMBOL_BLOCK_SIZE] = entry->key;
+  symbol_count++;
+
+  return sym;
+}
+
+/* Gets the symbol of a name, adding the name to the table if it isn't
+ * there yet.
+ *  input:
+ *    text - the name, which need not end with a null character.
+ *    len - the length of the name.
+ *  output:
+ *    the symbol, or -1 on error.
+ */
+int
+symbol_intern (const unsigned char * text, int len)
+{
+  unsigned char local[SYMBOL_LOCAL_LEN], * name = local;
+  int sym;
+
+  if (len >= SYMBOL_LOCAL_LEN)
+    {
+      name = (unsigned char *) calloc (len + 1, sizeof (char));
+      CHECK_ALLOC (name, -1);
+    }
+
+  memcpy (name, text, len);
+  name[len] = '\0';
+
+  pthread_mutex_lock (&symbol_lock);
+
+  sym = symbol_lookup (name);
+  if (sym == -1)
+    {
+      mem_keep_begin ();
+      sym = symbol_add (name);
+      mem_keep_end ();
+    }
+
+  pthread_mutex_unlock (&symbol_lock);
+
+  if (name != local)
+    free (name);
+
+  return sym;
+}
+
+/* Finds the symbol of a name, without adding it to the table.
+ *  input:
+ *    text - the name.
+ *  output:
+ *    the symbol, or -1 if the name has never been given a symbol.
+ */
+int
+symbol_find (const unsigned char * text)
+{
+  int sym;
+
+  pthread_mutex_lock (&symbol_lock);
+  sym = symbol_lookup (text);
+  pthread_mutex_unlock (&symbol_lock);
+
+  return sym;
+}
+
+/* Gets the text of a symbol.
+ *  input:
+ *    sym - the symbol.
+ *  output:
+ *    the text of the symbol, which must not be changed or freed.
+ */
+unsigned char *
+symbol_text (int sym)
+{
+  return symbol_blocks[sym / SYMBOL_BLOCK_SIZE][sym % SYMBOL_BLOCK_SIZE];
+}
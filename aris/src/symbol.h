@@ -0,0 +1,31 @@
+/* The table of symbols.
+
+   Copyright (C) 2012 Ian Dunn.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ARIS_SYMBOL_H
+#define ARIS_SYMBOL_H
+
+// The amount of symbols in each block of the table, and the most blocks.
+
+#define SYMBOL_BLOCK_SIZE 1024
+#define SYMBOL_MAX_BLOCKS 1024
+
+int symbol_intern (const unsigned char * text, int len);
+int symbol_find (const unsigned char * text);
+unsigned char * symbol_text (int sym);
+
+#endif /* ARIS_SYMBOL_H */
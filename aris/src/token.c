@@ -0,0 +1,431 @@
+/* Functions for handling the tokens of a sentence.
+
+   Copyright (C) 2012 Ian Dunn.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "token.h"
+#include "vec.h"
+#include "process.h"
+
+#define MEM_SUBSYSTEM MEM_PARSER
+#include "mem.h"
+
+#define TOKEN_NTH(v,n) ((token_t *) vec_nth ((v), (n)))
+
+/* Lexes a single token.
+ *  input:
+ *    text - the text to lex from.
+ *    pos - the position in text of the token.
+ *    tok - receives the token.
+ *  output:
+ *    the length of the token.
+ */
+static int
+token_lex (const unsigned char * text, int pos, token_t * tok)
+{
+  const unsigned char * c = text + pos;
+  int len = 1;
+
+  tok->bad = 0;
+
+  if (isspace (*c))
+    {
+      tok->type = TOKEN_SPACE;
+      while (isspace (c[len]))
+	len++;
+    }
+  else if (*c == '(')
+    {
+      tok->type = TOKEN_LPAREN;
+    }
+  else if (*c == ')')
+    {
+      tok->type = TOKEN_RPAREN;
+    }
+  else if (!strncmp (c, AND, CL) || !strncmp (c, OR, CL)
+	   || !strncmp (c, CON, CL) || !strncmp (c, BIC, CL))
+    {
+      tok->type = TOKEN_BINARY;
+      len = CL;
+    }
+  else if (!strncmp (c, UNV, CL) || !strncmp (c, EXL, CL))
+    {
+      tok->type = TOKEN_QUANT;
+      len = CL;
+    }
+  else if (!strncmp (c, NOT, NL))
+    {
+      tok->type = TOKEN_NOT;
+      len = NL;
+    }
+  else if (!strncmp (c, TAU, CL) || !strncmp (c, CTR, CL))
+    {
+      tok->type = TOKEN_TRUTH;
+      len = CL;
+    }
+  else if (!strncmp (c, NIL, CL))
+    {
+      tok->type = TOKEN_NIL;
+      len = CL;
+    }
+  else if (isalnum (*c) || *c == '_')
+    {
+      while (isalnum (c[len]) || c[len] == '_')
+	len++;
+
+      tok->type = (len == 1 && islower (*c)) ? TOKEN_VARIABLE : TOKEN_SYMBOL;
+    }
+  else
+    {
+      // Keep multibyte characters in one piece.
+      tok->type = TOKEN_OTHER;
+      if (*c >= 0x80)
+	while ((c[len] & 0xC0) == 0x80)
+	  len++;
+    }
+
+  tok->len = len;
+  return len;
+}
+
+/* Finds the closest token before another that isn't a space.
+ *  input:
+ *    tokens - the tokens to search.
+ *    i - the index of the token to start from.
+ *  output:
+ *    the index of the token, or -1 if there is none.
+ */
+static int
+token_prev (vec_t * tokens, int i)
+{
+  for (i--; i >= 0; i--)
+    if (TOKEN_NTH (tokens, i)->type != TOKEN_SPACE)
+      break;
+
+  return i;
+}
+
+/* Finds the closest token after another that isn't a space.
+ *  input:
+ *    tokens - the tokens to search.
+ *    i - the index of the token to start from.
+ *  output:
+ *    the index of the token, or -1 if there is none.
+ */
+static int
+token_next (vec_t * tokens, int i)
+{
+  for (i++; i < tokens->num_stuff; i++)
+    if (TOKEN_NTH (tokens, i)->type != TOKEN_SPACE)
+      return i;
+
+  return -1;
+}
+
+/* Gets the type of a token by its index.
+ *  input:
+ *    tokens - the tokens.
+ *    i - the index of the token, or -1.
+ *  output:
+ *    the type of the token, or -1 if i is -1.
+ */
+static int
+token_type (vec_t * tokens, int i)
+{
+  return (i < 0) ? -1 : TOKEN_NTH (tokens, i)->type;
+}
+
+/* Determines whether or not a type of token can start an operand.
+ *  input:
+ *    type - the type of the token.
+ *  output:
+ *    1 if it can, 0 otherwise.
+ */
+static int
+token_starts_operand (int type)
+{
+  return (type == TOKEN_SYMBOL || type == TOKEN_VARIABLE
+	  || type == TOKEN_LPAREN || type == TOKEN_NOT
+	  || type == TOKEN_QUANT || type == TOKEN_TRUTH);
+}
+
+/* Checks whether or not a connective or quantifier is misplaced,
+ * following the rules of check_conns and check_quants.
+ *  input:
+ *    tokens - the tokens.
+ *    i - the index of the token to check.
+ *  output:
+ *    1 if the token is misplaced, 0 otherwise.
+ */
+static int
+token_is_bad (vec_t * tokens, int i)
+{
+  int prev, next;
+
+  prev = token_type (tokens, token_prev (tokens, i));
+  next = token_next (tokens, i);
+
+  switch (TOKEN_NTH (tokens, i)->type)
+    {
+    case TOKEN_BINARY:
+      if (prev != TOKEN_SYMBOL && prev != TOKEN_VARIABLE
+	  && prev != TOKEN_RPAREN && prev != TOKEN_NIL)
+	return 1;
+
+      return !token_starts_operand (token_type (tokens, next));
+
+    case TOKEN_NOT:
+      return !token_starts_operand (token_type (tokens, next));
+
+    case TOKEN_QUANT:
+      if (prev == TOKEN_QUANT || token_type (tokens, next) != TOKEN_VARIABLE)
+	return 1;
+
+      next = token_type (tokens, token_next (tokens, next));
+      return (next != TOKEN_LPAREN && next != TOKEN_NOT && next != TOKEN_QUANT);
+    }
+
+  return 0;
+}
+
+/* Adds or removes a token from the summary of a token list.
+ *  input:
+ *    tl - the token list.
+ *    tok - the token.
+ *    mod - 1 to add the token, -1 to remove it.
+ *  output:
+ *    none.
+ */
+static void
+token_list_count (token_list_t * tl, token_t * tok, int mod)
+{
+  switch (tok->type)
+    {
+    case TOKEN_LPAREN:
+      tl->num_open += mod;
+      break;
+    case TOKEN_RPAREN:
+      tl->num_close += mod;
+      break;
+    case TOKEN_BINARY:
+    case TOKEN_NOT:
+      if (tok->bad)
+	tl->bad_conns += mod;
+      break;
+    case TOKEN_QUANT:
+      if (tok->bad)
+	tl->bad_quants += mod;
+      break;
+    }
+}
+
+/* Initializes a token list from a text.
+ *  input:
+ *    text - the text to lex.
+ *  output:
+ *    the newly initialized token list, or NULL on error.
+ */
+token_list_t *
+token_list_init (const unsigned char * text)
+{
+  token_list_t * tl;
+  int ret;
+
+  tl = (token_list_t *) calloc (1, sizeof (token_list_t));
+  CHECK_ALLOC (tl, NULL);
+
+  tl->tokens = init_vec (sizeof (token_t));
+  if (!tl->tokens)
+    return NULL;
+
+  ret = token_list_update (tl, (const unsigned char *) "", text, 0);
+  if (ret < 0)
+    return NULL;
+
+  return tl;
+}
+
+/* Destroys a token list.
+ *  input:
+ *    tl - the token list to destroy.
+ *  output:
+ *    none.
+ */
+void
+token_list_destroy (token_list_t * tl)
+{
+  destroy_vec (tl->tokens);
+  free (tl);
+}
+
+/* Updates a token list after its text has changed.  Only the tokens
+ * around the change are lexed again, and only their neighbors are checked.
+ *  input:
+ *    tl - the token list, which holds the tokens of old_text.
+ *    old_text - the text before the change.
+ *    new_text - the text after the change.
+ *    diff_pos - the first position at which the texts differ,
+ *      as returned by find_difference.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+int
+token_list_update (token_list_t * tl, const unsigned char * old_text,
+		   const unsigned char * new_text, int diff_pos)
+{
+  int old_len, new_len, start, suffix, old_end, new_end, delta;
+  int i, j, k, off, old_off, pos, first, last, ret;
+  vec_t * new_toks;
+  token_t tok;
+
+  old_len = tl->text_len;
+  new_len = strlen ((const char *) new_text);
+
+  if (diff_pos < 0)
+    {
+      if (old_len == new_len)
+	return 0;
+
+      diff_pos = (old_len < new_len) ? old_len : new_len;
+    }
+
+  start = diff_pos;
+
+  // Find the end of the change, from the text the two have in common.
+
+  for (suffix = 0; suffix < old_len - start && suffix < new_len - start;
+       suffix++)
+    {
+      if (old_text[old_len - suffix - 1] != new_text[new_len - suffix - 1])
+	break;
+    }
+
+  old_end = old_len - suffix;
+  new_end = new_len - suffix;
+  delta = new_len - old_len;
+
+  // Start with the token before the change, since it may grow.
+
+  off = 0;
+  for (i = 0; i < tl->tokens->num_stuff; i++)
+    {
+      int len = TOKEN_NTH (tl->tokens, i)->len;
+      if (off + len >= start)
+	break;
+      off += len;
+    }
+
+  // Lex until a token ends on the boundary of an old token after the change.
+
+  new_toks = init_vec (sizeof (token_t));
+  if (!new_toks)
+    return -1;
+
+  j = i;
+  old_off = off;
+  pos = off;
+
+  while (pos < new_len)
+    {
+      pos += token_lex (new_text, pos, &tok);
+      ret = vec_add_obj (new_toks, &tok);
+      if (ret < 0)
+	return -1;
+
+      if (pos < new_end)
+	continue;
+
+      while (j < tl->tokens->num_stuff && old_off + delta < pos)
+	old_off += TOKEN_NTH (tl->tokens, j++)->len;
+
+      if (j < tl->tokens->num_stuff && old_off + delta == pos
+	  && old_off >= old_end)
+	break;
+    }
+
+  if (pos >= new_len)
+    j = tl->tokens->num_stuff;
+
+  // Replace the old tokens with the new ones.
+
+  for (k = i; k < j; k++)
+    token_list_count (tl, TOKEN_NTH (tl->tokens, k), -1);
+
+  ret = vec_splice (tl->tokens, i, j - i, new_toks->stuff,
+		    new_toks->num_stuff);
+  if (ret < 0)
+    return -1;
+
+  for (k = 0; k < new_toks->num_stuff; k++)
+    token_list_count (tl, TOKEN_NTH (tl->tokens, i + k), 1);
+
+  // A quantifier looks two tokens ahead, and a connective one behind.
+
+  first = i;
+  for (k = 0; k < 2 && first > 0; k++)
+    {
+      ret = token_prev (tl->tokens, first);
+      first = (ret < 0) ? 0 : ret;
+    }
+
+  last = token_next (tl->tokens, i + new_toks->num_stuff - 1);
+  if (last < 0)
+    last = tl->tokens->num_stuff - 1;
+
+  destroy_vec (new_toks);
+
+  for (k = first; k <= last; k++)
+    {
+      token_t * cur = TOKEN_NTH (tl->tokens, k);
+
+      token_list_count (tl, cur, -1);
+      cur->bad = token_is_bad (tl->tokens, k);
+      token_list_count (tl, cur, 1);
+    }
+
+  tl->text_len = new_len;
+
+  return 0;
+}
+
+/* Checks a token list for errors.
+ *  input:
+ *    tl - the token list to check.
+ *  output:
+ *    0 if no errors were found, otherwise the error code that check_text
+ *    would give:
+ *    -2 - Parenthesis Error
+ *    -3 - Connective Error
+ *    -4 - Quantifier Error
+ */
+int
+token_list_check (token_list_t * tl)
+{
+  if (tl->num_open != tl->num_close)
+    return -2;
+
+  if (tl->bad_conns > 0)
+    return -3;
+
+  if (tl->bad_quants > 0)
+    return -4;
+
+  return 0;
+}
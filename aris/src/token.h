@@ -0,0 +1,68 @@
+/* Sentence token data type.
+
+   Copyright (C) 2012 Ian Dunn.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ARIS_TOKEN_H
+#define ARIS_TOKEN_H
+
+typedef struct token token_t;
+typedef struct token_list token_list_t;
+typedef struct vector vec_t;
+
+// The types of tokens.
+
+enum TOKEN_TYPES {
+  TOKEN_SPACE = 0,
+  TOKEN_LPAREN,
+  TOKEN_RPAREN,
+  TOKEN_BINARY,    // And, or, conditional, and biconditional.
+  TOKEN_NOT,
+  TOKEN_QUANT,     // Universal and existential.
+  TOKEN_TRUTH,     // Tautology and contradiction.
+  TOKEN_NIL,
+  TOKEN_VARIABLE,  // A single lower case letter.
+  TOKEN_SYMBOL,
+  TOKEN_OTHER
+};
+
+// A single token.  Only the length is kept, so that a change to the text
+// doesn't change the tokens that follow it.
+
+struct token {
+  int type;     // The type of this token.
+  int len;      // The length of this token in the text.
+  int bad : 1;  // Whether or not this connective or quantifier is misplaced.
+};
+
+// The tokens of a sentence, along with a summary of their errors.
+
+struct token_list {
+  vec_t * tokens;  // The tokens, in order.
+  int text_len;    // The length of the text that was lexed.
+  int num_open;    // The amount of opening parentheses.
+  int num_close;   // The amount of closing parentheses.
+  int bad_conns;   // The amount of misplaced connectives.
+  int bad_quants;  // The amount of misplaced quantifiers.
+};
+
+token_list_t * token_list_init (const unsigned char * text);
+void token_list_destroy (token_list_t * tl);
+int token_list_update (token_list_t * tl, const unsigned char * old_text,
+		       const unsigned char * new_text, int diff_pos);
+int token_list_check (token_list_t * tl);
+
+#endif /* ARIS_TOKEN_H */
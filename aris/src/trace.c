@@ -0,0 +1,216 @@
+/* Functions for recording evaluation traces.
+
+   Copyright (C) 2012 Ian Dunn.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "trace.h"
+
+#define MEM_SUBSYSTEM MEM_IO
+#include "mem.h"
+
+/* Gets the current time in microseconds.
+ *  input:
+ *    none.
+ *  output:
+ *    the current time.
+ */
+static double
+trace_clock ()
+{
+  struct timeval tv;
+
+  gettimeofday (&tv, NULL);
+  return (double) tv.tv_sec * 1000000.0 + (double) tv.tv_usec;
+}
+
+/* Writes a string to a file as a JSON string.  This is shared by the
+ * other writers of JSON, such as grading and benchmarking.
+ *  input:
+ *    file - the file to write to.
+ *    str - the string to write.
+ *  output:
+ *    none.
+ */
+void
+trace_write_str (FILE * file, const char * str)
+{
+  const unsigned char * c;
+
+  fputc ('"', file);
+  for (c = (const unsigned char *) str; *c; c++)
+    {
+      if (*c == '"' || *c == '\\')
+	fprintf (file, "\\%c", *c);
+      else if (*c < 0x20)
+	fprintf (file, "\\u%04x", *c);
+      else
+	fputc (*c, file);
+    }
+  fputc ('"', file);
+}
+
+/* Initializes a trace, and opens its file.
+ *  input:
+ *    file_name - the name of the file to write the trace to.
+ *  output:
+ *    the newly initialized trace, or NULL on error.
+ */
+trace_t *
+trace_init (const char * file_name)
+{
+  trace_t * trace;
+
+  trace = (trace_t *) calloc (1, sizeof (trace_t));
+  if (!trace)
+    {
+      perror (NULL);
+      return NULL;
+    }
+
+  trace->file = fopen (file_name, "w");
+  if (!trace->file)
+    {
+      perror (file_name);
+      free (trace);
+      return NULL;
+    }
+
+  trace->num_events = 0;
+  trace->pid = 1;
+  trace->origin = trace_clock ();
+
+  fprintf (trace->file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+  return trace;
+}
+
+/* Finishes a trace, closes its file and destroys it.
+ *  input:
+ *    trace - the trace to destroy.
+ *  output:
+ *    0 on success, -1 on error.
+ */
+int
+trace_destroy (trace_t * trace)
+{
+  int ret;
+
+  fprintf (trace->file, "\n]}\n");
+  ret = fclose (trace->file);
+  free (trace);
+
+  if (ret == EOF)
+    {
+      perror (NULL);
+      return -1;
+    }
+
+  return 0;
+}
+
+/* Starts a new proof in a trace.  Each proof is shown as its own process.
+ *  input:
+ *    trace - the trace to write to, or NULL.
+ *    pid - the process id to use for the following events.
+ *    name - the name of the proof.
+ *  output:
+ *    0 on success, -1 on error.
+ */
+int
+trace_set_proof (trace_t * trace, int pid, const char * name)
+{
+  if (!trace)
+    return 0;
+
+  trace->pid = pid;
+
+  fprintf (trace->file, "%s\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%i,\"tid\":1,\"args\":{\"name\":",
+	   (trace->num_events > 0) ? "," : "", pid);
+  trace_write_str (trace->file, name);
+  fprintf (trace->file, "}}");
+  trace->num_events++;
+
+  if (ferror (trace->file))
+    {
+      perror (NULL);
+      return -1;
+    }
+
+  return 0;
+}
+
+/* Gets the starting time of a span.
+ *  input:
+ *    trace - the trace that the span will be recorded to, or NULL.
+ *  output:
+ *    the time relative to the start of the trace, or 0 if trace is NULL.
+ */
+double
+trace_start (trace_t * trace)
+{
+  if (!trace)
+    return 0;
+
+  return trace_clock () - trace->origin;
+}
+
+/* Records a span that ends now.
+ *  input:
+ *    trace - the trace to record to, or NULL.
+ *    name - the name of the span.
+ *    line_num - the line that the span belongs to.
+ *    start - the starting time of the span, from trace_start.
+ *    detail - additional text to attach to the span, or NULL.
+ *  output:
+ *    0 on success, -1 on error.
+ */
+int
+trace_span (trace_t * trace, const char * name, int line_num,
+	    double start, const char * detail)
+{
+  double end;
+
+  if (!trace)
+    return 0;
+
+  end = trace_clock () - trace->origin;
+
+  fprintf (trace->file, "%s\n{\"name\":\"%s\",\"cat\":\"eval\",\"ph\":\"X\",\"ts\":%.0f,\"dur\":%.0f,\"pid\":%i,\"tid\":1,\"args\":{\"line\":%i",
+	   (trace->num_events > 0) ? "," : "", name, start, end - start,
+	   trace->pid, line_num);
+
+  if (detail)
+    {
+      fprintf (trace->file, ",\"detail\":");
+      trace_write_str (trace->file, detail);
+    }
+
+  fprintf (trace->file, "}}");
+  trace->num_events++;
+
+  if (ferror (trace->file))
+    {
+      perror (NULL);
+      return -1;
+    }
+
+  return 0;
+}
@@ -0,0 +1,54 @@
+/* Evaluation trace data type.
+
+   Copyright (C) 2012 Ian Dunn.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ARIS_TRACE_H
+#define ARIS_TRACE_H
+
+#include <stdio.h>
+
+typedef struct trace trace_t;
+
+// The names of the spans recorded for each line.
+
+#define TRACE_LINE     "line"
+#define TRACE_VALIDATE "validate"
+#define TRACE_SEXPR    "sexpr"
+#define TRACE_REFS     "refs"
+#define TRACE_LEMMA    "lemma"
+#define TRACE_RULE     "rule"
+
+// The trace structure.  Events are written out as they are recorded,
+// using the trace event format understood by chrome://tracing and
+// similar viewers.
+
+struct trace {
+  FILE * file;       // The file to write the events to.
+  int num_events;    // The number of events written so far.
+  int pid;           // The process id to attach to the events.
+  double origin;     // The time at which the trace was started.
+};
+
+trace_t * trace_init (const char * file_name);
+int trace_destroy (trace_t * trace);
+int trace_set_proof (trace_t * trace, int pid, const char * name);
+double trace_start (trace_t * trace);
+int trace_span (trace_t * trace, const char * name, int line_num,
+		double start, const char * detail);
+void trace_write_str (FILE * file, const char * str);
+
+#endif /* ARIS_TRACE_H */
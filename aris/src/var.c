@@ -21,6 +21,12 @@
 #include <stdio.h>
 
 #include "var.h"
+#include "symbol.h"
+#include "vec.h"
+#include "process.h"
+
+#define MEM_SUBSYSTEM MEM_PARSER
+#include "mem.h"
 
 /* Initializes a variable object.
  *  input:
@@ -33,7 +39,6 @@ variable *
 variable_init (unsigned char * text, int arbitrary)
 {
   variable * var;
-  int text_len;
 
   var = (variable *) calloc (1, sizeof (variable));
   if (!var)
@@ -42,21 +47,333 @@ variable_init (unsigned char * text, int arbitrary)
       return NULL;
     }
 
+  var->sym = -1;
   var->text = NULL;
   if (text)
     {
-      text_len = strlen ((const char *) text);
-      var->text = (unsigned char *) calloc (text_len + 1, sizeof (char));
-      if (!var->text)
+      var->sym = symbol_intern (text, strlen ((const char *) text));
+      if (var->sym == -1)
 	{
-	  perror (NULL);
+	  free (var);
 	  return NULL;
 	}
 
-      strcpy (var->text, text);
+      var->text = symbol_text (var->sym);
     }
 
   var->arbitrary = arbitrary;
 
   return var;
 }
+
+// The amount of bits of a hash used by each level of a set.
+
+#define VAR_SET_BITS 5
+#define VAR_SET_SLOT(h,s) (((h) >> (s)) & ((1u << VAR_SET_BITS) - 1))
+
+/* Counts the bits that are set in a bitmap.
+ *  input:
+ *    bitmap - the bitmap.
+ *  output:
+ *    the amount of set bits.
+ */
+static int
+var_set_count (unsigned int bitmap)
+{
+  int count = 0;
+
+  for (; bitmap; bitmap &= bitmap - 1)
+    count++;
+
+  return count;
+}
+
+/* Takes a reference to a set.
+ *  input:
+ *    set - the set, which may be NULL.
+ *  output:
+ *    set.
+ */
+var_set_t *
+var_set_ref (var_set_t * set)
+{
+  if (set)
+    set->ref_count++;
+
+  return set;
+}
+
+/* Releases a reference to a set, destroying the nodes that are no longer
+ * shared with another set.
+ *  input:
+ *    set - the set, which may be NULL.
+ *  output:
+ *    none.
+ */
+void
+var_set_unref (var_set_t * set)
+{
+  while (set && --set->ref_count == 0)
+    {
+      var_set_t * next = NULL;
+
+      if (set->var)
+	{
+	  free (set->var);
+	  next = set->next;
+	}
+      else
+	{
+	  int i, num_children;
+
+	  num_children = var_set_count (set->bitmap);
+	  for (i = 0; i < num_children; i++)
+	    var_set_unref (set->children[i]);
+	  free (set->children);
+	}
+
+      free (set);
+      set = next;
+    }
+}
+
+/* Finds a variable in a set by its symbol.
+ *  input:
+ *    set - the set to search.
+ *    sym - the symbol of the variable.
+ *  output:
+ *    the variable, or NULL if it isn't in the set.
+ */
+variable *
+var_set_find_sym (var_set_t * set, int sym)
+{
+  unsigned int hash = sym, bit;
+  int shift = 0;
+
+  while (set && !set->var)
+    {
+      bit = 1u << VAR_SET_SLOT (hash, shift);
+      if (!(set->bitmap & bit))
+	return NULL;
+
+      set = set->children[var_set_count (set->bitmap & (bit - 1))];
+      shift += VAR_SET_BITS;
+    }
+
+  // Symbols are unique, so a leaf holds a single variable.
+  return (set && set->hash == hash) ? set->var : NULL;
+}
+
+/* Finds a variable in a set.
+ *  input:
+ *    set - the set to search.
+ *    text - the text of the variable.
+ *  output:
+ *    the variable, or NULL if it isn't in the set.
+ */
+variable *
+var_set_find (var_set_t * set, const unsigned char * text)
+{
+  int sym;
+
+  // A name without a symbol can't be in any set.
+  sym = symbol_find (text);
+  if (sym == -1)
+    return NULL;
+
+  return var_set_find_sym (set, sym);
+}
+
+/* Builds a branch from an existing branch, with one child replaced
+ * or added.  The other children are shared with the existing branch.
+ *  input:
+ *    old - the existing branch, or NULL to start a new one.
+ *    bit - the slot of the child.
+ *    child - the child, whose reference is taken by the new branch.
+ *  output:
+ *    the new branch, or NULL on memory error.
+ */
+static var_set_t *
+var_set_branch (var_set_t * old, unsigned int bit, var_set_t * child)
+{
+  var_set_t * branch;
+  int i, pos, num_children, replace;
+
+  branch = (var_set_t *) calloc (1, sizeof (var_set_t));
+  CHECK_ALLOC (branch, NULL);
+
+  branch->ref_count = 1;
+  branch->bitmap = old ? old->bitmap : 0;
+  replace = (branch->bitmap & bit) ? 1 : 0;
+  branch->bitmap |= bit;
+
+  num_children = var_set_count (branch->bitmap);
+  pos = var_set_count (branch->bitmap & (bit - 1));
+
+  branch->children = (var_set_t **) calloc (num_children,
+					    sizeof (var_set_t *));
+  CHECK_ALLOC (branch->children, NULL);
+
+  for (i = 0; i < num_children; i++)
+    {
+      if (i == pos)
+	branch->children[i] = child;
+      else
+	branch->children[i] =
+	  var_set_ref (old->children[(i > pos && !replace) ? i - 1 : i]);
+    }
+
+  return branch;
+}
+
+/* Inserts a leaf below a node, copying the path to it.
+ *  input:
+ *    node - the node to insert below, or NULL.
+ *    leaf - the leaf to insert, whose reference is taken.
+ *    shift - the position in the hash of the level of node.
+ *  output:
+ *    the new node, or NULL on memory error.
+ */
+static var_set_t *
+var_set_insert (var_set_t * node, var_set_t * leaf, int shift)
+{
+  var_set_t * child;
+  unsigned int bit;
+
+  if (!node)
+    return leaf;
+
+  if (node->var)
+    {
+      // Variables with the same hash are chained together.
+      if (node->hash == leaf->hash)
+	{
+	  leaf->next = var_set_ref (node);
+	  return leaf;
+	}
+
+      // Otherwise, push the existing leaf down a level.
+      bit = 1u << VAR_SET_SLOT (node->hash, shift);
+      child = var_set_branch (NULL, bit, var_set_ref (node));
+      if (!child)
+	return NULL;
+
+      node = var_set_insert (child, leaf, shift);
+      var_set_unref (child);
+      return node;
+    }
+
+  bit = 1u << VAR_SET_SLOT (leaf->hash, shift);
+  child = NULL;
+  if (node->bitmap & bit)
+    child = node->children[var_set_count (node->bitmap & (bit - 1))];
+
+  child = var_set_insert (child, leaf, shift + VAR_SET_BITS);
+  if (!child)
+    return NULL;
+
+  return var_set_branch (node, bit, child);
+}
+
+/* Adds a variable to a set by its symbol, unless the variable is already
+ * there.  The other references to the old set are unaffected.
+ *  input:
+ *    set - the set, which receives the new set.
+ *    sym - the symbol of the variable.
+ *    arbitrary - whether or not the variable is arbitrary.
+ *  output:
+ *    0 on success, 1 if the variable was already in the set,
+ *    -1 on memory error.
+ */
+int
+var_set_add_sym (var_set_t ** set, int sym, int arbitrary)
+{
+  var_set_t * leaf, * new_set;
+  variable * var;
+
+  if (var_set_find_sym (*set, sym))
+    return 1;
+
+  var = variable_init (NULL, arbitrary);
+  if (!var)
+    return -1;
+
+  var->sym = sym;
+  var->text = symbol_text (sym);
+
+  leaf = (var_set_t *) calloc (1, sizeof (var_set_t));
+  CHECK_ALLOC (leaf, -1);
+
+  leaf->var = var;
+  leaf->ref_count = 1;
+  leaf->hash = sym;
+
+  new_set = var_set_insert (*set, leaf, 0);
+  if (!new_set)
+    return -1;
+
+  var_set_unref (*set);
+  *set = new_set;
+
+  return 0;
+}
+
+/* Adds a variable to a set, unless a variable with the same text is
+ * already there.  The other references to the old set are unaffected.
+ *  input:
+ *    set - the set, which receives the new set.
+ *    text - the text of the variable.
+ *    arbitrary - whether or not the variable is arbitrary.
+ *  output:
+ *    0 on success, 1 if the variable was already in the set,
+ *    -1 on memory error.
+ */
+int
+var_set_add (var_set_t ** set, unsigned char * text, int arbitrary)
+{
+  int sym;
+
+  sym = symbol_intern (text, strlen ((const char *) text));
+  if (sym == -1)
+    return -1;
+
+  return var_set_add_sym (set, sym, arbitrary);
+}
+
+/* Lists the variables of a set.
+ *  input:
+ *    set - the set to list.
+ *    vars - receives a pointer to each variable, in no particular order.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+int
+var_set_list (var_set_t * set, vec_t * vars)
+{
+  int i, num_children, ret;
+
+  if (!set)
+    return 0;
+
+  if (set->var)
+    {
+      for (; set; set = set->next)
+	{
+	  ret = vec_add_obj (vars, &set->var);
+	  if (ret < 0)
+	    return -1;
+	}
+
+      return 0;
+    }
+
+  num_children = var_set_count (set->bitmap);
+  for (i = 0; i < num_children; i++)
+    {
+      ret = var_set_list (set->children[i], vars);
+      if (ret == -1)
+	return -1;
+    }
+
+  return 0;
+}
@@ -20,16 +20,41 @@
 #define ARIS_VAR_H
 
 typedef struct variable variable;
+typedef struct var_set var_set_t;
+typedef struct vector vec_t;
 
 // The variable structure.
 
 struct variable {
-  unsigned char * text;  // The text of the variable.
+  int sym;               // The symbol of the variable.
+  unsigned char * text;  // The text of the variable, which is shared.
   int arbitrary : 1;     // Whether or not the variable is arbitrary.
 };
 
+// A persistent set of variables.  A set is never changed once it has
+// been built; adding a variable builds a new set that shares everything
+// but the path to the new variable with the old one.  This makes taking
+// a snapshot of a set as cheap as taking a reference to it.  The empty
+// set is NULL.  A set is keyed by the symbols of its variables.
+
+struct var_set {
+  int ref_count;          // The amount of references to this node.
+  unsigned int hash;      // For leaves, the symbol of the variable.
+  variable * var;         // For leaves, the variable, or NULL for branches.
+  var_set_t * next;       // For leaves, another leaf with the same hash.
+  unsigned int bitmap;    // For branches, the slots that have children.
+  var_set_t ** children;  // For branches, the children, in slot order.
+};
 
 variable * variable_init (unsigned char * text,
 			  int arbitrary);
 
+var_set_t * var_set_ref (var_set_t * set);
+void var_set_unref (var_set_t * set);
+variable * var_set_find (var_set_t * set, const unsigned char * text);
+variable * var_set_find_sym (var_set_t * set, int sym);
+int var_set_add (var_set_t ** set, unsigned char * text, int arbitrary);
+int var_set_add_sym (var_set_t ** set, int sym, int arbitrary);
+int var_set_list (var_set_t * set, vec_t * vars);
+
 #endif /* ARIS_VAR_H */
@@ -23,6 +23,9 @@
 
 #include "vec.h"
 
+#define MEM_SUBSYSTEM MEM_STRUCTS
+#include "mem.h"
+
 /* Initializes a vector object.
  *  input:
  *    stuff_size - the size of the desired objects.
@@ -41,48 +44,117 @@ init_vec (const unsigned int stuff_size)
       return NULL;
     }
 
+  vec_init_local (v, stuff_size);
+
+  return v;
+}
+
+/* Initializes a vector in place, such as on the stack.  Until it grows
+ * past its own space, it allocates nothing.
+ *  input:
+ *    v - the vector to initialize.
+ *    stuff_size - the size of the desired objects.
+ *  output:
+ *    none.
+ */
+void
+vec_init_local (vec_t * v, const unsigned int stuff_size)
+{
   v->num_stuff = 0;
   v->size_stuff = stuff_size;
-  v->alloc_space = 1;
+  v->borrowed = 0;
+
+  v->alloc_space = sizeof (v->local) / stuff_size;
+  v->stuff = (v->alloc_space > 0) ? v->local : NULL;
+}
+
+/* Initializes a string vector in place that borrows its strings.  The
+ * strings are neither copied nor freed, so they must outlive it.
+ *  input:
+ *    v - the vector to initialize.
+ *  output:
+ *    none.
+ */
+void
+vec_init_borrowed (vec_t * v)
+{
+  vec_init_local (v, sizeof (char *));
+  v->borrowed = 1;
+}
+
+/* Makes room in a vector.
+ *  input:
+ *    v - the vector.
+ *    num - the amount of objects that it must have room for.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+static int
+vec_reserve (vec_t * v, unsigned int num)
+{
+  unsigned int new_space;
+  void * new_stuff;
+
+  // There is always room for one more object.
+  if (num < v->alloc_space)
+    return 0;
+
+  new_space = (v->alloc_space > 0) ? v->alloc_space : 1;
+  while (num >= new_space)
+    new_space *= 2;
+
+  if (v->stuff == v->local || !v->stuff)
+    {
+      new_stuff = malloc (new_space * v->size_stuff);
+      if (new_stuff && v->num_stuff > 0)
+	memcpy (new_stuff, v->stuff, v->num_stuff * v->size_stuff);
+    }
+  else
+    {
+      new_stuff = realloc (v->stuff, new_space * v->size_stuff);
+    }
 
-  v->stuff = calloc (1, stuff_size);
-  if (!v->stuff)
+  if (!new_stuff)
     {
       perror (NULL);
-      return NULL;
+      return -1;
     }
 
-  return v;
+  v->stuff = new_stuff;
+  v->alloc_space = new_space;
+
+  return 0;
 }
 
-/* Destroys a vector.
+/* Frees the stuff of a vector, without freeing the vector itself.
  *  input:
- *    v - the vector to destroy.
+ *    v - the vector to finish.
  *  output:
  *    none.
  */
 void
-destroy_vec (vec_t * v)
+vec_fini (vec_t * v)
 {
-  if (v->stuff)
+  if (v->stuff && v->stuff != v->local)
     free (v->stuff);
 
+  v->stuff = NULL;
   v->num_stuff = 0;
   v->alloc_space = 0;
   v->size_stuff = 0;
-  free (v);
 }
 
-/* Destroys a string vector.
+/* Frees the strings and stuff of a string vector, without freeing the
+ * vector itself.
  *  input:
- *    v - the vector to destroy.
+ *    v - the vector to finish.
  *  output:
  *    none.
  */
 void
-destroy_str_vec (vec_t * v)
+vec_str_fini (vec_t * v)
 {
-  if (v->stuff)
+  if (v->stuff && !v->borrowed)
     {
       int i;
       for (i = 0; i < v->num_stuff; i++)
@@ -94,13 +166,34 @@ destroy_str_vec (vec_t * v)
 	    free (cur_str);
 	  cur_str = NULL;
 	}
-
-      free (v->stuff);
     }
 
-  v->num_stuff = 0;
-  v->alloc_space = 0;
-  v->size_stuff = 0;
+  vec_fini (v);
+}
+
+/* Destroys a vector.
+ *  input:
+ *    v - the vector to destroy.
+ *  output:
+ *    none.
+ */
+void
+destroy_vec (vec_t * v)
+{
+  vec_fini (v);
+  free (v);
+}
+
+/* Destroys a string vector.
+ *  input:
+ *    v - the vector to destroy.
+ *  output:
+ *    none.
+ */
+void
+destroy_str_vec (vec_t * v)
+{
+  vec_str_fini (v);
   free (v);
 }
 
@@ -116,19 +209,10 @@ vec_add_obj (vec_t * v, const void * more)
 {
   assert (more != NULL);
 
-  v->num_stuff++; 
+  if (vec_reserve (v, v->num_stuff + 1) < 0)
+    return -1;
 
-  if (v->alloc_space == v->num_stuff)
-    {
-      v->alloc_space *= 2;
-
-      v->stuff = realloc (v->stuff, v->alloc_space * v->size_stuff);
-      if (!v->stuff)
-	{
-	  perror (NULL);
-	  return -1;
-	}
-    }
+  v->num_stuff++;
 
   memcpy (v->stuff + ((v->num_stuff - 1) * v->size_stuff),
 	  more, v->size_stuff);
@@ -136,7 +220,8 @@ vec_add_obj (vec_t * v, const void * more)
   return 0;
 }
 
-/* Adds a new string to a string vector.
+/* Adds a new string to a string vector.  A vector that borrows its
+ * strings adds more itself.
  *  input:
  *    v - the string vector.
  *    more - the new string.
@@ -146,21 +231,11 @@ vec_add_obj (vec_t * v, const void * more)
 int
 vec_str_add_obj (vec_t * v, unsigned char * more)
 {
-  v->num_stuff++;
+  unsigned char * obj;
 
-  if (v->alloc_space == v->num_stuff)
-    {
-      v->alloc_space *= 2;
+  if (v->borrowed)
+    return vec_add_obj (v, &more);
 
-      v->stuff = realloc (v->stuff, v->alloc_space * sizeof (char *));
-      if (!v->stuff)
-	{
-	  perror (NULL);
-	  return -1;
-	}
-    }
-
-  unsigned char * obj;
   obj = (unsigned char *) calloc (strlen (more) + 1, sizeof (char));
   if (!obj)
     {
@@ -169,15 +244,30 @@ vec_str_add_obj (vec_t * v, unsigned char * more)
     }
 
   strcpy (obj, more);
-  memcpy (v->stuff + ((v->num_stuff - 1) * sizeof (char *)),
-	  &obj, sizeof (char *));
 
-  unsigned char * new_obj;
-  new_obj = vec_str_nth (v, v->num_stuff - 1);
+  if (vec_add_obj (v, &obj) < 0)
+    {
+      free (obj);
+      return -1;
+    }
 
   return 0;
 }
 
+/* Adds a string to a string vector without copying it.  The vector
+ * then owns the string, unless it borrows its strings.
+ *  input:
+ *    v - the string vector.
+ *    more - the new string.
+ *  output:
+ *    0 on success, -1 on memory error.
+ */
+int
+vec_str_take_obj (vec_t * v, unsigned char * more)
+{
+  return vec_add_obj (v, &more);
+}
+
 /* Removes an object from the end of a vector.
  *  input:
  *    v - the vector from which to remove the end element.
@@ -193,6 +283,41 @@ vec_pop_obj (vec_t * v)
   v->num_stuff--;
 }
 
+/* Replaces a range of objects in a vector with other objects.
+ *  input:
+ *    v - the vector to modify.
+ *    pos - the index of the first object to replace.
+ *    num_rem - the amount of objects to remove.
+ *    more - the objects to insert in their place.
+ *    num_more - the amount of objects to insert.
+ *  output:
+ *    0 on success, -1 on error.
+ */
+int
+vec_splice (vec_t * v, int pos, int num_rem, const void * more, int num_more)
+{
+  unsigned int new_num, num_tail;
+
+  assert (pos >= 0 && pos + num_rem <= v->num_stuff);
+
+  new_num = v->num_stuff - num_rem + num_more;
+  num_tail = v->num_stuff - pos - num_rem;
+
+  if (vec_reserve (v, new_num) < 0)
+    return -1;
+
+  memmove (v->stuff + (pos + num_more) * v->size_stuff,
+	   v->stuff + (pos + num_rem) * v->size_stuff,
+	   num_tail * v->size_stuff);
+
+  if (num_more > 0)
+    memcpy (v->stuff + pos * v->size_stuff, more, num_more * v->size_stuff);
+
+  v->num_stuff = new_num;
+
+  return 0;
+}
+
 /* Clears a vector.
  *  input:
  *    vec - the vector to clear.
@@ -202,15 +327,13 @@ vec_pop_obj (vec_t * v)
 int
 vec_clear (vec_t * vec)
 {
-  free (vec->stuff);
-  vec->num_stuff = 0;
-  vec->alloc_space = 1;
-  vec->stuff = calloc (1, vec->size_stuff);
-  if (!vec->stuff)
-    {
-      perror (NULL);
-      return -1;
-    }
+  unsigned int size_stuff = vec->size_stuff;
+  int borrowed = vec->borrowed;
+
+  vec_fini (vec);
+  vec_init_local (vec, size_stuff);
+  vec->borrowed = borrowed;
+
   return 0;
 }
 
@@ -21,7 +21,12 @@
 
 typedef struct vector vec_t;
 
-// The vector data structure.
+// The amount of pointers that fit in a vector without allocating.
+
+#define VEC_LOCAL_NUM 4
+
+// The vector data structure.  The stuff of a short vector is kept in
+// the vector itself, so a vector must not be copied or moved.
 
 struct vector
 {
@@ -31,15 +36,25 @@ struct vector
   unsigned int alloc_space;  //The allocated space.
 
   void * stuff;              //The stuff.
+
+  int borrowed;              //Whether strings are borrowed, not copied.
+  void * local[VEC_LOCAL_NUM];  //The space for the stuff of a short vector.
 };
 
 
 vec_t * init_vec (const unsigned int stuff_size);
+void vec_init_local (vec_t * v, const unsigned int stuff_size);
+void vec_init_borrowed (vec_t * v);
 void destroy_vec (vec_t * v);
 void destroy_str_vec (vec_t * v);
+void vec_fini (vec_t * v);
+void vec_str_fini (vec_t * v);
 int vec_add_obj (vec_t * v , const void * more);
 int vec_str_add_obj (vec_t * v, unsigned char * more);
+int vec_str_take_obj (vec_t * v, unsigned char * more);
 void vec_pop_obj (vec_t * v);
+int vec_splice (vec_t * v, int pos, int num_rem, const void * more,
+		int num_more);
 int vec_clear (vec_t * vec);
 void * vec_nth (vec_t * vec, int n);
 unsigned char * vec_str_nth (vec_t * vec, int n);
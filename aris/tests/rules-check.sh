@@ -0,0 +1,61 @@
+#!/bin/sh
+# Checks the rules against a list of cases.
+
+#  Copyright (C) 2012 Ian Dunn.
+
+#  This program is free software: you can redistribute it and/or modify
+#  it under the terms of the GNU General Public License as published by
+#  the Free Software Foundation, either version 3 of the License, or
+#  (at your option) any later version.
+
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+
+#  You should have received a copy of the GNU General Public License
+#  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# Usage: rules-check.sh ARIS CASES
+#
+# Each line of CASES is a rule, its premises separated by ';', a
+# conclusion and the message that ARIS must print, separated by tabs.
+# The sentences use the connectives of the command line.  Empty lines,
+# and lines that begin with '#', are skipped.  The check fails if any
+# case prints another message.
+
+aris=$1
+cases=$2
+
+tab=`printf '\t'`
+status=0
+num=0
+failed=0
+
+while IFS="$tab" read -r rule prems conc expect; do
+  case "$rule" in
+    ''|'#'*) continue ;;
+  esac
+
+  num=`expr $num + 1`
+
+  set -- -e
+  old_ifs=$IFS
+  IFS=';'
+  for prem in $prems; do
+    IFS=$old_ifs
+    prem=`echo "$prem" | sed 's/^ *//; s/ *$//'`
+    set -- "$@" -p "$prem"
+  done
+  IFS=$old_ifs
+
+  out=`"$aris" "$@" -r "$rule" -c "$conc" 2>&1`
+  if test "x$out" != "x$expect"; then
+    echo "rules-check: $rule: $prems |- $conc: got '$out', expected '$expect'"
+    failed=`expr $failed + 1`
+    status=1
+  fi
+done < "$cases"
+
+echo "rules-check: $failed of $num cases failed"
+exit $status